@@ -0,0 +1,84 @@
+#ifndef ANEL_IO_H
+#define ANEL_IO_H
+
+#include <linux/io_uring.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+// Anel io_uring mínimo, sobre as chamadas de sistema diretas (sem liburing).
+// Pedidos são enfileirados na fila de submissão e vão ao kernel todos juntos
+// em anel_submeter, que na mesma chamada espera pelas conclusões. A recepção
+// usa um grupo de buffers fornecidos: o kernel escolhe o buffer de cada
+// leitura, então conexões paradas não prendem memória.
+// Não é thread-safe: cada anel pertence a uma única thread.
+
+// Conclusão de um pedido
+typedef struct {
+	uint64_t dados;   // user_data do pedido
+	int32_t resultado;
+	uint32_t flags;   // IORING_CQE_F_*
+} EventoAnel;
+
+typedef struct {
+	int fd;
+
+	// Fila de submissão
+	unsigned* sq_cabeca;
+	unsigned* sq_cauda;
+	unsigned* sq_indices;
+	unsigned sq_mascara;
+	unsigned sq_entradas;
+	struct io_uring_sqe* sqes;
+	unsigned sq_cauda_local;  // Pedidos preparados e ainda não publicados ao kernel
+
+	// Fila de conclusão
+	unsigned* cq_cabeca;
+	unsigned* cq_cauda;
+	unsigned cq_mascara;
+	struct io_uring_cqe* cqes;
+
+	void* mapa_sq;
+	size_t tamanho_mapa_sq;
+	void* mapa_cq;
+	size_t tamanho_mapa_cq;
+	size_t tamanho_mapa_sqes;
+
+	// Buffers fornecidos para a recepção (grupo 0)
+	struct io_uring_buf_ring* anel_buffers;
+	uint8_t* buffers;
+	unsigned num_buffers;
+	size_t tamanho_buffer;
+	uint16_t buffers_cauda;
+
+	unsigned em_voo;  // Pedidos preparados cuja última conclusão ainda não chegou
+} AnelIO;
+
+// Cria o anel desabilitado; a thread dona chama anel_habilitar antes de
+// submeter. Retorna false se o kernel não tem io_uring ou algum recurso
+// necessário (buffers fornecidos, espera com timeout).
+bool anel_inicializar(AnelIO* anel, unsigned entradas, unsigned num_buffers, size_t tamanho_buffer);
+bool anel_habilitar(AnelIO* anel);
+
+// Preparam um pedido; vai ao kernel no próximo anel_submeter
+void anel_aceitar_multishot(AnelIO* anel, int socket, uint64_t dados);
+void anel_receber_multishot(AnelIO* anel, int socket, uint64_t dados);
+void anel_enviar(AnelIO* anel, int socket, const struct msghdr* mensagem, uint64_t dados);
+void anel_ler(AnelIO* anel, int fd, void* buffer, size_t tamanho, uint64_t dados);
+// Cancela todos os pedidos do anel; cada um termina com -ECANCELED (ou com o
+// resultado, se já tinha acontecido) e o próprio cancelamento gera uma conclusão
+void anel_cancelar_todos(AnelIO* anel, uint64_t dados);
+
+// Submete os pedidos preparados e espera ao menos uma conclusão ou
+// timeout_ms (-1 = sem limite). Retorna false em erro do io_uring_enter.
+bool anel_submeter(AnelIO* anel, int timeout_ms);
+
+// Retira a próxima conclusão; false se não há nenhuma
+bool anel_proximo(AnelIO* anel, EventoAnel* evento);
+
+// Buffer de uma recepção concluída (IORING_CQE_F_BUFFER) e sua devolução ao kernel
+uint8_t* anel_buffer(AnelIO* anel, uint32_t flags);
+void anel_devolver_buffer(AnelIO* anel, uint32_t flags);
+
+#endif  // ANEL_IO_H
@@ -0,0 +1,50 @@
+#ifndef CACHE_LOBBY_H
+#define CACHE_LOBBY_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "diretorio_salas.h"
+#include "fila_saida.h"
+
+// Páginas de MSG_LISTAR_SALAS já codificadas. Enquanto a versão do diretório
+// não muda, todos os clientes que pedem a mesma página recebem o mesmo buffer
+// (uma codificação, nenhuma cópia por conexão); qualquer mudança de sala
+// invalida o cache e a próxima requisição de cada página a recodifica.
+//
+// As páginas de uma versão formam um conjunto imutável com contagem de
+// referências, publicado por troca atômica de ponteiro. Um acerto não toma
+// lock: só lê o ponteiro atual e retém o conjunto. Uma falta codifica a página
+// sob o mutex e publica um conjunto novo com ela; o antigo é solto depois que
+// os leitores que podiam estar pegando o ponteiro velho saem (dois contadores
+// alternados, como num período de graça do RCU).
+#define CACHE_LOBBY_MAX_PAGINAS 64
+
+typedef struct {
+	PedidoListaSalas pedido;
+	BufferCompartilhado* quadros[2];  // [0] estrutura legada, [1] quadro compacto
+} PaginaLobby;
+
+typedef struct {
+	_Atomic uint32_t referencias;  // Uma do cache enquanto publicado, mais uma por leitor
+	uint64_t versao;               // Versão do diretório usada para codificar as páginas
+	int num_paginas;
+	PaginaLobby paginas[];
+} ConjuntoPaginas;
+
+typedef struct {
+	pthread_mutex_t mutex;  // Serializa só a recodificação
+	_Atomic(ConjuntoPaginas*) atual;
+	_Atomic uint32_t fase;
+	_Atomic uint32_t leitores[2];  // Leitores pegando o ponteiro, por fase
+} CacheLobby;
+
+void cache_lobby_inicializar(CacheLobby* cache);
+// Quadro pronto da página pedida, com uma referência que passa ao chamador
+BufferCompartilhado* cache_lobby_obter(CacheLobby* cache, DiretorioSalas* diretorio,
+                                       const PedidoListaSalas* pedido, bool compacto);
+
+#endif  // CACHE_LOBBY_H
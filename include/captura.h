@@ -0,0 +1,52 @@
+#ifndef CAPTURA_H
+#define CAPTURA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common.h"
+
+// Captura do tráfego de entrada do servidor (--captura=ARQUIVO) para ser
+// reproduzido por truco_trafego. O arquivo começa com [u32 CAPTURA_MAGICA] e
+// segue com registros:
+//
+//   [u8 TipoRegistroCaptura] [varint conexão] [varint µs desde o início da captura] [conteúdo]
+//
+// Conteúdo: MENSAGEM = [varint tamanho] [quadro compacto]; SALA = [varint sala_id]
+// criada pela conexão; ABERTURA e FECHAMENTO não têm conteúdo. A conexão é o
+// id do cliente no servidor. Registros de workers diferentes podem chegar
+// levemente fora de ordem de tempo.
+#define CAPTURA_MAGICA 0x50414354u  // "TCAP"
+
+typedef enum {
+	CAPTURA_ABERTURA = 0,
+	CAPTURA_MENSAGEM = 1,
+	CAPTURA_SALA = 2,  // Resposta de MSG_CRIAR_SALA: id que o servidor atribuiu
+	CAPTURA_FECHAMENTO = 3
+} TipoRegistroCaptura;
+
+typedef struct {
+	TipoRegistroCaptura tipo;
+	uint32_t conexao;
+	uint64_t instante_us;
+	uint32_t sala_id;  // CAPTURA_SALA
+	Mensagem msg;      // CAPTURA_MENSAGEM
+	const uint8_t* quadro;  // CAPTURA_MENSAGEM: quadro compacto dentro do buffer lido
+	size_t tamanho_quadro;
+} RegistroCaptura;
+
+// Abre o arquivo e inicia a thread que o grava; sem captura as funções abaixo não fazem nada
+bool captura_abrir_arquivo(const char* caminho);
+bool captura_ativa(void);
+
+void captura_abertura(uint32_t conexao);
+void captura_mensagem(uint32_t conexao, const Mensagem* msg);
+void captura_sala(uint32_t conexao, uint32_t sala_id);
+void captura_fechamento(uint32_t conexao);
+
+// Leitura de um arquivo carregado em memória: 1 com o próximo registro,
+// 0 no fim e -1 se está corrompido ou truncado. *posicao começa em 0.
+int captura_proximo_registro(const uint8_t* dados, size_t tamanho, size_t* posicao, RegistroCaptura* registro);
+
+#endif  // CAPTURA_H
@@ -54,7 +54,12 @@ typedef enum {
 	MSG_ERRO = 15,
 	MSG_DESCONECTAR = 16,
 	MSG_IR_BARALHO = 17,
-	MSG_SAIR_SALA = 18
+	MSG_SAIR_SALA = 18,
+	MSG_ESTADO_DELTA = 19,  // Apenas campos de EstadoJogo que mudaram (ver protocolo.h)
+	MSG_ASSINAR_LOBBY = 20, // dados[0] = 1 assina, 0 cancela os eventos do lobby
+	MSG_EVENTOS_LOBBY = 21, // Lote de EventoLobby enviado a cada tick aos assinantes
+	MSG_PING = 22,          // Heartbeat (CAP_HEARTBEAT); quem recebe responde MSG_PONG
+	MSG_PONG = 23
 } TipoMensagem;
 
 // Respostas ao truco
@@ -99,6 +104,27 @@ typedef struct {
 	uint8_t em_partida;
 } InfoSala;
 
+// Pedido paginado de MSG_LISTAR_SALAS, enviado em dados (pedido vazio lista a
+// primeira página sem filtro). Cada resposta traz uma página de InfoSala e, em
+// sala_id, o cursor da próxima página (0 = fim da lista).
+typedef struct {
+	uint32_t cursor;         // 0 na primeira página
+	uint8_t apenas_abertas;  // Só salas aguardando jogador e sem partida em andamento
+	char prefixo[59];        // Prefixo do nome; vazio aceita qualquer sala
+} PedidoListaSalas;
+
+// Mudança em uma sala, enviada em lote por MSG_EVENTOS_LOBBY
+typedef enum {
+	LOBBY_SALA_ADICIONADA = 0,
+	LOBBY_SALA_ATUALIZADA = 1,
+	LOBBY_SALA_REMOVIDA = 2  // Apenas sala.id é significativo
+} TipoEventoLobby;
+
+typedef struct {
+	uint8_t tipo;  // TipoEventoLobby
+	InfoSala sala;
+} EventoLobby;
+
 // Estado do jogo para enviar ao cliente
 typedef struct {
 	uint8_t pontos_jogador1;
@@ -126,6 +152,7 @@ typedef struct {
 // Funções auxiliares
 const char* naipe_para_string(Naipe naipe);
 const char* numero_para_string(NumeroCarta numero);
+const char* tipo_mensagem_para_string(TipoMensagem tipo);
 void imprimir_carta(Carta carta);
 
 #endif  // COMMON_H
@@ -0,0 +1,51 @@
+#ifndef DIRETORIO_SALAS_H
+#define DIRETORIO_SALAS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "common.h"
+
+// Diretório de salas para o lobby: uma entrada por slot do pool de salas,
+// atualizada quando a sala é criada, recebe ou perde jogadores, inicia ou
+// termina a partida. Cada entrada é um seqlock: escritores se serializam pelo
+// contador e leitores (MSG_LISTAR_SALAS) copiam sem lock, repetindo a leitura
+// se ela coincidir com uma escrita. Blocos de entradas são alocados sob
+// demanda e nunca liberados. Um bitmap de slots alterados alimenta os
+// eventos incrementais do lobby (ver diretorio_coletar_alterados).
+#define DIRETORIO_ENTRADAS_POR_BLOCO 1024
+
+typedef struct {
+	_Atomic uint32_t sequencia;  // Ímpar enquanto uma escrita está em andamento
+	bool ocupada;
+	InfoSala info;
+} EntradaDiretorio;
+
+typedef struct {
+	uint32_t capacidade;
+	_Atomic(EntradaDiretorio*)* blocos;
+	_Atomic uint32_t limite;  // Maior slot já publicado + 1
+	_Atomic uint64_t versao;  // Incrementada a cada publicação ou remoção
+	_Atomic uint64_t* alterados;  // Um bit por slot, ligado a cada escrita
+} DiretorioSalas;
+
+bool diretorio_inicializar(DiretorioSalas* diretorio, uint32_t capacidade);
+void diretorio_publicar(DiretorioSalas* diretorio, uint32_t slot, const InfoSala* info);
+void diretorio_remover(DiretorioSalas* diretorio, uint32_t slot);
+uint64_t diretorio_versao(DiretorioSalas* diretorio);
+// Cópia consistente da entrada; false se o slot está vazio
+bool diretorio_ler(DiretorioSalas* diretorio, uint32_t slot, InfoSala* info);
+
+// Visita e desmarca cada slot escrito desde a coleta anterior. Apenas um
+// coletor por vez; escritas concorrentes reaparecem na próxima coleta.
+typedef void (*VisitanteDiretorio)(uint32_t slot, void* contexto);
+void diretorio_coletar_alterados(DiretorioSalas* diretorio, VisitanteDiretorio visitar, void* contexto);
+
+// Copia até 'max' salas aceitas pelo filtro (NULL aceita todas), começando no
+// slot *cursor. Ao retornar, *cursor é onde a próxima página começa, ou 0 se
+// não há mais salas.
+int diretorio_listar(DiretorioSalas* diretorio, uint32_t* cursor, const PedidoListaSalas* filtro,
+                     InfoSala* saida, int max);
+
+#endif  // DIRETORIO_SALAS_H
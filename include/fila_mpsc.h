@@ -0,0 +1,25 @@
+#ifndef FILA_MPSC_H
+#define FILA_MPSC_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// Fila intrusiva lock-free com múltiplos produtores e um único consumidor
+// (algoritmo de Vyukov). O nó deve ser o primeiro campo da estrutura enfileirada.
+typedef struct NoFilaMpsc {
+	_Atomic(struct NoFilaMpsc*) proximo;
+} NoFilaMpsc;
+
+typedef struct {
+	_Atomic(NoFilaMpsc*) cabeca;  // Último nó inserido (produtores)
+	NoFilaMpsc* cauda;            // Próximo nó a remover (consumidor)
+	NoFilaMpsc stub;
+} FilaMpsc;
+
+void fila_mpsc_inicializar(FilaMpsc* fila);
+// Pode ser chamada por qualquer thread
+void fila_mpsc_inserir(FilaMpsc* fila, NoFilaMpsc* no);
+// Apenas a thread consumidora; retorna NULL se vazia (ou se um produtor ainda está inserindo)
+NoFilaMpsc* fila_mpsc_remover(FilaMpsc* fila);
+
+#endif  // FILA_MPSC_H
@@ -0,0 +1,98 @@
+#ifndef FILA_SAIDA_H
+#define FILA_SAIDA_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "fila_mpsc.h"
+
+// Fila de saída de uma conexão: quadros pequenos são acumulados em blocos
+// contíguos e a fila inteira é enviada com uma única chamada sendmsg (writev).
+// Qualquer thread entrega quadros sem lock (fila MPSC de entrada); só a thread
+// escritora da conexão descarrega, e é ela quem passa os quadros para os blocos.
+#define FILA_SAIDA_TAMANHO_BLOCO 4096
+#define FILA_SAIDA_MAX_IOV 64
+
+// Quadro imutável enfileirado em várias conexões sem cópia (ex.: páginas do
+// lobby); liberado quando a última fila o consome
+typedef struct {
+	_Atomic int referencias;
+	size_t tamanho;
+	uint8_t dados[];
+} BufferCompartilhado;
+
+typedef struct {
+	uint8_t* dados;
+	size_t tamanho;
+	size_t capacidade;
+	BufferCompartilhado* compartilhado;  // Dono de dados, se o segmento não é um bloco próprio
+} SegmentoSaida;
+
+// Quadro entregue por outra thread, ainda fora dos blocos
+typedef struct {
+	NoFilaMpsc no;
+	BufferCompartilhado* compartilhado;  // Se não é NULL, o conteúdo é dele
+	size_t tamanho;
+	uint8_t dados[];
+} QuadroSaida;
+
+typedef struct {
+	// Produtores (qualquer thread)
+	FilaMpsc entrada;
+	_Atomic uint32_t quadros_entrada;  // Incrementado antes de cada inserção
+	_Atomic size_t bytes_pendentes;    // Entregues e ainda não escritos no socket
+
+	// Thread escritora
+	SegmentoSaida* segmentos;
+	int num_segmentos;
+	int capacidade_segmentos;
+	size_t enviado;  // Bytes do primeiro segmento já enviados
+	size_t total;    // Bytes ainda pendentes em toda a fila
+	uint64_t bytes_enviados;  // Escritos no socket desde a inicialização
+} FilaSaida;
+
+// Resultado de fila_saida_descarregar
+typedef enum {
+	DESCARGA_COMPLETA = 0,  // Fila vazia
+	DESCARGA_PENDENTE = 1,  // Socket cheio (EAGAIN); tentar de novo no próximo EPOLLOUT
+	DESCARGA_ERRO = -1      // Conexão com erro ou fechada
+} ResultadoDescarga;
+
+void fila_saida_inicializar(FilaSaida* fila);
+// Descarta tudo; ninguém mais pode estar entregando quadros
+void fila_saida_limpar(FilaSaida* fila);
+
+// Entregam um quadro a partir de qualquer thread. Retornam true se a fila de
+// entrada estava vazia: o chamador deve acordar a thread escritora.
+bool fila_saida_enviar(FilaSaida* fila, const void* dados, size_t tamanho);
+// Enfileira o buffer sem copiar; a fila fica com uma referência própria
+bool fila_saida_enviar_compartilhado(FilaSaida* fila, BufferCompartilhado* buffer);
+
+// Bytes entregues que ainda não foram escritos; lido por qualquer thread para
+// limitar a fila de um cliente lento
+size_t fila_saida_pendente(FilaSaida* fila);
+
+// Só a thread escritora: junta os quadros entregues e envia sem bloquear
+ResultadoDescarga fila_saida_descarregar(FilaSaida* fila, int socket);
+
+// Envio feito por outro mecanismo (io_uring), também só pela thread escritora:
+// preparar junta os quadros entregues e aponta até max_iov vetores para o que
+// falta enviar, sem consumir nada (0 = fila vazia); os dados apontados não
+// mudam até confirmar os bytes efetivamente escritos
+int fila_saida_preparar(FilaSaida* fila, struct iovec* iov, int max_iov);
+void fila_saida_confirmar(FilaSaida* fila, size_t bytes);
+
+// Com a thread escritora parada: junta os quadros entregues e copia até
+// `capacidade` bytes do que falta enviar, sem consumir. Retorna o total
+// pendente, que pode ser maior que o copiado.
+size_t fila_saida_copiar(FilaSaida* fila, uint8_t* destino, size_t capacidade);
+
+// Cria com uma referência, do chamador
+BufferCompartilhado* buffer_compartilhado_criar(const void* dados, size_t tamanho);
+void buffer_compartilhado_reter(BufferCompartilhado* buffer);
+void buffer_compartilhado_liberar(BufferCompartilhado* buffer);
+
+#endif  // FILA_SAIDA_H
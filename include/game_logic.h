@@ -2,9 +2,29 @@
 #define GAME_LOGIC_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "common.h"
 
+// Índice compacto de carta (0-39): naipe * 10 + posição do número em
+// {1, 2, 3, 4, 5, 6, 7, 10, 11, 12}. Cabe em 6 bits; CARTA_INVALIDA (40)
+// representa cartas fora do baralho e tem valor 0 em todas as tabelas.
+typedef uint8_t IndiceCarta;
+#define CARTA_INVALIDA 40
+
+// Mão como conjunto de bits: bit i ligado se a carta de índice i está na mão.
+// Os bits de um naipe são contíguos (naipe * 10 até naipe * 10 + 9).
+typedef uint64_t MascaraMao;
+#define MASCARA_NAIPE(naipe) (0x3FFull << ((naipe) * 10))
+#define MASCARA_BARALHO ((1ull << 40) - 1)
+
+// Gerador pseudoaleatório de cada jogo (xoshiro256**). Cada partida tem seu
+// próprio estado: embaralhar não compartilha lock nem sequência com outras
+// salas, e a mesma semente reproduz as mesmas distribuições.
+typedef struct {
+	uint64_t s[4];
+} GeradorAleatorio;
+
 // Estrutura do baralho
 typedef struct {
 	Carta cartas[40];
@@ -33,6 +53,8 @@ typedef struct {
 // Estrutura do jogo
 typedef struct {
 	uint32_t sala_id;
+	uint64_t semente;  // Semente da partida (reproduz todas as distribuições)
+	GeradorAleatorio gerador;
 	Jogador jogador1;
 	Jogador jogador2;
 	Baralho baralho;
@@ -60,16 +82,29 @@ typedef struct {
 	int vencedor_partida;
 } Jogo;
 
+// Gerador aleatório
+void gerador_semear(GeradorAleatorio* gerador, uint64_t semente);
+uint64_t gerador_proximo(GeradorAleatorio* gerador);
+// Inteiro uniforme em [0, limite)
+uint32_t gerador_intervalo(GeradorAleatorio* gerador, uint32_t limite);
+// Mistura (splitmix64): deriva sementes independentes de um contador
+uint64_t misturar_semente(uint64_t valor);
+
 // Funções do baralho
 void inicializar_baralho(Baralho* baralho);
-void embaralhar(Baralho* baralho);
+void embaralhar(Baralho* baralho, GeradorAleatorio* gerador);
 Carta pegar_carta(Baralho* baralho);
 
 // Funções do jogo
-void inicializar_jogo(Jogo* jogo, uint32_t sala_id);
+void inicializar_jogo(Jogo* jogo, uint32_t sala_id, uint64_t semente);
 void distribuir_cartas(Jogo* jogo);
 void nova_mao(Jogo* jogo);
 
+// Conversão entre Carta e a representação compacta
+IndiceCarta carta_para_indice(Carta carta);
+Carta indice_para_carta(IndiceCarta indice);
+MascaraMao mascara_mao(const Carta* cartas, int num_cartas);
+
 // Funções de comparação de cartas
 int obter_valor_carta_truco(Carta carta);
 int comparar_cartas_truco(Carta c1, Carta c2);
@@ -104,4 +139,12 @@ bool verificar_fim_partida(Jogo* jogo);
 // Função para obter estado do jogo para um jogador
 EstadoJogo obter_estado_jogo(Jogo* jogo, int jogador);
 
+// Forma compacta e de tamanho fixo do jogo, para passar uma partida em
+// andamento a outro processo: cartas como IndiceCarta, contadores em um byte
+// e as flags num campo de bits. O nome dos jogadores não faz parte do jogo.
+#define JOGO_TAMANHO_SERIALIZADO 132
+void jogo_serializar(const Jogo* jogo, uint8_t* saida);
+// false se os dados não formam um jogo válido
+bool jogo_desserializar(Jogo* jogo, const uint8_t* dados);
+
 #endif  // GAME_LOGIC_H
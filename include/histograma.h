@@ -0,0 +1,37 @@
+#ifndef HISTOGRAMA_H
+#define HISTOGRAMA_H
+
+#include <stdint.h>
+
+// Histograma log-linear de valores inteiros (ex.: latências em microssegundos).
+// Até 63 cada valor tem seu balde; acima disso cada potência de 2 é dividida
+// em 32 baldes, então o erro relativo de um percentil fica abaixo de 3%.
+// Não é thread-safe: cada thread registra no seu e os resultados são somados.
+#define HISTOGRAMA_BITS_SUBBALDE 5
+#define HISTOGRAMA_SUBBALDES (1 << HISTOGRAMA_BITS_SUBBALDE)
+#define HISTOGRAMA_MAX_EXPOENTE 40  // Valores acima de 2^40 caem no último balde
+#define HISTOGRAMA_NUM_BALDES ((HISTOGRAMA_MAX_EXPOENTE - HISTOGRAMA_BITS_SUBBALDE + 1) * HISTOGRAMA_SUBBALDES)
+
+typedef struct {
+	uint64_t baldes[HISTOGRAMA_NUM_BALDES];
+	uint64_t total;
+	uint64_t soma;
+	uint64_t minimo;
+	uint64_t maximo;
+} Histograma;
+
+// Balde de um valor e maior valor que cabe no balde. Cada potência de 2 começa
+// um balde novo, então contagens "até 2^k" são exatas.
+int histograma_indice_balde(uint64_t valor);
+uint64_t histograma_limite_balde(int indice);
+
+void histograma_zerar(Histograma* histograma);
+void histograma_registrar(Histograma* histograma, uint64_t valor);
+// Acumula `origem` em `destino`
+void histograma_somar(Histograma* destino, const Histograma* origem);
+// Menor valor v tal que ao menos `percentil`% das amostras são <= v
+// (limite superior do balde, nunca acima do máximo registrado); 0 se vazio
+uint64_t histograma_percentil(const Histograma* histograma, double percentil);
+double histograma_media(const Histograma* histograma);
+
+#endif  // HISTOGRAMA_H
@@ -0,0 +1,27 @@
+#ifndef KEEPALIVE_H
+#define KEEPALIVE_H
+
+#include <stdint.h>
+
+// Heartbeat padrão (--heartbeat) e, sem --timeout-ocioso, o timeout de
+// ociosidade: três intervalos sem nenhum quadro
+#define INTERVALO_PING_PADRAO_MS 15000
+#define TIMEOUT_OCIOSO_PADRAO_MS (3 * INTERVALO_PING_PADRAO_MS)
+
+// Keepalive do TCP para clientes sem CAP_HEARTBEAT, em segundos. O kernel
+// desiste depois de ocioso + tentativas * intervalo, e essa soma fica igual
+// ao timeout de ociosidade. O tempo ocioso domina: as sondas só começam perto
+// do fim, então conexões paradas não geram tráfego constante.
+#define KEEPALIVE_TENTATIVAS 3
+
+typedef struct {
+	int ocioso;      // TCP_KEEPIDLE
+	int intervalo;   // TCP_KEEPINTVL
+	int tentativas;  // TCP_KEEPCNT
+} ParametrosKeepalive;
+
+// O intervalo do heartbeat só limita o intervalo entre sondas por cima.
+// Cada valor tem no mínimo 1 s (a resolução do TCP_KEEP*).
+ParametrosKeepalive keepalive_calcular(uint64_t timeout_ocioso_ms, uint64_t intervalo_ping_ms);
+
+#endif  // KEEPALIVE_H
@@ -0,0 +1,62 @@
+#ifndef METRICAS_H
+#define METRICAS_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "common.h"
+
+// Métricas do servidor no formato texto do Prometheus, servidas por HTTP.
+// Contadores e histogramas ficam em fragmentos: cada thread escreve sempre no
+// mesmo fragmento, escolhido no primeiro registro, com adições atômicas
+// relaxadas e sem lock. Os workers epoll ficam com um fragmento cada; no modo
+// de uma thread por conexão várias threads dividem o mesmo. A coleta soma
+// todos os fragmentos, então os valores são aproximadamente simultâneos.
+#define METRICAS_NUM_FRAGMENTOS 16
+#define METRICAS_NUM_TIPOS (MSG_PONG + 2)  // O último conta tipos desconhecidos
+
+typedef enum {
+	MUTEX_SALAS,     // salas_mutex
+	MUTEX_CLIENTES,  // clientes_mutex
+	NUM_MUTEX_MEDIDOS
+} MutexMedido;
+
+uint64_t metricas_agora_ns(void);
+
+void metricas_conexao_aceita(void);
+void metricas_mensagem_recebida(TipoMensagem tipo, size_t bytes);
+void metricas_mensagem_enviada(TipoMensagem tipo);
+void metricas_bytes_enviados(size_t bytes);
+// Tempo de processar_mensagem para uma mensagem do tipo
+void metricas_processamento(TipoMensagem tipo, uint64_t nanossegundos);
+
+// Tempo de um comando na caixa da sala, da entrega até o executor começar a tratá-lo
+void metricas_espera_sala(uint64_t nanossegundos);
+
+// Proteção contra clientes lentos: fila de saída passou do limite, EstadoJogo
+// não enviado porque o cliente estava atrasado e conexão derrubada pelo atraso
+void metricas_cliente_lento(void);
+void metricas_estado_descartado(void);
+void metricas_desconexao_por_atraso(void);
+
+// Conexão encerrada por falta de atividade e turno decidido por prazo esgotado
+void metricas_desconexao_ociosa(void);
+void metricas_turno_expirado(void);
+void metricas_sessao_retomada(void);
+
+// pthread_mutex_lock que registra o tempo de espera; sem disputa custa um trylock
+void metricas_travar(pthread_mutex_t* mutex, MutexMedido qual);
+
+// Escreve métricas instantâneas do chamador (gauges) ao fim de cada coleta
+typedef void (*ColetorMetricas)(FILE* saida, void* contexto);
+
+// Escreve todas as métricas em `saida`
+void metricas_escrever(FILE* saida, ColetorMetricas coletor, void* contexto);
+
+// Serve GET /metrics em 127.0.0.1:porta numa thread própria
+bool metricas_iniciar_servidor(int porta, ColetorMetricas coletor, void* contexto);
+
+#endif  // METRICAS_H
@@ -0,0 +1,38 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Pool de objetos de tamanho fixo alocado em blocos (slabs) sob demanda.
+// Blocos nunca são movidos nem liberados, então os endereços são estáveis e
+// índices devolvidos voltam a ser usados pela lista livre.
+// pool_obter pode ser chamada sem lock; pool_alocar e pool_liberar exigem
+// que o chamador serialize o acesso com seu próprio mutex.
+typedef void (*InicializadorPool)(void* elemento, uint32_t indice);
+
+typedef struct {
+	size_t tamanho_elemento;
+	uint32_t elementos_por_bloco;
+	uint32_t capacidade;           // Limite de elementos, definido na inicialização
+	_Atomic(uint8_t*)* blocos;     // Diretório com um ponteiro por bloco possível
+	_Atomic uint32_t num_usados;   // Índices já entregues ao menos uma vez
+	uint32_t* livres;              // Pilha de índices devolvidos
+	uint32_t num_livres;
+	uint32_t capacidade_livres;
+	InicializadorPool inicializar; // Chamado uma vez por elemento quando o bloco é criado
+} Pool;
+
+bool pool_inicializar(Pool* pool, size_t tamanho_elemento, uint32_t elementos_por_bloco,
+                      uint32_t capacidade, InicializadorPool inicializar);
+// Retorna NULL se o pool está cheio ou sem memória
+void* pool_alocar(Pool* pool, uint32_t* indice);
+void pool_liberar(Pool* pool, uint32_t indice);
+// NULL se o índice nunca foi alocado
+void* pool_obter(const Pool* pool, uint32_t indice);
+// Limite superior para percorrer o pool: todo índice válido é menor que ele
+uint32_t pool_num_usados(const Pool* pool);
+
+#endif  // POOL_H
@@ -0,0 +1,56 @@
+#ifndef PROTOCOLO_H
+#define PROTOCOLO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "common.h"
+
+// Formatos de quadro no fio:
+//  - Legado: a estrutura Mensagem inteira (sizeof(Mensagem) bytes). O primeiro
+//    byte é o byte baixo de `tipo`, sempre < 0x80.
+//  - Compacto: [0x80 | tipo] [varint sala_id] [varint jogador_id] [varint tamanho] [dados]
+// O receptor identifica o formato pelo primeiro byte, então os dois podem se misturar
+// na mesma conexão; a negociação em MSG_CONECTAR só decide o que o servidor envia.
+#define PROTOCOLO_MARCA_COMPACTO 0x80
+#define PROTOCOLO_TAMANHO_MAX_VARINT 5
+#define PROTOCOLO_TAMANHO_MAX_QUADRO (sizeof(Mensagem))
+
+// Capacidades negociadas em MSG_CONECTAR (dados = uint32_t com os bits abaixo)
+#define CAP_QUADRO_COMPACTO (1u << 0)
+#define CAP_ESTADO_DELTA (1u << 1)
+#define CAP_EVENTOS_LOBBY (1u << 2)  // Aceita MSG_ASSINAR_LOBBY / MSG_EVENTOS_LOBBY
+#define CAP_HEARTBEAT (1u << 3)      // Responde MSG_PING; sem resposta a conexão é encerrada
+#define CAP_SESSAO (1u << 4)         // Recebe um token de sessão e pode retomar o assento ao reconectar
+
+// Com CAP_SESSAO a resposta a MSG_CONECTAR traz [uint32_t capacidades][uint64_t token].
+// Para retomar, o pedido leva o mesmo formato com o token antigo e sala_id = sala da partida.
+#define SESSAO_TAMANHO_DADOS (sizeof(uint32_t) + sizeof(uint64_t))
+
+// MSG_ESTADO_DELTA: [varint máscara de campos alterados] [valor de cada campo marcado].
+// Campos uint8_t ocupam 1 byte; cartas ocupam 1 byte (naipe << 4 | numero).
+#define ESTADO_DELTA_NUM_CAMPOS 22
+#define ESTADO_DELTA_TAMANHO_MAX (PROTOCOLO_TAMANHO_MAX_VARINT + ESTADO_DELTA_NUM_CAMPOS)
+
+// Codifica a mensagem em `saida` (mínimo PROTOCOLO_TAMANHO_MAX_QUADRO bytes).
+// Retorna o número de bytes escritos.
+size_t protocolo_codificar(const Mensagem* msg, bool compacto, uint8_t* saida);
+
+// Decodifica um quadro do início do buffer.
+// Retorna bytes consumidos (> 0), 0 se o quadro ainda está incompleto ou -1 se é inválido.
+int protocolo_decodificar(const uint8_t* buffer, size_t tamanho, Mensagem* msg);
+
+// Codifica em `saida` os campos de `atual` que diferem de `anterior`; retorna bytes escritos
+size_t estado_delta_codificar(const EstadoJogo* anterior, const EstadoJogo* atual, uint8_t* saida);
+// Aplica um delta sobre `estado`; retorna false se o delta é inválido
+bool estado_delta_aplicar(EstadoJogo* estado, const uint8_t* dados, size_t tamanho);
+
+// Envio/recebimento bloqueantes de bytes e quadros completos
+bool send_all(int socket, const void* buffer, size_t length);
+bool recv_all(int socket, void* buffer, size_t length);
+bool protocolo_enviar(int socket, const Mensagem* msg, bool compacto);
+bool protocolo_receber(int socket, Mensagem* msg);
+// Como protocolo_receber, mas retorna o tamanho do quadro lido (0 em erro)
+size_t protocolo_receber_quadro(int socket, Mensagem* msg);
+
+#endif  // PROTOCOLO_H
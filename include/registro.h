@@ -0,0 +1,38 @@
+#ifndef REGISTRO_H
+#define REGISTRO_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+// Log do servidor fora do caminho crítico. Quem registra formata a linha numa
+// entrada de um anel lock-free (vários produtores, um consumidor) e segue;
+// uma thread própria escreve as entradas em lote no destino. Com o anel cheio
+// a linha é descartada e contada, nunca bloqueia o chamador.
+#define REGISTRO_TAMANHO_ANEL 4096  // Potência de 2
+#define REGISTRO_TAMANHO_TEXTO 232
+
+typedef enum {
+	REGISTRO_DEBUG = 0,
+	REGISTRO_INFO = 1,
+	REGISTRO_AVISO = 2,
+	REGISTRO_ERRO = 3
+} NivelRegistro;
+
+typedef enum {
+	REGISTRO_TEXTO,  // "2026-01-01 12:00:00.123 INFO  mensagem"
+	REGISTRO_JSON    // Uma linha JSON por entrada
+} FormatoRegistro;
+
+// Inicia a thread de escrita; antes disso as linhas ficam no anel
+bool registro_iniciar(FILE* destino, FormatoRegistro formato, NivelRegistro minimo);
+// Escreve o que está no anel; para mensagens finais antes de encerrar o processo
+void registro_descarregar(void);
+
+bool registro_ativo(NivelRegistro nivel);
+// Formato de printf; "%m" insere strerror(errno)
+void registro(NivelRegistro nivel, const char* formato, ...) __attribute__((format(printf, 2, 3)));
+
+// Converte "debug", "info", "aviso" ou "erro"; false se desconhecido
+bool registro_nivel_por_nome(const char* nome, NivelRegistro* nivel);
+
+#endif  // REGISTRO_H
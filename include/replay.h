@@ -0,0 +1,103 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game_logic.h"
+
+// Registro binário das partidas para reprodução. Cada partida vira um bloco
+// acrescentado ao fim do arquivo quando termina (ou é abandonada):
+//
+//   [u32 REPLAY_MAGICA] [u32 tamanho do restante]
+//   [varint sala_id] [varint jogador1_id] [varint jogador2_id] [u64 semente]
+//   [varint início em µs desde a época] [u8 vencedor] [varint pontos 1] [varint pontos 2]
+//   [varint número de ações] ações...
+//
+// Ação: [u8 tipo | 0x08 se jogador 2] [varint µs desde a ação anterior] [varint valor]
+// (o valor só existe em JOGAR_CARTA e nas respostas). Inteiros fixos em little-endian.
+// A semente e a sequência de ações reproduzem a partida inteira com game_logic.c.
+#define REPLAY_MAGICA 0x31505254u  // "TRP1"
+
+typedef enum {
+	REPLAY_JOGAR_CARTA = 0,      // valor = índice da carta na mão
+	REPLAY_TRUCO = 1,
+	REPLAY_RESPOSTA_TRUCO = 2,   // valor = RespostaTruco
+	REPLAY_ENVIDO = 3,
+	REPLAY_RESPOSTA_ENVIDO = 4,  // valor = RespostaEnvido
+	REPLAY_FLOR = 5,
+	REPLAY_RESPOSTA_FLOR = 6,    // valor = RespostaFlor
+	REPLAY_IR_BARALHO = 7
+} TipoAcaoReplay;
+
+typedef struct {
+	TipoAcaoReplay tipo;
+	int jogador;           // 1 ou 2
+	uint32_t valor;
+	uint64_t instante_us;  // Desde o início da partida
+} AcaoReplay;
+
+typedef struct {
+	uint32_t sala_id;
+	uint32_t jogador1_id;
+	uint32_t jogador2_id;
+	uint64_t semente;
+	uint64_t inicio_us;  // Relógio de parede
+} CabecalhoReplay;
+
+typedef struct {
+	int vencedor;  // 0 se a partida foi abandonada
+	int pontos_jogador1;
+	int pontos_jogador2;
+} FinalReplay;
+
+// Partida lida de um arquivo; as ações apontam para o buffer do leitor
+typedef struct {
+	CabecalhoReplay cabecalho;
+	FinalReplay final;
+	uint32_t num_acoes;
+	const uint8_t* acoes;
+	size_t tamanho_acoes;
+} PartidaReplay;
+
+// Gravação em andamento de uma sala (protegida pelo mutex da sala)
+typedef struct {
+	bool ativa;
+	CabecalhoReplay cabecalho;
+	uint8_t* acoes;
+	size_t tamanho;
+	size_t capacidade;
+	uint32_t num_acoes;
+	uint64_t ultimo_us;  // Relógio monotônico da última ação
+} GravacaoReplay;
+
+// Prepara o jogo para a primeira mão exatamente como o servidor faz
+void replay_preparar_jogo(Jogo* jogo, const CabecalhoReplay* cabecalho);
+// Aplica a ação com as mesmas chamadas de processar_mensagem; false se foi recusada
+bool replay_aplicar(Jogo* jogo, const AcaoReplay* acao);
+const char* tipo_acao_replay_para_string(TipoAcaoReplay tipo);
+
+// Abre o arquivo (em modo de acréscimo) e inicia a thread que grava os blocos.
+// Sem arquivo aberto as gravações não fazem nada.
+bool replay_abrir_arquivo(const char* caminho);
+bool replay_ativo(void);
+// Espera a thread de gravação escrever os blocos já entregues (antes de o
+// processo sair sem encerrar as threads)
+void replay_descarregar(void);
+
+void gravacao_inicializar(GravacaoReplay* gravacao);
+// Começa a gravar; descarta (como abandonada) uma gravação anterior ainda ativa
+void gravacao_iniciar(GravacaoReplay* gravacao, const CabecalhoReplay* cabecalho, const Jogo* jogo);
+void gravacao_registrar(GravacaoReplay* gravacao, TipoAcaoReplay tipo, int jogador, uint32_t valor);
+// Fecha o bloco com o placar atual e o entrega à thread de gravação
+void gravacao_finalizar(GravacaoReplay* gravacao, const Jogo* jogo);
+
+// Leitura: percorre os blocos de um arquivo carregado em memória.
+// Retorna 1 com a próxima partida, 0 no fim e -1 se o bloco está corrompido
+// ou truncado (*posicao fica no início dele).
+int replay_proxima_partida(const uint8_t* dados, size_t tamanho, size_t* posicao, PartidaReplay* partida);
+// Decodifica a ação seguinte; *cursor começa em 0 e *instante_us acumula os intervalos
+bool replay_proxima_acao(const PartidaReplay* partida, size_t* cursor, uint64_t* instante_us, AcaoReplay* acao);
+
+#endif  // REPLAY_H
@@ -0,0 +1,54 @@
+#ifndef SIMULADOR_H
+#define SIMULADOR_H
+
+#include <stdint.h>
+
+#include "game_logic.h"
+
+// Motor de partidas sem rede: duas políticas decidem as jogadas e o motor as
+// aplica em um Jogo local até PONTOS_VITORIA. Cada chamada usa apenas o Jogo
+// recebido, então threads diferentes podem simular em paralelo.
+
+typedef enum {
+	ACAO_JOGAR_CARTA,       // valor = índice da carta na mão
+	ACAO_CANTAR_TRUCO,
+	ACAO_CANTAR_ENVIDO,
+	ACAO_CANTAR_FLOR,
+	ACAO_IR_BARALHO,
+	ACAO_RESPONDER_TRUCO,   // valor = RespostaTruco
+	ACAO_RESPONDER_ENVIDO   // valor = RespostaEnvido
+} TipoAcao;
+
+typedef struct {
+	TipoAcao tipo;
+	int valor;
+} Acao;
+
+// Decide a ação do jogador (1 ou 2). Quando há truco ou envido pendente para
+// ele, a ação deve ser a resposta; nos demais casos é a vez dele jogar.
+// A política só consulta o jogo, nunca o altera.
+typedef struct {
+	const char* nome;
+	Acao (*decidir)(Jogo* jogo, int jogador, GeradorAleatorio* gerador, void* contexto);
+	void* contexto;
+} Politica;
+
+typedef struct {
+	int vencedor;  // 1 ou 2 (0 se a partida foi interrompida)
+	int pontos_jogador1;
+	int pontos_jogador2;
+	int acoes;     // Ações aplicadas, incluindo respostas
+} ResultadoPartida;
+
+// Joga uma partida completa; a semente define a distribuição das cartas e o
+// gerador entregue às políticas
+ResultadoPartida simular_partida(Jogo* jogo, const Politica politicas[2], uint64_t semente);
+
+// Políticas de referência
+extern const Politica POLITICA_ALEATORIA;  // Escolhe entre as ações válidas ao acaso
+extern const Politica POLITICA_GULOSA;     // Heurística simples baseada na força da mão
+
+// Política pelo nome ("aleatoria", "gulosa"); NULL se não existe
+const Politica* politica_por_nome(const char* nome);
+
+#endif  // SIMULADOR_H
@@ -0,0 +1,45 @@
+#ifndef TEMPORIZADORES_H
+#define TEMPORIZADORES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Roda de temporizadores hierárquica: RODA_NIVEIS níveis de RODA_BALDES
+// baldes, cada nível com baldes RODA_BALDES vezes mais largos que o anterior.
+// Agendar e cancelar são O(1); a cada tick só o balde atual do primeiro nível
+// é percorrido, e os níveis de cima descem um balde quando o de baixo dá a
+// volta. O tempo é contado em ticks; a unidade de um tick fica com quem usa.
+// Não é thread-safe: cada roda pertence a uma única thread.
+#define RODA_BITS_NIVEL 6
+#define RODA_BALDES (1 << RODA_BITS_NIVEL)
+#define RODA_NIVEIS 4
+
+// Intrusivo: embutido na estrutura que o temporizador representa
+typedef struct Temporizador {
+	struct Temporizador* proximo;
+	struct Temporizador* anterior;  // NULL se não está agendado
+	uint64_t expira;                // Tick em que dispara
+} Temporizador;
+
+typedef struct {
+	uint64_t agora;  // Último tick processado
+	size_t agendados;
+	Temporizador baldes[RODA_NIVEIS][RODA_BALDES];  // Sentinelas de listas circulares
+} RodaTemporizadores;
+
+// Chamada para cada temporizador vencido, já fora da roda; pode reagendá-lo
+typedef void (*TemporizadorExpirou)(Temporizador* temporizador, void* contexto);
+
+void roda_inicializar(RodaTemporizadores* roda, uint64_t agora);
+void temporizador_inicializar(Temporizador* temporizador);
+bool temporizador_agendado(const Temporizador* temporizador);
+
+// Agenda (ou reagenda) para o tick `expira`; ticks já passados disparam no próximo
+void roda_agendar(RodaTemporizadores* roda, Temporizador* temporizador, uint64_t expira);
+void roda_cancelar(RodaTemporizadores* roda, Temporizador* temporizador);
+
+// Processa os ticks até `agora`, inclusive, chamando `expirou` para os vencidos
+void roda_avancar(RodaTemporizadores* roda, uint64_t agora, TemporizadorExpirou expirou, void* contexto);
+
+#endif  // TEMPORIZADORES_H
@@ -0,0 +1,64 @@
+#ifndef TRANSFERENCIA_H
+#define TRANSFERENCIA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Passagem do servidor em execução para um novo processo sem derrubar
+// ninguém (--transferencia / --herdar). Os dois conversam por um socket UNIX
+// SOCK_SEQPACKET, que preserva as fronteiras das mensagens:
+//
+//   [cabeçalho: u32 TRANSFERENCIA_MAGICA, u32 versão, u32 número de fds, u64 tamanho do estado]
+//   [lotes de fds: u32 quantidade + SCM_RIGHTS com até TRANSFERENCIA_FDS_POR_LOTE fds] ...
+//   [estado em pedaços de até TRANSFERENCIA_TAMANHO_PEDACO bytes] ...
+//
+// O conteúdo do estado é definido por quem envia; este módulo só o transporta.
+#define TRANSFERENCIA_MAGICA 0x4e415254u  // "TRAN"
+#define TRANSFERENCIA_VERSAO 1
+#define TRANSFERENCIA_FDS_POR_LOTE 253  // SCM_MAX_FD do kernel
+#define TRANSFERENCIA_TAMANHO_PEDACO (64 * 1024)
+
+// Buffer de escrita do estado. Inteiros vão como varint (a maioria é pequena);
+// uma falha de alocação fica em erro e as escritas seguintes são ignoradas.
+typedef struct {
+	uint8_t* dados;
+	size_t tamanho;
+	size_t capacidade;
+	bool erro;
+} EscritorEstado;
+
+void escritor_u8(EscritorEstado* escritor, uint8_t valor);
+void escritor_varint(EscritorEstado* escritor, uint64_t valor);
+void escritor_u64(EscritorEstado* escritor, uint64_t valor);
+void escritor_bytes(EscritorEstado* escritor, const void* dados, size_t tamanho);
+// Espaço para `tamanho` bytes preenchidos pelo chamador; NULL em erro
+uint8_t* escritor_reservar(EscritorEstado* escritor, size_t tamanho);
+void escritor_liberar(EscritorEstado* escritor);
+
+// Leitura do estado recebido. Passar do fim marca erro e as leituras
+// seguintes retornam 0 (ou NULL), então basta conferir erro no final.
+typedef struct {
+	const uint8_t* dados;
+	size_t tamanho;
+	size_t posicao;
+	bool erro;
+} LeitorEstado;
+
+uint8_t leitor_u8(LeitorEstado* leitor);
+uint64_t leitor_varint(LeitorEstado* leitor);
+uint64_t leitor_u64(LeitorEstado* leitor);
+const uint8_t* leitor_bytes(LeitorEstado* leitor, size_t tamanho);
+
+// Socket de escuta no caminho (remove um arquivo que sobrou de execução
+// anterior) e conexão a ele. Retornam -1 em erro.
+int transferencia_escutar(const char* caminho);
+int transferencia_conectar(const char* caminho);
+
+// Envia os fds e o estado pela conexão (bloqueante)
+bool transferencia_enviar(int conexao, const int* fds, size_t num_fds, const uint8_t* dados, size_t tamanho);
+// Recebe o que transferencia_enviar mandou; os fds chegam com FD_CLOEXEC.
+// Em sucesso *fds e *dados são do chamador (liberar com free).
+bool transferencia_receber(int conexao, int** fds, size_t* num_fds, uint8_t** dados, size_t* tamanho);
+
+#endif  // TRANSFERENCIA_H
@@ -0,0 +1,251 @@
+#include "anel_io.h"
+
+#include <errno.h>
+#include <linux/time_types.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Grupo de buffers fornecidos usado por anel_receber_multishot
+#define GRUPO_BUFFERS 0
+
+static int io_uring_setup(unsigned entradas, struct io_uring_params* parametros) {
+	return (int)syscall(__NR_io_uring_setup, entradas, parametros);
+}
+
+static int io_uring_enter(int fd, unsigned submeter, unsigned minimo, unsigned flags, void* argumento,
+                          size_t tamanho) {
+	return (int)syscall(__NR_io_uring_enter, fd, submeter, minimo, flags, argumento, tamanho);
+}
+
+static int io_uring_register(int fd, unsigned operacao, void* argumento, unsigned quantidade) {
+	return (int)syscall(__NR_io_uring_register, fd, operacao, argumento, quantidade);
+}
+
+static void* mapear(int fd, size_t tamanho, off_t deslocamento) {
+	void* mapa = mmap(NULL, tamanho, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, deslocamento);
+	return mapa == MAP_FAILED ? NULL : mapa;
+}
+
+// Devolve um buffer ao fim do anel de buffers; o kernel o vê pela cauda
+static void publicar_buffer(AnelIO* anel, uint16_t id) {
+	struct io_uring_buf* buffer = &anel->anel_buffers->bufs[anel->buffers_cauda & (anel->num_buffers - 1)];
+	buffer->addr = (uint64_t)(uintptr_t)(anel->buffers + (size_t)id * anel->tamanho_buffer);
+	buffer->len = (uint32_t)anel->tamanho_buffer;
+	buffer->bid = id;
+	anel->buffers_cauda++;
+	__atomic_store_n(&anel->anel_buffers->tail, anel->buffers_cauda, __ATOMIC_RELEASE);
+}
+
+static bool registrar_buffers(AnelIO* anel, unsigned num_buffers, size_t tamanho_buffer) {
+	anel->num_buffers = num_buffers;
+	anel->tamanho_buffer = tamanho_buffer;
+	anel->buffers = malloc((size_t)num_buffers * tamanho_buffer);
+	void* mapa = mmap(NULL, num_buffers * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE,
+	                  MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (!anel->buffers || mapa == MAP_FAILED) return false;
+	anel->anel_buffers = mapa;
+
+	struct io_uring_buf_reg registro;
+	memset(&registro, 0, sizeof(registro));
+	registro.ring_addr = (uint64_t)(uintptr_t)anel->anel_buffers;
+	registro.ring_entries = num_buffers;
+	registro.bgid = GRUPO_BUFFERS;
+	if (io_uring_register(anel->fd, IORING_REGISTER_PBUF_RING, &registro, 1) < 0) return false;
+
+	anel->buffers_cauda = 0;
+	for (unsigned i = 0; i < num_buffers; i++) publicar_buffer(anel, (uint16_t)i);
+	return true;
+}
+
+static void finalizar(AnelIO* anel) {
+	if (anel->sqes) munmap(anel->sqes, anel->tamanho_mapa_sqes);
+	if (anel->mapa_cq && anel->mapa_cq != anel->mapa_sq) munmap(anel->mapa_cq, anel->tamanho_mapa_cq);
+	if (anel->mapa_sq) munmap(anel->mapa_sq, anel->tamanho_mapa_sq);
+	if (anel->anel_buffers) munmap(anel->anel_buffers, anel->num_buffers * sizeof(struct io_uring_buf));
+	free(anel->buffers);
+	if (anel->fd >= 0) close(anel->fd);
+	memset(anel, 0, sizeof(AnelIO));
+	anel->fd = -1;
+}
+
+bool anel_inicializar(AnelIO* anel, unsigned entradas, unsigned num_buffers, size_t tamanho_buffer) {
+	memset(anel, 0, sizeof(AnelIO));
+
+	// Multishot gera várias conclusões por pedido: a fila de conclusão é maior.
+	// SINGLE_ISSUER + DEFER_TASKRUN deixam o trabalho do kernel para a espera
+	// da própria thread dona; kernels sem eles ficam com o modo padrão.
+	struct io_uring_params parametros;
+	memset(&parametros, 0, sizeof(parametros));
+	parametros.flags = IORING_SETUP_CQSIZE | IORING_SETUP_R_DISABLED | IORING_SETUP_SUBMIT_ALL |
+	                   IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+	parametros.cq_entries = entradas * 4;
+	anel->fd = io_uring_setup(entradas, &parametros);
+	if (anel->fd < 0 && errno == EINVAL) {
+		memset(&parametros, 0, sizeof(parametros));
+		parametros.flags = IORING_SETUP_CQSIZE | IORING_SETUP_R_DISABLED;
+		parametros.cq_entries = entradas * 4;
+		anel->fd = io_uring_setup(entradas, &parametros);
+	}
+	if (anel->fd < 0) return false;
+
+	// Sem NODROP conclusões podem se perder; sem EXT_ARG não há espera com timeout
+	if ((parametros.features & (IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG)) !=
+	    (IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG)) {
+		finalizar(anel);
+		errno = ENOSYS;
+		return false;
+	}
+
+	anel->tamanho_mapa_sq = parametros.sq_off.array + parametros.sq_entries * sizeof(unsigned);
+	anel->tamanho_mapa_cq = parametros.cq_off.cqes + parametros.cq_entries * sizeof(struct io_uring_cqe);
+	if (parametros.features & IORING_FEAT_SINGLE_MMAP) {
+		if (anel->tamanho_mapa_cq > anel->tamanho_mapa_sq) anel->tamanho_mapa_sq = anel->tamanho_mapa_cq;
+		anel->tamanho_mapa_cq = anel->tamanho_mapa_sq;
+		anel->mapa_sq = mapear(anel->fd, anel->tamanho_mapa_sq, IORING_OFF_SQ_RING);
+		anel->mapa_cq = anel->mapa_sq;
+	} else {
+		anel->mapa_sq = mapear(anel->fd, anel->tamanho_mapa_sq, IORING_OFF_SQ_RING);
+		anel->mapa_cq = mapear(anel->fd, anel->tamanho_mapa_cq, IORING_OFF_CQ_RING);
+	}
+	anel->tamanho_mapa_sqes = parametros.sq_entries * sizeof(struct io_uring_sqe);
+	anel->sqes = mapear(anel->fd, anel->tamanho_mapa_sqes, IORING_OFF_SQES);
+	if (!anel->mapa_sq || !anel->mapa_cq || !anel->sqes) {
+		finalizar(anel);
+		return false;
+	}
+
+	uint8_t* sq = anel->mapa_sq;
+	anel->sq_cabeca = (unsigned*)(sq + parametros.sq_off.head);
+	anel->sq_cauda = (unsigned*)(sq + parametros.sq_off.tail);
+	anel->sq_indices = (unsigned*)(sq + parametros.sq_off.array);
+	anel->sq_mascara = *(unsigned*)(sq + parametros.sq_off.ring_mask);
+	anel->sq_entradas = parametros.sq_entries;
+	anel->sq_cauda_local = *anel->sq_cauda;
+	// Cada posição da fila aponta sempre para o SQE de mesmo índice
+	for (unsigned i = 0; i < anel->sq_entradas; i++) anel->sq_indices[i] = i;
+
+	uint8_t* cq = anel->mapa_cq;
+	anel->cq_cabeca = (unsigned*)(cq + parametros.cq_off.head);
+	anel->cq_cauda = (unsigned*)(cq + parametros.cq_off.tail);
+	anel->cq_mascara = *(unsigned*)(cq + parametros.cq_off.ring_mask);
+	anel->cqes = (struct io_uring_cqe*)(cq + parametros.cq_off.cqes);
+
+	if (!registrar_buffers(anel, num_buffers, tamanho_buffer)) {
+		finalizar(anel);
+		return false;
+	}
+	return true;
+}
+
+// Com SINGLE_ISSUER a thread que habilita o anel passa a ser a única que submete
+bool anel_habilitar(AnelIO* anel) {
+	return io_uring_register(anel->fd, IORING_REGISTER_ENABLE_RINGS, NULL, 0) == 0;
+}
+
+static void publicar_pedidos(AnelIO* anel) {
+	__atomic_store_n(anel->sq_cauda, anel->sq_cauda_local, __ATOMIC_RELEASE);
+}
+
+static unsigned pedidos_pendentes(AnelIO* anel) {
+	return anel->sq_cauda_local - __atomic_load_n(anel->sq_cabeca, __ATOMIC_ACQUIRE);
+}
+
+static struct io_uring_sqe* obter_sqe(AnelIO* anel) {
+	// Fila cheia: envia ao kernel o que já foi preparado, sem esperar conclusões
+	while (pedidos_pendentes(anel) >= anel->sq_entradas) {
+		publicar_pedidos(anel);
+		if (io_uring_enter(anel->fd, pedidos_pendentes(anel), 0, 0, NULL, 0) < 0 && errno != EINTR) break;
+	}
+
+	struct io_uring_sqe* sqe = &anel->sqes[anel->sq_cauda_local & anel->sq_mascara];
+	memset(sqe, 0, sizeof(*sqe));
+	anel->sq_cauda_local++;
+	anel->em_voo++;
+	return sqe;
+}
+
+void anel_aceitar_multishot(AnelIO* anel, int socket, uint64_t dados) {
+	struct io_uring_sqe* sqe = obter_sqe(anel);
+	sqe->opcode = IORING_OP_ACCEPT;
+	sqe->fd = socket;
+	sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+	sqe->user_data = dados;
+}
+
+void anel_receber_multishot(AnelIO* anel, int socket, uint64_t dados) {
+	struct io_uring_sqe* sqe = obter_sqe(anel);
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = socket;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = GRUPO_BUFFERS;
+	sqe->user_data = dados;
+}
+
+void anel_enviar(AnelIO* anel, int socket, const struct msghdr* mensagem, uint64_t dados) {
+	struct io_uring_sqe* sqe = obter_sqe(anel);
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = socket;
+	sqe->addr = (uint64_t)(uintptr_t)mensagem;
+	sqe->len = 1;
+	sqe->msg_flags = MSG_NOSIGNAL;
+	sqe->user_data = dados;
+}
+
+void anel_ler(AnelIO* anel, int fd, void* buffer, size_t tamanho, uint64_t dados) {
+	struct io_uring_sqe* sqe = obter_sqe(anel);
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t)(uintptr_t)buffer;
+	sqe->len = (uint32_t)tamanho;
+	sqe->off = (uint64_t)-1;  // Posição atual: o descritor não é posicionável
+	sqe->user_data = dados;
+}
+
+void anel_cancelar_todos(AnelIO* anel, uint64_t dados) {
+	struct io_uring_sqe* sqe = obter_sqe(anel);
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = -1;
+	sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+	sqe->user_data = dados;
+}
+
+bool anel_submeter(AnelIO* anel, int timeout_ms) {
+	publicar_pedidos(anel);
+
+	// Conclusões já na fila: só submete, sem esperar
+	bool prontas = __atomic_load_n(anel->cq_cauda, __ATOMIC_ACQUIRE) != *anel->cq_cabeca;
+	struct __kernel_timespec espera = {.tv_sec = timeout_ms / 1000, .tv_nsec = (timeout_ms % 1000) * 1000000L};
+	struct io_uring_getevents_arg argumento = {.sigmask = 0,
+	                                           .sigmask_sz = _NSIG / 8,
+	                                           .ts = timeout_ms >= 0 ? (uint64_t)(uintptr_t)&espera : 0};
+
+	int resultado = io_uring_enter(anel->fd, pedidos_pendentes(anel), prontas ? 0 : 1,
+	                               IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &argumento, sizeof(argumento));
+	return resultado >= 0 || errno == EINTR || errno == ETIME || errno == EBUSY || errno == EAGAIN;
+}
+
+bool anel_proximo(AnelIO* anel, EventoAnel* evento) {
+	unsigned cabeca = *anel->cq_cabeca;
+	if (cabeca == __atomic_load_n(anel->cq_cauda, __ATOMIC_ACQUIRE)) return false;
+
+	struct io_uring_cqe* cqe = &anel->cqes[cabeca & anel->cq_mascara];
+	evento->dados = cqe->user_data;
+	evento->resultado = cqe->res;
+	evento->flags = cqe->flags;
+	if (!(cqe->flags & IORING_CQE_F_MORE)) anel->em_voo--;
+	__atomic_store_n(anel->cq_cabeca, cabeca + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+uint8_t* anel_buffer(AnelIO* anel, uint32_t flags) {
+	return anel->buffers + (size_t)(flags >> IORING_CQE_BUFFER_SHIFT) * anel->tamanho_buffer;
+}
+
+void anel_devolver_buffer(AnelIO* anel, uint32_t flags) {
+	publicar_buffer(anel, (uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT));
+}
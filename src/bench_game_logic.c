@@ -0,0 +1,225 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "game_logic.h"
+
+// Microbenchmarks das funções quentes de game_logic. Cada caso roda
+// `repeticoes` lotes de `iteracoes` chamadas; a tabela mostra média, desvio e
+// mínimo de ns/op entre os lotes. --csv grava o mesmo resultado em formato
+// estável para comparar execuções entre commits.
+
+#define NUM_ENTRADAS 1024  // Potência de 2: o índice da entrada é i & (NUM_ENTRADAS - 1)
+
+typedef struct {
+	const char* nome;
+	uint64_t (*executar)(uint64_t iteracoes);
+} CasoBench;
+
+// Entradas pré-geradas, iguais em toda execução (semente fixa)
+static Carta cartas[NUM_ENTRADAS];
+static Jogador jogadores[NUM_ENTRADAS];
+static Jogo jogos[NUM_ENTRADAS];  // Mãos recém distribuídas, prontas para a primeira rodada
+
+// Impede que o compilador descarte o trabalho medido
+static volatile uint64_t sorvedouro;
+
+static void preparar_entradas(void) {
+	GeradorAleatorio gerador;
+	gerador_semear(&gerador, 0x5EED);
+
+	Baralho baralho;
+	inicializar_baralho(&baralho);
+	for (int i = 0; i < NUM_ENTRADAS; i++) {
+		cartas[i] = baralho.cartas[gerador_intervalo(&gerador, 40)];
+
+		embaralhar(&baralho, &gerador);
+		jogadores[i].num_cartas = 3;
+		for (int c = 0; c < 3; c++) jogadores[i].mao[c] = baralho.cartas[c];
+
+		inicializar_jogo(&jogos[i], 0, gerador_proximo(&gerador));
+		inicializar_baralho(&jogos[i].baralho);
+		distribuir_cartas(&jogos[i]);
+	}
+}
+
+static uint64_t bench_obter_valor_carta_truco(uint64_t iteracoes) {
+	uint64_t acumulado = 0;
+	for (uint64_t i = 0; i < iteracoes; i++) {
+		acumulado += obter_valor_carta_truco(cartas[i & (NUM_ENTRADAS - 1)]);
+	}
+	return acumulado;
+}
+
+static uint64_t bench_comparar_cartas_truco(uint64_t iteracoes) {
+	uint64_t acumulado = 0;
+	for (uint64_t i = 0; i < iteracoes; i++) {
+		acumulado += comparar_cartas_truco(cartas[i & (NUM_ENTRADAS - 1)], cartas[(i + 1) & (NUM_ENTRADAS - 1)]);
+	}
+	return acumulado;
+}
+
+static uint64_t bench_calcular_pontos_envido(uint64_t iteracoes) {
+	uint64_t acumulado = 0;
+	for (uint64_t i = 0; i < iteracoes; i++) {
+		acumulado += calcular_pontos_envido(&jogadores[i & (NUM_ENTRADAS - 1)]);
+	}
+	return acumulado;
+}
+
+static uint64_t bench_verificar_flor(uint64_t iteracoes) {
+	uint64_t acumulado = 0;
+	for (uint64_t i = 0; i < iteracoes; i++) {
+		acumulado += verificar_flor(&jogadores[i & (NUM_ENTRADAS - 1)]);
+	}
+	return acumulado;
+}
+
+static uint64_t bench_embaralhar(uint64_t iteracoes) {
+	GeradorAleatorio gerador;
+	gerador_semear(&gerador, 1);
+	Baralho baralho;
+	inicializar_baralho(&baralho);
+
+	for (uint64_t i = 0; i < iteracoes; i++) {
+		embaralhar(&baralho, &gerador);
+	}
+	return baralho.cartas[0].numero;
+}
+
+static uint64_t bench_distribuir_cartas(uint64_t iteracoes) {
+	Jogo jogo;
+	inicializar_jogo(&jogo, 0, 1);
+	inicializar_baralho(&jogo.baralho);
+
+	uint64_t acumulado = 0;
+	for (uint64_t i = 0; i < iteracoes; i++) {
+		distribuir_cartas(&jogo);
+		acumulado += jogo.jogador1.pontos_envido;
+	}
+	return acumulado;
+}
+
+// Uma rodada completa: cópia do jogo de entrada + duas jogar_carta, a segunda
+// chamando resolver_rodada
+static uint64_t bench_jogar_rodada(uint64_t iteracoes) {
+	Jogo jogo;
+	uint64_t acumulado = 0;
+	for (uint64_t i = 0; i < iteracoes; i++) {
+		memcpy(&jogo, &jogos[i & (NUM_ENTRADAS - 1)], sizeof(Jogo));
+		jogar_carta(&jogo, jogo.vez_jogador, (int)(i % 3));
+		jogar_carta(&jogo, jogo.vez_jogador, (int)((i >> 2) % 2));
+		acumulado += jogo.rodadas[0].vencedor;
+	}
+	return acumulado;
+}
+
+static uint64_t bench_obter_estado_jogo(uint64_t iteracoes) {
+	uint64_t acumulado = 0;
+	for (uint64_t i = 0; i < iteracoes; i++) {
+		EstadoJogo estado = obter_estado_jogo(&jogos[i & (NUM_ENTRADAS - 1)], (int)(i & 1) + 1);
+		acumulado += estado.pode_cantar_truco + estado.num_cartas_mao;
+	}
+	return acumulado;
+}
+
+static const CasoBench CASOS[] = {
+	{"obter_valor_carta_truco", bench_obter_valor_carta_truco},
+	{"comparar_cartas_truco", bench_comparar_cartas_truco},
+	{"calcular_pontos_envido", bench_calcular_pontos_envido},
+	{"verificar_flor", bench_verificar_flor},
+	{"embaralhar", bench_embaralhar},
+	{"distribuir_cartas", bench_distribuir_cartas},
+	{"jogar_rodada", bench_jogar_rodada},
+	{"obter_estado_jogo", bench_obter_estado_jogo},
+};
+
+static double agora_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+int main(int argc, char* argv[]) {
+	uint64_t iteracoes = 1000000;
+	int repeticoes = 10;
+	const char* caminho_csv = NULL;
+	const char* rotulo = "";
+	const char* filtro = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--iteracoes=", 12) == 0) {
+			iteracoes = strtoull(argv[i] + 12, NULL, 0);
+		} else if (strncmp(argv[i], "--repeticoes=", 13) == 0) {
+			repeticoes = atoi(argv[i] + 13);
+		} else if (strncmp(argv[i], "--csv=", 6) == 0) {
+			caminho_csv = argv[i] + 6;
+		} else if (strncmp(argv[i], "--rotulo=", 9) == 0) {
+			// Identifica a execução no CSV (ex.: hash do commit)
+			rotulo = argv[i] + 9;
+		} else if (strncmp(argv[i], "--filtro=", 9) == 0) {
+			filtro = argv[i] + 9;
+		} else {
+			fprintf(stderr, "Uso: %s [--iteracoes=N] [--repeticoes=N] [--csv=ARQUIVO] [--rotulo=TEXTO] [--filtro=NOME]\n",
+			        argv[0]);
+			return 1;
+		}
+	}
+	if (iteracoes == 0) iteracoes = 1;
+	if (repeticoes < 2) repeticoes = 2;
+
+	FILE* csv = NULL;
+	if (caminho_csv) {
+		csv = fopen(caminho_csv, "w");
+		if (!csv) {
+			perror("Erro ao abrir arquivo CSV");
+			return 1;
+		}
+		fprintf(csv, "rotulo,caso,iteracoes,repeticoes,ns_op_media,ns_op_desvio,ns_op_min,ops_por_segundo\n");
+	}
+
+	preparar_entradas();
+
+	printf("%-24s %12s %10s %7s %12s %14s\n", "caso", "ns/op", "desvio", "cv%", "min ns/op", "ops/s");
+	double* amostras = malloc(sizeof(double) * repeticoes);
+	if (!amostras) return 1;
+
+	for (size_t c = 0; c < sizeof(CASOS) / sizeof(CASOS[0]); c++) {
+		const CasoBench* caso = &CASOS[c];
+		if (filtro && !strstr(caso->nome, filtro)) continue;
+
+		// Aquecimento: caches e preditores antes da primeira amostra
+		sorvedouro += caso->executar(iteracoes / 10 + 1);
+
+		double soma = 0, minimo = 0;
+		for (int r = 0; r < repeticoes; r++) {
+			double inicio = agora_ns();
+			sorvedouro += caso->executar(iteracoes);
+			amostras[r] = (agora_ns() - inicio) / (double)iteracoes;
+			soma += amostras[r];
+			if (r == 0 || amostras[r] < minimo) minimo = amostras[r];
+		}
+
+		double media = soma / repeticoes;
+		double variancia = 0;
+		for (int r = 0; r < repeticoes; r++) variancia += (amostras[r] - media) * (amostras[r] - media);
+		double desvio = sqrt(variancia / (repeticoes - 1));
+		double ops_por_segundo = media > 0 ? 1e9 / media : 0;
+
+		printf("%-24s %12.2f %10.2f %7.1f %12.2f %14.0f\n", caso->nome, media, desvio,
+		       media > 0 ? 100.0 * desvio / media : 0, minimo, ops_por_segundo);
+		if (csv) {
+			fprintf(csv, "%s,%s,%llu,%d,%.3f,%.3f,%.3f,%.0f\n", rotulo, caso->nome, (unsigned long long)iteracoes,
+			        repeticoes, media, desvio, minimo, ops_por_segundo);
+		}
+	}
+
+	free(amostras);
+	if (csv) {
+		fclose(csv);
+		printf("Resultados gravados em %s\n", caminho_csv);
+	}
+	return 0;
+}
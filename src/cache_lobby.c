@@ -0,0 +1,169 @@
+#include "cache_lobby.h"
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "protocolo.h"
+
+// Pontos em que um leitor pode perder a CPU no meio da aquisição; o teste de
+// estresse os define como sched_yield() para alargar as janelas de corrida
+#ifndef CACHE_LOBBY_PONTO_DE_CORRIDA
+#define CACHE_LOBBY_PONTO_DE_CORRIDA()
+#endif
+
+void cache_lobby_inicializar(CacheLobby* cache) {
+	memset(cache, 0, sizeof(CacheLobby));
+	pthread_mutex_init(&cache->mutex, NULL);
+	atomic_init(&cache->atual, NULL);
+}
+
+static void conjunto_liberar(ConjuntoPaginas* conjunto) {
+	if (atomic_fetch_sub_explicit(&conjunto->referencias, 1, memory_order_acq_rel) != 1) return;
+	for (int i = 0; i < conjunto->num_paginas; i++) {
+		buffer_compartilhado_liberar(conjunto->paginas[i].quadros[0]);
+		buffer_compartilhado_liberar(conjunto->paginas[i].quadros[1]);
+	}
+	free(conjunto);
+}
+
+// Conjunto publicado com uma referência para o chamador (NULL se não há
+// nenhum). Ordem sequencialmente consistente: o leitor só fica contado numa
+// fase que ainda é a atual depois de contado, então a próxima publicação
+// (que troca essa fase) espera por ele antes de soltar o que ele pode ter lido.
+static ConjuntoPaginas* conjunto_adquirir(CacheLobby* cache) {
+	uint32_t fase;
+	for (;;) {
+		fase = atomic_load(&cache->fase);
+		CACHE_LOBBY_PONTO_DE_CORRIDA();
+		atomic_fetch_add(&cache->leitores[fase & 1], 1);
+		if (atomic_load(&cache->fase) == fase) break;
+		// Uma publicação trocou a fase no meio e pode já ter conferido o contador
+		atomic_fetch_sub(&cache->leitores[fase & 1], 1);
+	}
+
+	ConjuntoPaginas* conjunto = atomic_load(&cache->atual);
+	CACHE_LOBBY_PONTO_DE_CORRIDA();
+	if (conjunto) atomic_fetch_add_explicit(&conjunto->referencias, 1, memory_order_relaxed);
+	atomic_fetch_sub_explicit(&cache->leitores[fase & 1], 1, memory_order_release);
+	return conjunto;
+}
+
+// Só com o mutex. Troca o conjunto publicado e solta a referência do cache
+// no antigo assim que nenhum leitor pode mais estar pegando-o: quem ainda
+// pode ter lido o ponteiro antigo está contado na fase que termina aqui.
+static void conjunto_publicar(CacheLobby* cache, ConjuntoPaginas* novo) {
+	ConjuntoPaginas* antigo = atomic_exchange(&cache->atual, novo);
+	uint32_t fase = atomic_fetch_add(&cache->fase, 1) & 1;
+	while (atomic_load(&cache->leitores[fase]) != 0) sched_yield();
+	if (antigo) conjunto_liberar(antigo);
+}
+
+static const PaginaLobby* procurar_pagina(const ConjuntoPaginas* conjunto, const PedidoListaSalas* pedido) {
+	for (int i = 0; i < conjunto->num_paginas; i++) {
+		if (memcmp(&conjunto->paginas[i].pedido, pedido, sizeof(PedidoListaSalas)) == 0) return &conjunto->paginas[i];
+	}
+	return NULL;
+}
+
+// Lê a página do diretório e a codifica nos dois formatos
+static bool codificar_pagina(DiretorioSalas* diretorio, const PedidoListaSalas* pedido,
+                             BufferCompartilhado* quadros[2]) {
+	Mensagem resposta;
+	memset(&resposta, 0, sizeof(Mensagem));
+
+	uint32_t cursor = pedido->cursor;
+	InfoSala info_salas[sizeof(resposta.dados) / sizeof(InfoSala)];
+	int num_salas = diretorio_listar(diretorio, &cursor, pedido, info_salas,
+	                                 (int)(sizeof(info_salas) / sizeof(InfoSala)));
+
+	resposta.tipo = MSG_LISTAR_SALAS;
+	resposta.sala_id = cursor;
+	resposta.tamanho_dados = num_salas * sizeof(InfoSala);
+	memcpy(resposta.dados, info_salas, resposta.tamanho_dados);
+
+	uint8_t quadro[PROTOCOLO_TAMANHO_MAX_QUADRO];
+	for (int compacto = 0; compacto < 2; compacto++) {
+		size_t tamanho = protocolo_codificar(&resposta, compacto, quadro);
+		quadros[compacto] = buffer_compartilhado_criar(quadro, tamanho);
+	}
+
+	if (!quadros[0] || !quadros[1]) {
+		if (quadros[0]) buffer_compartilhado_liberar(quadros[0]);
+		if (quadros[1]) buffer_compartilhado_liberar(quadros[1]);
+		return false;
+	}
+	return true;
+}
+
+// Falta no cache: codifica a página e publica um conjunto com ela, junto com
+// as páginas da mesma versão que já estavam prontas
+static BufferCompartilhado* recodificar(CacheLobby* cache, DiretorioSalas* diretorio,
+                                        const PedidoListaSalas* pedido, bool compacto) {
+	pthread_mutex_lock(&cache->mutex);
+
+	// Lida antes de codificar: se o diretório mudar durante a leitura, a
+	// página fica marcada com a versão antiga e é refeita no próximo pedido.
+	// Com o mutex ninguém mais troca o conjunto, então ele pode ser lido direto.
+	uint64_t versao = diretorio_versao(diretorio);
+	ConjuntoPaginas* atual = atomic_load_explicit(&cache->atual, memory_order_relaxed);
+	if (atual && atual->versao != versao) atual = NULL;
+
+	// Outra thread pode ter codificado a mesma página enquanto esta esperava
+	const PaginaLobby* pronta = atual ? procurar_pagina(atual, pedido) : NULL;
+	if (pronta) {
+		BufferCompartilhado* quadro = pronta->quadros[compacto];
+		buffer_compartilhado_reter(quadro);
+		pthread_mutex_unlock(&cache->mutex);
+		return quadro;
+	}
+
+	BufferCompartilhado* quadros[2];
+	if (!codificar_pagina(diretorio, pedido, quadros)) {
+		pthread_mutex_unlock(&cache->mutex);
+		return NULL;
+	}
+
+	int anteriores = atual ? atual->num_paginas : 0;
+	ConjuntoPaginas* novo = NULL;
+	if (anteriores < CACHE_LOBBY_MAX_PAGINAS) {
+		novo = malloc(sizeof(ConjuntoPaginas) + (anteriores + 1) * sizeof(PaginaLobby));
+	}
+
+	BufferCompartilhado* quadro = quadros[compacto];
+	if (novo) {
+		atomic_init(&novo->referencias, 1);
+		novo->versao = versao;
+		novo->num_paginas = anteriores + 1;
+		for (int i = 0; i < anteriores; i++) {
+			novo->paginas[i] = atual->paginas[i];
+			buffer_compartilhado_reter(novo->paginas[i].quadros[0]);
+			buffer_compartilhado_reter(novo->paginas[i].quadros[1]);
+		}
+		// O conjunto fica com as referências de criação; o chamador recebe uma nova
+		novo->paginas[anteriores].pedido = *pedido;
+		novo->paginas[anteriores].quadros[0] = quadros[0];
+		novo->paginas[anteriores].quadros[1] = quadros[1];
+		buffer_compartilhado_reter(quadro);
+		conjunto_publicar(cache, novo);
+	} else {
+		buffer_compartilhado_liberar(quadros[!compacto]);
+	}
+
+	pthread_mutex_unlock(&cache->mutex);
+	return quadro;
+}
+
+BufferCompartilhado* cache_lobby_obter(CacheLobby* cache, DiretorioSalas* diretorio,
+                                       const PedidoListaSalas* pedido, bool compacto) {
+	uint64_t versao = diretorio_versao(diretorio);
+	ConjuntoPaginas* conjunto = conjunto_adquirir(cache);
+	if (conjunto) {
+		const PaginaLobby* pagina = conjunto->versao == versao ? procurar_pagina(conjunto, pedido) : NULL;
+		BufferCompartilhado* quadro = pagina ? pagina->quadros[compacto] : NULL;
+		if (quadro) buffer_compartilhado_reter(quadro);
+		conjunto_liberar(conjunto);
+		if (quadro) return quadro;
+	}
+	return recodificar(cache, diretorio, pedido, compacto);
+}
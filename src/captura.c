@@ -0,0 +1,180 @@
+#include "captura.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fila_mpsc.h"
+#include "protocolo.h"
+#include "registro.h"
+
+#define ESPERA_GRAVADOR_US 10000
+#define TAMANHO_MAX_PREFIXO 16  // Tipo e dois varints
+#define TAMANHO_BUFFER_ARQUIVO (1 << 16)
+
+// Registro codificado, a caminho da thread de gravação
+typedef struct {
+	NoFilaMpsc no;
+	size_t tamanho;
+	uint8_t dados[];
+} BlocoCaptura;
+
+static FilaMpsc fila_registros;
+static FILE* arquivo_captura = NULL;
+static uint64_t inicio_captura_us = 0;
+
+static uint64_t agora_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static size_t escrever_varint(uint8_t* saida, uint64_t valor) {
+	size_t n = 0;
+	while (valor >= 0x80) {
+		saida[n++] = (uint8_t)(valor | 0x80);
+		valor >>= 7;
+	}
+	saida[n++] = (uint8_t)valor;
+	return n;
+}
+
+static bool ler_varint(const uint8_t* dados, size_t tamanho, size_t* posicao, uint64_t* valor) {
+	*valor = 0;
+	for (int deslocamento = 0; deslocamento < 64; deslocamento += 7) {
+		if (*posicao >= tamanho) return false;
+		uint8_t byte = dados[(*posicao)++];
+		*valor |= (uint64_t)(byte & 0x7F) << deslocamento;
+		if (!(byte & 0x80)) return true;
+	}
+	return false;
+}
+
+static void* thread_gravador(void* arg) {
+	(void)arg;
+	while (1) {
+		NoFilaMpsc* no = fila_mpsc_remover(&fila_registros);
+		if (!no) {
+			// Fila vazia: o que está no buffer do arquivo vai para o disco
+			fflush(arquivo_captura);
+			usleep(ESPERA_GRAVADOR_US);
+			continue;
+		}
+
+		BlocoCaptura* bloco = (BlocoCaptura*)no;
+		if (fwrite(bloco->dados, 1, bloco->tamanho, arquivo_captura) != bloco->tamanho) {
+			registro(REGISTRO_ERRO, "Erro ao gravar captura: %m");
+		}
+		free(bloco);
+	}
+	return NULL;
+}
+
+bool captura_abrir_arquivo(const char* caminho) {
+	FILE* arquivo = fopen(caminho, "wb");
+	if (!arquivo) return false;
+	setvbuf(arquivo, NULL, _IOFBF, TAMANHO_BUFFER_ARQUIVO);
+
+	uint8_t magica[4];
+	for (int i = 0; i < 4; i++) magica[i] = (uint8_t)(CAPTURA_MAGICA >> (8 * i));
+	fwrite(magica, 1, sizeof(magica), arquivo);
+
+	fila_mpsc_inicializar(&fila_registros);
+	inicio_captura_us = agora_us();
+
+	pthread_t thread;
+	arquivo_captura = arquivo;
+	if (pthread_create(&thread, NULL, thread_gravador, NULL) != 0) {
+		fclose(arquivo);
+		arquivo_captura = NULL;
+		return false;
+	}
+	pthread_detach(thread);
+	return true;
+}
+
+bool captura_ativa(void) {
+	return arquivo_captura != NULL;
+}
+
+static void capturar(TipoRegistroCaptura tipo, uint32_t conexao, const uint8_t* conteudo, size_t tamanho) {
+	if (!arquivo_captura) return;
+
+	BlocoCaptura* bloco = malloc(sizeof(BlocoCaptura) + TAMANHO_MAX_PREFIXO + tamanho);
+	if (!bloco) return;
+	size_t n = 0;
+	bloco->dados[n++] = (uint8_t)tipo;
+	n += escrever_varint(bloco->dados + n, conexao);
+	n += escrever_varint(bloco->dados + n, agora_us() - inicio_captura_us);
+	if (tamanho > 0) memcpy(bloco->dados + n, conteudo, tamanho);
+	bloco->tamanho = n + tamanho;
+	fila_mpsc_inserir(&fila_registros, &bloco->no);
+}
+
+void captura_abertura(uint32_t conexao) {
+	capturar(CAPTURA_ABERTURA, conexao, NULL, 0);
+}
+
+void captura_mensagem(uint32_t conexao, const Mensagem* msg) {
+	if (!arquivo_captura) return;
+
+	uint8_t conteudo[PROTOCOLO_TAMANHO_MAX_VARINT + PROTOCOLO_TAMANHO_MAX_QUADRO];
+	uint8_t quadro[PROTOCOLO_TAMANHO_MAX_QUADRO];
+	size_t tamanho = protocolo_codificar(msg, true, quadro);
+	size_t n = escrever_varint(conteudo, tamanho);
+	memcpy(conteudo + n, quadro, tamanho);
+	capturar(CAPTURA_MENSAGEM, conexao, conteudo, n + tamanho);
+}
+
+void captura_sala(uint32_t conexao, uint32_t sala_id) {
+	if (!arquivo_captura) return;
+
+	uint8_t conteudo[PROTOCOLO_TAMANHO_MAX_VARINT];
+	capturar(CAPTURA_SALA, conexao, conteudo, escrever_varint(conteudo, sala_id));
+}
+
+void captura_fechamento(uint32_t conexao) {
+	capturar(CAPTURA_FECHAMENTO, conexao, NULL, 0);
+}
+
+int captura_proximo_registro(const uint8_t* dados, size_t tamanho, size_t* posicao, RegistroCaptura* registro) {
+	if (*posicao == 0) {
+		if (tamanho < 4) return -1;
+		uint32_t magica = dados[0] | (dados[1] << 8) | (dados[2] << 16) | ((uint32_t)dados[3] << 24);
+		if (magica != CAPTURA_MAGICA) return -1;
+		*posicao = 4;
+	}
+	if (*posicao == tamanho) return 0;
+
+	size_t p = *posicao;
+	uint8_t tipo = dados[p++];
+	uint64_t conexao, instante;
+	if (tipo > CAPTURA_FECHAMENTO || !ler_varint(dados, tamanho, &p, &conexao) ||
+	    !ler_varint(dados, tamanho, &p, &instante)) {
+		return -1;
+	}
+	registro->tipo = (TipoRegistroCaptura)tipo;
+	registro->conexao = (uint32_t)conexao;
+	registro->instante_us = instante;
+
+	if (tipo == CAPTURA_MENSAGEM) {
+		uint64_t tamanho_quadro;
+		if (!ler_varint(dados, tamanho, &p, &tamanho_quadro) || tamanho_quadro > tamanho - p) return -1;
+		if (protocolo_decodificar(dados + p, (size_t)tamanho_quadro, &registro->msg) != (int)tamanho_quadro) {
+			return -1;
+		}
+		registro->quadro = dados + p;
+		registro->tamanho_quadro = (size_t)tamanho_quadro;
+		p += (size_t)tamanho_quadro;
+	} else if (tipo == CAPTURA_SALA) {
+		uint64_t sala_id;
+		if (!ler_varint(dados, tamanho, &p, &sala_id)) return -1;
+		registro->sala_id = (uint32_t)sala_id;
+	}
+
+	*posicao = p;
+	return 1;
+}
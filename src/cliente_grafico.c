@@ -10,58 +10,39 @@
 #include <unistd.h>
 
 #include "common.h"
+#include "protocolo.h"
 #include "ui_grafica.h"
 
 // Estrutura do cliente gráfico
 typedef struct {
 	int socket;
 	uint32_t id;
+	uint32_t capacidades;  // Capacidades aceitas pelo servidor (CAP_*)
+	uint64_t token_sessao;  // Recebido com CAP_SESSAO; permite retomar o assento ao reconectar
+	bool retomando_sessao;  // Pedido de retomada enviado, aguardando a sala
 	bool conectado;
 	char server_ip[16];
 	int server_porta;
 	UIGrafica ui;
 	UIEstado estado;
+	bool lista_salas_nova;          // Próxima página de salas substitui a lista atual
+	uint32_t proxima_pagina_salas;  // Cursor a pedir no próximo quadro (0 = nenhum)
+	bool assinando_lobby;           // Recebendo MSG_EVENTOS_LOBBY
 	pthread_t thread_recebimento;
 	pthread_mutex_t mutex_estado;
+	pthread_mutex_t mutex_envio;  // A thread de recebimento também envia (MSG_PONG)
 } ClienteGrafico;
 
 static ClienteGrafico cliente;
 
-// Funções auxiliares de rede - envio/recebimento completo
-static bool send_all(int socket, const void* buffer, size_t length) {
-	const char* ptr = (const char*)buffer;
-	size_t remaining = length;
-
-	while (remaining > 0) {
-		ssize_t sent = send(socket, ptr, remaining, 0);
-		if (sent <= 0) {
-			return false;
-		}
-		ptr += sent;
-		remaining -= sent;
-	}
-	return true;
-}
-
-static bool recv_all(int socket, void* buffer, size_t length) {
-	char* ptr = (char*)buffer;
-	size_t remaining = length;
-
-	while (remaining > 0) {
-		ssize_t received = recv(socket, ptr, remaining, 0);
-		if (received <= 0) {
-			return false;
-		}
-		ptr += received;
-		remaining -= received;
-	}
-	return true;
-}
-
 // Protótipos de funções
 bool conectar_servidor(const char* ip, int porta);
 void desconectar_servidor();
 bool enviar_mensagem(Mensagem* msg);
+bool negociar_capacidades();
+bool pedir_pagina_salas(uint32_t cursor);
+void assinar_lobby(bool ativo);
+void aplicar_eventos_lobby(Mensagem* msg);
 void* thread_receber_mensagens(void* arg);
 void processar_mensagem_recebida(Mensagem* msg);
 
@@ -125,6 +106,8 @@ bool conectar_servidor(const char* ip, int porta) {
 		strncpy(cliente.server_ip, ip, sizeof(cliente.server_ip) - 1);
 		cliente.server_porta = porta;
 		pthread_mutex_init(&cliente.mutex_estado, NULL);
+		pthread_mutex_init(&cliente.mutex_envio, NULL);
+		negociar_capacidades();
 
 		// Inicia thread de recebimento
 		pthread_create(&cliente.thread_recebimento, NULL, thread_receber_mensagens, NULL);
@@ -146,6 +129,7 @@ void desconectar_servidor() {
 		close(cliente.socket);
 		pthread_cancel(cliente.thread_recebimento);
 		pthread_mutex_destroy(&cliente.mutex_estado);
+		pthread_mutex_destroy(&cliente.mutex_envio);
 	}
 }
 
@@ -155,18 +139,104 @@ bool enviar_mensagem(Mensagem* msg) {
 	msg->jogador_id = cliente.id;
 	msg->sala_id = cliente.estado.sala_id;
 
-	return send_all(cliente.socket, msg, sizeof(Mensagem));
+	pthread_mutex_lock(&cliente.mutex_envio);
+	bool enviado = protocolo_enviar(cliente.socket, msg, cliente.capacidades & CAP_QUADRO_COMPACTO);
+	pthread_mutex_unlock(&cliente.mutex_envio);
+	return enviado;
+}
+
+// Pede ao servidor o protocolo compacto, estados delta, eventos do lobby,
+// heartbeat e sessão. O pedido vai no formato legado; servidores antigos o
+// ignoram e a conexão segue com a estrutura completa. Com um token de sessão e
+// uma sala, o pedido também retoma o assento que a conexão anterior ocupava.
+bool negociar_capacidades() {
+	cliente.capacidades = 0;
+	cliente.assinando_lobby = false;
+
+	Mensagem msg;
+	memset(&msg, 0, sizeof(Mensagem));
+	msg.tipo = MSG_CONECTAR;
+	uint32_t pedidas = CAP_QUADRO_COMPACTO | CAP_ESTADO_DELTA | CAP_EVENTOS_LOBBY | CAP_HEARTBEAT | CAP_SESSAO;
+	memcpy(msg.dados, &pedidas, sizeof(uint32_t));
+	msg.tamanho_dados = sizeof(uint32_t);
+
+	if (cliente.retomando_sessao) {
+		msg.sala_id = cliente.estado.sala_id;
+		memcpy(msg.dados + sizeof(uint32_t), &cliente.token_sessao, sizeof(uint64_t));
+		msg.tamanho_dados = SESSAO_TAMANHO_DADOS;
+	}
+
+	return protocolo_enviar(cliente.socket, &msg, false);
+}
+
+// Liga ou desliga os eventos do lobby; sem suporte do servidor a lista
+// só é atualizada quando o jogador pede de novo
+void assinar_lobby(bool ativo) {
+	if (!(cliente.capacidades & CAP_EVENTOS_LOBBY) || cliente.assinando_lobby == ativo) return;
+
+	Mensagem msg;
+	memset(&msg, 0, sizeof(Mensagem));
+	msg.tipo = MSG_ASSINAR_LOBBY;
+	msg.dados[0] = ativo ? 1 : 0;
+	msg.tamanho_dados = 1;
+
+	if (enviar_mensagem(&msg)) cliente.assinando_lobby = ativo;
+}
+
+// Aplica um lote de eventos à lista de salas exibida
+void aplicar_eventos_lobby(Mensagem* msg) {
+	int num = msg->tamanho_dados / sizeof(EventoLobby);
+	for (int e = 0; e < num; e++) {
+		EventoLobby evento;
+		memcpy(&evento, msg->dados + e * sizeof(EventoLobby), sizeof(EventoLobby));
+
+		int i = 0;
+		while (i < cliente.estado.num_salas && cliente.estado.salas[i].id != evento.sala.id) i++;
+
+		if (evento.tipo == LOBBY_SALA_REMOVIDA) {
+			if (i < cliente.estado.num_salas) {
+				memmove(&cliente.estado.salas[i], &cliente.estado.salas[i + 1],
+				        (cliente.estado.num_salas - i - 1) * sizeof(InfoSala));
+				cliente.estado.num_salas--;
+			}
+		} else if (i < cliente.estado.num_salas) {
+			cliente.estado.salas[i] = evento.sala;
+		} else if (cliente.estado.num_salas < MAX_SALAS) {
+			cliente.estado.salas[cliente.estado.num_salas++] = evento.sala;
+		}
+	}
+
+	if (cliente.estado.tela_atual == TELA_LISTAR_SALAS) {
+		cliente.estado.precisa_reconfigurar_botoes = true;
+	}
 }
 
 void processar_mensagem_recebida(Mensagem* msg) {
 	pthread_mutex_lock(&cliente.mutex_estado);
 
 	switch (msg->tipo) {
+		case MSG_PING: {
+			// Sem resposta o servidor considera a conexão morta
+			Mensagem pong;
+			memset(&pong, 0, sizeof(Mensagem));
+			pong.tipo = MSG_PONG;
+			enviar_mensagem(&pong);
+			break;
+		}
+
 		case MSG_CONECTAR:
 			// Só processa se for conexão inicial (tem jogador_id)
 			if (msg->jogador_id != 0) {
 				cliente.id = msg->jogador_id;
 				cliente.estado.meu_id = msg->jogador_id;
+				// Resposta à negociação: capacidades aceitas pelo servidor
+				if (msg->tamanho_dados >= sizeof(uint32_t)) {
+					memcpy(&cliente.capacidades, msg->dados, sizeof(uint32_t));
+				}
+				cliente.token_sessao = 0;
+				if ((cliente.capacidades & CAP_SESSAO) && msg->tamanho_dados >= SESSAO_TAMANHO_DADOS) {
+					memcpy(&cliente.token_sessao, msg->dados + sizeof(uint32_t), sizeof(uint64_t));
+				}
 				snprintf(cliente.estado.mensagem_temporaria, sizeof(cliente.estado.mensagem_temporaria),
 				         "Conectado! ID: %u", cliente.id);
 				cliente.estado.tempo_mensagem = 3.0f;
@@ -190,6 +260,16 @@ void processar_mensagem_recebida(Mensagem* msg) {
 				snprintf(cliente.estado.mensagem_temporaria, sizeof(cliente.estado.mensagem_temporaria),
 				         "Jogador saiu! Aguardando outro jogador...");
 				cliente.estado.tempo_mensagem = 3.0f;
+			} else if (msg->jogador_id == cliente.id && cliente.retomando_sessao) {
+				// Voltei ao meu assento; na partida o estado completo vem em seguida
+				cliente.retomando_sessao = false;
+				cliente.estado.sala_id = msg->sala_id;
+				cliente.estado.num_jogadores_sala = 2;
+				if (!cliente.estado.em_partida) cliente.estado.tela_atual = TELA_LOBBY;
+				cliente.estado.precisa_reconfigurar_botoes = true;
+				snprintf(cliente.estado.mensagem_temporaria, sizeof(cliente.estado.mensagem_temporaria),
+				         "Reconectado! De volta a sala %u", msg->sala_id);
+				cliente.estado.tempo_mensagem = 3.0f;
 			} else if (msg->jogador_id == cliente.id) {
 				// EU entrei na sala
 				cliente.estado.sala_id = msg->sala_id;
@@ -206,15 +286,35 @@ void processar_mensagem_recebida(Mensagem* msg) {
 			}
 			break;
 		case MSG_LISTAR_SALAS: {
+			if (cliente.lista_salas_nova) {
+				cliente.estado.num_salas = 0;
+				cliente.lista_salas_nova = false;
+			}
+
+			// Acumula páginas até encher a lista; sala_id traz o cursor da próxima
 			int num = msg->tamanho_dados / sizeof(InfoSala);
-			cliente.estado.num_salas = num;
-			memcpy(cliente.estado.salas, msg->dados, msg->tamanho_dados);
+			if (num > MAX_SALAS - cliente.estado.num_salas) num = MAX_SALAS - cliente.estado.num_salas;
+			memcpy(&cliente.estado.salas[cliente.estado.num_salas], msg->dados, num * sizeof(InfoSala));
+			cliente.estado.num_salas += num;
+			if (msg->sala_id != 0 && cliente.estado.num_salas < MAX_SALAS) {
+				cliente.proxima_pagina_salas = msg->sala_id;
+			}
+
 			cliente.estado.tela_atual = TELA_LISTAR_SALAS;
 			cliente.estado.precisa_reconfigurar_botoes = true;
 			break;
 		}
+		case MSG_EVENTOS_LOBBY:
+			aplicar_eventos_lobby(msg);
+			break;
 		case MSG_ESTADO_JOGO:
-			memcpy(&cliente.estado.estado_jogo, msg->dados, sizeof(EstadoJogo));
+		case MSG_ESTADO_DELTA:
+			if (msg->tipo == MSG_ESTADO_JOGO) {
+				memcpy(&cliente.estado.estado_jogo, msg->dados, sizeof(EstadoJogo));
+			} else if (!estado_delta_aplicar(&cliente.estado.estado_jogo, msg->dados, msg->tamanho_dados)) {
+				printf("Delta de estado inválido recebido\n");
+				break;
+			}
 
 			// Atualiza aguardando_resposta_canto baseado no estado recebido
 			cliente.estado.aguardando_resposta_canto = cliente.estado.estado_jogo.aguardando_resposta;
@@ -279,6 +379,16 @@ void processar_mensagem_recebida(Mensagem* msg) {
 				         "Erro na operacao!");
 			}
 			cliente.estado.tempo_mensagem = 3.0f;
+
+			// Assento não pôde ser retomado (reserva vencida ou partida encerrada)
+			if (cliente.retomando_sessao) {
+				cliente.retomando_sessao = false;
+				cliente.estado.sala_id = 0;
+				cliente.estado.num_jogadores_sala = 0;
+				cliente.estado.em_partida = false;
+				cliente.estado.tela_atual = TELA_MENU_PRINCIPAL;
+				cliente.estado.precisa_reconfigurar_botoes = true;
+			}
 			break;
 		default:
 			break;
@@ -294,7 +404,7 @@ void* thread_receber_mensagens(void* arg) {
 	const int DELAY_BASE = 2;
 
 	while (cliente.conectado) {
-		bool recebeu = recv_all(cliente.socket, &msg, sizeof(Mensagem));
+		bool recebeu = protocolo_receber(cliente.socket, &msg);
 
 		if (recebeu) {
 			processar_mensagem_recebida(&msg);
@@ -336,23 +446,24 @@ void* thread_receber_mensagens(void* arg) {
 					if (connect_result == 0) {
 						printf("Reconectado com sucesso!\n");
 
-						// Resetar estado do cliente (perdeu contexto no servidor)
+						// Com sessão o servidor guarda o assento; sem ela o contexto se perdeu
 						pthread_mutex_lock(&cliente.mutex_estado);
-						cliente.estado.sala_id = 0;
-						cliente.estado.num_jogadores_sala = 0;
-						cliente.estado.tela_atual = TELA_MENU_PRINCIPAL;
-						cliente.estado.precisa_reconfigurar_botoes = true;
+						cliente.retomando_sessao = cliente.token_sessao != 0 && cliente.estado.sala_id != 0;
+						if (!cliente.retomando_sessao) {
+							cliente.estado.sala_id = 0;
+							cliente.estado.num_jogadores_sala = 0;
+							cliente.estado.tela_atual = TELA_MENU_PRINCIPAL;
+							cliente.estado.precisa_reconfigurar_botoes = true;
+						}
 						snprintf(cliente.estado.mensagem_temporaria,
 						         sizeof(cliente.estado.mensagem_temporaria),
-						         "Reconectado! Voltando ao menu...");
+						         cliente.retomando_sessao ? "Reconectado! Retomando a partida..."
+						                                  : "Reconectado! Voltando ao menu...");
 						cliente.estado.tempo_mensagem = 3.0f;
 						pthread_mutex_unlock(&cliente.mutex_estado);
 
-						// Reautenticar com servidor
-						Mensagem msg_conectar;
-						memset(&msg_conectar, 0, sizeof(Mensagem));
-						msg_conectar.tipo = MSG_CONECTAR;
-						if (send(cliente.socket, &msg_conectar, sizeof(Mensagem), 0) > 0) {
+						// Reautenticar com servidor (renegocia o protocolo)
+						if (negociar_capacidades()) {
 							reconectou = true;
 							break;
 						} else {
@@ -390,6 +501,7 @@ void* thread_receber_mensagens(void* arg) {
 // Implementação dos callbacks
 void callback_criar_sala(void* data) {
 	(void)data;
+	assinar_lobby(false);
 	cliente.estado.tela_atual = TELA_CRIAR_SALA;
 	memset(cliente.estado.input_texto, 0, sizeof(cliente.estado.input_texto));
 }
@@ -407,29 +519,46 @@ void callback_confirmar_criar_sala(void* data) {
 	Mensagem msg;
 	memset(&msg, 0, sizeof(Mensagem));
 	msg.tipo = MSG_CRIAR_SALA;
-	strncpy((char*)msg.dados, cliente.estado.input_texto, sizeof(msg.dados) - 1);
+	strncpy((char*)msg.dados, cliente.estado.input_texto, 63);
+	msg.tamanho_dados = 64;  // Nome da sala ocupa um campo fixo de 64 bytes
 
 	enviar_mensagem(&msg);
 }
 
-void callback_listar_salas(void* data) {
-	(void)data;
-
+bool pedir_pagina_salas(uint32_t cursor) {
 	Mensagem msg;
 	memset(&msg, 0, sizeof(Mensagem));
 	msg.tipo = MSG_LISTAR_SALAS;
 
-	enviar_mensagem(&msg);
+	PedidoListaSalas pedido;
+	memset(&pedido, 0, sizeof(PedidoListaSalas));
+	pedido.cursor = cursor;
+	memcpy(msg.dados, &pedido, sizeof(PedidoListaSalas));
+	msg.tamanho_dados = sizeof(PedidoListaSalas);
+
+	return enviar_mensagem(&msg);
+}
+
+void callback_listar_salas(void* data) {
+	(void)data;
+
+	// Assina antes de listar: mudanças feitas entre as duas respostas chegam como eventos
+	assinar_lobby(true);
+	cliente.lista_salas_nova = true;
+	cliente.proxima_pagina_salas = 0;
+	pedir_pagina_salas(0);
 	// A tela será mudada quando recebermos MSG_LISTAR_SALAS
 }
 
 void callback_entrar_sala(void* data) {
 	uint32_t* sala_id = (uint32_t*)data;
+	assinar_lobby(false);
 
 	Mensagem msg;
 	memset(&msg, 0, sizeof(Mensagem));
 	msg.tipo = MSG_ENTRAR_SALA;
 	memcpy(msg.dados, sala_id, sizeof(uint32_t));
+	msg.tamanho_dados = sizeof(uint32_t);
 
 	enviar_mensagem(&msg);
 }
@@ -446,6 +575,7 @@ void callback_iniciar_partida(void* data) {
 
 void callback_voltar_menu(void* data) {
 	(void)data;
+	assinar_lobby(false);
 
 	// Se estava em uma sala, notifica servidor
 	if (cliente.estado.sala_id != 0) {
@@ -493,6 +623,7 @@ void callback_jogar_carta(void* data) {
 	memset(&msg, 0, sizeof(Mensagem));
 	msg.tipo = MSG_JOGAR_CARTA;
 	memcpy(msg.dados, &indice, sizeof(int));
+	msg.tamanho_dados = sizeof(int);
 
 	enviar_mensagem(&msg);
 
@@ -609,14 +740,17 @@ void callback_quero(void* data) {
 		msg.tipo = MSG_RESPOSTA_TRUCO;
 		RespostaTruco resp = RESPOSTA_QUERO;
 		memcpy(msg.dados, &resp, sizeof(RespostaTruco));
+		msg.tamanho_dados = sizeof(RespostaTruco);
 	} else if (cliente.estado.tipo_canto_aguardando == MSG_ENVIDO) {
 		msg.tipo = MSG_RESPOSTA_ENVIDO;
 		RespostaEnvido resp = ENVIDO_QUERO;
 		memcpy(msg.dados, &resp, sizeof(RespostaEnvido));
+		msg.tamanho_dados = sizeof(RespostaEnvido);
 	} else if (cliente.estado.tipo_canto_aguardando == MSG_FLOR) {
 		msg.tipo = MSG_RESPOSTA_FLOR;
 		RespostaFlor resp = FLOR_QUERO;
 		memcpy(msg.dados, &resp, sizeof(RespostaFlor));
+		msg.tamanho_dados = sizeof(RespostaFlor);
 	}
 
 	enviar_mensagem(&msg);
@@ -633,14 +767,17 @@ void callback_nao_quero(void* data) {
 		msg.tipo = MSG_RESPOSTA_TRUCO;
 		RespostaTruco resp = RESPOSTA_NAO_QUERO;
 		memcpy(msg.dados, &resp, sizeof(RespostaTruco));
+		msg.tamanho_dados = sizeof(RespostaTruco);
 	} else if (cliente.estado.tipo_canto_aguardando == MSG_ENVIDO) {
 		msg.tipo = MSG_RESPOSTA_ENVIDO;
 		RespostaEnvido resp = ENVIDO_NAO_QUERO;
 		memcpy(msg.dados, &resp, sizeof(RespostaEnvido));
+		msg.tamanho_dados = sizeof(RespostaEnvido);
 	} else if (cliente.estado.tipo_canto_aguardando == MSG_FLOR) {
 		msg.tipo = MSG_RESPOSTA_FLOR;
 		RespostaFlor resp = FLOR_NAO_QUERO;
 		memcpy(msg.dados, &resp, sizeof(RespostaFlor));
+		msg.tamanho_dados = sizeof(RespostaFlor);
 	}
 
 	enviar_mensagem(&msg);
@@ -655,6 +792,7 @@ void callback_retruco(void* data) {
 	msg.tipo = MSG_RESPOSTA_TRUCO;
 	RespostaTruco resp = RESPOSTA_RETRUCO;
 	memcpy(msg.dados, &resp, sizeof(RespostaTruco));
+	msg.tamanho_dados = sizeof(RespostaTruco);
 
 	enviar_mensagem(&msg);
 	cliente.estado.aguardando_resposta_canto = false;
@@ -668,6 +806,7 @@ void callback_vale_quatro(void* data) {
 	msg.tipo = MSG_RESPOSTA_TRUCO;
 	RespostaTruco resp = RESPOSTA_VALE_QUATRO;
 	memcpy(msg.dados, &resp, sizeof(RespostaTruco));
+	msg.tamanho_dados = sizeof(RespostaTruco);
 
 	enviar_mensagem(&msg);
 	cliente.estado.aguardando_resposta_canto = false;
@@ -681,6 +820,7 @@ void callback_real_envido(void* data) {
 	msg.tipo = MSG_RESPOSTA_ENVIDO;
 	RespostaEnvido resp = ENVIDO_REAL_ENVIDO;
 	memcpy(msg.dados, &resp, sizeof(RespostaEnvido));
+	msg.tamanho_dados = sizeof(RespostaEnvido);
 
 	enviar_mensagem(&msg);
 	cliente.estado.aguardando_resposta_canto = false;
@@ -694,6 +834,7 @@ void callback_falta_envido(void* data) {
 	msg.tipo = MSG_RESPOSTA_ENVIDO;
 	RespostaEnvido resp = ENVIDO_FALTA_ENVIDO;
 	memcpy(msg.dados, &resp, sizeof(RespostaEnvido));
+	msg.tamanho_dados = sizeof(RespostaEnvido);
 
 	enviar_mensagem(&msg);
 	cliente.estado.aguardando_resposta_canto = false;
@@ -885,6 +1026,12 @@ int main(int argc, char* argv[]) {
 			cliente.estado.precisa_reconfigurar_botoes = false;
 		}
 
+		// Páginas seguintes da lista de salas são pedidas pela thread principal
+		if (cliente.proxima_pagina_salas != 0) {
+			pedir_pagina_salas(cliente.proxima_pagina_salas);
+			cliente.proxima_pagina_salas = 0;
+		}
+
 		// Renderizar
 		ui_renderizar(&cliente.ui, &cliente.estado);
 		pthread_mutex_unlock(&cliente.mutex_estado);
@@ -44,6 +44,61 @@ const char* numero_para_string(NumeroCarta numero) {
 	}
 }
 
+const char* tipo_mensagem_para_string(TipoMensagem tipo) {
+	switch (tipo) {
+		case MSG_CONECTAR:
+			return "CONECTAR";
+		case MSG_CRIAR_SALA:
+			return "CRIAR_SALA";
+		case MSG_ENTRAR_SALA:
+			return "ENTRAR_SALA";
+		case MSG_LISTAR_SALAS:
+			return "LISTAR_SALAS";
+		case MSG_INICIAR_PARTIDA:
+			return "INICIAR_PARTIDA";
+		case MSG_JOGAR_CARTA:
+			return "JOGAR_CARTA";
+		case MSG_TRUCO:
+			return "TRUCO";
+		case MSG_RESPOSTA_TRUCO:
+			return "RESPOSTA_TRUCO";
+		case MSG_ENVIDO:
+			return "ENVIDO";
+		case MSG_RESPOSTA_ENVIDO:
+			return "RESPOSTA_ENVIDO";
+		case MSG_FLOR:
+			return "FLOR";
+		case MSG_RESPOSTA_FLOR:
+			return "RESPOSTA_FLOR";
+		case MSG_ESTADO_JOGO:
+			return "ESTADO_JOGO";
+		case MSG_RESULTADO_RODADA:
+			return "RESULTADO_RODADA";
+		case MSG_FIM_PARTIDA:
+			return "FIM_PARTIDA";
+		case MSG_ERRO:
+			return "ERRO";
+		case MSG_DESCONECTAR:
+			return "DESCONECTAR";
+		case MSG_IR_BARALHO:
+			return "IR_BARALHO";
+		case MSG_SAIR_SALA:
+			return "SAIR_SALA";
+		case MSG_ESTADO_DELTA:
+			return "ESTADO_DELTA";
+		case MSG_ASSINAR_LOBBY:
+			return "ASSINAR_LOBBY";
+		case MSG_EVENTOS_LOBBY:
+			return "EVENTOS_LOBBY";
+		case MSG_PING:
+			return "PING";
+		case MSG_PONG:
+			return "PONG";
+		default:
+			return "DESCONHECIDA";
+	}
+}
+
 void imprimir_carta(Carta carta) {
 	printf("%s de %s", numero_para_string(carta.numero), naipe_para_string(carta.naipe));
 }
@@ -0,0 +1,142 @@
+#include "diretorio_salas.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool diretorio_inicializar(DiretorioSalas* diretorio, uint32_t capacidade) {
+	memset(diretorio, 0, sizeof(DiretorioSalas));
+	diretorio->capacidade = capacidade;
+
+	uint32_t num_blocos = (capacidade + DIRETORIO_ENTRADAS_POR_BLOCO - 1) / DIRETORIO_ENTRADAS_POR_BLOCO;
+	diretorio->blocos = calloc(num_blocos, sizeof(*diretorio->blocos));
+	diretorio->alterados = calloc((capacidade + 63) / 64, sizeof(*diretorio->alterados));
+	return diretorio->blocos != NULL && diretorio->alterados != NULL;
+}
+
+static EntradaDiretorio* obter_entrada(DiretorioSalas* diretorio, uint32_t slot, bool criar) {
+	if (slot >= diretorio->capacidade) return NULL;
+
+	_Atomic(EntradaDiretorio*)* bloco = &diretorio->blocos[slot / DIRETORIO_ENTRADAS_POR_BLOCO];
+	EntradaDiretorio* entradas = atomic_load_explicit(bloco, memory_order_acquire);
+	if (!entradas && criar) {
+		// Dois escritores podem criar o mesmo bloco; o perdedor descarta o seu
+		EntradaDiretorio* novas = calloc(DIRETORIO_ENTRADAS_POR_BLOCO, sizeof(EntradaDiretorio));
+		if (!novas) return NULL;
+		if (atomic_compare_exchange_strong_explicit(bloco, &entradas, novas,
+		                                            memory_order_acq_rel, memory_order_acquire)) {
+			entradas = novas;
+		} else {
+			free(novas);
+		}
+	}
+	if (!entradas) return NULL;
+	return &entradas[slot % DIRETORIO_ENTRADAS_POR_BLOCO];
+}
+
+static void iniciar_escrita(EntradaDiretorio* entrada) {
+	uint32_t sequencia = atomic_load_explicit(&entrada->sequencia, memory_order_relaxed);
+	for (;;) {
+		if (!(sequencia & 1) &&
+		    atomic_compare_exchange_weak_explicit(&entrada->sequencia, &sequencia, sequencia + 1,
+		                                          memory_order_acquire, memory_order_relaxed)) {
+			break;
+		}
+		sequencia = atomic_load_explicit(&entrada->sequencia, memory_order_relaxed);
+	}
+	atomic_thread_fence(memory_order_release);
+}
+
+static void terminar_escrita(DiretorioSalas* diretorio, EntradaDiretorio* entrada, uint32_t slot) {
+	atomic_fetch_add_explicit(&entrada->sequencia, 1, memory_order_release);
+	atomic_fetch_add_explicit(&diretorio->versao, 1, memory_order_release);
+	atomic_fetch_or_explicit(&diretorio->alterados[slot / 64], 1ull << (slot % 64), memory_order_release);
+}
+
+void diretorio_publicar(DiretorioSalas* diretorio, uint32_t slot, const InfoSala* info) {
+	EntradaDiretorio* entrada = obter_entrada(diretorio, slot, true);
+	if (!entrada) return;
+
+	iniciar_escrita(entrada);
+	entrada->info = *info;
+	entrada->ocupada = true;
+	terminar_escrita(diretorio, entrada, slot);
+
+	uint32_t limite = atomic_load_explicit(&diretorio->limite, memory_order_relaxed);
+	while (limite <= slot &&
+	       !atomic_compare_exchange_weak_explicit(&diretorio->limite, &limite, slot + 1,
+	                                              memory_order_release, memory_order_relaxed)) {
+	}
+}
+
+void diretorio_remover(DiretorioSalas* diretorio, uint32_t slot) {
+	EntradaDiretorio* entrada = obter_entrada(diretorio, slot, false);
+	if (!entrada) return;
+
+	iniciar_escrita(entrada);
+	entrada->ocupada = false;
+	terminar_escrita(diretorio, entrada, slot);
+}
+
+uint64_t diretorio_versao(DiretorioSalas* diretorio) {
+	return atomic_load_explicit(&diretorio->versao, memory_order_acquire);
+}
+
+// Cópia consistente de uma entrada; false se o slot está vazio
+static bool ler_entrada(EntradaDiretorio* entrada, InfoSala* info) {
+	for (;;) {
+		uint32_t antes = atomic_load_explicit(&entrada->sequencia, memory_order_acquire);
+		if (antes & 1) continue;
+
+		bool ocupada = entrada->ocupada;
+		*info = entrada->info;
+
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&entrada->sequencia, memory_order_relaxed) == antes) {
+			return ocupada;
+		}
+	}
+}
+
+bool diretorio_ler(DiretorioSalas* diretorio, uint32_t slot, InfoSala* info) {
+	EntradaDiretorio* entrada = obter_entrada(diretorio, slot, false);
+	return entrada && ler_entrada(entrada, info);
+}
+
+void diretorio_coletar_alterados(DiretorioSalas* diretorio, VisitanteDiretorio visitar, void* contexto) {
+	uint32_t limite = atomic_load_explicit(&diretorio->limite, memory_order_acquire);
+	for (uint32_t palavra = 0; palavra < (limite + 63) / 64; palavra++) {
+		uint64_t bits = atomic_exchange_explicit(&diretorio->alterados[palavra], 0, memory_order_acquire);
+		while (bits) {
+			int bit = __builtin_ctzll(bits);
+			bits &= bits - 1;
+			visitar(palavra * 64 + (uint32_t)bit, contexto);
+		}
+	}
+}
+
+static bool aceita_filtro(const InfoSala* info, const PedidoListaSalas* filtro) {
+	if (!filtro) return true;
+	if (filtro->apenas_abertas && (info->em_partida || info->num_jogadores >= info->max_jogadores)) {
+		return false;
+	}
+	size_t tamanho_prefixo = strnlen(filtro->prefixo, sizeof(filtro->prefixo));
+	return strncmp(info->nome, filtro->prefixo, tamanho_prefixo) == 0;
+}
+
+int diretorio_listar(DiretorioSalas* diretorio, uint32_t* cursor, const PedidoListaSalas* filtro,
+                     InfoSala* saida, int max) {
+	uint32_t limite = atomic_load_explicit(&diretorio->limite, memory_order_acquire);
+	uint32_t slot = *cursor;
+	int num = 0;
+
+	while (slot < limite && num < max) {
+		EntradaDiretorio* entrada = obter_entrada(diretorio, slot, false);
+		slot++;
+		if (entrada && ler_entrada(entrada, &saida[num]) && aceita_filtro(&saida[num], filtro)) {
+			num++;
+		}
+	}
+
+	*cursor = slot < limite ? slot : 0;
+	return num;
+}
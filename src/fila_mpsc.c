@@ -0,0 +1,45 @@
+#include "fila_mpsc.h"
+
+#include <stddef.h>
+
+void fila_mpsc_inicializar(FilaMpsc* fila) {
+	atomic_store_explicit(&fila->stub.proximo, NULL, memory_order_relaxed);
+	atomic_store_explicit(&fila->cabeca, &fila->stub, memory_order_relaxed);
+	fila->cauda = &fila->stub;
+}
+
+void fila_mpsc_inserir(FilaMpsc* fila, NoFilaMpsc* no) {
+	atomic_store_explicit(&no->proximo, NULL, memory_order_relaxed);
+	NoFilaMpsc* anterior = atomic_exchange_explicit(&fila->cabeca, no, memory_order_acq_rel);
+	atomic_store_explicit(&anterior->proximo, no, memory_order_release);
+}
+
+NoFilaMpsc* fila_mpsc_remover(FilaMpsc* fila) {
+	NoFilaMpsc* cauda = fila->cauda;
+	NoFilaMpsc* proximo = atomic_load_explicit(&cauda->proximo, memory_order_acquire);
+
+	// Pula o nó sentinela
+	if (cauda == &fila->stub) {
+		if (!proximo) return NULL;
+		fila->cauda = proximo;
+		cauda = proximo;
+		proximo = atomic_load_explicit(&cauda->proximo, memory_order_acquire);
+	}
+
+	if (proximo) {
+		fila->cauda = proximo;
+		return cauda;
+	}
+
+	// Um produtor trocou a cabeça mas ainda não ligou o nó: tenta de novo depois
+	if (cauda != atomic_load_explicit(&fila->cabeca, memory_order_acquire)) return NULL;
+
+	// Último nó: reinsere o sentinela para poder removê-lo
+	fila_mpsc_inserir(fila, &fila->stub);
+	proximo = atomic_load_explicit(&cauda->proximo, memory_order_acquire);
+	if (proximo) {
+		fila->cauda = proximo;
+		return cauda;
+	}
+	return NULL;
+}
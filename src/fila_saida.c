@@ -0,0 +1,241 @@
+#include "fila_saida.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+void fila_saida_inicializar(FilaSaida* fila) {
+	memset(fila, 0, sizeof(FilaSaida));
+	fila_mpsc_inicializar(&fila->entrada);
+}
+
+BufferCompartilhado* buffer_compartilhado_criar(const void* dados, size_t tamanho) {
+	BufferCompartilhado* buffer = malloc(sizeof(BufferCompartilhado) + tamanho);
+	if (!buffer) return NULL;
+	atomic_init(&buffer->referencias, 1);
+	buffer->tamanho = tamanho;
+	memcpy(buffer->dados, dados, tamanho);
+	return buffer;
+}
+
+void buffer_compartilhado_reter(BufferCompartilhado* buffer) {
+	atomic_fetch_add_explicit(&buffer->referencias, 1, memory_order_relaxed);
+}
+
+void buffer_compartilhado_liberar(BufferCompartilhado* buffer) {
+	if (atomic_fetch_sub_explicit(&buffer->referencias, 1, memory_order_acq_rel) == 1) {
+		free(buffer);
+	}
+}
+
+static void liberar_segmento(SegmentoSaida* segmento) {
+	if (segmento->compartilhado) {
+		buffer_compartilhado_liberar(segmento->compartilhado);
+	} else {
+		free(segmento->dados);
+	}
+}
+
+static void liberar_quadro(QuadroSaida* quadro) {
+	if (quadro->compartilhado) buffer_compartilhado_liberar(quadro->compartilhado);
+	free(quadro);
+}
+
+void fila_saida_limpar(FilaSaida* fila) {
+	NoFilaMpsc* no;
+	while ((no = fila_mpsc_remover(&fila->entrada)) != NULL) {
+		liberar_quadro((QuadroSaida*)no);
+	}
+	for (int i = 0; i < fila->num_segmentos; i++) {
+		liberar_segmento(&fila->segmentos[i]);
+	}
+	free(fila->segmentos);
+	fila_saida_inicializar(fila);
+}
+
+static bool reservar_segmento(FilaSaida* fila) {
+	if (fila->num_segmentos == fila->capacidade_segmentos) {
+		int nova_capacidade = fila->capacidade_segmentos ? fila->capacidade_segmentos * 2 : 4;
+		SegmentoSaida* novos = realloc(fila->segmentos, nova_capacidade * sizeof(SegmentoSaida));
+		if (!novos) return false;
+		fila->segmentos = novos;
+		fila->capacidade_segmentos = nova_capacidade;
+	}
+	return true;
+}
+
+static SegmentoSaida* novo_segmento(FilaSaida* fila, size_t capacidade) {
+	if (!reservar_segmento(fila)) return NULL;
+
+	SegmentoSaida* segmento = &fila->segmentos[fila->num_segmentos];
+	segmento->dados = malloc(capacidade);
+	if (!segmento->dados) return NULL;
+	segmento->tamanho = 0;
+	segmento->capacidade = capacidade;
+	segmento->compartilhado = NULL;
+	fila->num_segmentos++;
+	return segmento;
+}
+
+static bool acrescentar(FilaSaida* fila, const void* dados, size_t tamanho) {
+	// Coalesce no último bloco enquanto couber
+	SegmentoSaida* ultimo = fila->num_segmentos ? &fila->segmentos[fila->num_segmentos - 1] : NULL;
+	if (!ultimo || ultimo->capacidade - ultimo->tamanho < tamanho) {
+		ultimo = novo_segmento(fila, tamanho > FILA_SAIDA_TAMANHO_BLOCO ? tamanho : FILA_SAIDA_TAMANHO_BLOCO);
+		if (!ultimo) return false;
+	}
+
+	memcpy(ultimo->dados + ultimo->tamanho, dados, tamanho);
+	ultimo->tamanho += tamanho;
+	fila->total += tamanho;
+	return true;
+}
+
+static bool acrescentar_compartilhado(FilaSaida* fila, BufferCompartilhado* buffer) {
+	if (!reservar_segmento(fila)) return false;
+
+	// Segmento cheio (capacidade == tamanho): quadros seguintes vão para um bloco novo
+	SegmentoSaida* segmento = &fila->segmentos[fila->num_segmentos++];
+	segmento->dados = buffer->dados;
+	segmento->tamanho = buffer->tamanho;
+	segmento->capacidade = buffer->tamanho;
+	segmento->compartilhado = buffer;
+	buffer_compartilhado_reter(buffer);
+	fila->total += buffer->tamanho;
+	return true;
+}
+
+// O contador sobe antes da inserção, então o escritor nunca o vê abaixo do
+// número de nós na fila de entrada
+static bool entregar(FilaSaida* fila, QuadroSaida* quadro) {
+	atomic_fetch_add_explicit(&fila->bytes_pendentes, quadro->tamanho, memory_order_relaxed);
+	bool vazia = atomic_fetch_add_explicit(&fila->quadros_entrada, 1, memory_order_acq_rel) == 0;
+	fila_mpsc_inserir(&fila->entrada, &quadro->no);
+	return vazia;
+}
+
+bool fila_saida_enviar(FilaSaida* fila, const void* dados, size_t tamanho) {
+	QuadroSaida* quadro = malloc(sizeof(QuadroSaida) + tamanho);
+	if (!quadro) return false;
+	quadro->compartilhado = NULL;
+	quadro->tamanho = tamanho;
+	memcpy(quadro->dados, dados, tamanho);
+	return entregar(fila, quadro);
+}
+
+bool fila_saida_enviar_compartilhado(FilaSaida* fila, BufferCompartilhado* buffer) {
+	QuadroSaida* quadro = malloc(sizeof(QuadroSaida));
+	if (!quadro) return false;
+	buffer_compartilhado_reter(buffer);
+	quadro->compartilhado = buffer;
+	quadro->tamanho = buffer->tamanho;
+	return entregar(fila, quadro);
+}
+
+size_t fila_saida_pendente(FilaSaida* fila) {
+	return atomic_load_explicit(&fila->bytes_pendentes, memory_order_relaxed);
+}
+
+// Passa os quadros entregues por outras threads para os blocos da fila
+static void coletar_entrada(FilaSaida* fila) {
+	uint32_t pendentes = atomic_load_explicit(&fila->quadros_entrada, memory_order_acquire);
+	while (pendentes > 0) {
+		uint32_t coletados = 0;
+		while (coletados < pendentes) {
+			NoFilaMpsc* no = fila_mpsc_remover(&fila->entrada);
+			if (!no) {
+				sched_yield();  // Um produtor contou o quadro mas ainda não o ligou à fila
+				continue;
+			}
+			QuadroSaida* quadro = (QuadroSaida*)no;
+			bool acrescentado = quadro->compartilhado ? acrescentar_compartilhado(fila, quadro->compartilhado)
+			                                          : acrescentar(fila, quadro->dados, quadro->tamanho);
+			if (!acrescentado) {
+				atomic_fetch_sub_explicit(&fila->bytes_pendentes, quadro->tamanho, memory_order_relaxed);
+			}
+			liberar_quadro(quadro);
+			coletados++;
+		}
+		pendentes = atomic_fetch_sub_explicit(&fila->quadros_entrada, coletados, memory_order_acq_rel) - coletados;
+	}
+}
+
+// Remove os bytes enviados do início da fila
+static void consumir(FilaSaida* fila, size_t bytes) {
+	fila->total -= bytes;
+	fila->bytes_enviados += bytes;
+	atomic_fetch_sub_explicit(&fila->bytes_pendentes, bytes, memory_order_relaxed);
+
+	int removidos = 0;
+	while (removidos < fila->num_segmentos && bytes > 0) {
+		SegmentoSaida* segmento = &fila->segmentos[removidos];
+		size_t restante = segmento->tamanho - fila->enviado;
+		if (bytes < restante) {
+			fila->enviado += bytes;
+			break;
+		}
+		bytes -= restante;
+		fila->enviado = 0;
+		liberar_segmento(segmento);
+		removidos++;
+	}
+
+	if (removidos > 0) {
+		memmove(fila->segmentos, fila->segmentos + removidos,
+		        (fila->num_segmentos - removidos) * sizeof(SegmentoSaida));
+		fila->num_segmentos -= removidos;
+	}
+}
+
+int fila_saida_preparar(FilaSaida* fila, struct iovec* iov, int max_iov) {
+	coletar_entrada(fila);
+	int num_iov = 0;
+	for (int i = 0; i < fila->num_segmentos && num_iov < max_iov; i++) {
+		size_t inicio = (i == 0) ? fila->enviado : 0;
+		iov[num_iov].iov_base = fila->segmentos[i].dados + inicio;
+		iov[num_iov].iov_len = fila->segmentos[i].tamanho - inicio;
+		num_iov++;
+	}
+	return num_iov;
+}
+
+void fila_saida_confirmar(FilaSaida* fila, size_t bytes) {
+	consumir(fila, bytes);
+}
+
+size_t fila_saida_copiar(FilaSaida* fila, uint8_t* destino, size_t capacidade) {
+	coletar_entrada(fila);
+	size_t copiado = 0;
+	for (int i = 0; i < fila->num_segmentos && copiado < capacidade; i++) {
+		size_t inicio = (i == 0) ? fila->enviado : 0;
+		size_t tamanho = fila->segmentos[i].tamanho - inicio;
+		if (tamanho > capacidade - copiado) tamanho = capacidade - copiado;
+		memcpy(destino + copiado, fila->segmentos[i].dados + inicio, tamanho);
+		copiado += tamanho;
+	}
+	return fila->total;
+}
+
+ResultadoDescarga fila_saida_descarregar(FilaSaida* fila, int socket) {
+	struct iovec iov[FILA_SAIDA_MAX_IOV];
+	int num_iov;
+	while ((num_iov = fila_saida_preparar(fila, iov, FILA_SAIDA_MAX_IOV)) > 0) {
+		// sendmsg com iovec equivale a writev, mas aceita MSG_NOSIGNAL
+		struct msghdr cabecalho;
+		memset(&cabecalho, 0, sizeof(cabecalho));
+		cabecalho.msg_iov = iov;
+		cabecalho.msg_iovlen = num_iov;
+
+		ssize_t escrito = sendmsg(socket, &cabecalho, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (escrito < 0) {
+			if (errno == EINTR) continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK) return DESCARGA_PENDENTE;
+			return DESCARGA_ERRO;
+		}
+		consumir(fila, (size_t)escrito);
+	}
+	return DESCARGA_COMPLETA;
+}
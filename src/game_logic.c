@@ -3,7 +3,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 
 // Inicializar baralho com 40 cartas (sem 8 e 9)
 void inicializar_baralho(Baralho* baralho) {
@@ -20,10 +19,57 @@ void inicializar_baralho(Baralho* baralho) {
 	baralho->topo = 0;
 }
 
-void embaralhar(Baralho* baralho) {
-	srand(time(NULL));
+uint64_t misturar_semente(uint64_t valor) {
+	valor += 0x9E3779B97F4A7C15ull;
+	valor = (valor ^ (valor >> 30)) * 0xBF58476D1CE4E5B9ull;
+	valor = (valor ^ (valor >> 27)) * 0x94D049BB133111EBull;
+	return valor ^ (valor >> 31);
+}
+
+void gerador_semear(GeradorAleatorio* gerador, uint64_t semente) {
+	// splitmix64 espalha a semente pelos 256 bits; o estado nunca fica todo zero
+	for (int i = 0; i < 4; i++) {
+		semente += 0x9E3779B97F4A7C15ull;
+		gerador->s[i] = misturar_semente(semente);
+	}
+}
+
+static inline uint64_t rotacionar(uint64_t x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+uint64_t gerador_proximo(GeradorAleatorio* gerador) {
+	uint64_t* s = gerador->s;
+	uint64_t resultado = rotacionar(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotacionar(s[3], 45);
+
+	return resultado;
+}
+
+uint32_t gerador_intervalo(GeradorAleatorio* gerador, uint32_t limite) {
+	// Multiplicação de Lemire, rejeitando a faixa que causaria viés
+	uint64_t produto = (gerador_proximo(gerador) >> 32) * limite;
+	uint32_t baixo = (uint32_t)produto;
+	if (baixo < limite) {
+		uint32_t minimo = -limite % limite;
+		while (baixo < minimo) {
+			produto = (gerador_proximo(gerador) >> 32) * limite;
+			baixo = (uint32_t)produto;
+		}
+	}
+	return (uint32_t)(produto >> 32);
+}
+
+void embaralhar(Baralho* baralho, GeradorAleatorio* gerador) {
 	for (int i = 39; i > 0; i--) {
-		int j = rand() % (i + 1);
+		int j = (int)gerador_intervalo(gerador, (uint32_t)(i + 1));
 		Carta temp = baralho->cartas[i];
 		baralho->cartas[i] = baralho->cartas[j];
 		baralho->cartas[j] = temp;
@@ -35,9 +81,11 @@ Carta pegar_carta(Baralho* baralho) {
 	return baralho->cartas[baralho->topo++];
 }
 
-void inicializar_jogo(Jogo* jogo, uint32_t sala_id) {
+void inicializar_jogo(Jogo* jogo, uint32_t sala_id, uint64_t semente) {
 	memset(jogo, 0, sizeof(Jogo));
 	jogo->sala_id = sala_id;
+	jogo->semente = semente;
+	gerador_semear(&jogo->gerador, semente);
 	jogo->pontos_jogador1 = 0;
 	jogo->pontos_jogador2 = 0;
 	jogo->valor_rodada = 1;
@@ -47,7 +95,7 @@ void inicializar_jogo(Jogo* jogo, uint32_t sala_id) {
 }
 
 void distribuir_cartas(Jogo* jogo) {
-	embaralhar(&jogo->baralho);
+	embaralhar(&jogo->baralho, &jogo->gerador);
 
 	// Distribui 3 cartas para cada jogador
 	for (int i = 0; i < 3; i++) {
@@ -90,89 +138,94 @@ void nova_mao(Jogo* jogo) {
 	distribuir_cartas(jogo);
 }
 
-// Hierarquia do truco espanhol (do mais forte ao mais fraco)
+// Tabelas indexadas por IndiceCarta; a posição 40 é a carta inválida
+#define LINHA_INDICES(base)                                                                      \
+	{CARTA_INVALIDA, (base), (base) + 1, (base) + 2, (base) + 3, (base) + 4, (base) + 5, (base) + 6, \
+	 CARTA_INVALIDA, CARTA_INVALIDA, (base) + 7, (base) + 8, (base) + 9, CARTA_INVALIDA,            \
+	 CARTA_INVALIDA, CARTA_INVALIDA}
+
+// [naipe][número & 15] -> índice
+static const IndiceCarta INDICE_CARTA[4][16] = {
+    LINHA_INDICES(0), LINHA_INDICES(10), LINHA_INDICES(20), LINHA_INDICES(30)};
+
+static const NumeroCarta NUMERO_POR_POSICAO[10] = {NUMERO_AS, NUMERO_2,  NUMERO_3,  NUMERO_4,  NUMERO_5,
+                                                   NUMERO_6,  NUMERO_7,  NUMERO_10, NUMERO_11, NUMERO_12};
+
+// Hierarquia do truco espanhol: 14 (As de espadas) até 1 (os 4s)
+//   posição:  As  2   3  4  5  6  7   10 11 12
+static const uint8_t VALOR_TRUCO[CARTA_INVALIDA + 1] = {
+    14, 9, 10, 1, 2, 3, 12, 5, 6, 7,  // Espadas: As é a Espada Ancha, 7 de espadas
+    13, 9, 10, 1, 2, 3, 4,  5, 6, 7,  // Paus: As é o Espadão
+    8,  9, 10, 1, 2, 3, 4,  5, 6, 7,  // Copas
+    8,  9, 10, 1, 2, 3, 11, 5, 6, 7,  // Ouros: 7 de ouros
+    0};
+
+// Figuras valem 0 no envido
+static const uint8_t VALOR_ENVIDO[CARTA_INVALIDA + 1] = {
+    1, 2, 3, 4, 5, 6, 7, 0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 0, 0, 0,
+    1, 2, 3, 4, 5, 6, 7, 0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 0, 0, 0, 0};
+
+static const uint8_t NAIPE_INDICE[CARTA_INVALIDA + 1] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0};
+
+IndiceCarta carta_para_indice(Carta carta) {
+	return INDICE_CARTA[carta.naipe & 3][carta.numero & 15];
+}
+
+Carta indice_para_carta(IndiceCarta indice) {
+	Carta carta = {(Naipe)NAIPE_INDICE[indice], NUMERO_POR_POSICAO[indice % 10]};
+	return carta;
+}
+
+MascaraMao mascara_mao(const Carta* cartas, int num_cartas) {
+	MascaraMao mascara = 0;
+	for (int i = 0; i < num_cartas; i++) {
+		// A carta inválida cai no bit 40, fora de todos os naipes
+		mascara |= 1ull << carta_para_indice(cartas[i]);
+	}
+	return mascara;
+}
+
 int obter_valor_carta_truco(Carta carta) {
-	// As de espadas (Espada Ancha) - mais forte
-	if (carta.numero == NUMERO_AS && carta.naipe == NAIPE_ESPADAS) return 14;
-	// As de paus (Espadão)
-	if (carta.numero == NUMERO_AS && carta.naipe == NAIPE_PAUS) return 13;
-	// 7 de espadas
-	if (carta.numero == NUMERO_7 && carta.naipe == NAIPE_ESPADAS) return 12;
-	// 7 de ouros
-	if (carta.numero == NUMERO_7 && carta.naipe == NAIPE_OUROS) return 11;
-	// Todos os 3s
-	if (carta.numero == NUMERO_3) return 10;
-	// Todos os 2s
-	if (carta.numero == NUMERO_2) return 9;
-	// As de copas e ouros
-	if (carta.numero == NUMERO_AS) return 8;
-	// Reis (12)
-	if (carta.numero == NUMERO_12) return 7;
-	// Cavalos (11)
-	if (carta.numero == NUMERO_11) return 6;
-	// Valetes (10)
-	if (carta.numero == NUMERO_10) return 5;
-	// 7 de paus e copas
-	if (carta.numero == NUMERO_7) return 4;
-	// 6
-	if (carta.numero == NUMERO_6) return 3;
-	// 5
-	if (carta.numero == NUMERO_5) return 2;
-	// 4
-	if (carta.numero == NUMERO_4) return 1;
-
-	return 0;
+	return VALOR_TRUCO[carta_para_indice(carta)];
 }
 
 int comparar_cartas_truco(Carta c1, Carta c2) {
-	int v1 = obter_valor_carta_truco(c1);
-	int v2 = obter_valor_carta_truco(c2);
-
-	if (v1 > v2) return 1;
-	if (v1 < v2) return -1;
-	return 0;  // Empate
+	int v1 = VALOR_TRUCO[carta_para_indice(c1)];
+	int v2 = VALOR_TRUCO[carta_para_indice(c2)];
+	return (v1 > v2) - (v1 < v2);  // 1, -1 ou 0 (empate)
 }
 
 int calcular_pontos_envido(Jogador* jogador) {
-	int pontos_por_naipe[4] = {0, 0, 0, 0};
-	int cartas_por_naipe[4] = {0, 0, 0, 0};
+	MascaraMao mao = mascara_mao(jogador->mao, jogador->num_cartas) & MASCARA_BARALHO;
 
-	// Conta cartas e pontos por naipe
-	for (int i = 0; i < jogador->num_cartas; i++) {
-		Carta c = jogador->mao[i];
-		int valor = (c.numero <= 7) ? c.numero : 0;  // Figuras valem 0
-		pontos_por_naipe[c.naipe] += valor;
-		cartas_por_naipe[c.naipe]++;
+	int pontos_por_naipe[4] = {0, 0, 0, 0};
+	int maior_carta = 0;
+	for (MascaraMao resto = mao; resto; resto &= resto - 1) {
+		int indice = __builtin_ctzll(resto);
+		int valor = VALOR_ENVIDO[indice];
+		pontos_por_naipe[NAIPE_INDICE[indice]] += valor;
+		maior_carta = (valor > maior_carta) ? valor : maior_carta;
 	}
 
-	// Procura o maior envido
+	// Naipe com duas ou mais cartas: 20 + soma dos valores desse naipe
 	int maior_envido = 0;
-	for (int i = 0; i < 4; i++) {
-		if (cartas_por_naipe[i] >= 2) {
-			int envido = pontos_por_naipe[i] + 20;
-			if (envido > maior_envido) maior_envido = envido;
-		}
+	for (int naipe = 0; naipe < 4; naipe++) {
+		int envido = (__builtin_popcountll(mao & MASCARA_NAIPE(naipe)) >= 2) ? pontos_por_naipe[naipe] + 20 : 0;
+		maior_envido = (envido > maior_envido) ? envido : maior_envido;
 	}
 
-	// Se não tem duas cartas do mesmo naipe, pega a maior carta
-	if (maior_envido == 0) {
-		for (int i = 0; i < jogador->num_cartas; i++) {
-			int valor = (jogador->mao[i].numero <= 7) ? jogador->mao[i].numero : 0;
-			if (valor > maior_envido) maior_envido = valor;
-		}
-	}
-
-	return maior_envido;
+	// Se não tem duas cartas do mesmo naipe, vale a maior carta
+	return maior_envido ? maior_envido : maior_carta;
 }
 
 bool verificar_flor(Jogador* jogador) {
 	if (jogador->num_cartas < 3) return false;
 
-	Naipe primeiro_naipe = jogador->mao[0].naipe;
-	for (int i = 1; i < 3; i++) {
-		if (jogador->mao[i].naipe != primeiro_naipe) return false;
-	}
-	return true;
+	// Flor: as três cartas no naipe da primeira
+	MascaraMao mao = mascara_mao(jogador->mao, 3);
+	return (mao & ~MASCARA_NAIPE(NAIPE_INDICE[carta_para_indice(jogador->mao[0])])) == 0;
 }
 
 bool pode_jogar_carta(Jogo* jogo, int jogador, int indice_carta) {
@@ -648,3 +701,135 @@ EstadoJogo obter_estado_jogo(Jogo* jogo, int jogador) {
 
 	return estado;
 }
+
+// Serialização
+
+static void escrever_u32(uint8_t* saida, uint32_t valor) {
+	for (int i = 0; i < 4; i++) saida[i] = (uint8_t)(valor >> (8 * i));
+}
+
+static void escrever_u64(uint8_t* saida, uint64_t valor) {
+	for (int i = 0; i < 8; i++) saida[i] = (uint8_t)(valor >> (8 * i));
+}
+
+static uint32_t ler_u32(const uint8_t* dados) {
+	uint32_t valor = 0;
+	for (int i = 0; i < 4; i++) valor |= (uint32_t)dados[i] << (8 * i);
+	return valor;
+}
+
+static uint64_t ler_u64(const uint8_t* dados) {
+	uint64_t valor = 0;
+	for (int i = 0; i < 8; i++) valor |= (uint64_t)dados[i] << (8 * i);
+	return valor;
+}
+
+// Cartas ainda não jogadas são zeradas na estrutura e viram CARTA_INVALIDA
+static Carta carta_serializada(uint8_t indice) {
+	Carta vazia = {0, 0};
+	return indice == CARTA_INVALIDA ? vazia : indice_para_carta(indice);
+}
+
+static void serializar_jogador(const Jogador* jogador, uint8_t* saida) {
+	escrever_u32(saida, jogador->id);
+	for (int i = 0; i < 3; i++) saida[4 + i] = carta_para_indice(jogador->mao[i]);
+	saida[7] = (uint8_t)jogador->num_cartas;
+	saida[8] = jogador->pontos_envido;
+	saida[9] = jogador->tem_flor;
+}
+
+static void desserializar_jogador(Jogador* jogador, const uint8_t* dados) {
+	memset(jogador, 0, sizeof(Jogador));
+	jogador->id = ler_u32(dados);
+	for (int i = 0; i < 3; i++) jogador->mao[i] = carta_serializada(dados[4 + i]);
+	jogador->num_cartas = dados[7];
+	jogador->pontos_envido = dados[8];
+	jogador->tem_flor = dados[9] != 0;
+}
+
+void jogo_serializar(const Jogo* jogo, uint8_t* saida) {
+	escrever_u32(saida, jogo->sala_id);
+	escrever_u64(saida + 4, jogo->semente);
+	for (int i = 0; i < 4; i++) escrever_u64(saida + 12 + 8 * i, jogo->gerador.s[i]);
+
+	uint8_t* p = saida + 44;
+	for (int i = 0; i < 40; i++) *p++ = carta_para_indice(jogo->baralho.cartas[i]);
+	*p++ = (uint8_t)jogo->baralho.topo;
+
+	serializar_jogador(&jogo->jogador1, p);
+	serializar_jogador(&jogo->jogador2, p + 10);
+	p += 20;
+
+	for (int r = 0; r < 3; r++) {
+		const Rodada* rodada = &jogo->rodadas[r];
+		*p++ = carta_para_indice(rodada->carta_jogador1);
+		*p++ = carta_para_indice(rodada->carta_jogador2);
+		*p++ = (rodada->jogador1_jogou ? 1 : 0) | (rodada->jogador2_jogou ? 2 : 0);
+		*p++ = (uint8_t)rodada->vencedor;
+	}
+
+	const int contadores[] = {jogo->rodada_atual,          jogo->mao_jogador,           jogo->vez_jogador,
+	                          jogo->pontos_jogador1,       jogo->pontos_jogador2,       jogo->valor_rodada,
+	                          jogo->valor_envido,          jogo->valor_flor,            jogo->jogador_cantou_truco,
+	                          jogo->jogador_cantou_envido, jogo->jogador_cantou_flor,   jogo->ultimo_a_aumentar_truco,
+	                          jogo->ultimo_a_aumentar_envido, jogo->vencedor_partida};
+	for (size_t i = 0; i < sizeof(contadores) / sizeof(contadores[0]); i++) *p++ = (uint8_t)contadores[i];
+
+	*p = (jogo->truco_cantado ? 0x01 : 0) | (jogo->envido_cantado ? 0x02 : 0) | (jogo->flor_cantada ? 0x04 : 0) |
+	     (jogo->aguardando_resposta_truco ? 0x08 : 0) | (jogo->aguardando_resposta_envido ? 0x10 : 0) |
+	     (jogo->aguardando_resposta_flor ? 0x20 : 0) | (jogo->partida_finalizada ? 0x40 : 0);
+}
+
+bool jogo_desserializar(Jogo* jogo, const uint8_t* dados) {
+	// Posições das cartas: baralho, mãos e rodadas
+	static const uint8_t inicio_cartas[] = {44, 89, 99, 105, 109, 113};
+	static const uint8_t num_cartas[] = {40, 3, 3, 2, 2, 2};
+	for (int i = 0; i < 6; i++) {
+		for (int c = 0; c < num_cartas[i]; c++) {
+			if (dados[inicio_cartas[i] + c] > CARTA_INVALIDA) return false;
+		}
+	}
+	// Topo do baralho, cartas na mão, rodada atual, mão e vez
+	if (dados[84] > 40 || dados[92] > 3 || dados[102] > 3 || dados[117] > 3 || dados[118] < 1 || dados[118] > 2 ||
+	    dados[119] < 1 || dados[119] > 2) {
+		return false;
+	}
+
+	memset(jogo, 0, sizeof(Jogo));
+	jogo->sala_id = ler_u32(dados);
+	jogo->semente = ler_u64(dados + 4);
+	for (int i = 0; i < 4; i++) jogo->gerador.s[i] = ler_u64(dados + 12 + 8 * i);
+
+	const uint8_t* p = dados + 44;
+	for (int i = 0; i < 40; i++) jogo->baralho.cartas[i] = carta_serializada(*p++);
+	jogo->baralho.topo = *p++;
+
+	desserializar_jogador(&jogo->jogador1, p);
+	desserializar_jogador(&jogo->jogador2, p + 10);
+	p += 20;
+
+	for (int r = 0; r < 3; r++) {
+		Rodada* rodada = &jogo->rodadas[r];
+		rodada->carta_jogador1 = carta_serializada(*p++);
+		rodada->carta_jogador2 = carta_serializada(*p++);
+		rodada->jogador1_jogou = *p & 1;
+		rodada->jogador2_jogou = (*p++ & 2) != 0;
+		rodada->vencedor = *p++;
+	}
+
+	int* contadores[] = {&jogo->rodada_atual,          &jogo->mao_jogador,         &jogo->vez_jogador,
+	                     &jogo->pontos_jogador1,       &jogo->pontos_jogador2,     &jogo->valor_rodada,
+	                     &jogo->valor_envido,          &jogo->valor_flor,          &jogo->jogador_cantou_truco,
+	                     &jogo->jogador_cantou_envido, &jogo->jogador_cantou_flor, &jogo->ultimo_a_aumentar_truco,
+	                     &jogo->ultimo_a_aumentar_envido, &jogo->vencedor_partida};
+	for (size_t i = 0; i < sizeof(contadores) / sizeof(contadores[0]); i++) *contadores[i] = *p++;
+
+	jogo->truco_cantado = *p & 0x01;
+	jogo->envido_cantado = (*p & 0x02) != 0;
+	jogo->flor_cantada = (*p & 0x04) != 0;
+	jogo->aguardando_resposta_truco = (*p & 0x08) != 0;
+	jogo->aguardando_resposta_envido = (*p & 0x10) != 0;
+	jogo->aguardando_resposta_flor = (*p & 0x20) != 0;
+	jogo->partida_finalizada = (*p & 0x40) != 0;
+	return true;
+}
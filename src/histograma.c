@@ -0,0 +1,68 @@
+#include "histograma.h"
+
+#include <string.h>
+
+int histograma_indice_balde(uint64_t valor) {
+	if (valor < 2 * HISTOGRAMA_SUBBALDES) return (int)valor;
+
+	int expoente = 63 - __builtin_clzll(valor);
+	if (expoente > HISTOGRAMA_MAX_EXPOENTE) return HISTOGRAMA_NUM_BALDES - 1;
+
+	// Os HISTOGRAMA_BITS_SUBBALDE bits abaixo do mais significativo escolhem o subbalde
+	int deslocamento = expoente - HISTOGRAMA_BITS_SUBBALDE;
+	return (deslocamento + 1) * HISTOGRAMA_SUBBALDES + (int)(valor >> deslocamento) - HISTOGRAMA_SUBBALDES;
+}
+
+uint64_t histograma_limite_balde(int indice) {
+	if (indice < 2 * HISTOGRAMA_SUBBALDES) return (uint64_t)indice;
+
+	int deslocamento = indice / HISTOGRAMA_SUBBALDES - 1;
+	uint64_t mantissa = (uint64_t)(indice % HISTOGRAMA_SUBBALDES + HISTOGRAMA_SUBBALDES);
+	return ((mantissa + 1) << deslocamento) - 1;
+}
+
+void histograma_zerar(Histograma* histograma) {
+	memset(histograma, 0, sizeof(Histograma));
+}
+
+void histograma_registrar(Histograma* histograma, uint64_t valor) {
+	histograma->baldes[histograma_indice_balde(valor)]++;
+	if (histograma->total == 0 || valor < histograma->minimo) histograma->minimo = valor;
+	if (valor > histograma->maximo) histograma->maximo = valor;
+	histograma->total++;
+	histograma->soma += valor;
+}
+
+void histograma_somar(Histograma* destino, const Histograma* origem) {
+	if (origem->total == 0) return;
+
+	for (int i = 0; i < HISTOGRAMA_NUM_BALDES; i++) {
+		destino->baldes[i] += origem->baldes[i];
+	}
+	if (destino->total == 0 || origem->minimo < destino->minimo) destino->minimo = origem->minimo;
+	if (origem->maximo > destino->maximo) destino->maximo = origem->maximo;
+	destino->total += origem->total;
+	destino->soma += origem->soma;
+}
+
+uint64_t histograma_percentil(const Histograma* histograma, double percentil) {
+	if (histograma->total == 0) return 0;
+
+	uint64_t alvo = (uint64_t)(percentil / 100.0 * (double)histograma->total + 0.5);
+	if (alvo < 1) alvo = 1;
+	if (alvo > histograma->total) alvo = histograma->total;
+
+	uint64_t acumulado = 0;
+	for (int i = 0; i < HISTOGRAMA_NUM_BALDES; i++) {
+		acumulado += histograma->baldes[i];
+		if (acumulado >= alvo) {
+			uint64_t limite = histograma_limite_balde(i);
+			return limite < histograma->maximo ? limite : histograma->maximo;
+		}
+	}
+	return histograma->maximo;
+}
+
+double histograma_media(const Histograma* histograma) {
+	return histograma->total ? (double)histograma->soma / (double)histograma->total : 0.0;
+}
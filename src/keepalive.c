@@ -0,0 +1,20 @@
+#include "keepalive.h"
+
+ParametrosKeepalive keepalive_calcular(uint64_t timeout_ocioso_ms, uint64_t intervalo_ping_ms) {
+	ParametrosKeepalive parametros;
+	parametros.tentativas = KEEPALIVE_TENTATIVAS;
+
+	// Metade do orçamento, no máximo, vai para as sondas
+	uint64_t timeout = (timeout_ocioso_ms + 999) / 1000;
+	uint64_t intervalo = timeout / (2 * KEEPALIVE_TENTATIVAS);
+	uint64_t intervalo_ping = (intervalo_ping_ms + 999) / 1000;
+	if (intervalo_ping > 0 && intervalo > intervalo_ping) intervalo = intervalo_ping;
+	if (intervalo < 1) intervalo = 1;
+
+	uint64_t sondas = KEEPALIVE_TENTATIVAS * intervalo;
+	uint64_t ocioso = timeout > sondas ? timeout - sondas : 1;
+
+	parametros.intervalo = (int)intervalo;
+	parametros.ocioso = ocioso > INT32_MAX ? INT32_MAX : (int)ocioso;
+	return parametros;
+}
@@ -0,0 +1,392 @@
+#include "metricas.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "histograma.h"
+
+// Histograma atualizado com atômicos; mesmos baldes de histograma.h
+typedef struct {
+	_Atomic uint64_t baldes[HISTOGRAMA_NUM_BALDES];
+	_Atomic uint64_t soma;
+} HistogramaAtomico;
+
+typedef struct {
+	_Atomic uint64_t conexoes_aceitas;
+	_Atomic uint64_t bytes_recebidos;
+	_Atomic uint64_t bytes_enviados;
+	_Atomic uint64_t clientes_lentos;
+	_Atomic uint64_t estados_descartados;
+	_Atomic uint64_t desconexoes_por_atraso;
+	_Atomic uint64_t desconexoes_ociosas;
+	_Atomic uint64_t turnos_expirados;
+	_Atomic uint64_t sessoes_retomadas;
+	_Atomic uint64_t recebidas[METRICAS_NUM_TIPOS];
+	_Atomic uint64_t enviadas[METRICAS_NUM_TIPOS];
+	HistogramaAtomico processamento[METRICAS_NUM_TIPOS];  // ns
+	HistogramaAtomico espera_mutex[NUM_MUTEX_MEDIDOS];     // ns
+	HistogramaAtomico espera_sala;                         // ns
+} FragmentoMetricas;
+
+// Fragmentos alocados no primeiro uso; nunca liberados
+static _Atomic(FragmentoMetricas*) fragmentos[METRICAS_NUM_FRAGMENTOS];
+static _Atomic uint32_t proximo_fragmento = 0;
+static __thread FragmentoMetricas* fragmento_local = NULL;
+
+static const char* NOMES_MUTEX[NUM_MUTEX_MEDIDOS] = {"salas", "clientes"};
+
+// Limites dos baldes exportados: potências de 2 de 2^10 ns (~1 µs) a 2^34 ns (~17 s)
+#define EXPOENTE_MIN_EXPORTADO 10
+#define EXPOENTE_MAX_EXPORTADO 34
+
+uint64_t metricas_agora_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static FragmentoMetricas* obter_fragmento(void) {
+	if (fragmento_local) return fragmento_local;
+
+	uint32_t indice = atomic_fetch_add_explicit(&proximo_fragmento, 1, memory_order_relaxed) % METRICAS_NUM_FRAGMENTOS;
+	FragmentoMetricas* fragmento = atomic_load_explicit(&fragmentos[indice], memory_order_acquire);
+	if (!fragmento) {
+		FragmentoMetricas* novo = calloc(1, sizeof(FragmentoMetricas));
+		if (!novo) abort();
+		if (atomic_compare_exchange_strong_explicit(&fragmentos[indice], &fragmento, novo, memory_order_acq_rel,
+		                                            memory_order_acquire)) {
+			fragmento = novo;
+		} else {
+			free(novo);  // Outra thread criou o mesmo fragmento antes
+		}
+	}
+	fragmento_local = fragmento;
+	return fragmento;
+}
+
+static inline void somar(_Atomic uint64_t* contador, uint64_t valor) {
+	atomic_fetch_add_explicit(contador, valor, memory_order_relaxed);
+}
+
+static void registrar(HistogramaAtomico* histograma, uint64_t valor) {
+	somar(&histograma->baldes[histograma_indice_balde(valor)], 1);
+	somar(&histograma->soma, valor);
+}
+
+static int indice_tipo(TipoMensagem tipo) {
+	return ((unsigned)tipo < METRICAS_NUM_TIPOS - 1) ? (int)tipo : METRICAS_NUM_TIPOS - 1;
+}
+
+void metricas_conexao_aceita(void) {
+	somar(&obter_fragmento()->conexoes_aceitas, 1);
+}
+
+void metricas_mensagem_recebida(TipoMensagem tipo, size_t bytes) {
+	FragmentoMetricas* fragmento = obter_fragmento();
+	somar(&fragmento->recebidas[indice_tipo(tipo)], 1);
+	somar(&fragmento->bytes_recebidos, bytes);
+}
+
+void metricas_mensagem_enviada(TipoMensagem tipo) {
+	somar(&obter_fragmento()->enviadas[indice_tipo(tipo)], 1);
+}
+
+void metricas_bytes_enviados(size_t bytes) {
+	if (bytes > 0) somar(&obter_fragmento()->bytes_enviados, bytes);
+}
+
+void metricas_processamento(TipoMensagem tipo, uint64_t nanossegundos) {
+	registrar(&obter_fragmento()->processamento[indice_tipo(tipo)], nanossegundos);
+}
+
+void metricas_espera_sala(uint64_t nanossegundos) {
+	registrar(&obter_fragmento()->espera_sala, nanossegundos);
+}
+
+void metricas_cliente_lento(void) {
+	somar(&obter_fragmento()->clientes_lentos, 1);
+}
+
+void metricas_estado_descartado(void) {
+	somar(&obter_fragmento()->estados_descartados, 1);
+}
+
+void metricas_desconexao_por_atraso(void) {
+	somar(&obter_fragmento()->desconexoes_por_atraso, 1);
+}
+
+void metricas_desconexao_ociosa(void) {
+	somar(&obter_fragmento()->desconexoes_ociosas, 1);
+}
+
+void metricas_turno_expirado(void) {
+	somar(&obter_fragmento()->turnos_expirados, 1);
+}
+
+void metricas_sessao_retomada(void) {
+	somar(&obter_fragmento()->sessoes_retomadas, 1);
+}
+
+void metricas_travar(pthread_mutex_t* mutex, MutexMedido qual) {
+	HistogramaAtomico* histograma = &obter_fragmento()->espera_mutex[qual];
+	if (pthread_mutex_trylock(mutex) == 0) {
+		registrar(histograma, 0);
+		return;
+	}
+
+	uint64_t inicio = metricas_agora_ns();
+	pthread_mutex_lock(mutex);
+	registrar(histograma, metricas_agora_ns() - inicio);
+}
+
+// Coleta
+
+typedef struct {
+	uint64_t conexoes_aceitas;
+	uint64_t bytes_recebidos;
+	uint64_t bytes_enviados;
+	uint64_t clientes_lentos;
+	uint64_t estados_descartados;
+	uint64_t desconexoes_por_atraso;
+	uint64_t desconexoes_ociosas;
+	uint64_t turnos_expirados;
+	uint64_t sessoes_retomadas;
+	uint64_t recebidas[METRICAS_NUM_TIPOS];
+	uint64_t enviadas[METRICAS_NUM_TIPOS];
+	Histograma processamento[METRICAS_NUM_TIPOS];
+	Histograma espera_mutex[NUM_MUTEX_MEDIDOS];
+	Histograma espera_sala;
+} TotaisMetricas;
+
+static uint64_t ler(_Atomic uint64_t* contador) {
+	return atomic_load_explicit(contador, memory_order_relaxed);
+}
+
+static void acumular_histograma(Histograma* destino, HistogramaAtomico* origem) {
+	for (int i = 0; i < HISTOGRAMA_NUM_BALDES; i++) {
+		uint64_t contagem = ler(&origem->baldes[i]);
+		destino->baldes[i] += contagem;
+		destino->total += contagem;
+	}
+	destino->soma += ler(&origem->soma);
+}
+
+static void somar_fragmentos(TotaisMetricas* totais) {
+	memset(totais, 0, sizeof(TotaisMetricas));
+	for (int f = 0; f < METRICAS_NUM_FRAGMENTOS; f++) {
+		FragmentoMetricas* fragmento = atomic_load_explicit(&fragmentos[f], memory_order_acquire);
+		if (!fragmento) continue;
+
+		totais->conexoes_aceitas += ler(&fragmento->conexoes_aceitas);
+		totais->bytes_recebidos += ler(&fragmento->bytes_recebidos);
+		totais->bytes_enviados += ler(&fragmento->bytes_enviados);
+		totais->clientes_lentos += ler(&fragmento->clientes_lentos);
+		totais->estados_descartados += ler(&fragmento->estados_descartados);
+		totais->desconexoes_por_atraso += ler(&fragmento->desconexoes_por_atraso);
+		totais->desconexoes_ociosas += ler(&fragmento->desconexoes_ociosas);
+		totais->turnos_expirados += ler(&fragmento->turnos_expirados);
+		totais->sessoes_retomadas += ler(&fragmento->sessoes_retomadas);
+		for (int t = 0; t < METRICAS_NUM_TIPOS; t++) {
+			totais->recebidas[t] += ler(&fragmento->recebidas[t]);
+			totais->enviadas[t] += ler(&fragmento->enviadas[t]);
+			acumular_histograma(&totais->processamento[t], &fragmento->processamento[t]);
+		}
+		for (int m = 0; m < NUM_MUTEX_MEDIDOS; m++) {
+			acumular_histograma(&totais->espera_mutex[m], &fragmento->espera_mutex[m]);
+		}
+		acumular_histograma(&totais->espera_sala, &fragmento->espera_sala);
+	}
+}
+
+// Um histograma do Prometheus em segundos, com baldes cumulativos em potências de 2.
+// Sem rótulo se `rotulo` é NULL.
+static void escrever_histograma(FILE* saida, const char* nome, const char* rotulo, const char* valor,
+                                const Histograma* histograma) {
+	char rotulos[128] = "";
+	if (rotulo) snprintf(rotulos, sizeof(rotulos), "%s=\"%s\",", rotulo, valor);
+
+	int balde = 0;
+	uint64_t acumulado = 0;
+	for (int expoente = EXPOENTE_MIN_EXPORTADO; expoente <= EXPOENTE_MAX_EXPORTADO; expoente++) {
+		uint64_t limite = (1ull << expoente) - 1;
+		while (balde < HISTOGRAMA_NUM_BALDES && histograma_limite_balde(balde) <= limite) {
+			acumulado += histograma->baldes[balde++];
+		}
+		fprintf(saida, "%s_bucket{%sle=\"%.9g\"} %llu\n", nome, rotulos, (double)(1ull << expoente) / 1e9,
+		        (unsigned long long)acumulado);
+	}
+	fprintf(saida, "%s_bucket{%sle=\"+Inf\"} %llu\n", nome, rotulos, (unsigned long long)histograma->total);
+
+	// Sem rótulo, _sum e _count não levam chaves
+	if (rotulo) snprintf(rotulos, sizeof(rotulos), "{%s=\"%s\"}", rotulo, valor);
+	fprintf(saida, "%s_sum%s %.9f\n", nome, rotulos, (double)histograma->soma / 1e9);
+	fprintf(saida, "%s_count%s %llu\n", nome, rotulos, (unsigned long long)histograma->total);
+}
+
+static const char* nome_tipo(int indice) {
+	return indice == METRICAS_NUM_TIPOS - 1 ? "DESCONHECIDA" : tipo_mensagem_para_string((TipoMensagem)indice);
+}
+
+void metricas_escrever(FILE* saida, ColetorMetricas coletor, void* contexto) {
+	TotaisMetricas* totais = malloc(sizeof(TotaisMetricas));
+	if (!totais) return;
+	somar_fragmentos(totais);
+
+	fprintf(saida, "# HELP truco_conexoes_aceitas_total Conexões aceitas.\n");
+	fprintf(saida, "# TYPE truco_conexoes_aceitas_total counter\n");
+	fprintf(saida, "truco_conexoes_aceitas_total %llu\n", (unsigned long long)totais->conexoes_aceitas);
+
+	fprintf(saida, "# HELP truco_bytes_recebidos_total Bytes de quadros recebidos.\n");
+	fprintf(saida, "# TYPE truco_bytes_recebidos_total counter\n");
+	fprintf(saida, "truco_bytes_recebidos_total %llu\n", (unsigned long long)totais->bytes_recebidos);
+	fprintf(saida, "# HELP truco_bytes_enviados_total Bytes escritos nos sockets.\n");
+	fprintf(saida, "# TYPE truco_bytes_enviados_total counter\n");
+	fprintf(saida, "truco_bytes_enviados_total %llu\n", (unsigned long long)totais->bytes_enviados);
+
+	fprintf(saida, "# HELP truco_clientes_lentos_total Vezes que a fila de saída de um cliente passou do limite.\n");
+	fprintf(saida, "# TYPE truco_clientes_lentos_total counter\n");
+	fprintf(saida, "truco_clientes_lentos_total %llu\n", (unsigned long long)totais->clientes_lentos);
+	fprintf(saida, "# HELP truco_estados_descartados_total EstadoJogo não enviados a clientes atrasados.\n");
+	fprintf(saida, "# TYPE truco_estados_descartados_total counter\n");
+	fprintf(saida, "truco_estados_descartados_total %llu\n", (unsigned long long)totais->estados_descartados);
+	fprintf(saida, "# HELP truco_desconexoes_por_atraso_total Conexões derrubadas por excesso de saída pendente.\n");
+	fprintf(saida, "# TYPE truco_desconexoes_por_atraso_total counter\n");
+	fprintf(saida, "truco_desconexoes_por_atraso_total %llu\n", (unsigned long long)totais->desconexoes_por_atraso);
+	fprintf(saida, "# HELP truco_desconexoes_ociosas_total Conexões encerradas por falta de atividade.\n");
+	fprintf(saida, "# TYPE truco_desconexoes_ociosas_total counter\n");
+	fprintf(saida, "truco_desconexoes_ociosas_total %llu\n", (unsigned long long)totais->desconexoes_ociosas);
+	fprintf(saida, "# HELP truco_turnos_expirados_total Turnos decididos porque o jogador da vez esgotou o prazo.\n");
+	fprintf(saida, "# TYPE truco_turnos_expirados_total counter\n");
+	fprintf(saida, "truco_turnos_expirados_total %llu\n", (unsigned long long)totais->turnos_expirados);
+	fprintf(saida, "# HELP truco_sessoes_retomadas_total Reconexões que voltaram ao assento reservado na partida.\n");
+	fprintf(saida, "# TYPE truco_sessoes_retomadas_total counter\n");
+	fprintf(saida, "truco_sessoes_retomadas_total %llu\n", (unsigned long long)totais->sessoes_retomadas);
+
+	fprintf(saida, "# HELP truco_mensagens_recebidas_total Mensagens recebidas por tipo.\n");
+	fprintf(saida, "# TYPE truco_mensagens_recebidas_total counter\n");
+	for (int t = 0; t < METRICAS_NUM_TIPOS; t++) {
+		if (totais->recebidas[t] == 0) continue;
+		fprintf(saida, "truco_mensagens_recebidas_total{tipo=\"%s\"} %llu\n", nome_tipo(t),
+		        (unsigned long long)totais->recebidas[t]);
+	}
+	fprintf(saida, "# HELP truco_mensagens_enviadas_total Mensagens enfileiradas para envio por tipo.\n");
+	fprintf(saida, "# TYPE truco_mensagens_enviadas_total counter\n");
+	for (int t = 0; t < METRICAS_NUM_TIPOS; t++) {
+		if (totais->enviadas[t] == 0) continue;
+		fprintf(saida, "truco_mensagens_enviadas_total{tipo=\"%s\"} %llu\n", nome_tipo(t),
+		        (unsigned long long)totais->enviadas[t]);
+	}
+
+	fprintf(saida, "# HELP truco_processamento_segundos Tempo em processar_mensagem por tipo.\n");
+	fprintf(saida, "# TYPE truco_processamento_segundos histogram\n");
+	for (int t = 0; t < METRICAS_NUM_TIPOS; t++) {
+		if (totais->processamento[t].total == 0) continue;
+		escrever_histograma(saida, "truco_processamento_segundos", "tipo", nome_tipo(t), &totais->processamento[t]);
+	}
+
+	fprintf(saida, "# HELP truco_espera_mutex_segundos Espera para adquirir cada mutex.\n");
+	fprintf(saida, "# TYPE truco_espera_mutex_segundos histogram\n");
+	for (int m = 0; m < NUM_MUTEX_MEDIDOS; m++) {
+		escrever_histograma(saida, "truco_espera_mutex_segundos", "mutex", NOMES_MUTEX[m], &totais->espera_mutex[m]);
+	}
+
+	fprintf(saida, "# HELP truco_espera_sala_segundos Tempo dos comandos na caixa da sala até o executor.\n");
+	fprintf(saida, "# TYPE truco_espera_sala_segundos histogram\n");
+	escrever_histograma(saida, "truco_espera_sala_segundos", NULL, NULL, &totais->espera_sala);
+
+	free(totais);
+	if (coletor) coletor(saida, contexto);
+}
+
+// Endpoint HTTP
+
+typedef struct {
+	int socket;
+	ColetorMetricas coletor;
+	void* contexto;
+} ServidorMetricas;
+
+static void responder_coleta(int cliente, ServidorMetricas* servidor) {
+	// O pedido não importa: qualquer GET recebe as métricas
+	char pedido[1024];
+	ssize_t lido = recv(cliente, pedido, sizeof(pedido), 0);
+	if (lido <= 0) return;
+
+	char* corpo = NULL;
+	size_t tamanho = 0;
+	FILE* saida = open_memstream(&corpo, &tamanho);
+	if (!saida) return;
+	metricas_escrever(saida, servidor->coletor, servidor->contexto);
+	fclose(saida);
+
+	char cabecalho[256];
+	int tamanho_cabecalho = snprintf(cabecalho, sizeof(cabecalho),
+	                                 "HTTP/1.0 200 OK\r\n"
+	                                 "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+	                                 "Content-Length: %zu\r\n"
+	                                 "Connection: close\r\n\r\n",
+	                                 tamanho);
+	if (send(cliente, cabecalho, tamanho_cabecalho, MSG_NOSIGNAL) == tamanho_cabecalho) {
+		size_t enviado = 0;
+		while (enviado < tamanho) {
+			ssize_t n = send(cliente, corpo + enviado, tamanho - enviado, MSG_NOSIGNAL);
+			if (n <= 0) break;
+			enviado += (size_t)n;
+		}
+	}
+	free(corpo);
+}
+
+static void* thread_metricas(void* arg) {
+	ServidorMetricas* servidor = (ServidorMetricas*)arg;
+	while (1) {
+		int cliente = accept(servidor->socket, NULL, NULL);
+		if (cliente < 0) continue;
+		responder_coleta(cliente, servidor);
+		close(cliente);
+	}
+	return NULL;
+}
+
+bool metricas_iniciar_servidor(int porta, ColetorMetricas coletor, void* contexto) {
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0) return false;
+
+	int opt = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+	// Só local: as métricas não passam pelo protocolo do jogo nem saem da máquina
+	struct sockaddr_in endereco;
+	memset(&endereco, 0, sizeof(endereco));
+	endereco.sin_family = AF_INET;
+	endereco.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	endereco.sin_port = htons(porta);
+	if (bind(fd, (struct sockaddr*)&endereco, sizeof(endereco)) < 0 || listen(fd, 16) < 0) {
+		close(fd);
+		return false;
+	}
+
+	ServidorMetricas* servidor = malloc(sizeof(ServidorMetricas));
+	if (!servidor) {
+		close(fd);
+		return false;
+	}
+	servidor->socket = fd;
+	servidor->coletor = coletor;
+	servidor->contexto = contexto;
+
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, thread_metricas, servidor) != 0) {
+		close(fd);
+		free(servidor);
+		return false;
+	}
+	pthread_detach(thread);
+	return true;
+}
@@ -0,0 +1,67 @@
+#include "pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool pool_inicializar(Pool* pool, size_t tamanho_elemento, uint32_t elementos_por_bloco,
+                      uint32_t capacidade, InicializadorPool inicializar) {
+	memset(pool, 0, sizeof(Pool));
+	pool->tamanho_elemento = tamanho_elemento;
+	pool->elementos_por_bloco = elementos_por_bloco;
+	pool->capacidade = capacidade;
+	pool->inicializar = inicializar;
+
+	uint32_t num_blocos = (capacidade + elementos_por_bloco - 1) / elementos_por_bloco;
+	pool->blocos = calloc(num_blocos, sizeof(*pool->blocos));
+	return pool->blocos != NULL;
+}
+
+void* pool_alocar(Pool* pool, uint32_t* indice) {
+	if (pool->num_livres > 0) {
+		*indice = pool->livres[--pool->num_livres];
+		return pool_obter(pool, *indice);
+	}
+
+	uint32_t usados = atomic_load_explicit(&pool->num_usados, memory_order_relaxed);
+	if (usados >= pool->capacidade) return NULL;
+
+	uint32_t bloco = usados / pool->elementos_por_bloco;
+	if (usados % pool->elementos_por_bloco == 0) {
+		uint8_t* dados = calloc(pool->elementos_por_bloco, pool->tamanho_elemento);
+		if (!dados) return NULL;
+		if (pool->inicializar) {
+			for (uint32_t i = 0; i < pool->elementos_por_bloco; i++) {
+				pool->inicializar(dados + i * pool->tamanho_elemento, usados + i);
+			}
+		}
+		atomic_store_explicit(&pool->blocos[bloco], dados, memory_order_release);
+	}
+
+	*indice = usados;
+	atomic_store_explicit(&pool->num_usados, usados + 1, memory_order_release);
+	return pool_obter(pool, usados);
+}
+
+void pool_liberar(Pool* pool, uint32_t indice) {
+	if (pool->num_livres == pool->capacidade_livres) {
+		uint32_t nova_capacidade = pool->capacidade_livres ? pool->capacidade_livres * 2 : 64;
+		uint32_t* novos = realloc(pool->livres, nova_capacidade * sizeof(uint32_t));
+		if (!novos) return;  // O índice se perde, mas o pool continua consistente
+		pool->livres = novos;
+		pool->capacidade_livres = nova_capacidade;
+	}
+	pool->livres[pool->num_livres++] = indice;
+}
+
+void* pool_obter(const Pool* pool, uint32_t indice) {
+	if (indice >= pool->capacidade) return NULL;
+
+	uint8_t* bloco = atomic_load_explicit(&pool->blocos[indice / pool->elementos_por_bloco],
+	                                      memory_order_acquire);
+	if (!bloco) return NULL;
+	return bloco + (size_t)(indice % pool->elementos_por_bloco) * pool->tamanho_elemento;
+}
+
+uint32_t pool_num_usados(const Pool* pool) {
+	return atomic_load_explicit(&pool->num_usados, memory_order_acquire);
+}
@@ -0,0 +1,231 @@
+#include "protocolo.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <sys/socket.h>
+
+// Campos de EstadoJogo na ordem dos bits da máscara do delta
+typedef enum {
+	CAMPO_U8,
+	CAMPO_CARTA
+} TipoCampoEstado;
+
+static const struct {
+	size_t offset;
+	TipoCampoEstado tipo;
+} CAMPOS_ESTADO[ESTADO_DELTA_NUM_CAMPOS] = {
+    {offsetof(EstadoJogo, pontos_jogador1), CAMPO_U8},
+    {offsetof(EstadoJogo, pontos_jogador2), CAMPO_U8},
+    {offsetof(EstadoJogo, rodada_atual), CAMPO_U8},
+    {offsetof(EstadoJogo, num_cartas_mao), CAMPO_U8},
+    {offsetof(EstadoJogo, cartas_mao[0]), CAMPO_CARTA},
+    {offsetof(EstadoJogo, cartas_mao[1]), CAMPO_CARTA},
+    {offsetof(EstadoJogo, cartas_mao[2]), CAMPO_CARTA},
+    {offsetof(EstadoJogo, cartas_jogadas_rodada[0]), CAMPO_CARTA},
+    {offsetof(EstadoJogo, cartas_jogadas_rodada[1]), CAMPO_CARTA},
+    {offsetof(EstadoJogo, cartas_jogadas_rodada[2]), CAMPO_CARTA},
+    {offsetof(EstadoJogo, cartas_jogadas_rodada[3]), CAMPO_CARTA},
+    {offsetof(EstadoJogo, cartas_jogadas_rodada[4]), CAMPO_CARTA},
+    {offsetof(EstadoJogo, cartas_jogadas_rodada[5]), CAMPO_CARTA},
+    {offsetof(EstadoJogo, mao_jogador), CAMPO_U8},
+    {offsetof(EstadoJogo, vez_jogador), CAMPO_U8},
+    {offsetof(EstadoJogo, valor_rodada), CAMPO_U8},
+    {offsetof(EstadoJogo, valor_envido), CAMPO_U8},
+    {offsetof(EstadoJogo, valor_flor), CAMPO_U8},
+    {offsetof(EstadoJogo, pode_cantar_truco), CAMPO_U8},
+    {offsetof(EstadoJogo, pode_cantar_envido), CAMPO_U8},
+    {offsetof(EstadoJogo, pode_cantar_flor), CAMPO_U8},
+    {offsetof(EstadoJogo, aguardando_resposta), CAMPO_U8},
+};
+
+static size_t escrever_varint(uint8_t* saida, uint32_t valor) {
+	size_t n = 0;
+	while (valor >= 0x80) {
+		saida[n++] = (uint8_t)(valor | 0x80);
+		valor >>= 7;
+	}
+	saida[n++] = (uint8_t)valor;
+	return n;
+}
+
+// Retorna bytes lidos, 0 se incompleto ou -1 se excede 32 bits
+static int ler_varint(const uint8_t* buffer, size_t tamanho, uint32_t* valor) {
+	uint32_t resultado = 0;
+	for (size_t i = 0; i < PROTOCOLO_TAMANHO_MAX_VARINT; i++) {
+		if (i >= tamanho) return 0;
+		resultado |= (uint32_t)(buffer[i] & 0x7F) << (7 * i);
+		if (!(buffer[i] & 0x80)) {
+			*valor = resultado;
+			return (int)i + 1;
+		}
+	}
+	return -1;
+}
+
+size_t protocolo_codificar(const Mensagem* msg, bool compacto, uint8_t* saida) {
+	if (!compacto) {
+		memcpy(saida, msg, sizeof(Mensagem));
+		return sizeof(Mensagem);
+	}
+
+	uint32_t tamanho = msg->tamanho_dados;
+	if (tamanho > sizeof(msg->dados)) tamanho = sizeof(msg->dados);
+
+	size_t n = 0;
+	saida[n++] = PROTOCOLO_MARCA_COMPACTO | (uint8_t)msg->tipo;
+	n += escrever_varint(saida + n, msg->sala_id);
+	n += escrever_varint(saida + n, msg->jogador_id);
+	n += escrever_varint(saida + n, tamanho);
+	memcpy(saida + n, msg->dados, tamanho);
+	return n + tamanho;
+}
+
+int protocolo_decodificar(const uint8_t* buffer, size_t tamanho, Mensagem* msg) {
+	if (tamanho == 0) return 0;
+
+	if (!(buffer[0] & PROTOCOLO_MARCA_COMPACTO)) {
+		if (tamanho < sizeof(Mensagem)) return 0;
+		memcpy(msg, buffer, sizeof(Mensagem));
+		return sizeof(Mensagem);
+	}
+
+	uint32_t campos[3];  // sala_id, jogador_id, tamanho
+	size_t n = 1;
+	for (int i = 0; i < 3; i++) {
+		int lidos = ler_varint(buffer + n, tamanho - n, &campos[i]);
+		if (lidos <= 0) return lidos;
+		n += lidos;
+	}
+	if (campos[2] > sizeof(msg->dados)) return -1;
+	if (tamanho - n < campos[2]) return 0;
+
+	memset(msg, 0, sizeof(Mensagem));
+	msg->tipo = (TipoMensagem)(buffer[0] & ~PROTOCOLO_MARCA_COMPACTO);
+	msg->sala_id = campos[0];
+	msg->jogador_id = campos[1];
+	msg->tamanho_dados = campos[2];
+	memcpy(msg->dados, buffer + n, campos[2]);
+	return (int)(n + campos[2]);
+}
+
+static uint8_t ler_campo_estado(const EstadoJogo* estado, int campo) {
+	const uint8_t* ptr = (const uint8_t*)estado + CAMPOS_ESTADO[campo].offset;
+	if (CAMPOS_ESTADO[campo].tipo == CAMPO_U8) return *ptr;
+
+	const Carta* carta = (const Carta*)ptr;
+	return (uint8_t)((carta->naipe << 4) | (carta->numero & 0x0F));
+}
+
+static void escrever_campo_estado(EstadoJogo* estado, int campo, uint8_t valor) {
+	uint8_t* ptr = (uint8_t*)estado + CAMPOS_ESTADO[campo].offset;
+	if (CAMPOS_ESTADO[campo].tipo == CAMPO_U8) {
+		*ptr = valor;
+		return;
+	}
+
+	Carta* carta = (Carta*)ptr;
+	carta->naipe = (Naipe)(valor >> 4);
+	carta->numero = (NumeroCarta)(valor & 0x0F);
+}
+
+size_t estado_delta_codificar(const EstadoJogo* anterior, const EstadoJogo* atual, uint8_t* saida) {
+	uint8_t valores[ESTADO_DELTA_NUM_CAMPOS];
+	uint32_t mascara = 0;
+	size_t num_valores = 0;
+
+	for (int i = 0; i < ESTADO_DELTA_NUM_CAMPOS; i++) {
+		uint8_t valor = ler_campo_estado(atual, i);
+		if (valor != ler_campo_estado(anterior, i)) {
+			mascara |= 1u << i;
+			valores[num_valores++] = valor;
+		}
+	}
+
+	size_t n = escrever_varint(saida, mascara);
+	memcpy(saida + n, valores, num_valores);
+	return n + num_valores;
+}
+
+bool estado_delta_aplicar(EstadoJogo* estado, const uint8_t* dados, size_t tamanho) {
+	uint32_t mascara;
+	int n = ler_varint(dados, tamanho, &mascara);
+	if (n <= 0 || (mascara >> ESTADO_DELTA_NUM_CAMPOS) != 0) return false;
+
+	size_t pos = n;
+	for (int i = 0; i < ESTADO_DELTA_NUM_CAMPOS; i++) {
+		if (!(mascara & (1u << i))) continue;
+		if (pos >= tamanho) return false;
+		escrever_campo_estado(estado, i, dados[pos++]);
+	}
+	return true;
+}
+
+// Envia todos os bytes garantindo entrega completa
+bool send_all(int socket, const void* buffer, size_t length) {
+	const char* ptr = (const char*)buffer;
+	size_t remaining = length;
+
+	while (remaining > 0) {
+		ssize_t sent = send(socket, ptr, remaining, MSG_NOSIGNAL);
+		if (sent <= 0) {
+			return false;  // Erro ou conexão fechada
+		}
+		ptr += sent;
+		remaining -= sent;
+	}
+	return true;
+}
+
+// Recebe todos os bytes garantindo leitura completa
+bool recv_all(int socket, void* buffer, size_t length) {
+	char* ptr = (char*)buffer;
+	size_t remaining = length;
+
+	while (remaining > 0) {
+		ssize_t received = recv(socket, ptr, remaining, 0);
+		if (received <= 0) {
+			return false;  // Erro ou conexão fechada
+		}
+		ptr += received;
+		remaining -= received;
+	}
+	return true;
+}
+
+bool protocolo_enviar(int socket, const Mensagem* msg, bool compacto) {
+	uint8_t quadro[PROTOCOLO_TAMANHO_MAX_QUADRO];
+	size_t tamanho = protocolo_codificar(msg, compacto, quadro);
+	return send_all(socket, quadro, tamanho);
+}
+
+bool protocolo_receber(int socket, Mensagem* msg) {
+	return protocolo_receber_quadro(socket, msg) > 0;
+}
+
+size_t protocolo_receber_quadro(int socket, Mensagem* msg) {
+	uint8_t quadro[PROTOCOLO_TAMANHO_MAX_QUADRO];
+	if (!recv_all(socket, quadro, 1)) return 0;
+
+	if (!(quadro[0] & PROTOCOLO_MARCA_COMPACTO)) {
+		if (!recv_all(socket, quadro + 1, sizeof(Mensagem) - 1)) return 0;
+		return protocolo_decodificar(quadro, sizeof(Mensagem), msg) > 0 ? sizeof(Mensagem) : 0;
+	}
+
+	// Cabeçalho compacto: lê os três varints byte a byte
+	size_t n = 1;
+	size_t inicio_tamanho = 1;
+	for (int campo = 0; campo < 3; campo++) {
+		if (campo == 2) inicio_tamanho = n;
+		do {
+			if (n >= 1 + 3 * PROTOCOLO_TAMANHO_MAX_VARINT) return 0;
+			if (!recv_all(socket, quadro + n, 1)) return 0;
+		} while (quadro[n++] & 0x80);
+	}
+
+	uint32_t tamanho;
+	if (ler_varint(quadro + inicio_tamanho, n - inicio_tamanho, &tamanho) <= 0 ||
+	    tamanho > sizeof(msg->dados)) return 0;
+	if (tamanho > 0 && !recv_all(socket, quadro + n, tamanho)) return 0;
+
+	return protocolo_decodificar(quadro, n + tamanho, msg) > 0 ? n + tamanho : 0;
+}
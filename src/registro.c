@@ -0,0 +1,187 @@
+#include "registro.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MASCARA_ANEL (REGISTRO_TAMANHO_ANEL - 1)
+#define ESPERA_ESCRITOR_US 5000  // Intervalo da thread de escrita com o anel vazio
+
+// Fila circular limitada de Vyukov: a sequência de cada entrada diz se ela
+// está livre para a posição `pos` (== pos) ou pronta para leitura (== pos + 1)
+typedef struct {
+	_Atomic uint64_t sequencia;
+	struct timespec instante;
+	uint32_t thread;
+	uint8_t nivel;
+	char texto[REGISTRO_TAMANHO_TEXTO];
+} EntradaRegistro;
+
+static EntradaRegistro anel[REGISTRO_TAMANHO_ANEL];
+static _Atomic uint64_t posicao_escrita = 0;
+static uint64_t posicao_leitura = 0;  // Só a thread de escrita (ou registro_descarregar)
+static pthread_mutex_t leitura_mutex = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic uint64_t descartadas = 0;
+static _Atomic int nivel_minimo = REGISTRO_INFO;
+static _Atomic bool anel_inicializado = false;
+static pthread_once_t inicializacao_anel = PTHREAD_ONCE_INIT;
+
+static FILE* destino_registro = NULL;
+static FormatoRegistro formato_registro = REGISTRO_TEXTO;
+
+static _Atomic uint32_t proxima_thread = 1;
+static __thread uint32_t thread_atual = 0;
+
+static const char* NOMES_NIVEL[] = {"debug", "info", "aviso", "erro"};
+static const char* ROTULOS_NIVEL[] = {"DEBUG", "INFO ", "AVISO", "ERRO "};
+
+static void inicializar_anel(void) {
+	for (uint64_t i = 0; i < REGISTRO_TAMANHO_ANEL; i++) {
+		atomic_store_explicit(&anel[i].sequencia, i, memory_order_relaxed);
+	}
+	atomic_store_explicit(&anel_inicializado, true, memory_order_release);
+}
+
+bool registro_ativo(NivelRegistro nivel) {
+	return (int)nivel >= atomic_load_explicit(&nivel_minimo, memory_order_relaxed);
+}
+
+bool registro_nivel_por_nome(const char* nome, NivelRegistro* nivel) {
+	for (int i = REGISTRO_DEBUG; i <= REGISTRO_ERRO; i++) {
+		if (strcmp(nome, NOMES_NIVEL[i]) == 0) {
+			*nivel = (NivelRegistro)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+void registro(NivelRegistro nivel, const char* formato, ...) {
+	if (!registro_ativo(nivel)) return;
+	int erro = errno;  // Antes de qualquer chamada que possa alterá-lo (para "%m")
+	pthread_once(&inicializacao_anel, inicializar_anel);
+	if (thread_atual == 0) thread_atual = atomic_fetch_add_explicit(&proxima_thread, 1, memory_order_relaxed);
+
+	// Reserva uma entrada livre; com o anel cheio a linha é descartada
+	EntradaRegistro* entrada;
+	uint64_t pos = atomic_load_explicit(&posicao_escrita, memory_order_relaxed);
+	while (1) {
+		entrada = &anel[pos & MASCARA_ANEL];
+		uint64_t sequencia = atomic_load_explicit(&entrada->sequencia, memory_order_acquire);
+		int64_t diferenca = (int64_t)(sequencia - pos);
+		if (diferenca == 0) {
+			if (atomic_compare_exchange_weak_explicit(&posicao_escrita, &pos, pos + 1, memory_order_relaxed,
+			                                          memory_order_relaxed)) {
+				break;
+			}
+		} else if (diferenca < 0) {
+			atomic_fetch_add_explicit(&descartadas, 1, memory_order_relaxed);
+			return;
+		} else {
+			pos = atomic_load_explicit(&posicao_escrita, memory_order_relaxed);
+		}
+	}
+
+	clock_gettime(CLOCK_REALTIME, &entrada->instante);
+	entrada->thread = thread_atual;
+	entrada->nivel = (uint8_t)nivel;
+	va_list args;
+	va_start(args, formato);
+	errno = erro;
+	vsnprintf(entrada->texto, sizeof(entrada->texto), formato, args);
+	va_end(args);
+	errno = erro;
+
+	atomic_store_explicit(&entrada->sequencia, pos + 1, memory_order_release);
+}
+
+static void escrever_json_texto(FILE* saida, const char* texto) {
+	for (const unsigned char* c = (const unsigned char*)texto; *c; c++) {
+		if (*c == '"' || *c == '\\') {
+			fputc('\\', saida);
+			fputc(*c, saida);
+		} else if (*c < 0x20) {
+			fprintf(saida, "\\u%04x", *c);
+		} else {
+			fputc(*c, saida);
+		}
+	}
+}
+
+static void escrever_entrada(const struct timespec* instante, uint32_t thread, int nivel, const char* texto) {
+	struct tm data;
+	localtime_r(&instante->tv_sec, &data);
+	char hora[32];
+	strftime(hora, sizeof(hora), formato_registro == REGISTRO_JSON ? "%Y-%m-%dT%H:%M:%S" : "%Y-%m-%d %H:%M:%S",
+	         &data);
+	int milissegundos = (int)(instante->tv_nsec / 1000000);
+
+	if (formato_registro == REGISTRO_JSON) {
+		fprintf(destino_registro, "{\"ts\":\"%s.%03d\",\"nivel\":\"%s\",\"thread\":%u,\"msg\":\"", hora,
+		        milissegundos, NOMES_NIVEL[nivel], thread);
+		escrever_json_texto(destino_registro, texto);
+		fputs("\"}\n", destino_registro);
+	} else {
+		fprintf(destino_registro, "%s.%03d %s %s\n", hora, milissegundos, ROTULOS_NIVEL[nivel], texto);
+	}
+}
+
+// Escreve as entradas prontas; retorna quantas
+static int escrever_pendentes(void) {
+	if (!atomic_load_explicit(&anel_inicializado, memory_order_acquire)) return 0;
+
+	pthread_mutex_lock(&leitura_mutex);
+	int escritas = 0;
+	while (1) {
+		EntradaRegistro* entrada = &anel[posicao_leitura & MASCARA_ANEL];
+		if (atomic_load_explicit(&entrada->sequencia, memory_order_acquire) != posicao_leitura + 1) break;
+
+		escrever_entrada(&entrada->instante, entrada->thread, entrada->nivel, entrada->texto);
+		atomic_store_explicit(&entrada->sequencia, posicao_leitura + REGISTRO_TAMANHO_ANEL, memory_order_release);
+		posicao_leitura++;
+		escritas++;
+	}
+
+	uint64_t perdidas = atomic_exchange_explicit(&descartadas, 0, memory_order_relaxed);
+	if (perdidas > 0) {
+		char aviso[64];
+		snprintf(aviso, sizeof(aviso), "%llu linha(s) de log descartada(s): anel cheio", (unsigned long long)perdidas);
+		struct timespec agora;
+		clock_gettime(CLOCK_REALTIME, &agora);
+		escrever_entrada(&agora, 0, REGISTRO_AVISO, aviso);
+		escritas++;
+	}
+
+	if (escritas > 0) fflush(destino_registro);
+	pthread_mutex_unlock(&leitura_mutex);
+	return escritas;
+}
+
+static void* thread_escritor(void* arg) {
+	(void)arg;
+	while (1) {
+		if (escrever_pendentes() == 0) usleep(ESPERA_ESCRITOR_US);
+	}
+	return NULL;
+}
+
+bool registro_iniciar(FILE* destino, FormatoRegistro formato, NivelRegistro minimo) {
+	pthread_once(&inicializacao_anel, inicializar_anel);
+	destino_registro = destino;
+	formato_registro = formato;
+	atomic_store_explicit(&nivel_minimo, minimo, memory_order_relaxed);
+
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, thread_escritor, NULL) != 0) return false;
+	pthread_detach(thread);
+	return true;
+}
+
+void registro_descarregar(void) {
+	if (destino_registro) escrever_pendentes();
+}
@@ -0,0 +1,303 @@
+#include "replay.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fila_mpsc.h"
+#include "registro.h"
+
+#define ESPERA_GRAVADOR_US 10000       // Intervalo da thread de gravação com a fila vazia
+#define TAMANHO_MAX_CABECALHO_BLOCO 64  // Magica, tamanho, cabeçalho e final codificados
+
+// Bloco pronto, a caminho da thread de gravação
+typedef struct {
+	NoFilaMpsc no;
+	size_t tamanho;
+	uint8_t dados[];
+} BlocoReplay;
+
+static FilaMpsc fila_blocos;
+static _Atomic uint32_t blocos_pendentes = 0;  // Entregues e ainda não escritos
+static int arquivo_replay = -1;
+
+static uint64_t agora_us(clockid_t relogio) {
+	struct timespec ts;
+	clock_gettime(relogio, &ts);
+	return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static size_t escrever_varint(uint8_t* saida, uint64_t valor) {
+	size_t n = 0;
+	while (valor >= 0x80) {
+		saida[n++] = (uint8_t)(valor | 0x80);
+		valor >>= 7;
+	}
+	saida[n++] = (uint8_t)valor;
+	return n;
+}
+
+static bool ler_varint(const uint8_t* dados, size_t tamanho, size_t* posicao, uint64_t* valor) {
+	*valor = 0;
+	for (int deslocamento = 0; deslocamento < 64; deslocamento += 7) {
+		if (*posicao >= tamanho) return false;
+		uint8_t byte = dados[(*posicao)++];
+		*valor |= (uint64_t)(byte & 0x7F) << deslocamento;
+		if (!(byte & 0x80)) return true;
+	}
+	return false;
+}
+
+static void escrever_u32(uint8_t* saida, uint32_t valor) {
+	for (int i = 0; i < 4; i++) saida[i] = (uint8_t)(valor >> (8 * i));
+}
+
+static uint64_t ler_u64(const uint8_t* dados) {
+	uint64_t valor = 0;
+	for (int i = 0; i < 8; i++) valor |= (uint64_t)dados[i] << (8 * i);
+	return valor;
+}
+
+static bool acao_tem_valor(TipoAcaoReplay tipo) {
+	return tipo == REPLAY_JOGAR_CARTA || tipo == REPLAY_RESPOSTA_TRUCO || tipo == REPLAY_RESPOSTA_ENVIDO ||
+	       tipo == REPLAY_RESPOSTA_FLOR;
+}
+
+const char* tipo_acao_replay_para_string(TipoAcaoReplay tipo) {
+	switch (tipo) {
+		case REPLAY_JOGAR_CARTA: return "JOGAR_CARTA";
+		case REPLAY_TRUCO: return "TRUCO";
+		case REPLAY_RESPOSTA_TRUCO: return "RESPOSTA_TRUCO";
+		case REPLAY_ENVIDO: return "ENVIDO";
+		case REPLAY_RESPOSTA_ENVIDO: return "RESPOSTA_ENVIDO";
+		case REPLAY_FLOR: return "FLOR";
+		case REPLAY_RESPOSTA_FLOR: return "RESPOSTA_FLOR";
+		case REPLAY_IR_BARALHO: return "IR_BARALHO";
+	}
+	return "DESCONHECIDA";
+}
+
+void replay_preparar_jogo(Jogo* jogo, const CabecalhoReplay* cabecalho) {
+	inicializar_jogo(jogo, cabecalho->sala_id, cabecalho->semente);
+	jogo->jogador1.id = cabecalho->jogador1_id;
+	jogo->jogador2.id = cabecalho->jogador2_id;
+	inicializar_baralho(&jogo->baralho);
+	distribuir_cartas(jogo);
+}
+
+bool replay_aplicar(Jogo* jogo, const AcaoReplay* acao) {
+	switch (acao->tipo) {
+		case REPLAY_JOGAR_CARTA:
+			if (!jogar_carta(jogo, acao->jogador, (int)acao->valor)) return false;
+			if (jogo->rodada_atual >= 3 && !jogo->partida_finalizada) nova_mao(jogo);
+			return true;
+		case REPLAY_TRUCO:
+			return cantar_truco(jogo, acao->jogador);
+		case REPLAY_RESPOSTA_TRUCO:
+			responder_truco(jogo, acao->jogador, (RespostaTruco)acao->valor);
+			return true;
+		case REPLAY_ENVIDO:
+			return cantar_envido(jogo, acao->jogador);
+		case REPLAY_RESPOSTA_ENVIDO:
+			responder_envido(jogo, acao->jogador, (RespostaEnvido)acao->valor);
+			return true;
+		case REPLAY_FLOR:
+			return cantar_flor(jogo, acao->jogador);
+		case REPLAY_RESPOSTA_FLOR:
+			responder_flor(jogo, acao->jogador, (RespostaFlor)acao->valor);
+			return true;
+		case REPLAY_IR_BARALHO:
+			ir_baralho(jogo, acao->jogador);
+			return true;
+	}
+	return false;
+}
+
+// Gravação
+
+static void* thread_gravador(void* arg) {
+	(void)arg;
+	while (1) {
+		NoFilaMpsc* no = fila_mpsc_remover(&fila_blocos);
+		if (!no) {
+			usleep(ESPERA_GRAVADOR_US);
+			continue;
+		}
+
+		// O_APPEND: cada bloco vai inteiro para o fim do arquivo
+		BlocoReplay* bloco = (BlocoReplay*)no;
+		size_t escrito = 0;
+		while (escrito < bloco->tamanho) {
+			ssize_t n = write(arquivo_replay, bloco->dados + escrito, bloco->tamanho - escrito);
+			if (n <= 0) {
+				registro(REGISTRO_ERRO, "Erro ao gravar replay: %m");
+				break;
+			}
+			escrito += (size_t)n;
+		}
+		free(bloco);
+		atomic_fetch_sub_explicit(&blocos_pendentes, 1, memory_order_release);
+	}
+	return NULL;
+}
+
+bool replay_abrir_arquivo(const char* caminho) {
+	int fd = open(caminho, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (fd < 0) return false;
+
+	fila_mpsc_inicializar(&fila_blocos);
+	arquivo_replay = fd;
+
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, thread_gravador, NULL) != 0) {
+		close(fd);
+		arquivo_replay = -1;
+		return false;
+	}
+	pthread_detach(thread);
+	return true;
+}
+
+bool replay_ativo(void) {
+	return arquivo_replay >= 0;
+}
+
+void replay_descarregar(void) {
+	while (atomic_load_explicit(&blocos_pendentes, memory_order_acquire) > 0) usleep(1000);
+}
+
+void gravacao_inicializar(GravacaoReplay* gravacao) {
+	memset(gravacao, 0, sizeof(GravacaoReplay));
+}
+
+void gravacao_iniciar(GravacaoReplay* gravacao, const CabecalhoReplay* cabecalho, const Jogo* jogo) {
+	if (gravacao->ativa) gravacao_finalizar(gravacao, jogo);
+	if (arquivo_replay < 0) return;
+
+	gravacao->ativa = true;
+	gravacao->cabecalho = *cabecalho;
+	gravacao->cabecalho.inicio_us = agora_us(CLOCK_REALTIME);
+	gravacao->tamanho = 0;
+	gravacao->num_acoes = 0;
+	gravacao->ultimo_us = agora_us(CLOCK_MONOTONIC);
+}
+
+void gravacao_registrar(GravacaoReplay* gravacao, TipoAcaoReplay tipo, int jogador, uint32_t valor) {
+	if (!gravacao->ativa) return;
+
+	// Tipo, dois varints de até 10 bytes
+	if (gravacao->tamanho + 21 > gravacao->capacidade) {
+		size_t nova_capacidade = gravacao->capacidade ? gravacao->capacidade * 2 : 256;
+		uint8_t* novas = realloc(gravacao->acoes, nova_capacidade);
+		if (!novas) {
+			gravacao->ativa = false;  // Sem memória: a partida não é gravada
+			return;
+		}
+		gravacao->acoes = novas;
+		gravacao->capacidade = nova_capacidade;
+	}
+
+	uint64_t agora = agora_us(CLOCK_MONOTONIC);
+	uint8_t* saida = gravacao->acoes + gravacao->tamanho;
+	size_t n = 0;
+	saida[n++] = (uint8_t)tipo | (jogador == 2 ? 0x08 : 0);
+	n += escrever_varint(saida + n, agora - gravacao->ultimo_us);
+	if (acao_tem_valor(tipo)) n += escrever_varint(saida + n, valor);
+
+	gravacao->tamanho += n;
+	gravacao->num_acoes++;
+	gravacao->ultimo_us = agora;
+}
+
+void gravacao_finalizar(GravacaoReplay* gravacao, const Jogo* jogo) {
+	if (!gravacao->ativa) return;
+	gravacao->ativa = false;
+
+	uint8_t cabecalho[TAMANHO_MAX_CABECALHO_BLOCO];
+	size_t n = 8;  // Mágica e tamanho, escritos no fim
+	n += escrever_varint(cabecalho + n, gravacao->cabecalho.sala_id);
+	n += escrever_varint(cabecalho + n, gravacao->cabecalho.jogador1_id);
+	n += escrever_varint(cabecalho + n, gravacao->cabecalho.jogador2_id);
+	for (int i = 0; i < 8; i++) cabecalho[n++] = (uint8_t)(gravacao->cabecalho.semente >> (8 * i));
+	n += escrever_varint(cabecalho + n, gravacao->cabecalho.inicio_us);
+	cabecalho[n++] = jogo->partida_finalizada ? (uint8_t)jogo->vencedor_partida : 0;
+	n += escrever_varint(cabecalho + n, (uint32_t)jogo->pontos_jogador1);
+	n += escrever_varint(cabecalho + n, (uint32_t)jogo->pontos_jogador2);
+	n += escrever_varint(cabecalho + n, gravacao->num_acoes);
+	escrever_u32(cabecalho, REPLAY_MAGICA);
+	escrever_u32(cabecalho + 4, (uint32_t)(n - 8 + gravacao->tamanho));
+
+	BlocoReplay* bloco = malloc(sizeof(BlocoReplay) + n + gravacao->tamanho);
+	if (!bloco) return;
+	bloco->tamanho = n + gravacao->tamanho;
+	memcpy(bloco->dados, cabecalho, n);
+	if (gravacao->tamanho > 0) memcpy(bloco->dados + n, gravacao->acoes, gravacao->tamanho);
+	atomic_fetch_add_explicit(&blocos_pendentes, 1, memory_order_relaxed);
+	fila_mpsc_inserir(&fila_blocos, &bloco->no);
+}
+
+// Leitura
+
+int replay_proxima_partida(const uint8_t* dados, size_t tamanho, size_t* posicao, PartidaReplay* partida) {
+	if (*posicao == tamanho) return 0;
+	if (tamanho - *posicao < 8) return -1;
+
+	const uint8_t* bloco = dados + *posicao;
+	uint32_t magica = bloco[0] | (bloco[1] << 8) | (bloco[2] << 16) | ((uint32_t)bloco[3] << 24);
+	uint32_t tamanho_bloco = bloco[4] | (bloco[5] << 8) | (bloco[6] << 16) | ((uint32_t)bloco[7] << 24);
+	if (magica != REPLAY_MAGICA || tamanho_bloco > tamanho - *posicao - 8) return -1;
+
+	const uint8_t* corpo = bloco + 8;
+	size_t p = 0;
+	uint64_t sala_id, jogador1_id, jogador2_id, inicio, pontos1, pontos2, num_acoes;
+	if (!ler_varint(corpo, tamanho_bloco, &p, &sala_id) || !ler_varint(corpo, tamanho_bloco, &p, &jogador1_id) ||
+	    !ler_varint(corpo, tamanho_bloco, &p, &jogador2_id) || tamanho_bloco - p < 8) {
+		return -1;
+	}
+	uint64_t semente = ler_u64(corpo + p);
+	p += 8;
+	if (!ler_varint(corpo, tamanho_bloco, &p, &inicio) || p >= tamanho_bloco) return -1;
+	uint8_t vencedor = corpo[p++];
+	if (!ler_varint(corpo, tamanho_bloco, &p, &pontos1) || !ler_varint(corpo, tamanho_bloco, &p, &pontos2) ||
+	    !ler_varint(corpo, tamanho_bloco, &p, &num_acoes) || vencedor > 2) {
+		return -1;
+	}
+
+	partida->cabecalho.sala_id = (uint32_t)sala_id;
+	partida->cabecalho.jogador1_id = (uint32_t)jogador1_id;
+	partida->cabecalho.jogador2_id = (uint32_t)jogador2_id;
+	partida->cabecalho.semente = semente;
+	partida->cabecalho.inicio_us = inicio;
+	partida->final.vencedor = vencedor;
+	partida->final.pontos_jogador1 = (int)pontos1;
+	partida->final.pontos_jogador2 = (int)pontos2;
+	partida->num_acoes = (uint32_t)num_acoes;
+	partida->acoes = corpo + p;
+	partida->tamanho_acoes = tamanho_bloco - p;
+
+	*posicao += 8 + tamanho_bloco;
+	return 1;
+}
+
+bool replay_proxima_acao(const PartidaReplay* partida, size_t* cursor, uint64_t* instante_us, AcaoReplay* acao) {
+	if (*cursor >= partida->tamanho_acoes) return false;
+
+	uint8_t byte = partida->acoes[(*cursor)++];
+	if (byte & 0xF0) return false;
+	acao->tipo = (TipoAcaoReplay)(byte & 0x07);
+	acao->jogador = (byte & 0x08) ? 2 : 1;
+
+	uint64_t intervalo, valor = 0;
+	if (!ler_varint(partida->acoes, partida->tamanho_acoes, cursor, &intervalo)) return false;
+	if (acao_tem_valor(acao->tipo) && !ler_varint(partida->acoes, partida->tamanho_acoes, cursor, &valor)) {
+		return false;
+	}
+	*instante_us += intervalo;
+	acao->instante_us = *instante_us;
+	acao->valor = (uint32_t)valor;
+	return true;
+}
@@ -1,164 +1,529 @@
+#define _GNU_SOURCE
+
 #include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/random.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "cache_lobby.h"
+#include "anel_io.h"
+#include "captura.h"
 #include "common.h"
+#include "diretorio_salas.h"
+#include "fila_mpsc.h"
+#include "fila_saida.h"
 #include "game_logic.h"
-
-// Estrutura de uma sala
+#include "keepalive.h"
+#include "metricas.h"
+#include "pool.h"
+#include "protocolo.h"
+#include "registro.h"
+#include "replay.h"
+#include "temporizadores.h"
+#include "transferencia.h"
+
+struct ComandoSala;
+
+// Comandos guardados por uma sala pausada (--cliente-lento=pausar)
+#define MAX_COMANDOS_ADIADOS 16
+
+// Estrutura de uma sala. Cada sala é um ator: comandos chegam pela caixa
+// (fila MPSC) e só o executor da sala os trata, um por vez, sem lock.
 typedef struct {
-	uint32_t id;
+	NoFilaMpsc no;       // Na fila de salas prontas do executor (primeiro campo)
+	_Atomic uint32_t id; // Definido em alocar_sala; lido sem lock para validar comandos
 	char nome[64];
 	int jogador1_socket;
 	int jogador2_socket;
 	uint32_t jogador1_id;
 	uint32_t jogador2_id;
-	bool ativa;
+	_Atomic bool ativa;
 	bool em_partida;
+	uint16_t geracao;    // Incrementada a cada reuso do slot (parte do id, protegida por salas_mutex)
+	uint32_t indice;     // Slot no pool de salas
 	Jogo jogo;
-	pthread_mutex_t mutex;
+	GravacaoReplay gravacao;  // Ações da partida atual (com --replay)
+
+	// Último EstadoJogo enviado a cada jogador, base para o próximo MSG_ESTADO_DELTA
+	EstadoJogo estado_enviado[2];
+	bool tem_estado_enviado[2];
+	int deltas_desde_snapshot[2];
+
+	FilaMpsc comandos;                    // Caixa de ComandoSala
+	_Atomic uint32_t comandos_pendentes;  // Incrementado antes de cada inserção
+
+	// Jogadas recebidas enquanto um jogador está atrasado, na ordem de chegada
+	struct ComandoSala* adiados[MAX_COMANDOS_ADIADOS];
+	int num_adiados;
+
+	// Prazo do turno (--prazo-turno), na roda do executor da sala
+	Temporizador prazo;
+	uint64_t ultima_acao;  // ms da última ação de quem tinha a vez
+
+	// Sessões (CAP_SESSAO): quem cai no meio da partida tem o assento reservado
+	// até suspenso_ate e pode retomá-lo com o token de quem o ocupava
+	uint64_t token_assento[2];
+	bool assento_suspenso[2];
+	uint64_t suspenso_ate[2];  // ms
+	Temporizador graca;        // Reserva que vence primeiro, na roda de reservas do executor
 } Sala;
 
-// Estrutura de cliente conectado
+// Identificador de sala = geração (12 bits altos) | índice do slot (20 bits baixos).
+// A busca por id é um acesso direto ao slot; a geração invalida ids de salas antigas.
+#define BITS_SLOT_SALA 20
+#define MASCARA_SLOT_SALA ((1u << BITS_SLOT_SALA) - 1)
+#define MAX_GERACAO_SALA ((1u << (32 - BITS_SLOT_SALA)) - 1)
+
+// Cabe vários quadros compactos e ao menos um quadro legado completo
+#define TAMANHO_BUFFER_ENTRADA 4096
+
+// Modo uring: tamanho do anel de cada worker, buffers fornecidos para a
+// recepção e vetores por SENDMSG
+#define ENTRADAS_ANEL 4096
+#define BUFFERS_ANEL 4096
+#define MAX_IOV_ANEL 16
+
+// Capacidades que o servidor aceita negociar
+#define CAPACIDADES_SERVIDOR \
+	(CAP_QUADRO_COMPACTO | CAP_ESTADO_DELTA | CAP_EVENTOS_LOBBY | CAP_HEARTBEAT | CAP_SESSAO)
+
+// A cada N deltas um EstadoJogo completo é reenviado
+#define DELTAS_POR_SNAPSHOT 32
+
+// Intervalo entre lotes de MSG_EVENTOS_LOBBY
+#define INTERVALO_TICK_LOBBY_MS 50
+
+// Resolução das rodas de temporizadores (ociosidade e prazos de turno)
+#define MS_POR_TICK 100
+#define GRACA_SESSAO_PADRAO_MS 30000
+
+// Estrutura de cliente conectado. O slot só volta ao pool quando a última
+// referência é solta: a da conexão, a de cada assento em sala, a de cada
+// comando na caixa de uma sala e a do aviso ao worker escritor.
 typedef struct {
+	NoFilaMpsc no;          // Na caixa do worker escritor (primeiro campo)
 	int socket;
 	uint32_t id;
-	uint32_t sala_id;
-	bool ativo;
+	_Atomic uint32_t sala_id;  // Sala que recebe os comandos; o executor zera se a entrada falha
+	_Atomic bool ativo;     // false quando a conexão terminou, antes da última referência
+	uint32_t indice;        // Slot no pool de clientes
+	int worker;             // Worker que escreve na conexão (e que a lê, no modo epoll)
+	_Atomic uint32_t capacidades;  // Capacidades negociadas em MSG_CONECTAR (CAP_*)
+	_Atomic uint64_t token_sessao; // Emitido em MSG_CONECTAR com CAP_SESSAO (0 = nenhum)
+	int indice_assinante;   // Posição em assinantes_lobby, -1 se não assina
+	_Atomic int referencias;
+	_Atomic bool na_caixa;  // Já avisado ao escritor e ainda não descarregado
+	_Atomic bool destruir;  // Sem referências: o escritor fecha o socket e libera o slot
+	_Atomic bool atrasado;  // Saída pendente passou de limite_saida e ainda não baixou à metade
+	_Atomic bool derrubado; // Conexão encerrada por atraso; novos quadros são descartados
+	_Atomic uint64_t ultima_atividade;  // ms do último quadro recebido
+	Temporizador ocioso;    // Verificação de ociosidade, na roda do worker escritor
+
+	// Buffers do modo epoll (leituras parciais)
+	uint8_t buffer_entrada[TAMANHO_BUFFER_ENTRADA];
+	size_t bytes_entrada;
+
+	// Quadros entregues por qualquer thread; só o worker escritor os envia
+	FilaSaida saida;
+
+	// Modo uring, só o worker: pedidos no anel que ainda podem citar o cliente
+	int pedidos_anel;
+	bool enviando;            // SENDMSG em andamento; os vetores apontam para a fila de saída
+	bool destruicao_adiada;   // Sem referências: a última conclusão destrói o cliente
+	struct msghdr envio;
+	struct iovec vetores_envio[MAX_IOV_ANEL];
 } Cliente;
 
+// Clientes com quadros enfileirados pelo handler em execução nesta thread
+#define MAX_SAIDAS_PENDENTES 16
+
+// Modo de E/S do servidor
+typedef enum {
+	IO_THREADS = 0,  // Uma thread por conexão (padrão)
+	IO_EPOLL = 1,    // Reator epoll edge-triggered com sockets não bloqueantes
+	IO_URING = 2     // Reator io_uring: accept e recv multishot, envios submetidos em lote
+} ModoIO;
+
+#define MAX_EVENTOS_EPOLL 256
+
+// Reator: nos modos epoll e uring cada worker tem seu socket de escuta
+// (SO_REUSEPORT) e lê e escreve nas próprias conexões. No modo threads um único
+// worker, sem escuta, só escreve: as threads de conexão apenas leem.
+typedef struct {
+	int indice;
+	int epoll_fd;       // -1 no modo uring
+	int server_socket;  // -1 no escritor do modo threads
+	int evento_fd;      // eventfd que acorda o worker quando a caixa recebe clientes
+	FilaMpsc caixa;     // Clientes com saída pendente ou a destruir
+	RodaTemporizadores roda;  // Ociosidade das conexões em que escreve
+	AnelIO anel;              // Modo uring
+	uint64_t contador_caixa;  // Destino da leitura do eventfd pelo anel
+	bool parando;             // Modo uring: drenando o anel antes de uma pausa
+	pthread_t thread;
+} Worker;
+
+// Modo uring: o user_data de cada pedido é o ponteiro do cliente (ou do
+// worker) com a operação nos dois bits baixos
+typedef enum {
+	OPERACAO_ACEITAR = 0,
+	OPERACAO_CAIXA = 1,
+	OPERACAO_RECEBER = 2,
+	OPERACAO_ENVIAR = 3
+} OperacaoAnel;
+
+#define MASCARA_OPERACAO 3u
+#define DADOS_CANCELAMENTO 0  // Conclusão do próprio pedido de cancelamento do anel
+
+// Executor de salas: trata as caixas das salas que lhe cabem (índice do slot
+// módulo o número de executores), então cada sala tem um único dono
+typedef struct {
+	int indice;
+	int evento_fd;     // Acorda o executor quando uma sala fica pronta
+	FilaMpsc prontas;  // Salas com comandos pendentes
+	RodaTemporizadores roda;      // Prazos de turno das suas salas
+	RodaTemporizadores reservas;  // Assentos reservados das suas salas
+	pthread_t thread;
+} Executor;
+
+// O que fazer quando a fila de saída de um cliente passa de limite_saida
+typedef enum {
+	LENTO_SNAPSHOT = 0,     // Deixa de enviar EstadoJogo; ao se recuperar recebe um completo
+	LENTO_DESCONECTAR = 1,  // Derruba a conexão
+	LENTO_PAUSAR = 2        // A sala guarda as jogadas até o cliente se recuperar
+} PoliticaLento;
+
+// Acima de limite_saida * FATOR_LIMITE_RIGIDO a conexão cai em qualquer política
+#define FATOR_LIMITE_RIGIDO 4
+#define LIMITE_SAIDA_PADRAO (64 * 1024)
+
+typedef enum {
+	COMANDO_MENSAGEM = 0,  // Mensagem do cliente para a sala
+	COMANDO_SAIR = 1,      // Tira o cliente da sala sem confirmação (desconexão ou troca de sala)
+	COMANDO_RETOMAR = 2,   // O cliente se recuperou do atraso
+	COMANDO_DESCONECTAR = 3  // A conexão caiu: com sessão em partida o assento fica reservado
+} TipoComandoSala;
+
+typedef struct ComandoSala {
+	NoFilaMpsc no;
+	TipoComandoSala tipo;
+	Cliente* cliente;      // Com uma referência, solta pelo executor
+	uint32_t sala_id;      // Id completo: comandos para uma geração antiga do slot são recusados
+	uint64_t enfileirado_em;
+	Mensagem msg;
+} ComandoSala;
+
+// Comandos tratados por sala antes de passar a vez para a próxima
+#define COMANDOS_POR_VEZ 32
+
+// Elementos alocados de uma vez quando o pool cresce
+#define SALAS_POR_BLOCO 256
+#define CLIENTES_POR_BLOCO 64
+
 // Variáveis globais
-static Sala salas[MAX_SALAS];
-static Cliente clientes[MAX_CLIENTES];
+static Pool salas;     // Protegido por salas_mutex (exceto pool_obter)
+static Pool clientes;  // Protegido por clientes_mutex (exceto pool_obter)
+static DiretorioSalas diretorio;  // Lido sem lock por MSG_LISTAR_SALAS
+static CacheLobby cache_lobby;    // Páginas do diretório já codificadas
+
+// Clientes que recebem MSG_EVENTOS_LOBBY
+static Cliente** assinantes_lobby = NULL;
+static int num_assinantes_lobby = 0;
+static int capacidade_assinantes_lobby = 0;
+static pthread_mutex_t assinantes_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t capacidade_salas = MAX_SALAS;
+static uint32_t capacidade_clientes = MAX_CLIENTES;
 static pthread_mutex_t salas_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t clientes_mutex = PTHREAD_MUTEX_INITIALIZER;
 static uint32_t proximo_cliente_id = 1;
-static uint32_t proxima_sala_id = 1;
+
+// Sementes das partidas: derivadas da semente do servidor (aleatória ou
+// --semente=N) e de um contador, então cada partida tem uma sequência própria
+static uint64_t semente_servidor = 0;
+static _Atomic uint64_t partidas_iniciadas = 0;
+
+static _Atomic uint32_t clientes_conectados = 0;  // Exportado em --metricas
+
+// Índice descritor -> cliente, lido sem lock por obter_cliente_por_socket
+static _Atomic(Cliente*)* clientes_por_socket = NULL;
+static int max_descritores = 0;
+static ModoIO modo_io = IO_THREADS;
+static Worker* workers = NULL;
+static int num_workers = 1;
+static Executor* executores = NULL;
+static int num_executores = 0;  // 0 = um por núcleo
+static size_t limite_saida = LIMITE_SAIDA_PADRAO;
+static PoliticaLento politica_lento = LENTO_SNAPSHOT;
+
+// Com CAP_HEARTBEAT uma conexão ociosa recebe MSG_PING a cada intervalo e é
+// encerrada sem nenhum quadro por timeout_ocioso_ms; as demais ficam com o
+// keepalive do TCP. Intervalo 0 desliga os dois.
+static uint64_t intervalo_ping_ms = INTERVALO_PING_PADRAO_MS;
+static uint64_t timeout_ocioso_ms = TIMEOUT_OCIOSO_PADRAO_MS;
+static uint64_t prazo_turno_ms = 0;  // 0 = sem prazo
+static uint64_t graca_sessao_ms = GRACA_SESSAO_PADRAO_MS;  // 0 = sem reserva de assento
+
+// Marcadores de data.ptr no epoll para os descritores que não são clientes
+static char marcador_escuta;
+static char marcador_caixa;
+
+// Pausa para a transferência a outro processo (--transferencia): primeiro os
+// workers, para nenhum comando novo chegar às salas; depois os executores,
+// que esvaziam as filas de prontas; por fim o lobby, que entrega o último tick
+static _Atomic bool pausar_workers = false;
+static _Atomic bool pausar_executores = false;
+static _Atomic bool pausar_lobby = false;
+static pthread_mutex_t pausa_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pausa_cond = PTHREAD_COND_INITIALIZER;
+static int threads_em_pausa = 0;
+
+static __thread Cliente* saidas_pendentes[MAX_SAIDAS_PENDENTES];
+static __thread int num_saidas_pendentes = 0;
+
+// Worker em execução nesta thread: avisos a ele mesmo dispensam o eventfd
+static __thread Worker* worker_atual = NULL;
 
 // Funções auxiliares
 void inicializar_servidor();
 Cliente* obter_cliente_por_socket(int socket);
-Sala* obter_sala_por_id(uint32_t sala_id);
-Sala* criar_sala(const char* nome, int criador_socket, uint32_t criador_id);
-bool entrar_sala(uint32_t sala_id, int socket, uint32_t cliente_id);
-void remover_cliente_da_sala(Cliente* cliente);
+Sala* alocar_sala();
+void remover_cliente_da_sala(Sala* sala, Cliente* cliente);
 void enviar_mensagem(int socket, Mensagem* msg);
 bool receber_mensagem(int socket, Mensagem* msg);
 void broadcast_sala(Sala* sala, Mensagem* msg, int exceto_socket);
+void enviar_estado_jogo(Sala* sala);
+static void retomar_sala_do_cliente(Cliente* cliente);
+Cliente* registrar_cliente(int socket, int worker, uint32_t id);
+void liberar_cliente(Cliente* cliente);
 void* thread_cliente(void* arg);
 void processar_mensagem(Cliente* cliente, Mensagem* msg);
+void processar_mensagem_sala(Sala* sala, Cliente* cliente, Mensagem* msg);
+void* executar_executor(void* arg);
+void* executar_worker(void* arg);
 
 // Implementação
-void inicializar_servidor() {
-	memset(salas, 0, sizeof(salas));
-	memset(clientes, 0, sizeof(clientes));
+static void inicializar_slot_sala(void* elemento, uint32_t indice) {
+	Sala* sala = elemento;
+	sala->indice = indice;
+	gravacao_inicializar(&sala->gravacao);
+	fila_mpsc_inicializar(&sala->comandos);
+	sala->num_adiados = 0;
+	temporizador_inicializar(&sala->prazo);
+	temporizador_inicializar(&sala->graca);
+}
+
+static void inicializar_slot_cliente(void* elemento, uint32_t indice) {
+	Cliente* cliente = elemento;
+	cliente->indice = indice;
+	fila_saida_inicializar(&cliente->saida);
+	temporizador_inicializar(&cliente->ocioso);
+}
 
-	for (int i = 0; i < MAX_SALAS; i++) {
-		pthread_mutex_init(&salas[i].mutex, NULL);
+void inicializar_servidor() {
+	pool_inicializar(&salas, sizeof(Sala), SALAS_POR_BLOCO, capacidade_salas, inicializar_slot_sala);
+	pool_inicializar(&clientes, sizeof(Cliente), CLIENTES_POR_BLOCO, capacidade_clientes,
+	                 inicializar_slot_cliente);
+	diretorio_inicializar(&diretorio, capacidade_salas);
+	cache_lobby_inicializar(&cache_lobby);
+
+	// Um slot por descritor possível no processo
+	struct rlimit limite;
+	max_descritores = 65536;
+	if (getrlimit(RLIMIT_NOFILE, &limite) == 0 && limite.rlim_cur != RLIM_INFINITY) {
+		max_descritores = limite.rlim_cur > (1 << 20) ? (1 << 20) : (int)limite.rlim_cur;
 	}
+	clientes_por_socket = calloc(max_descritores, sizeof(*clientes_por_socket));
 }
 
 Cliente* obter_cliente_por_socket(int socket) {
-	pthread_mutex_lock(&clientes_mutex);
-	for (int i = 0; i < MAX_CLIENTES; i++) {
-		if (clientes[i].ativo && clientes[i].socket == socket) {
-			pthread_mutex_unlock(&clientes_mutex);
-			return &clientes[i];
-		}
-	}
-	pthread_mutex_unlock(&clientes_mutex);
-	return NULL;
+	if (socket < 0 || socket >= max_descritores) return NULL;
+	return atomic_load_explicit(&clientes_por_socket[socket], memory_order_acquire);
 }
 
-Sala* obter_sala_por_id(uint32_t sala_id) {
-	pthread_mutex_lock(&salas_mutex);
-	for (int i = 0; i < MAX_SALAS; i++) {
-		if (salas[i].ativa && salas[i].id == sala_id) {
-			pthread_mutex_unlock(&salas_mutex);
-			return &salas[i];
-		}
-	}
-	pthread_mutex_unlock(&salas_mutex);
-	return NULL;
+static uint64_t agora_ms() {
+	return metricas_agora_ns() / 1000000;
 }
 
-Sala* criar_sala(const char* nome, int criador_socket, uint32_t criador_id) {
-	pthread_mutex_lock(&salas_mutex);
+static uint64_t tick_de(uint64_t ms) {
+	return ms / MS_POR_TICK;
+}
 
-	for (int i = 0; i < MAX_SALAS; i++) {
-		if (!salas[i].ativa) {
-			salas[i].id = proxima_sala_id++;
-			strncpy(salas[i].nome, nome, sizeof(salas[i].nome) - 1);
-			salas[i].jogador1_socket = criador_socket;
-			salas[i].jogador1_id = criador_id;
-			salas[i].jogador2_socket = -1;
-			salas[i].jogador2_id = 0;
-			salas[i].ativa = true;
-			salas[i].em_partida = false;
+static void acordar(int evento_fd) {
+	uint64_t um = 1;
+	ssize_t escrito = write(evento_fd, &um, sizeof(um));
+	(void)escrito;
+}
 
-			pthread_mutex_unlock(&salas_mutex);
-			return &salas[i];
-		}
-	}
+// Chamada pela thread que viu o pedido; volta quando a pausa termina
+static void aguardar_pausa(_Atomic bool* pedido) {
+	pthread_mutex_lock(&pausa_mutex);
+	threads_em_pausa++;
+	pthread_cond_broadcast(&pausa_cond);
+	while (atomic_load_explicit(pedido, memory_order_acquire)) pthread_cond_wait(&pausa_cond, &pausa_mutex);
+	threads_em_pausa--;
+	pthread_cond_broadcast(&pausa_cond);
+	pthread_mutex_unlock(&pausa_mutex);
+}
 
-	pthread_mutex_unlock(&salas_mutex);
-	return NULL;
+static void reter_cliente(Cliente* cliente) {
+	atomic_fetch_add_explicit(&cliente->referencias, 1, memory_order_relaxed);
 }
 
-bool entrar_sala(uint32_t sala_id, int socket, uint32_t cliente_id) {
-	Sala* sala = obter_sala_por_id(sala_id);
-	if (!sala) return false;
+// A última referência entrega o cliente ao worker escritor, que fecha o socket
+// e libera o slot entre dois lotes do epoll
+static void soltar_cliente(Cliente* cliente) {
+	if (atomic_fetch_sub_explicit(&cliente->referencias, 1, memory_order_acq_rel) != 1) return;
 
-	pthread_mutex_lock(&sala->mutex);
+	Worker* worker = &workers[cliente->worker];
+	atomic_store_explicit(&cliente->destruir, true, memory_order_relaxed);
+	fila_mpsc_inserir(&worker->caixa, &cliente->no);
+	if (worker != worker_atual) acordar(worker->evento_fd);
+}
 
-	// Prioriza slot jogador2, mas aceita jogador1 se vazio
-	if (sala->jogador2_socket == -1) {
-		sala->jogador2_socket = socket;
-		sala->jogador2_id = cliente_id;
-		pthread_mutex_unlock(&sala->mutex);
-		return true;
-	} else if (sala->jogador1_socket == -1) {
-		// Se jogador2 está ocupado mas jogador1 vazio (host saiu), aceita como jogador1
-		sala->jogador1_socket = socket;
-		sala->jogador1_id = cliente_id;
-		pthread_mutex_unlock(&sala->mutex);
-		return true;
-	}
+// Só o worker escritor, sem nenhum evento do lote atual pendente para o cliente
+static void destruir_cliente(Cliente* cliente) {
+	int socket = cliente->socket;
 
-	pthread_mutex_unlock(&sala->mutex);
-	return false;
+	metricas_travar(&clientes_mutex, MUTEX_CLIENTES);
+	atomic_store_explicit(&clientes_por_socket[socket], NULL, memory_order_release);
+	pthread_mutex_unlock(&clientes_mutex);
+
+	roda_cancelar(&workers[cliente->worker].roda, &cliente->ocioso);
+	fila_saida_limpar(&cliente->saida);
+	close(socket);
+
+	// Só depois de limpo o slot pode ser entregue a uma nova conexão
+	metricas_travar(&clientes_mutex, MUTEX_CLIENTES);
+	pool_liberar(&clientes, cliente->indice);
+	pthread_mutex_unlock(&clientes_mutex);
+	atomic_fetch_sub_explicit(&clientes_conectados, 1, memory_order_relaxed);
 }
 
-void remover_cliente_da_sala(Cliente* cliente) {
-	if (cliente->sala_id == 0) return;
+// Assento com jogador conectado ou reservado para quem caiu
+static bool assento_ocupado(const Sala* sala, int jogador) {
+	int socket = (jogador == 1) ? sala->jogador1_socket : sala->jogador2_socket;
+	return socket != -1 || sala->assento_suspenso[jogador - 1];
+}
 
-	Sala* sala = obter_sala_por_id(cliente->sala_id);
-	if (!sala) return;
+// Atualiza a entrada da sala no diretório do lobby; chamada pelo executor da
+// sala a cada mudança de ocupação ou de partida
+static void publicar_sala(Sala* sala) {
+	InfoSala info;
+	memset(&info, 0, sizeof(InfoSala));
+	info.id = sala->id;
+	strncpy(info.nome, sala->nome, sizeof(info.nome) - 1);
+	info.num_jogadores = (assento_ocupado(sala, 1) ? 1 : 0) + (assento_ocupado(sala, 2) ? 1 : 0);
+	info.max_jogadores = 2;
+	info.em_partida = sala->em_partida;
+	diretorio_publicar(&diretorio, sala->indice, &info);
+}
 
-	pthread_mutex_lock(&sala->mutex);
+// Reserva um slot e define o id da nova sala; o estado é preenchido pelo
+// executor ao tratar o MSG_CRIAR_SALA
+Sala* alocar_sala() {
+	metricas_travar(&salas_mutex, MUTEX_SALAS);
 
-	int jogador_saiu = 0;
-	int socket_restante = -1;
+	uint32_t indice;
+	Sala* sala = pool_alocar(&salas, &indice);
+	if (sala) {
+		sala->geracao = (sala->geracao % MAX_GERACAO_SALA) + 1;
+		atomic_store_explicit(&sala->id, ((uint32_t)sala->geracao << BITS_SLOT_SALA) | indice, memory_order_release);
+	}
 
-	if (sala->jogador1_socket == cliente->socket) {
-		sala->jogador1_socket = -1;
+	pthread_mutex_unlock(&salas_mutex);
+	return sala;
+}
+
+// Jogador (1 ou 2) do cliente na sala, 0 se ele não ocupa um assento
+static int jogador_na_sala(const Sala* sala, const Cliente* cliente) {
+	if (cliente->socket == sala->jogador1_socket) return 1;
+	if (cliente->socket == sala->jogador2_socket) return 2;
+	return 0;
+}
+
+// Desocupa o assento (conectado ou reservado) e solta a referência que ele
+// mantinha no cliente
+static void liberar_assento(Sala* sala, int jogador) {
+	int* socket = (jogador == 1) ? &sala->jogador1_socket : &sala->jogador2_socket;
+	if (!assento_ocupado(sala, jogador)) return;
+
+	Cliente* cliente = *socket != -1 ? obter_cliente_por_socket(*socket) : NULL;
+	if (cliente) {
+		// Só zera se o cliente ainda aponta para esta sala
+		uint32_t esperado = sala->id;
+		atomic_compare_exchange_strong(&cliente->sala_id, &esperado, 0);
+		soltar_cliente(cliente);
+	}
+	*socket = -1;
+	if (jogador == 1) {
 		sala->jogador1_id = 0;
-		jogador_saiu = 1;
-		socket_restante = sala->jogador2_socket;
-	} else if (sala->jogador2_socket == cliente->socket) {
-		sala->jogador2_socket = -1;
+	} else {
 		sala->jogador2_id = 0;
-		jogador_saiu = 2;
-		socket_restante = sala->jogador1_socket;
 	}
+	sala->token_assento[jogador - 1] = 0;
+	sala->assento_suspenso[jogador - 1] = false;
+}
+
+static void ocupar_assento(Sala* sala, int jogador, Cliente* cliente) {
+	reter_cliente(cliente);
+	if (jogador == 1) {
+		sala->jogador1_socket = cliente->socket;
+		sala->jogador1_id = cliente->id;
+	} else {
+		sala->jogador2_socket = cliente->socket;
+		sala->jogador2_id = cliente->id;
+	}
+	sala->tem_estado_enviado[jogador - 1] = false;
+	sala->token_assento[jogador - 1] = atomic_load_explicit(&cliente->token_sessao, memory_order_relaxed);
+	sala->assento_suspenso[jogador - 1] = false;
+}
+
+// Solta as jogadas guardadas por uma sala pausada sem tratá-las
+static void descartar_adiados(Sala* sala) {
+	for (int i = 0; i < sala->num_adiados; i++) {
+		soltar_cliente(sala->adiados[i]->cliente);
+		free(sala->adiados[i]);
+	}
+	sala->num_adiados = 0;
+}
+
+// Só o executor da sala; o slot volta para a lista livre do pool
+static void liberar_sala(Sala* sala) {
+	descartar_adiados(sala);
+	roda_cancelar(&executores[sala->indice % num_executores].roda, &sala->prazo);
+	roda_cancelar(&executores[sala->indice % num_executores].reservas, &sala->graca);
+	gravacao_finalizar(&sala->gravacao, &sala->jogo);  // Partida abandonada, se ainda gravando
+	diretorio_remover(&diretorio, sala->indice);
+	liberar_assento(sala, 1);
+	liberar_assento(sala, 2);
+
+	metricas_travar(&salas_mutex, MUTEX_SALAS);
+	atomic_store_explicit(&sala->ativa, false, memory_order_release);
+	pool_liberar(&salas, sala->indice);
+	pthread_mutex_unlock(&salas_mutex);
+}
+
+// Libera o assento, avisa quem ficou e destrói a sala se ela esvaziou
+static void desocupar(Sala* sala, int jogador_saiu) {
+	liberar_assento(sala, jogador_saiu);
+	int socket_restante = (jogador_saiu == 1) ? sala->jogador2_socket : sala->jogador1_socket;
 
 	// Notifica o jogador restante (se houver)
-	if (socket_restante != -1 && jogador_saiu != 0) {
+	if (socket_restante != -1) {
 		Mensagem notif;
 		memset(&notif, 0, sizeof(Mensagem));
 		notif.tipo = MSG_ENTRAR_SALA;  // Reutiliza mensagem para atualizar contagem
@@ -167,58 +532,159 @@ void remover_cliente_da_sala(Cliente* cliente) {
 		enviar_mensagem(socket_restante, &notif);
 	}
 
-	// Se ficou vazia, desativa a sala
-	if (sala->jogador1_socket == -1 && sala->jogador2_socket == -1) {
-		sala->ativa = false;
-		printf("Sala %u destruída (todos saíram)\n", sala->id);
+	// Se ficou vazia, desativa a sala; o slot pode ser realocado logo em seguida
+	if (!assento_ocupado(sala, 1) && !assento_ocupado(sala, 2)) {
+		uint32_t sala_id = sala->id;
+		liberar_sala(sala);
+		registro(REGISTRO_INFO, "Sala %u destruída (todos saíram)", sala_id);
+	} else {
+		publicar_sala(sala);
+	}
+}
+
+void remover_cliente_da_sala(Sala* sala, Cliente* cliente) {
+	int jogador_saiu = jogador_na_sala(sala, cliente);
+	if (jogador_saiu != 0) desocupar(sala, jogador_saiu);
+}
+
+// Depois de cada envio. Histerese: o atraso só termina quando a fila baixa à
+// metade do limite.
+static void conferir_atraso(Cliente* cliente) {
+	if (atomic_load_explicit(&cliente->atrasado, memory_order_relaxed) &&
+	    fila_saida_pendente(&cliente->saida) <= limite_saida / 2 &&
+	    atomic_exchange_explicit(&cliente->atrasado, false, memory_order_acq_rel)) {
+		retomar_sala_do_cliente(cliente);
 	}
+}
 
-	pthread_mutex_unlock(&sala->mutex);
-	cliente->sala_id = 0;
+// Envia a fila de saída do cliente com um único sendmsg que não bloqueia; o
+// restante segue no próximo EPOLLOUT. Só o worker escritor do cliente.
+static ResultadoDescarga descarregar_cliente(Cliente* cliente) {
+	uint64_t antes = cliente->saida.bytes_enviados;
+	ResultadoDescarga resultado = fila_saida_descarregar(&cliente->saida, cliente->socket);
+	metricas_bytes_enviados(cliente->saida.bytes_enviados - antes);
+	conferir_atraso(cliente);
+	return resultado;
 }
 
-// Envia todos os bytes garantindo entrega completa
-bool send_all(int socket, const void* buffer, size_t length) {
-	const char* ptr = (const char*)buffer;
-	size_t remaining = length;
+// Põe na caixa dos workers escritores os clientes que receberam quadros no
+// handler atual; cada worker é acordado uma vez
+static void descarregar_saidas_pendentes() {
+	Worker* acordar_workers[MAX_SAIDAS_PENDENTES];
+	int num_acordar = 0;
 
-	while (remaining > 0) {
-		ssize_t sent = send(socket, ptr, remaining, 0);
-		if (sent <= 0) {
-			return false;  // Erro ou conexão fechada
-		}
-		ptr += sent;
-		remaining -= sent;
+	for (int i = 0; i < num_saidas_pendentes; i++) {
+		Worker* worker = &workers[saidas_pendentes[i]->worker];
+		fila_mpsc_inserir(&worker->caixa, &saidas_pendentes[i]->no);
+		if (worker == worker_atual) continue;  // Esvazia a caixa ao fim do lote atual
+
+		int j = 0;
+		while (j < num_acordar && acordar_workers[j] != worker) j++;
+		if (j == num_acordar) acordar_workers[num_acordar++] = worker;
 	}
-	return true;
+	for (int i = 0; i < num_acordar; i++) acordar(acordar_workers[i]->evento_fd);
+	num_saidas_pendentes = 0;
 }
 
-// Recebe todos os bytes garantindo leitura completa
-bool recv_all(int socket, void* buffer, size_t length) {
-	char* ptr = (char*)buffer;
-	size_t remaining = length;
+// Chamada quando a fila de entrada do cliente deixou de estar vazia. O aviso
+// mantém uma referência até o escritor descarregar.
+static void marcar_saida_pendente(Cliente* cliente) {
+	if (atomic_exchange_explicit(&cliente->na_caixa, true, memory_order_acq_rel)) return;
+	reter_cliente(cliente);
+	if (num_saidas_pendentes == MAX_SAIDAS_PENDENTES) descarregar_saidas_pendentes();
+	saidas_pendentes[num_saidas_pendentes++] = cliente;
+}
 
-	while (remaining > 0) {
-		ssize_t received = recv(socket, ptr, remaining, 0);
-		if (received <= 0) {
-			return false;  // Erro ou conexão fechada
-		}
-		ptr += received;
-		remaining -= received;
+// O shutdown faz a thread leitora (ou o worker) ver o fim da conexão e liberá-la
+static void derrubar_cliente(Cliente* cliente, size_t pendente) {
+	if (atomic_exchange_explicit(&cliente->derrubado, true, memory_order_acq_rel)) return;
+	metricas_desconexao_por_atraso();
+	registro(REGISTRO_AVISO, "Cliente %u desconectado: %zu bytes de saída pendentes", cliente->id, pendente);
+	shutdown(cliente->socket, SHUT_RDWR);
+}
+
+// Aplica o limite de saída antes de entregar um quadro. Retorna false se o
+// quadro deve ser descartado porque a conexão foi derrubada.
+static bool admitir_quadro(Cliente* cliente, size_t tamanho) {
+	if (atomic_load_explicit(&cliente->derrubado, memory_order_relaxed)) return false;
+
+	size_t pendente = fila_saida_pendente(&cliente->saida) + tamanho;
+	if (pendente <= limite_saida) return true;
+
+	if (!atomic_exchange_explicit(&cliente->atrasado, true, memory_order_acq_rel)) {
+		metricas_cliente_lento();
+		registro(REGISTRO_DEBUG, "Cliente %u atrasado: %zu bytes de saída pendentes", cliente->id, pendente);
+	}
+	if (politica_lento == LENTO_DESCONECTAR || pendente > limite_saida * FATOR_LIMITE_RIGIDO) {
+		derrubar_cliente(cliente, pendente);
+		return false;
 	}
 	return true;
 }
 
+// Codifica no formato negociado pelo destinatário (compacto ou estrutura legada)
+// e entrega à fila de saída; quem envia é o worker escritor do cliente
 void enviar_mensagem(int socket, Mensagem* msg) {
-	send_all(socket, msg, sizeof(Mensagem));
+	Cliente* cliente = obter_cliente_por_socket(socket);
+	if (!cliente) return;
+	bool compacto = atomic_load_explicit(&cliente->capacidades, memory_order_relaxed) & CAP_QUADRO_COMPACTO;
+
+	uint8_t quadro[PROTOCOLO_TAMANHO_MAX_QUADRO];
+	size_t tamanho = protocolo_codificar(msg, compacto, quadro);
+	if (!admitir_quadro(cliente, tamanho)) return;
+
+	if (fila_saida_enviar(&cliente->saida, quadro, tamanho)) marcar_saida_pendente(cliente);
+	metricas_mensagem_enviada(msg->tipo);
+}
+
+// Entrega um quadro já codificado e compartilhado com outras conexões
+static void enviar_quadro_compartilhado(Cliente* cliente, TipoMensagem tipo, BufferCompartilhado* quadro) {
+	if (!admitir_quadro(cliente, quadro->tamanho)) return;
+	if (fila_saida_enviar_compartilhado(&cliente->saida, quadro)) marcar_saida_pendente(cliente);
+	metricas_mensagem_enviada(tipo);
+}
+
+static void assinar_lobby(Cliente* cliente) {
+	pthread_mutex_lock(&assinantes_mutex);
+	if (cliente->indice_assinante < 0) {
+		if (num_assinantes_lobby == capacidade_assinantes_lobby) {
+			int nova_capacidade = capacidade_assinantes_lobby ? capacidade_assinantes_lobby * 2 : 64;
+			Cliente** novos = realloc(assinantes_lobby, nova_capacidade * sizeof(Cliente*));
+			if (!novos) {
+				pthread_mutex_unlock(&assinantes_mutex);
+				return;
+			}
+			assinantes_lobby = novos;
+			capacidade_assinantes_lobby = nova_capacidade;
+		}
+		cliente->indice_assinante = num_assinantes_lobby;
+		assinantes_lobby[num_assinantes_lobby++] = cliente;
+	}
+	pthread_mutex_unlock(&assinantes_mutex);
+}
+
+static void cancelar_assinatura_lobby(Cliente* cliente) {
+	pthread_mutex_lock(&assinantes_mutex);
+	int indice = cliente->indice_assinante;
+	if (indice >= 0) {
+		// O último assinante ocupa a posição liberada
+		Cliente* ultimo = assinantes_lobby[--num_assinantes_lobby];
+		assinantes_lobby[indice] = ultimo;
+		ultimo->indice_assinante = indice;
+		cliente->indice_assinante = -1;
+	}
+	pthread_mutex_unlock(&assinantes_mutex);
 }
 
 bool receber_mensagem(int socket, Mensagem* msg) {
-	return recv_all(socket, msg, sizeof(Mensagem));
+	size_t tamanho = protocolo_receber_quadro(socket, msg);
+	if (tamanho == 0) return false;
+	metricas_mensagem_recebida(msg->tipo, tamanho);
+	return true;
 }
 
+// Só o executor da sala
 void broadcast_sala(Sala* sala, Mensagem* msg, int exceto_socket) {
-	// NOTA: Caller deve já possuir sala->mutex
 	if (sala->jogador1_socket != -1 && sala->jogador1_socket != exceto_socket) {
 		enviar_mensagem(sala->jogador1_socket, msg);
 	}
@@ -227,56 +693,232 @@ void broadcast_sala(Sala* sala, Mensagem* msg, int exceto_socket) {
 	}
 }
 
+// Envia ao jogador (1 ou 2) seu EstadoJogo: delta em relação ao último estado enviado
+// se o cliente suporta, snapshot completo na primeira vez e a cada DELTAS_POR_SNAPSHOT
+static void enviar_estado_jogador(Sala* sala, int jogador) {
+	int socket = (jogador == 1) ? sala->jogador1_socket : sala->jogador2_socket;
+	if (socket == -1) return;
+
+	Mensagem resposta;
+	memset(&resposta, 0, sizeof(Mensagem));
+	resposta.sala_id = sala->id;
+	resposta.jogador_id = (jogador == 1) ? sala->jogador1_id : sala->jogador2_id;
+
+	Cliente* cliente = obter_cliente_por_socket(socket);
+	uint32_t capacidades = cliente ? atomic_load_explicit(&cliente->capacidades, memory_order_relaxed) : 0;
+	int assento = jogador - 1;
+
+	// Cliente atrasado não recebe estados intermediários; quando se recuperar,
+	// COMANDO_RETOMAR manda um snapshot completo
+	if (politica_lento == LENTO_SNAPSHOT && cliente && atomic_load_explicit(&cliente->atrasado, memory_order_acquire)) {
+		sala->tem_estado_enviado[assento] = false;
+		metricas_estado_descartado();
+		return;
+	}
+
+	EstadoJogo estado = obter_estado_jogo(&sala->jogo, jogador);
+
+	if ((capacidades & CAP_ESTADO_DELTA) && sala->tem_estado_enviado[assento] &&
+	    sala->deltas_desde_snapshot[assento] < DELTAS_POR_SNAPSHOT) {
+		resposta.tipo = MSG_ESTADO_DELTA;
+		resposta.tamanho_dados = estado_delta_codificar(&sala->estado_enviado[assento], &estado, resposta.dados);
+		sala->deltas_desde_snapshot[assento]++;
+	} else {
+		resposta.tipo = MSG_ESTADO_JOGO;
+		memcpy(resposta.dados, &estado, sizeof(EstadoJogo));
+		resposta.tamanho_dados = sizeof(EstadoJogo);
+		sala->deltas_desde_snapshot[assento] = 0;
+	}
+
+	sala->estado_enviado[assento] = estado;
+	sala->tem_estado_enviado[assento] = true;
+	enviar_mensagem(socket, &resposta);
+}
+
+void enviar_estado_jogo(Sala* sala) {
+	enviar_estado_jogador(sala, 1);
+	enviar_estado_jogador(sala, 2);
+}
+
+// Se a última jogada decidiu a partida, avisa os dois jogadores e marca a sala
+// como fora de partida. Retorna true se a partida acabou.
+static bool anunciar_fim_partida(Sala* sala) {
+	if (!sala->em_partida || !sala->jogo.partida_finalizada) return false;
+
+	Mensagem fim;
+	memset(&fim, 0, sizeof(Mensagem));
+	fim.tipo = MSG_FIM_PARTIDA;
+	fim.sala_id = sala->id;
+	// Envia ID do cliente vencedor (não o número do jogador)
+	uint32_t id_vencedor = (sala->jogo.vencedor_partida == 1) ? sala->jogador1_id : sala->jogador2_id;
+	memcpy(fim.dados, &id_vencedor, sizeof(uint32_t));
+	fim.tamanho_dados = sizeof(uint32_t);
+	broadcast_sala(sala, &fim, -1);
+	sala->em_partida = false;
+	gravacao_finalizar(&sala->gravacao, &sala->jogo);
+	registro(REGISTRO_INFO, "Partida finalizada na sala %u - Vencedor: Jogador %d", sala->id,
+	         sala->jogo.vencedor_partida);
+	return true;
+}
+
+// Entrega um comando à caixa da sala; a primeira entrega põe a sala na fila
+// do executor dela
+static void enviar_comando_sala(Sala* sala, TipoComandoSala tipo, Cliente* cliente, uint32_t sala_id,
+                                const Mensagem* msg) {
+	ComandoSala* comando = malloc(sizeof(ComandoSala));
+	if (!comando) return;
+	comando->tipo = tipo;
+	comando->cliente = cliente;
+	comando->sala_id = sala_id;
+	comando->enfileirado_em = metricas_agora_ns();
+	if (msg) comando->msg = *msg;
+	reter_cliente(cliente);
+
+	bool ociosa = atomic_fetch_add_explicit(&sala->comandos_pendentes, 1, memory_order_acq_rel) == 0;
+	fila_mpsc_inserir(&sala->comandos, &comando->no);
+	if (ociosa) {
+		Executor* executor = &executores[sala->indice % num_executores];
+		fila_mpsc_inserir(&executor->prontas, &sala->no);
+		acordar(executor->evento_fd);
+	}
+}
+
+// Slot da sala pelo id; a geração é conferida pelo executor
+static Sala* slot_da_sala(uint32_t sala_id) {
+	return sala_id ? pool_obter(&salas, sala_id & MASCARA_SLOT_SALA) : NULL;
+}
+
+// Avisa a sala do cliente que ele saiu do atraso. Chamada pelo worker escritor.
+static void retomar_sala_do_cliente(Cliente* cliente) {
+	if (politica_lento == LENTO_DESCONECTAR) return;
+	uint32_t sala_id = atomic_load_explicit(&cliente->sala_id, memory_order_acquire);
+	Sala* sala = slot_da_sala(sala_id);
+	if (sala) enviar_comando_sala(sala, COMANDO_RETOMAR, cliente, sala_id, NULL);
+}
+
+// Tira o cliente da sala atual sem confirmação (COMANDO_SAIR ou COMANDO_DESCONECTAR)
+static void sair_da_sala_atual(Cliente* cliente, TipoComandoSala tipo) {
+	uint32_t sala_id = atomic_exchange_explicit(&cliente->sala_id, 0, memory_order_acq_rel);
+	Sala* sala = slot_da_sala(sala_id);
+	if (sala) enviar_comando_sala(sala, tipo, cliente, sala_id, NULL);
+}
+
+static void enviar_erro(Cliente* cliente, const char* texto) {
+	Mensagem resposta;
+	memset(&resposta, 0, sizeof(Mensagem));
+	resposta.tipo = MSG_ERRO;
+	if (texto) {
+		memcpy(resposta.dados, texto, strlen(texto) + 1);
+		resposta.tamanho_dados = strlen(texto) + 1;
+	}
+	enviar_mensagem(cliente->socket, &resposta);
+}
+
+// Chamada pela thread que lê a conexão. Pedidos que só dependem do cliente são
+// respondidos aqui; os que tocam uma sala viram comandos na caixa dela.
 void processar_mensagem(Cliente* cliente, Mensagem* msg) {
+	uint64_t inicio = metricas_agora_ns();
+	bool encaminhada = false;
 	Mensagem resposta;
 	memset(&resposta, 0, sizeof(Mensagem));
+	atomic_store_explicit(&cliente->ultima_atividade, inicio / 1000000, memory_order_relaxed);
 
 	switch (msg->tipo) {
+		case MSG_PING:
+			resposta.tipo = MSG_PONG;
+			enviar_mensagem(cliente->socket, &resposta);
+			break;
+
+		case MSG_PONG:
+			// Basta ter chegado: a atividade já foi registrada
+			break;
+
+		case MSG_CONECTAR: {
+			// Negociação de capacidades: clientes antigos não enviam dados e não recebem resposta
+			if (msg->tamanho_dados < sizeof(uint32_t)) break;
+
+			uint32_t pedidas;
+			memcpy(&pedidas, msg->dados, sizeof(uint32_t));
+			uint32_t capacidades = pedidas & CAPACIDADES_SERVIDOR;
+			atomic_store_explicit(&cliente->capacidades, capacidades, memory_order_relaxed);
+
+			resposta.tipo = MSG_CONECTAR;
+			resposta.jogador_id = cliente->id;
+			memcpy(resposta.dados, &capacidades, sizeof(uint32_t));
+			resposta.tamanho_dados = sizeof(uint32_t);
+
+			// Cada conexão recebe um token novo; o antigo só serve para retomar o assento
+			uint64_t token_antigo = 0;
+			if (capacidades & CAP_SESSAO) {
+				uint64_t token = 0;
+				while (token == 0) {
+					if (getrandom(&token, sizeof(token), 0) != sizeof(token)) {
+						token = misturar_semente(semente_servidor ^ metricas_agora_ns());
+					}
+				}
+				atomic_store_explicit(&cliente->token_sessao, token, memory_order_relaxed);
+				memcpy(resposta.dados + sizeof(uint32_t), &token, sizeof(uint64_t));
+				resposta.tamanho_dados = SESSAO_TAMANHO_DADOS;
+				if (msg->tamanho_dados >= SESSAO_TAMANHO_DADOS) {
+					memcpy(&token_antigo, msg->dados + sizeof(uint32_t), sizeof(uint64_t));
+				}
+			}
+			enviar_mensagem(cliente->socket, &resposta);
+
+			// Retomada: a sala confere o token e devolve o assento reservado
+			Sala* sala = slot_da_sala(msg->sala_id);
+			if (token_antigo != 0 && sala) {
+				sair_da_sala_atual(cliente, COMANDO_SAIR);
+				atomic_store_explicit(&cliente->sala_id, msg->sala_id, memory_order_release);
+				enviar_comando_sala(sala, COMANDO_MENSAGEM, cliente, msg->sala_id, msg);
+				encaminhada = true;
+			}
+			break;
+		}
+
 		case MSG_CRIAR_SALA: {
-			char nome_sala[64];
-			memcpy(nome_sala, msg->dados, sizeof(nome_sala));
+			sair_da_sala_atual(cliente, COMANDO_SAIR);
 
-			Sala* sala = criar_sala(nome_sala, cliente->socket, cliente->id);
+			// O id já vale para rotear os próximos comandos; o executor preenche a sala
+			Sala* sala = alocar_sala();
 			if (sala) {
-				cliente->sala_id = sala->id;
-				resposta.tipo = MSG_CRIAR_SALA;
-				resposta.sala_id = sala->id;
-				resposta.jogador_id = cliente->id;
-				enviar_mensagem(cliente->socket, &resposta);
+				atomic_store_explicit(&cliente->sala_id, sala->id, memory_order_release);
+				enviar_comando_sala(sala, COMANDO_MENSAGEM, cliente, sala->id, msg);
+				encaminhada = true;
+			} else {
+				enviar_erro(cliente, NULL);
+			}
+			break;
+		}
+
+		case MSG_ASSINAR_LOBBY: {
+			if (!(atomic_load_explicit(&cliente->capacidades, memory_order_relaxed) & CAP_EVENTOS_LOBBY)) break;
 
-				printf("Cliente %u criou sala %u: %s\n", cliente->id, sala->id, nome_sala);
+			if (msg->tamanho_dados > 0 && msg->dados[0]) {
+				assinar_lobby(cliente);
 			} else {
-				resposta.tipo = MSG_ERRO;
-				enviar_mensagem(cliente->socket, &resposta);
+				cancelar_assinatura_lobby(cliente);
 			}
 			break;
 		}
 
 		case MSG_LISTAR_SALAS: {
-			pthread_mutex_lock(&salas_mutex);
-
-			int num_salas = 0;
-			InfoSala info_salas[MAX_SALAS];
-
-			for (int i = 0; i < MAX_SALAS; i++) {
-				if (salas[i].ativa) {
-					info_salas[num_salas].id = salas[i].id;
-					strncpy(info_salas[num_salas].nome, salas[i].nome, 64);
-					info_salas[num_salas].num_jogadores =
-					    (salas[i].jogador1_socket != -1 ? 1 : 0) +
-					    (salas[i].jogador2_socket != -1 ? 1 : 0);
-					info_salas[num_salas].max_jogadores = 2;
-					info_salas[num_salas].em_partida = salas[i].em_partida;
-					num_salas++;
-				}
+			// Uma página por resposta, lida do diretório sem nenhum lock
+			PedidoListaSalas pedido;
+			memset(&pedido, 0, sizeof(PedidoListaSalas));
+			memcpy(&pedido, msg->dados,
+			       msg->tamanho_dados < sizeof(PedidoListaSalas) ? msg->tamanho_dados : sizeof(PedidoListaSalas));
+
+			// Zera o que vem depois do prefixo: pedidos iguais têm os mesmos bytes no cache
+			size_t tamanho_prefixo = strnlen(pedido.prefixo, sizeof(pedido.prefixo) - 1);
+			memset(pedido.prefixo + tamanho_prefixo, 0, sizeof(pedido.prefixo) - tamanho_prefixo);
+
+			bool compacto = atomic_load_explicit(&cliente->capacidades, memory_order_relaxed) & CAP_QUADRO_COMPACTO;
+			BufferCompartilhado* quadro = cache_lobby_obter(&cache_lobby, &diretorio, &pedido, compacto);
+			if (quadro) {
+				enviar_quadro_compartilhado(cliente, MSG_LISTAR_SALAS, quadro);
+				buffer_compartilhado_liberar(quadro);
 			}
-
-			pthread_mutex_unlock(&salas_mutex);
-
-			resposta.tipo = MSG_LISTAR_SALAS;
-			resposta.tamanho_dados = num_salas * sizeof(InfoSala);
-			memcpy(resposta.dados, info_salas, resposta.tamanho_dados);
-			enviar_mensagem(cliente->socket, &resposta);
 			break;
 		}
 
@@ -285,159 +927,240 @@ void processar_mensagem(Cliente* cliente, Mensagem* msg) {
 			memcpy(&sala_id, msg->dados, sizeof(uint32_t));
 
 			// Verifica se já está na sala
-			if (cliente->sala_id == sala_id) {
-				resposta.tipo = MSG_ERRO;
-				const char* msg_erro = "Voce ja esta nesta sala";
-				memcpy(resposta.dados, msg_erro, strlen(msg_erro) + 1);
-				enviar_mensagem(cliente->socket, &resposta);
+			if (atomic_load_explicit(&cliente->sala_id, memory_order_acquire) == sala_id) {
+				enviar_erro(cliente, "Voce ja esta nesta sala");
 				break;
 			}
 
-			if (entrar_sala(sala_id, cliente->socket, cliente->id)) {
-				cliente->sala_id = sala_id;
-				resposta.tipo = MSG_ENTRAR_SALA;
-				resposta.sala_id = sala_id;
-				resposta.jogador_id = cliente->id;
-				enviar_mensagem(cliente->socket, &resposta);
+			Sala* sala = slot_da_sala(sala_id);
+			if (!sala) {
+				enviar_erro(cliente, "Sala inexistente");
+				break;
+			}
 
-				// Notifica o outro jogador
-				Sala* sala = obter_sala_por_id(sala_id);
-				if (sala) {
-					pthread_mutex_lock(&sala->mutex);
-					Mensagem notif;
-					memset(&notif, 0, sizeof(Mensagem));
-					notif.tipo = MSG_ENTRAR_SALA;
-					notif.sala_id = sala_id;
-					notif.jogador_id = cliente->id;  // ID do jogador que entrou
-					broadcast_sala(sala, &notif, cliente->socket);
-					pthread_mutex_unlock(&sala->mutex);
-				}
-				printf("Cliente %u entrou na sala %u\n", cliente->id, sala_id);
+			// Os comandos seguintes já vão para a nova sala; se ela recusar, o executor zera sala_id
+			sair_da_sala_atual(cliente, COMANDO_SAIR);
+			atomic_store_explicit(&cliente->sala_id, sala_id, memory_order_release);
+			enviar_comando_sala(sala, COMANDO_MENSAGEM, cliente, sala_id, msg);
+			encaminhada = true;
+			break;
+		}
+
+		case MSG_SAIR_SALA: {
+			uint32_t sala_id = atomic_exchange_explicit(&cliente->sala_id, 0, memory_order_acq_rel);
+			registro(REGISTRO_INFO, "Cliente %u saindo da sala %u", cliente->id, sala_id);
+
+			// A sala confirma depois de tirar o jogador; sem sala a confirmação é imediata
+			Sala* sala = slot_da_sala(sala_id);
+			if (sala) {
+				enviar_comando_sala(sala, COMANDO_MENSAGEM, cliente, sala_id, msg);
+				encaminhada = true;
 			} else {
-				resposta.tipo = MSG_ERRO;
+				resposta.tipo = MSG_CONECTAR;
+				resposta.jogador_id = 0;
+				enviar_mensagem(cliente->socket, &resposta);
+			}
+			break;
+		}
+
+		default: {
+			// Ações de partida: a sala confere se o cliente ocupa um assento
+			uint32_t sala_id = atomic_load_explicit(&cliente->sala_id, memory_order_acquire);
+			Sala* sala = slot_da_sala(sala_id);
+			if (sala) {
+				enviar_comando_sala(sala, COMANDO_MENSAGEM, cliente, sala_id, msg);
+				encaminhada = true;
+			}
+			break;
+		}
+	}
+
+	// Um evento gera no máximo um aviso por worker escritor
+	descarregar_saidas_pendentes();
+
+	// Mensagem encaminhada: o executor mede o tratamento na sala
+	if (!encaminhada) metricas_processamento(msg->tipo, metricas_agora_ns() - inicio);
+}
+
+// Só o executor da sala. Trata uma mensagem de um cliente para uma sala ativa
+// (ou, no caso de MSG_CRIAR_SALA, para o slot recém-alocado).
+void processar_mensagem_sala(Sala* sala, Cliente* cliente, Mensagem* msg) {
+	Mensagem resposta;
+	memset(&resposta, 0, sizeof(Mensagem));
+	int jogador = jogador_na_sala(sala, cliente);
+
+	switch (msg->tipo) {
+		case MSG_CRIAR_SALA: {
+			char nome_sala[64];
+			memcpy(nome_sala, msg->dados, sizeof(nome_sala));
+			nome_sala[sizeof(nome_sala) - 1] = '\0';
+
+			memset(sala->nome, 0, sizeof(sala->nome));
+			strncpy(sala->nome, nome_sala, sizeof(sala->nome) - 1);
+			sala->jogador1_socket = -1;
+			sala->jogador2_socket = -1;
+			sala->jogador1_id = 0;
+			sala->jogador2_id = 0;
+			sala->token_assento[1] = 0;
+			sala->assento_suspenso[1] = false;
+			sala->em_partida = false;
+			ocupar_assento(sala, 1, cliente);
+			atomic_store_explicit(&sala->ativa, true, memory_order_release);
+			publicar_sala(sala);
+
+			resposta.tipo = MSG_CRIAR_SALA;
+			resposta.sala_id = sala->id;
+			resposta.jogador_id = cliente->id;
+			enviar_mensagem(cliente->socket, &resposta);
+			captura_sala(cliente->id, sala->id);
+
+			registro(REGISTRO_INFO, "Cliente %u criou sala %u: %s", cliente->id, sala->id, nome_sala);
+			break;
+		}
+
+		case MSG_ENTRAR_SALA: {
+			// Prioriza slot jogador2, mas aceita jogador1 se vazio (host saiu)
+			int assento = 0;
+			if (jogador == 0 && !assento_ocupado(sala, 2)) {
+				assento = 2;
+			} else if (jogador == 0 && !assento_ocupado(sala, 1)) {
+				assento = 1;
+			}
+
+			if (assento == 0) {
+				uint32_t esperado = sala->id;
+				atomic_compare_exchange_strong(&cliente->sala_id, &esperado, 0);
 				const char* msg_erro = "Sala cheia";
+				resposta.tipo = MSG_ERRO;
 				memcpy(resposta.dados, msg_erro, strlen(msg_erro) + 1);
+				resposta.tamanho_dados = strlen(msg_erro) + 1;
 				enviar_mensagem(cliente->socket, &resposta);
+				break;
+			}
+
+			ocupar_assento(sala, assento, cliente);
+			publicar_sala(sala);
+
+			resposta.tipo = MSG_ENTRAR_SALA;
+			resposta.sala_id = sala->id;
+			resposta.jogador_id = cliente->id;
+			enviar_mensagem(cliente->socket, &resposta);
+
+			// Notifica o outro jogador
+			Mensagem notif;
+			memset(&notif, 0, sizeof(Mensagem));
+			notif.tipo = MSG_ENTRAR_SALA;
+			notif.sala_id = sala->id;
+			notif.jogador_id = cliente->id;  // ID do jogador que entrou
+			broadcast_sala(sala, &notif, cliente->socket);
+			registro(REGISTRO_INFO, "Cliente %u entrou na sala %u", cliente->id, sala->id);
+			break;
+		}
+
+		case MSG_CONECTAR: {
+			// Retomada de sessão: o token antigo identifica o assento
+			uint64_t token;
+			memcpy(&token, msg->dados + sizeof(uint32_t), sizeof(uint64_t));
+			int assento = 0;
+			if (sala->token_assento[0] == token) assento = 1;
+			if (sala->token_assento[1] == token) assento = 2;
+
+			if (assento == 0) {
+				uint32_t esperado = sala->id;
+				atomic_compare_exchange_strong(&cliente->sala_id, &esperado, 0);
+				enviar_erro(cliente, "Sessao expirada");
+				break;
 			}
+
+			if (jogador != assento) {
+				// A conexão antiga pode não ter percebido a queda (meia-aberta): é
+				// encerrada antes de soltar o assento, enquanto o descritor é dela
+				int socket_antigo = (assento == 1) ? sala->jogador1_socket : sala->jogador2_socket;
+				if (socket_antigo != -1) shutdown(socket_antigo, SHUT_RDWR);
+				liberar_assento(sala, assento);
+				ocupar_assento(sala, assento, cliente);
+				publicar_sala(sala);
+			}
+
+			resposta.tipo = MSG_ENTRAR_SALA;
+			resposta.sala_id = sala->id;
+			resposta.jogador_id = cliente->id;
+			enviar_mensagem(cliente->socket, &resposta);
+
+			// Estado completo: ocupar_assento descartou a base dos deltas
+			if (sala->em_partida) enviar_estado_jogador(sala, assento);
+			metricas_sessao_retomada();
+			registro(REGISTRO_INFO, "Cliente %u retomou o assento %d da sala %u", cliente->id, assento, sala->id);
 			break;
 		}
 
 		case MSG_SAIR_SALA: {
-			printf("Cliente %u saindo da sala %u\n", cliente->id, cliente->sala_id);
-			remover_cliente_da_sala(cliente);  // Já reseta cliente->sala_id = 0
+			remover_cliente_da_sala(sala, cliente);
 			// Envia confirmação (jogador_id=0 indica que é resposta de saída)
 			resposta.tipo = MSG_CONECTAR;
 			resposta.jogador_id = 0;
 			enviar_mensagem(cliente->socket, &resposta);
 			break;
 		}
+
 		case MSG_INICIAR_PARTIDA: {
-			Sala* sala = obter_sala_por_id(cliente->sala_id);
-			if (sala && sala->jogador1_socket != -1 && sala->jogador2_socket != -1) {
-				pthread_mutex_lock(&sala->mutex);
-
-				inicializar_jogo(&sala->jogo, sala->id);
-				sala->jogo.jogador1.id = sala->jogador1_id;
-				sala->jogo.jogador2.id = sala->jogador2_id;
-				inicializar_baralho(&sala->jogo.baralho);
-				distribuir_cartas(&sala->jogo);
+			if (jogador != 0 && sala->jogador1_socket != -1 && sala->jogador2_socket != -1) {
+				uint64_t semente = misturar_semente(
+				    semente_servidor + atomic_fetch_add_explicit(&partidas_iniciadas, 1, memory_order_relaxed));
+				CabecalhoReplay cabecalho = {.sala_id = sala->id,
+				                             .jogador1_id = sala->jogador1_id,
+				                             .jogador2_id = sala->jogador2_id,
+				                             .semente = semente};
+				gravacao_iniciar(&sala->gravacao, &cabecalho, &sala->jogo);
+				replay_preparar_jogo(&sala->jogo, &cabecalho);
 				sala->em_partida = true;
+				publicar_sala(sala);
 
-				pthread_mutex_unlock(&sala->mutex);
-
-				// Envia estado inicial para ambos jogadores
-				resposta.tipo = MSG_ESTADO_JOGO;
-				resposta.sala_id = sala->id;
-
-				EstadoJogo estado1 = obter_estado_jogo(&sala->jogo, 1);
-				resposta.jogador_id = sala->jogador1_id;
-				memcpy(resposta.dados, &estado1, sizeof(EstadoJogo));
-				enviar_mensagem(sala->jogador1_socket, &resposta);
+				// Envia estado inicial completo para ambos jogadores
+				sala->tem_estado_enviado[0] = false;
+				sala->tem_estado_enviado[1] = false;
+				enviar_estado_jogo(sala);
 
-				EstadoJogo estado2 = obter_estado_jogo(&sala->jogo, 2);
-				resposta.jogador_id = sala->jogador2_id;
-				memcpy(resposta.dados, &estado2, sizeof(EstadoJogo));
-				enviar_mensagem(sala->jogador2_socket, &resposta);
-
-				printf("Partida iniciada na sala %u\n", sala->id);
+				registro(REGISTRO_INFO, "Partida iniciada na sala %u (semente %llu)", sala->id,
+				         (unsigned long long)semente);
 			}
 			break;
 		}
 
 		case MSG_JOGAR_CARTA: {
-			Sala* sala = obter_sala_por_id(cliente->sala_id);
-			if (sala && sala->em_partida) {
-				pthread_mutex_lock(&sala->mutex);
-
-				int jogador = (cliente->socket == sala->jogador1_socket) ? 1 : 2;
+			if (jogador != 0 && sala->em_partida) {
 				int indice_carta;
 				memcpy(&indice_carta, msg->dados, sizeof(int));
 
 				if (jogar_carta(&sala->jogo, jogador, indice_carta)) {
+					gravacao_registrar(&sala->gravacao, REPLAY_JOGAR_CARTA, jogador, (uint32_t)indice_carta);
 					// Envia estado atualizado para ambos
-					resposta.tipo = MSG_ESTADO_JOGO;
-					resposta.sala_id = sala->id;
-
-					EstadoJogo estado1 = obter_estado_jogo(&sala->jogo, 1);
-					resposta.jogador_id = sala->jogador1_id;
-					memcpy(resposta.dados, &estado1, sizeof(EstadoJogo));
-					enviar_mensagem(sala->jogador1_socket, &resposta);
-
-					EstadoJogo estado2 = obter_estado_jogo(&sala->jogo, 2);
-					resposta.jogador_id = sala->jogador2_id;
-					memcpy(resposta.dados, &estado2, sizeof(EstadoJogo));
-					enviar_mensagem(sala->jogador2_socket, &resposta);
+					enviar_estado_jogo(sala);
 
 					// Verifica se a mão terminou (3 rodadas completas ou 2 vitórias)
 					if (sala->jogo.rodada_atual >= 3 && !sala->jogo.partida_finalizada) {
-						printf("Mão finalizada! Iniciando nova mão...\n");
+						registro(REGISTRO_DEBUG, "Mão finalizada na sala %u, iniciando nova mão", sala->id);
 						nova_mao(&sala->jogo);
 
 						// Envia novo estado após nova mão
-						resposta.tipo = MSG_ESTADO_JOGO;
-
-						estado1 = obter_estado_jogo(&sala->jogo, 1);
-						resposta.jogador_id = sala->jogador1_id;
-						memcpy(resposta.dados, &estado1, sizeof(EstadoJogo));
-						enviar_mensagem(sala->jogador1_socket, &resposta);
-
-						estado2 = obter_estado_jogo(&sala->jogo, 2);
-						resposta.jogador_id = sala->jogador2_id;
-						memcpy(resposta.dados, &estado2, sizeof(EstadoJogo));
-						enviar_mensagem(sala->jogador2_socket, &resposta);
+						enviar_estado_jogo(sala);
 					}
 
 					// Verifica se a partida terminou
-					if (sala->jogo.partida_finalizada) {
-						Mensagem fim;
-						memset(&fim, 0, sizeof(Mensagem));
-						fim.tipo = MSG_FIM_PARTIDA;
-						fim.sala_id = sala->id;
-						// Envia ID do cliente vencedor (não o número do jogador)
-						uint32_t id_vencedor = (sala->jogo.vencedor_partida == 1) ? sala->jogador1_id : sala->jogador2_id;
-						memcpy(fim.dados, &id_vencedor, sizeof(uint32_t));
-						broadcast_sala(sala, &fim, -1);
-						sala->em_partida = false;
-						sala->ativa = false;  // Destrói a sala após fim da partida
-						printf("Partida finalizada na sala %u - Vencedor: Jogador %d\n",
-						       sala->id, sala->jogo.vencedor_partida);
-						printf("Sala %u destruída\n", sala->id);
+					if (anunciar_fim_partida(sala)) {
+						uint32_t sala_id = sala->id;
+						liberar_sala(sala);  // Destrói a sala após fim da partida
+						registro(REGISTRO_INFO, "Sala %u destruída", sala_id);
 					}
 				}
-
-				pthread_mutex_unlock(&sala->mutex);
 			}
 			break;
 		}
 
 		case MSG_TRUCO: {
-			Sala* sala = obter_sala_por_id(cliente->sala_id);
-			if (sala && sala->em_partida) {
-				pthread_mutex_lock(&sala->mutex);
-
-				int jogador = (cliente->socket == sala->jogador1_socket) ? 1 : 2;
-
+			if (jogador != 0 && sala->em_partida) {
 				if (cantar_truco(&sala->jogo, jogador)) {
+					gravacao_registrar(&sala->gravacao, REPLAY_TRUCO, jogador, 0);
 					// Primeiro envia notificação MSG_TRUCO
 					resposta.tipo = MSG_TRUCO;
 					resposta.sala_id = sala->id;
@@ -445,77 +1168,33 @@ void processar_mensagem(Cliente* cliente, Mensagem* msg) {
 					broadcast_sala(sala, &resposta, -1);
 
 					// Depois envia estado atualizado (com aguardando_resposta=1)
-					resposta.tipo = MSG_ESTADO_JOGO;
-					resposta.sala_id = sala->id;
-
-					EstadoJogo estado1 = obter_estado_jogo(&sala->jogo, 1);
-					resposta.jogador_id = sala->jogador1_id;
-					memcpy(resposta.dados, &estado1, sizeof(EstadoJogo));
-					enviar_mensagem(sala->jogador1_socket, &resposta);
-
-					EstadoJogo estado2 = obter_estado_jogo(&sala->jogo, 2);
-					resposta.jogador_id = sala->jogador2_id;
-					memcpy(resposta.dados, &estado2, sizeof(EstadoJogo));
-					enviar_mensagem(sala->jogador2_socket, &resposta);
+					enviar_estado_jogo(sala);
 				}
-
-				pthread_mutex_unlock(&sala->mutex);
 			}
 			break;
 		}
-		case MSG_RESPOSTA_TRUCO: {
-			Sala* sala = obter_sala_por_id(cliente->sala_id);
-			if (sala && sala->em_partida) {
-				pthread_mutex_lock(&sala->mutex);
 
-				int jogador = (cliente->socket == sala->jogador1_socket) ? 1 : 2;
+		case MSG_RESPOSTA_TRUCO: {
+			if (jogador != 0 && sala->em_partida) {
 				RespostaTruco resp;
 				memcpy(&resp, msg->dados, sizeof(RespostaTruco));
 
 				responder_truco(&sala->jogo, jogador, resp);
+				gravacao_registrar(&sala->gravacao, REPLAY_RESPOSTA_TRUCO, jogador, (uint32_t)resp);
 
 				// Envia estado atualizado
-				resposta.tipo = MSG_ESTADO_JOGO;
-				resposta.sala_id = sala->id;
-
-				EstadoJogo estado1 = obter_estado_jogo(&sala->jogo, 1);
-				resposta.jogador_id = sala->jogador1_id;
-				memcpy(resposta.dados, &estado1, sizeof(EstadoJogo));
-				enviar_mensagem(sala->jogador1_socket, &resposta);
-
-				EstadoJogo estado2 = obter_estado_jogo(&sala->jogo, 2);
-				resposta.jogador_id = sala->jogador2_id;
-				memcpy(resposta.dados, &estado2, sizeof(EstadoJogo));
-				enviar_mensagem(sala->jogador2_socket, &resposta);
+				enviar_estado_jogo(sala);
 
 				// Verifica se a partida terminou
-				if (sala->jogo.partida_finalizada) {
-					Mensagem fim;
-					memset(&fim, 0, sizeof(Mensagem));
-					fim.tipo = MSG_FIM_PARTIDA;
-					fim.sala_id = sala->id;
-					// Envia ID do cliente vencedor (não o número do jogador)
-					uint32_t id_vencedor = (sala->jogo.vencedor_partida == 1) ? sala->jogador1_id : sala->jogador2_id;
-					memcpy(fim.dados, &id_vencedor, sizeof(uint32_t));
-					broadcast_sala(sala, &fim, -1);
-					sala->em_partida = false;
-					printf("Partida finalizada na sala %u - Vencedor: Jogador %d\n",
-					       sala->id, sala->jogo.vencedor_partida);
-				}
-
-				pthread_mutex_unlock(&sala->mutex);
+				if (anunciar_fim_partida(sala)) publicar_sala(sala);
 			}
 			break;
 		}
 
 		case MSG_ENVIDO: {
-			Sala* sala = obter_sala_por_id(cliente->sala_id);
-			if (sala && sala->em_partida) {
-				pthread_mutex_lock(&sala->mutex);
-
-				int jogador = (cliente->socket == sala->jogador1_socket) ? 1 : 2;
-
+			if (jogador != 0 && sala->em_partida) {
 				if (cantar_envido(&sala->jogo, jogador)) {
+					gravacao_registrar(&sala->gravacao, REPLAY_ENVIDO, jogador, 0);
 					// Primeiro envia notificação MSG_ENVIDO
 					resposta.tipo = MSG_ENVIDO;
 					resposta.sala_id = sala->id;
@@ -523,133 +1202,58 @@ void processar_mensagem(Cliente* cliente, Mensagem* msg) {
 					broadcast_sala(sala, &resposta, -1);
 
 					// Depois envia estado atualizado (com aguardando_resposta=1)
-					resposta.tipo = MSG_ESTADO_JOGO;
-					resposta.sala_id = sala->id;
-
-					EstadoJogo estado1 = obter_estado_jogo(&sala->jogo, 1);
-					resposta.jogador_id = sala->jogador1_id;
-					memcpy(resposta.dados, &estado1, sizeof(EstadoJogo));
-					enviar_mensagem(sala->jogador1_socket, &resposta);
-
-					EstadoJogo estado2 = obter_estado_jogo(&sala->jogo, 2);
-					resposta.jogador_id = sala->jogador2_id;
-					memcpy(resposta.dados, &estado2, sizeof(EstadoJogo));
-					enviar_mensagem(sala->jogador2_socket, &resposta);
+					enviar_estado_jogo(sala);
 				}
-
-				pthread_mutex_unlock(&sala->mutex);
 			}
 			break;
 		}
 
 		case MSG_RESPOSTA_ENVIDO: {
-			Sala* sala = obter_sala_por_id(cliente->sala_id);
-			if (sala && sala->em_partida) {
-				pthread_mutex_lock(&sala->mutex);
-
-				int jogador = (cliente->socket == sala->jogador1_socket) ? 1 : 2;
+			if (jogador != 0 && sala->em_partida) {
 				RespostaEnvido resp;
 				memcpy(&resp, msg->dados, sizeof(RespostaEnvido));
 
 				responder_envido(&sala->jogo, jogador, resp);
+				gravacao_registrar(&sala->gravacao, REPLAY_RESPOSTA_ENVIDO, jogador, (uint32_t)resp);
 
 				// Envia estado atualizado
-				resposta.tipo = MSG_ESTADO_JOGO;
-				resposta.sala_id = sala->id;
-
-				EstadoJogo estado1 = obter_estado_jogo(&sala->jogo, 1);
-				resposta.jogador_id = sala->jogador1_id;
-				memcpy(resposta.dados, &estado1, sizeof(EstadoJogo));
-				enviar_mensagem(sala->jogador1_socket, &resposta);
-
-				EstadoJogo estado2 = obter_estado_jogo(&sala->jogo, 2);
-				resposta.jogador_id = sala->jogador2_id;
-				memcpy(resposta.dados, &estado2, sizeof(EstadoJogo));
-				enviar_mensagem(sala->jogador2_socket, &resposta);
+				enviar_estado_jogo(sala);
 
 				// Verifica se a partida terminou
-				if (sala->jogo.partida_finalizada) {
-					Mensagem fim;
-					memset(&fim, 0, sizeof(Mensagem));
-					fim.tipo = MSG_FIM_PARTIDA;
-					fim.sala_id = sala->id;
-					// Envia ID do cliente vencedor (não o número do jogador)
-					uint32_t id_vencedor = (sala->jogo.vencedor_partida == 1) ? sala->jogador1_id : sala->jogador2_id;
-					memcpy(fim.dados, &id_vencedor, sizeof(uint32_t));
-					broadcast_sala(sala, &fim, -1);
-					sala->em_partida = false;
-					printf("Partida finalizada na sala %u - Vencedor: Jogador %d\n",
-					       sala->id, sala->jogo.vencedor_partida);
-				}
-
-				pthread_mutex_unlock(&sala->mutex);
+				if (anunciar_fim_partida(sala)) publicar_sala(sala);
 			}
 			break;
 		}
 
 		case MSG_RESPOSTA_FLOR: {
-			Sala* sala = obter_sala_por_id(cliente->sala_id);
-			if (sala && sala->em_partida) {
-				pthread_mutex_lock(&sala->mutex);
-
-				int jogador = (cliente->socket == sala->jogador1_socket) ? 1 : 2;
+			if (jogador != 0 && sala->em_partida) {
 				RespostaFlor resp;
 				memcpy(&resp, msg->dados, sizeof(RespostaFlor));
 
 				responder_flor(&sala->jogo, jogador, resp);
+				gravacao_registrar(&sala->gravacao, REPLAY_RESPOSTA_FLOR, jogador, (uint32_t)resp);
 
 				// Envia estado atualizado
-				resposta.tipo = MSG_ESTADO_JOGO;
-				resposta.sala_id = sala->id;
-
-				EstadoJogo estado1 = obter_estado_jogo(&sala->jogo, 1);
-				resposta.jogador_id = sala->jogador1_id;
-				memcpy(resposta.dados, &estado1, sizeof(EstadoJogo));
-				enviar_mensagem(sala->jogador1_socket, &resposta);
-
-				EstadoJogo estado2 = obter_estado_jogo(&sala->jogo, 2);
-				resposta.jogador_id = sala->jogador2_id;
-				memcpy(resposta.dados, &estado2, sizeof(EstadoJogo));
-				enviar_mensagem(sala->jogador2_socket, &resposta);
-
-				pthread_mutex_unlock(&sala->mutex);
+				enviar_estado_jogo(sala);
 			}
 			break;
 		}
 
 		case MSG_IR_BARALHO: {
-			Sala* sala = obter_sala_por_id(cliente->sala_id);
-			if (sala && sala->em_partida) {
-				pthread_mutex_lock(&sala->mutex);
-
-				int jogador = (cliente->socket == sala->jogador1_socket) ? 1 : 2;
-				ir_baralho(&sala->jogo, jogador);  // Envia estado atualizado
-				resposta.tipo = MSG_ESTADO_JOGO;
-				resposta.sala_id = sala->id;
+			if (jogador != 0 && sala->em_partida) {
+				ir_baralho(&sala->jogo, jogador);
+				gravacao_registrar(&sala->gravacao, REPLAY_IR_BARALHO, jogador, 0);
 
-				EstadoJogo estado1 = obter_estado_jogo(&sala->jogo, 1);
-				resposta.jogador_id = sala->jogador1_id;
-				memcpy(resposta.dados, &estado1, sizeof(EstadoJogo));
-				enviar_mensagem(sala->jogador1_socket, &resposta);
-
-				EstadoJogo estado2 = obter_estado_jogo(&sala->jogo, 2);
-				resposta.jogador_id = sala->jogador2_id;
-				memcpy(resposta.dados, &estado2, sizeof(EstadoJogo));
-				enviar_mensagem(sala->jogador2_socket, &resposta);
-
-				pthread_mutex_unlock(&sala->mutex);
+				// Envia estado atualizado
+				enviar_estado_jogo(sala);
 			}
 			break;
 		}
 
 		case MSG_FLOR: {
-			Sala* sala = obter_sala_por_id(cliente->sala_id);
-			if (sala && sala->em_partida) {
-				pthread_mutex_lock(&sala->mutex);
-
-				int jogador = (cliente->socket == sala->jogador1_socket) ? 1 : 2;
-
+			if (jogador != 0 && sala->em_partida) {
 				if (cantar_flor(&sala->jogo, jogador)) {
+					gravacao_registrar(&sala->gravacao, REPLAY_FLOR, jogador, 0);
 					// Primeiro envia notificação MSG_FLOR
 					resposta.tipo = MSG_FLOR;
 					resposta.sala_id = sala->id;
@@ -657,21 +1261,8 @@ void processar_mensagem(Cliente* cliente, Mensagem* msg) {
 					broadcast_sala(sala, &resposta, -1);
 
 					// Depois envia estado atualizado (com aguardando_resposta=1)
-					resposta.tipo = MSG_ESTADO_JOGO;
-					resposta.sala_id = sala->id;
-
-					EstadoJogo estado1 = obter_estado_jogo(&sala->jogo, 1);
-					resposta.jogador_id = sala->jogador1_id;
-					memcpy(resposta.dados, &estado1, sizeof(EstadoJogo));
-					enviar_mensagem(sala->jogador1_socket, &resposta);
-
-					EstadoJogo estado2 = obter_estado_jogo(&sala->jogo, 2);
-					resposta.jogador_id = sala->jogador2_id;
-					memcpy(resposta.dados, &estado2, sizeof(EstadoJogo));
-					enviar_mensagem(sala->jogador2_socket, &resposta);
+					enviar_estado_jogo(sala);
 				}
-
-				pthread_mutex_unlock(&sala->mutex);
 			}
 			break;
 		}
@@ -681,29 +1272,565 @@ void processar_mensagem(Cliente* cliente, Mensagem* msg) {
 	}
 }
 
-void* thread_cliente(void* arg) {
-	int socket = *(int*)arg;
-	free(arg);
+// Comando para uma sala que já não existe (ou para outra geração do slot)
+static void tratar_sala_inexistente(ComandoSala* comando) {
+	if (comando->tipo != COMANDO_MENSAGEM) return;
 
-	// Registra cliente
-	pthread_mutex_lock(&clientes_mutex);
-	Cliente* cliente = NULL;
-	for (int i = 0; i < MAX_CLIENTES; i++) {
-		if (!clientes[i].ativo) {
-			clientes[i].socket = socket;
-			clientes[i].id = proximo_cliente_id++;
-			clientes[i].sala_id = 0;
-			clientes[i].ativo = true;
-			cliente = &clientes[i];
-			break;
+	Cliente* cliente = comando->cliente;
+	Mensagem resposta;
+	memset(&resposta, 0, sizeof(Mensagem));
+	if (comando->msg.tipo == MSG_ENTRAR_SALA || comando->msg.tipo == MSG_CONECTAR) {
+		uint32_t esperado = comando->sala_id;
+		atomic_compare_exchange_strong(&cliente->sala_id, &esperado, 0);
+		enviar_erro(cliente, comando->msg.tipo == MSG_CONECTAR ? "Sessao expirada" : "Sala inexistente");
+	} else if (comando->msg.tipo == MSG_SAIR_SALA) {
+		resposta.tipo = MSG_CONECTAR;
+		resposta.jogador_id = 0;
+		enviar_mensagem(cliente->socket, &resposta);
+	}
+}
+
+// Jogador que precisa agir: quem responde a um canto pendente ou quem tem a vez
+static int jogador_da_vez(const Jogo* jogo) {
+	if (jogo->aguardando_resposta_truco) return 3 - jogo->jogador_cantou_truco;
+	if (jogo->aguardando_resposta_envido) return 3 - jogo->jogador_cantou_envido;
+	if (jogo->aguardando_resposta_flor) return 3 - jogo->jogador_cantou_flor;
+	return jogo->vez_jogador;
+}
+
+// Reinicia o prazo do turno. O temporizador não é movido a cada jogada: ao
+// vencer ele confere ultima_acao e, se houve ação, só se reagenda.
+static void renovar_prazo_turno(Sala* sala, uint64_t agora) {
+	sala->ultima_acao = agora;
+	if (!temporizador_agendado(&sala->prazo)) {
+		Executor* executor = &executores[sala->indice % num_executores];
+		roda_agendar(&executor->roda, &sala->prazo, tick_de(agora + prazo_turno_ms));
+	}
+}
+
+static void executar_mensagem_sala(Sala* sala, ComandoSala* comando) {
+	bool em_partida = sala->em_partida;
+	int da_vez = em_partida ? jogador_da_vez(&sala->jogo) : 0;
+
+	uint64_t inicio = metricas_agora_ns();
+	processar_mensagem_sala(sala, comando->cliente, &comando->msg);
+	uint64_t fim = metricas_agora_ns();
+	metricas_processamento(comando->msg.tipo, fim - inicio);
+
+	// O prazo corre a partir do início da partida e de cada ação de quem tinha a vez
+	if (prazo_turno_ms > 0 && atomic_load_explicit(&sala->ativa, memory_order_relaxed) && sala->em_partida &&
+	    !sala->jogo.partida_finalizada && (!em_partida || jogador_na_sala(sala, comando->cliente) == da_vez)) {
+		renovar_prazo_turno(sala, fim / 1000000);
+	}
+}
+
+// Prazo do turno vencido: quem tinha a vez recusa o canto pendente ou vai ao
+// baralho, como se tivesse mandado a mensagem
+static void expirar_prazo_turno(Temporizador* temporizador, void* contexto) {
+	(void)contexto;
+	Sala* sala = (Sala*)((char*)temporizador - offsetof(Sala, prazo));
+	// Partidas decididas por flor ou ir ao baralho ficam em_partida até os jogadores saírem
+	if (!atomic_load_explicit(&sala->ativa, memory_order_relaxed) || !sala->em_partida ||
+	    sala->jogo.partida_finalizada) {
+		return;
+	}
+
+	uint64_t agora = agora_ms();
+	uint64_t vence = sala->ultima_acao + prazo_turno_ms;
+	if (agora < vence || sala->num_adiados > 0) {
+		// Houve ação desde o agendamento, ou a jogada está guardada numa sala pausada
+		Executor* executor = &executores[sala->indice % num_executores];
+		roda_agendar(&executor->roda, temporizador, tick_de(agora < vence ? vence : agora + prazo_turno_ms));
+		return;
+	}
+
+	int jogador = jogador_da_vez(&sala->jogo);
+	int socket = (jogador == 1) ? sala->jogador1_socket : sala->jogador2_socket;
+	Cliente* cliente = socket != -1 ? obter_cliente_por_socket(socket) : NULL;
+	if (!cliente) return;  // Assento reservado: o prazo volta a correr quando a sessão for retomada
+
+	Mensagem msg;
+	memset(&msg, 0, sizeof(Mensagem));
+	msg.sala_id = sala->id;
+	if (sala->jogo.aguardando_resposta_truco) {
+		RespostaTruco resposta = RESPOSTA_NAO_QUERO;
+		msg.tipo = MSG_RESPOSTA_TRUCO;
+		memcpy(msg.dados, &resposta, sizeof(resposta));
+		msg.tamanho_dados = sizeof(resposta);
+	} else if (sala->jogo.aguardando_resposta_envido) {
+		RespostaEnvido resposta = ENVIDO_NAO_QUERO;
+		msg.tipo = MSG_RESPOSTA_ENVIDO;
+		memcpy(msg.dados, &resposta, sizeof(resposta));
+		msg.tamanho_dados = sizeof(resposta);
+	} else if (sala->jogo.aguardando_resposta_flor) {
+		RespostaFlor resposta = FLOR_NAO_QUERO;
+		msg.tipo = MSG_RESPOSTA_FLOR;
+		memcpy(msg.dados, &resposta, sizeof(resposta));
+		msg.tamanho_dados = sizeof(resposta);
+	} else {
+		msg.tipo = MSG_IR_BARALHO;
+	}
+
+	registro(REGISTRO_INFO, "Prazo do turno esgotado na sala %u: jogador %d (%s)", sala->id, jogador,
+	         tipo_mensagem_para_string(msg.tipo));
+	metricas_turno_expirado();
+	processar_mensagem_sala(sala, cliente, &msg);
+
+	if (atomic_load_explicit(&sala->ativa, memory_order_relaxed) && sala->em_partida) {
+		renovar_prazo_turno(sala, agora);
+	}
+}
+
+// Conexão de um jogador com sessão caiu no meio da partida: o assento fica
+// reservado por graca_sessao_ms, sem avisar o adversário. Retorna false se
+// não há o que reservar e o jogador deve sair da sala.
+static bool suspender_assento(Sala* sala, Cliente* cliente) {
+	int jogador = jogador_na_sala(sala, cliente);
+	if (jogador == 0 || !sala->em_partida || graca_sessao_ms == 0 || sala->token_assento[jogador - 1] == 0) {
+		return false;
+	}
+
+	if (jogador == 1) {
+		sala->jogador1_socket = -1;
+	} else {
+		sala->jogador2_socket = -1;
+	}
+	soltar_cliente(cliente);  // Referência do assento; o comando ainda tem a dele
+	sala->assento_suspenso[jogador - 1] = true;
+	sala->suspenso_ate[jogador - 1] = agora_ms() + graca_sessao_ms;
+
+	// Um temporizador por sala: se já está agendado, vence antes desta reserva
+	if (!temporizador_agendado(&sala->graca)) {
+		Executor* executor = &executores[sala->indice % num_executores];
+		roda_agendar(&executor->reservas, &sala->graca, tick_de(sala->suspenso_ate[jogador - 1]));
+	}
+	registro(REGISTRO_INFO, "Cliente %u caiu: assento %d da sala %u reservado por %llu ms", cliente->id, jogador,
+	         sala->id, (unsigned long long)graca_sessao_ms);
+	return true;
+}
+
+// Reservas vencidas saem da sala como uma desconexão comum; a próxima a vencer
+// reagenda o temporizador
+static void expirar_reservas(Temporizador* temporizador, void* contexto) {
+	(void)contexto;
+	Sala* sala = (Sala*)((char*)temporizador - offsetof(Sala, graca));
+	uint64_t agora = agora_ms();
+	uint64_t proxima = 0;
+
+	for (int jogador = 1; jogador <= 2; jogador++) {
+		if (!atomic_load_explicit(&sala->ativa, memory_order_relaxed)) return;
+		if (!sala->assento_suspenso[jogador - 1]) continue;
+
+		uint64_t vence = sala->suspenso_ate[jogador - 1];
+		if (vence > agora) {
+			if (proxima == 0 || vence < proxima) proxima = vence;
+			continue;
+		}
+		registro(REGISTRO_INFO, "Reserva do assento %d da sala %u expirou", jogador, sala->id);
+		desocupar(sala, jogador);
+	}
+
+	if (proxima != 0 && atomic_load_explicit(&sala->ativa, memory_order_relaxed)) {
+		roda_agendar(&executores[sala->indice % num_executores].reservas, temporizador, tick_de(proxima));
+	}
+}
+
+// Com --cliente-lento=pausar a sala para enquanto um dos jogadores está atrasado
+static bool sala_pausada(const Sala* sala) {
+	if (politica_lento != LENTO_PAUSAR) return false;
+	int sockets[2] = {sala->jogador1_socket, sala->jogador2_socket};
+	for (int i = 0; i < 2; i++) {
+		Cliente* cliente = sockets[i] != -1 ? obter_cliente_por_socket(sockets[i]) : NULL;
+		if (cliente && atomic_load_explicit(&cliente->atrasado, memory_order_acquire)) return true;
+	}
+	return false;
+}
+
+// Entrar, criar, retomar e sair nunca esperam: só as jogadas ficam paradas
+static bool comando_adiavel(const ComandoSala* comando) {
+	if (comando->tipo != COMANDO_MENSAGEM) return false;
+	TipoMensagem tipo = comando->msg.tipo;
+	return tipo != MSG_CRIAR_SALA && tipo != MSG_ENTRAR_SALA && tipo != MSG_SAIR_SALA && tipo != MSG_CONECTAR;
+}
+
+// Trata as jogadas guardadas enquanto a sala não voltar a pausar
+static void retomar_adiados(Sala* sala) {
+	while (sala->num_adiados > 0 && !sala_pausada(sala)) {
+		ComandoSala* comando = sala->adiados[0];
+		sala->num_adiados--;
+		memmove(sala->adiados, sala->adiados + 1, sala->num_adiados * sizeof(ComandoSala*));
+
+		executar_mensagem_sala(sala, comando);
+		soltar_cliente(comando->cliente);
+		free(comando);
+		if (!atomic_load_explicit(&sala->ativa, memory_order_relaxed)) break;  // Partida acabou
+	}
+}
+
+// Retorna true se a sala ficou com o comando (jogada adiada)
+static bool tratar_comando_sala(Sala* sala, ComandoSala* comando) {
+	bool mesma_sala = atomic_load_explicit(&sala->id, memory_order_acquire) == comando->sala_id;
+	bool ativa = atomic_load_explicit(&sala->ativa, memory_order_acquire);
+	bool criacao = comando->tipo == COMANDO_MENSAGEM && comando->msg.tipo == MSG_CRIAR_SALA;
+
+	if (!mesma_sala || ativa == criacao) {
+		tratar_sala_inexistente(comando);
+		return false;
+	}
+
+	if (comando->tipo == COMANDO_SAIR) {
+		remover_cliente_da_sala(sala, comando->cliente);
+		return false;
+	}
+
+	if (comando->tipo == COMANDO_DESCONECTAR) {
+		if (!suspender_assento(sala, comando->cliente)) remover_cliente_da_sala(sala, comando->cliente);
+		return false;
+	}
+
+	if (comando->tipo == COMANDO_RETOMAR) {
+		retomar_adiados(sala);
+		// Quem perdeu estados enquanto estava atrasado recebe um snapshot
+		if (atomic_load_explicit(&sala->ativa, memory_order_relaxed) && sala->em_partida) {
+			int jogador = jogador_na_sala(sala, comando->cliente);
+			if (jogador != 0 && !sala->tem_estado_enviado[jogador - 1]) enviar_estado_jogador(sala, jogador);
+		}
+		return false;
+	}
+
+	if (comando_adiavel(comando)) {
+		retomar_adiados(sala);
+		if (!atomic_load_explicit(&sala->ativa, memory_order_relaxed)) {
+			tratar_sala_inexistente(comando);
+			return false;
+		}
+		if (sala->num_adiados > 0 || sala_pausada(sala)) {
+			if (sala->num_adiados == MAX_COMANDOS_ADIADOS) {
+				enviar_erro(comando->cliente, "Sala pausada: aguardando outro jogador");
+				return false;
+			}
+			sala->adiados[sala->num_adiados++] = comando;
+			return true;
+		}
+	}
+
+	executar_mensagem_sala(sala, comando);
+	return false;
+}
+
+// Trata até COMANDOS_POR_VEZ comandos da sala; se sobrou algum, a sala volta
+// para o fim da fila de prontas
+static void executar_sala(Executor* executor, Sala* sala) {
+	uint32_t tratados = 0;
+	while (tratados < COMANDOS_POR_VEZ) {
+		NoFilaMpsc* no = fila_mpsc_remover(&sala->comandos);
+		if (!no) break;  // Vazia, ou um produtor ainda ligando o nó
+
+		ComandoSala* comando = (ComandoSala*)no;
+		metricas_espera_sala(metricas_agora_ns() - comando->enfileirado_em);
+		if (!tratar_comando_sala(sala, comando)) {
+			soltar_cliente(comando->cliente);
+			free(comando);
+		}
+		tratados++;
+	}
+	descarregar_saidas_pendentes();
+
+	if (atomic_fetch_sub_explicit(&sala->comandos_pendentes, tratados, memory_order_acq_rel) != tratados) {
+		if (tratados == 0) sched_yield();
+		fila_mpsc_inserir(&executor->prontas, &sala->no);
+	}
+}
+
+void* executar_executor(void* arg) {
+	Executor* executor = (Executor*)arg;
+
+	while (1) {
+		bool temporizadores = executor->roda.agendados > 0 || executor->reservas.agendados > 0;
+		if (temporizadores) {
+			uint64_t agora = tick_de(agora_ms());
+			roda_avancar(&executor->roda, agora, expirar_prazo_turno, NULL);
+			roda_avancar(&executor->reservas, agora, expirar_reservas, NULL);
+			descarregar_saidas_pendentes();
+		}
+
+		NoFilaMpsc* no = fila_mpsc_remover(&executor->prontas);
+		if (no) {
+			executar_sala(executor, (Sala*)no);
+			continue;
+		}
+
+		// Sem salas prontas: com os workers parados nenhum comando novo chega
+		if (atomic_load_explicit(&pausar_executores, memory_order_acquire)) {
+			aguardar_pausa(&pausar_executores);
+			continue;
+		}
+
+		// Dorme até a próxima entrega ou o próximo tick da roda
+		struct pollfd evento = {.fd = executor->evento_fd, .events = POLLIN};
+		if (poll(&evento, 1, temporizadores ? MS_POR_TICK : -1) > 0) {
+			uint64_t contador;
+			ssize_t lido = read(executor->evento_fd, &contador, sizeof(contador));
+			(void)lido;
+		}
+	}
+	return NULL;
+}
+
+// As rodas já existem antes das threads: salas herdadas agendam seus prazos nelas
+static bool preparar_executores() {
+	if (num_executores <= 0) num_executores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (num_executores <= 0) num_executores = 1;
+	executores = calloc(num_executores, sizeof(Executor));
+	if (!executores) return false;
+
+	for (int i = 0; i < num_executores; i++) {
+		Executor* executor = &executores[i];
+		executor->indice = i;
+		executor->evento_fd = eventfd(0, 0);
+		fila_mpsc_inicializar(&executor->prontas);
+		roda_inicializar(&executor->roda, tick_de(agora_ms()));
+		roda_inicializar(&executor->reservas, tick_de(agora_ms()));
+		if (executor->evento_fd < 0) {
+			registro(REGISTRO_ERRO, "Erro ao iniciar executor de salas: %m");
+			return false;
 		}
 	}
+	return true;
+}
+
+static bool iniciar_executores() {
+	for (int i = 0; i < num_executores; i++) {
+		Executor* executor = &executores[i];
+		if (pthread_create(&executor->thread, NULL, executar_executor, executor) != 0) {
+			registro(REGISTRO_ERRO, "Erro ao iniciar executor de salas: %m");
+			return false;
+		}
+		pthread_detach(executor->thread);
+	}
+	return true;
+}
+
+// Clientes sem CAP_HEARTBEAT só são detectados pelo keepalive do kernel:
+// a conexão cai depois de timeout_ocioso_ms sem resposta
+static void configurar_keepalive(int socket) {
+	if (intervalo_ping_ms == 0) return;
+	int ligado = 1;
+	ParametrosKeepalive keepalive = keepalive_calcular(timeout_ocioso_ms, intervalo_ping_ms);
+	setsockopt(socket, SOL_SOCKET, SO_KEEPALIVE, &ligado, sizeof(ligado));
+	setsockopt(socket, IPPROTO_TCP, TCP_KEEPIDLE, &keepalive.ocioso, sizeof(keepalive.ocioso));
+	setsockopt(socket, IPPROTO_TCP, TCP_KEEPINTVL, &keepalive.intervalo, sizeof(keepalive.intervalo));
+	setsockopt(socket, IPPROTO_TCP, TCP_KEEPCNT, &keepalive.tentativas, sizeof(keepalive.tentativas));
+}
+
+// id 0 = próximo id livre; outro valor vem de uma conexão herdada
+Cliente* registrar_cliente(int socket, int worker, uint32_t id) {
+	if (socket >= max_descritores) return NULL;
+
+	metricas_travar(&clientes_mutex, MUTEX_CLIENTES);
+	uint32_t indice;
+	Cliente* cliente = pool_alocar(&clientes, &indice);
+	if (cliente) {
+		cliente->socket = socket;
+		cliente->id = id ? id : proximo_cliente_id++;
+		atomic_store_explicit(&cliente->sala_id, 0, memory_order_relaxed);
+		cliente->worker = worker;
+		atomic_store_explicit(&cliente->capacidades, 0, memory_order_relaxed);
+		atomic_store_explicit(&cliente->token_sessao, 0, memory_order_relaxed);
+		cliente->indice_assinante = -1;
+		cliente->bytes_entrada = 0;
+		cliente->pedidos_anel = 0;
+		cliente->enviando = false;
+		cliente->destruicao_adiada = false;
+		atomic_store_explicit(&cliente->referencias, 1, memory_order_relaxed);  // Da conexão
+		atomic_store_explicit(&cliente->na_caixa, false, memory_order_relaxed);
+		atomic_store_explicit(&cliente->destruir, false, memory_order_relaxed);
+		atomic_store_explicit(&cliente->atrasado, false, memory_order_relaxed);
+		atomic_store_explicit(&cliente->derrubado, false, memory_order_relaxed);
+		atomic_store_explicit(&cliente->ultima_atividade, agora_ms(), memory_order_relaxed);
+		atomic_store_explicit(&cliente->ativo, true, memory_order_relaxed);
+		atomic_store_explicit(&clientes_por_socket[socket], cliente, memory_order_release);
+		atomic_fetch_add_explicit(&clientes_conectados, 1, memory_order_relaxed);
+	}
 	pthread_mutex_unlock(&clientes_mutex);
+	if (cliente) {
+		captura_abertura(cliente->id);
+		configurar_keepalive(socket);
+	}
+	return cliente;
+}
+
+// Fim da conexão, pela thread que a lê. O descritor continua aberto (só com
+// shutdown) até a última referência: nenhum outro cliente recebe o mesmo número
+// enquanto uma sala ainda pode escrever nele.
+void liberar_cliente(Cliente* cliente) {
+	captura_fechamento(cliente->id);
+	atomic_store_explicit(&cliente->ativo, false, memory_order_release);
+
+	sair_da_sala_atual(cliente, COMANDO_DESCONECTAR);
+	cancelar_assinatura_lobby(cliente);
+	descarregar_saidas_pendentes();
 
+	shutdown(cliente->socket, SHUT_RDWR);
+	soltar_cliente(cliente);
+}
+
+static bool definir_nao_bloqueante(int fd) {
+	int flags = fcntl(fd, F_GETFL, 0);
+	return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static bool definir_bloqueante(int fd) {
+	int flags = fcntl(fd, F_GETFL, 0);
+	return flags >= 0 && fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) == 0;
+}
+
+static bool registrar_no_epoll(int epoll_fd, int fd, uint32_t eventos, void* ptr) {
+	struct epoll_event ev;
+	ev.events = eventos;
+	ev.data.ptr = ptr;
+	return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+// Estado da thread do lobby entre ticks
+typedef struct {
+	InfoSala* conhecidas;  // Última versão anunciada de cada slot (id 0 = vazio)
+	uint32_t num_conhecidas;
+	Mensagem lote;         // Lote de eventos em montagem
+	BufferCompartilhado** quadros;  // Lotes fechados no tick: pares legado/compacto
+	int num_quadros;
+	int capacidade_quadros;
+	bool silencioso;  // Só atualiza conhecidas: salas herdadas que os assinantes já conhecem
+} TickLobby;
+
+// Codifica o lote atual nos dois formatos e guarda para o envio do tick
+static void fechar_lote_lobby(TickLobby* tick) {
+	if (tick->lote.tamanho_dados == 0) return;
+
+	if (tick->num_quadros + 2 > tick->capacidade_quadros) {
+		int nova_capacidade = tick->capacidade_quadros ? tick->capacidade_quadros * 2 : 16;
+		BufferCompartilhado** novos = realloc(tick->quadros, nova_capacidade * sizeof(BufferCompartilhado*));
+		if (!novos) return;
+		tick->quadros = novos;
+		tick->capacidade_quadros = nova_capacidade;
+	}
+
+	uint8_t quadro[PROTOCOLO_TAMANHO_MAX_QUADRO];
+	for (int compacto = 0; compacto < 2; compacto++) {
+		size_t tamanho = protocolo_codificar(&tick->lote, compacto, quadro);
+		tick->quadros[tick->num_quadros++] = buffer_compartilhado_criar(quadro, tamanho);
+	}
+
+	memset(&tick->lote, 0, sizeof(Mensagem));
+	tick->lote.tipo = MSG_EVENTOS_LOBBY;
+}
+
+static void adicionar_evento_lobby(TickLobby* tick, TipoEventoLobby tipo, const InfoSala* info) {
+	if (tick->lote.tamanho_dados + sizeof(EventoLobby) > sizeof(tick->lote.dados)) {
+		fechar_lote_lobby(tick);
+	}
+
+	EventoLobby evento;
+	memset(&evento, 0, sizeof(EventoLobby));
+	evento.tipo = tipo;
+	evento.sala = *info;
+	memcpy(tick->lote.dados + tick->lote.tamanho_dados, &evento, sizeof(EventoLobby));
+	tick->lote.tamanho_dados += sizeof(EventoLobby);
+}
+
+// Compara o slot alterado com o último estado anunciado e gera os eventos
+static void visitar_alteracao_lobby(uint32_t slot, void* contexto) {
+	TickLobby* tick = contexto;
+
+	if (slot >= tick->num_conhecidas) {
+		uint32_t novo_tamanho = tick->num_conhecidas ? tick->num_conhecidas : 256;
+		while (novo_tamanho <= slot) novo_tamanho *= 2;
+		InfoSala* novas = realloc(tick->conhecidas, novo_tamanho * sizeof(InfoSala));
+		if (!novas) return;
+		memset(novas + tick->num_conhecidas, 0, (novo_tamanho - tick->num_conhecidas) * sizeof(InfoSala));
+		tick->conhecidas = novas;
+		tick->num_conhecidas = novo_tamanho;
+	}
+
+	InfoSala atual;
+	bool ocupada = diretorio_ler(&diretorio, slot, &atual);
+	InfoSala* anterior = &tick->conhecidas[slot];
+	if (tick->silencioso) {
+		if (ocupada) *anterior = atual;
+		return;
+	}
+
+	// Slot reutilizado por outra sala: a antiga some antes da nova aparecer
+	if (anterior->id != 0 && (!ocupada || atual.id != anterior->id)) {
+		adicionar_evento_lobby(tick, LOBBY_SALA_REMOVIDA, anterior);
+		memset(anterior, 0, sizeof(InfoSala));
+	}
+
+	if (ocupada) {
+		if (anterior->id == 0) {
+			adicionar_evento_lobby(tick, LOBBY_SALA_ADICIONADA, &atual);
+		} else if (memcmp(anterior, &atual, sizeof(InfoSala)) != 0) {
+			adicionar_evento_lobby(tick, LOBBY_SALA_ATUALIZADA, &atual);
+		}
+		*anterior = atual;
+	}
+}
+
+// Entrega os lotes do tick a todos os assinantes; o mesmo buffer codificado é
+// enfileirado em todas as conexões
+static void entregar_tick_lobby(TickLobby* tick) {
+	pthread_mutex_lock(&assinantes_mutex);
+	for (int i = 0; i < num_assinantes_lobby; i++) {
+		Cliente* cliente = assinantes_lobby[i];
+		uint32_t capacidades = atomic_load_explicit(&cliente->capacidades, memory_order_relaxed);
+		int compacto = (capacidades & CAP_QUADRO_COMPACTO) ? 1 : 0;
+		for (int q = compacto; q < tick->num_quadros; q += 2) {
+			if (tick->quadros[q]) enviar_quadro_compartilhado(cliente, MSG_EVENTOS_LOBBY, tick->quadros[q]);
+		}
+	}
+	pthread_mutex_unlock(&assinantes_mutex);
+	descarregar_saidas_pendentes();  // Os avisos mantêm referências aos clientes
+
+	for (int q = 0; q < tick->num_quadros; q++) {
+		if (tick->quadros[q]) buffer_compartilhado_liberar(tick->quadros[q]);
+	}
+	tick->num_quadros = 0;
+}
+
+// A cada tick junta as mudanças do diretório em lotes e os entrega. O estado
+// entre ticks vem de main (com as salas herdadas já conhecidas).
+static void* thread_lobby(void* arg) {
+	TickLobby* tick = arg;
+
+	while (1) {
+		usleep(INTERVALO_TICK_LOBBY_MS * 1000);
+		// Pedido de pausa: este último tick anuncia o que as salas mudaram até parar
+		bool pausar = atomic_load_explicit(&pausar_lobby, memory_order_acquire);
+
+		diretorio_coletar_alterados(&diretorio, visitar_alteracao_lobby, tick);
+		fechar_lote_lobby(tick);
+		if (tick->num_quadros > 0) entregar_tick_lobby(tick);
+
+		if (pausar) aguardar_pausa(&pausar_lobby);
+	}
+	return NULL;
+}
+
+void* thread_cliente(void* arg) {
+	int socket = *(int*)arg;
+	free(arg);
+
+	// Registra cliente; a escrita fica com o worker escritor
+	Cliente* cliente = registrar_cliente(socket, 0, 0);
 	if (!cliente) {
 		close(socket);
 		return NULL;
 	}
+	if (!registrar_no_epoll(workers[0].epoll_fd, socket, EPOLLOUT | EPOLLET, cliente)) {
+		registro(REGISTRO_ERRO, "Erro ao registrar conexão no escritor: %m");
+		liberar_cliente(cliente);
+		return NULL;
+	}
 
 	// Envia ID do cliente
 	Mensagem msg;
@@ -711,42 +1838,489 @@ void* thread_cliente(void* arg) {
 	msg.tipo = MSG_CONECTAR;
 	msg.jogador_id = cliente->id;
 	enviar_mensagem(socket, &msg);
+	descarregar_saidas_pendentes();
 
 	// Loop de recebimento de mensagens
 	while (receber_mensagem(socket, &msg)) {
+		captura_mensagem(cliente->id, &msg);
 		processar_mensagem(cliente, &msg);
 	}
 
 	// Cliente desconectou
-	remover_cliente_da_sala(cliente);
+	liberar_cliente(cliente);
+	return NULL;
+}
 
-	pthread_mutex_lock(&clientes_mutex);
-	cliente->ativo = false;
-	pthread_mutex_unlock(&clientes_mutex);
+// Gauges de --metricas: salas e partidas lidas do diretório, sem lock
+static void coletar_metricas_servidor(FILE* saida, void* contexto) {
+	(void)contexto;
+	uint32_t salas = 0, partidas = 0;
+	uint32_t limite = atomic_load_explicit(&diretorio.limite, memory_order_acquire);
+	for (uint32_t slot = 0; slot < limite; slot++) {
+		InfoSala info;
+		if (!diretorio_ler(&diretorio, slot, &info)) continue;
+		salas++;
+		if (info.em_partida) partidas++;
+	}
+
+	fprintf(saida, "# HELP truco_salas_ativas Salas abertas.\n");
+	fprintf(saida, "# TYPE truco_salas_ativas gauge\n");
+	fprintf(saida, "truco_salas_ativas %u\n", salas);
+	fprintf(saida, "# HELP truco_partidas_ativas Salas com partida em andamento.\n");
+	fprintf(saida, "# TYPE truco_partidas_ativas gauge\n");
+	fprintf(saida, "truco_partidas_ativas %u\n", partidas);
+	fprintf(saida, "# HELP truco_clientes_conectados Conexões registradas.\n");
+	fprintf(saida, "# TYPE truco_clientes_conectados gauge\n");
+	fprintf(saida, "truco_clientes_conectados %u\n",
+	        atomic_load_explicit(&clientes_conectados, memory_order_relaxed));
+	fprintf(saida, "# HELP truco_partidas_iniciadas_total Partidas iniciadas.\n");
+	fprintf(saida, "# TYPE truco_partidas_iniciadas_total counter\n");
+	fprintf(saida, "truco_partidas_iniciadas_total %llu\n",
+	        (unsigned long long)atomic_load_explicit(&partidas_iniciadas, memory_order_relaxed));
+}
+
+// Aceita todas as conexões pendentes (o listener é edge-triggered)
+static void aceitar_conexoes_epoll(Worker* worker) {
+	while (1) {
+		int client_socket = accept4(worker->server_socket, NULL, NULL, SOCK_NONBLOCK);
+		if (client_socket < 0) {
+			if (errno == EINTR) continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK) registro(REGISTRO_ERRO, "Erro ao aceitar conexão: %m");
+			return;
+		}
+		metricas_conexao_aceita();
+
+		Cliente* cliente = registrar_cliente(client_socket, worker->indice, 0);
+		if (!cliente) {
+			close(client_socket);
+			continue;
+		}
+
+		if (!registrar_no_epoll(worker->epoll_fd, client_socket,
+		                        EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, cliente)) {
+			registro(REGISTRO_ERRO, "Erro ao registrar conexão no epoll: %m");
+			liberar_cliente(cliente);
+			continue;
+		}
+
+		Mensagem msg;
+		memset(&msg, 0, sizeof(Mensagem));
+		msg.tipo = MSG_CONECTAR;
+		msg.jogador_id = cliente->id;
+		enviar_mensagem(client_socket, &msg);
+		descarregar_saidas_pendentes();
+	}
+}
+
+// Processa os quadros completos de `dados`. Retorna os bytes consumidos (o
+// restante é um quadro incompleto) ou -1 se chegou um quadro inválido.
+static long processar_quadros(Cliente* cliente, const uint8_t* dados, size_t tamanho) {
+	size_t inicio = 0;
+	while (1) {
+		Mensagem msg;
+		int consumido = protocolo_decodificar(dados + inicio, tamanho - inicio, &msg);
+		if (consumido < 0) return -1;
+		if (consumido == 0) return (long)inicio;
+
+		inicio += consumido;
+		metricas_mensagem_recebida(msg.tipo, consumido);
+		captura_mensagem(cliente->id, &msg);
+		processar_mensagem(cliente, &msg);
+	}
+}
+
+// Processa os quadros completos do buffer de entrada e compacta o restante.
+// Retorna false se chegou um quadro inválido.
+static bool processar_buffer_entrada(Cliente* cliente) {
+	long consumido = processar_quadros(cliente, cliente->buffer_entrada, cliente->bytes_entrada);
+	if (consumido < 0) return false;
+
+	memmove(cliente->buffer_entrada, cliente->buffer_entrada + consumido, cliente->bytes_entrada - consumido);
+	cliente->bytes_entrada -= consumido;
+	return true;
+}
+
+// Lê tudo o que estiver disponível e processa cada mensagem completa.
+// Retorna false se a conexão foi encerrada ou falhou.
+static bool ler_cliente_epoll(Cliente* cliente) {
+	while (1) {
+		ssize_t received = recv(cliente->socket, cliente->buffer_entrada + cliente->bytes_entrada,
+		                        TAMANHO_BUFFER_ENTRADA - cliente->bytes_entrada, 0);
+		if (received == 0) return false;
+		if (received < 0) {
+			if (errno == EINTR) continue;
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+
+		cliente->bytes_entrada += received;
+		if (!processar_buffer_entrada(cliente)) return false;
+	}
+}
+
+// Conexão que falhou: nos modos epoll e uring o worker também é o leitor e a
+// libera; no modo threads o shutdown faz o recv da thread da conexão retornar
+static void encerrar_conexao(Worker* worker, Cliente* cliente) {
+	if (modo_io != IO_URING) epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, cliente->socket, NULL);
+	if (modo_io == IO_THREADS) {
+		shutdown(cliente->socket, SHUT_RDWR);
+	} else {
+		liberar_cliente(cliente);
+	}
+}
+
+// Verificação de ociosidade de um cliente do worker. Como no prazo de turno,
+// o temporizador não acompanha cada quadro recebido: ao vencer ele confere
+// ultima_atividade e se reagenda.
+static void expirar_ociosidade(Temporizador* temporizador, void* contexto) {
+	Worker* worker = contexto;
+	Cliente* cliente = (Cliente*)((char*)temporizador - offsetof(Cliente, ocioso));
+	if (!atomic_load_explicit(&cliente->ativo, memory_order_acquire)) return;
+
+	// Sem heartbeat negociado a conexão fica com o keepalive do TCP
+	if (!(atomic_load_explicit(&cliente->capacidades, memory_order_relaxed) & CAP_HEARTBEAT)) return;
+
+	uint64_t agora = agora_ms();
+	uint64_t ultima = atomic_load_explicit(&cliente->ultima_atividade, memory_order_relaxed);
+	uint64_t ocioso = agora > ultima ? agora - ultima : 0;
+	if (ocioso >= timeout_ocioso_ms) {
+		registro(REGISTRO_INFO, "Cliente %u sem atividade há %llu ms: desconectando", cliente->id,
+		         (unsigned long long)ocioso);
+		metricas_desconexao_ociosa();
+		encerrar_conexao(worker, cliente);
+		return;
+	}
+
+	uint64_t proxima = ultima + intervalo_ping_ms;
+	if (ocioso >= intervalo_ping_ms) {
+		Mensagem ping;
+		memset(&ping, 0, sizeof(Mensagem));
+		ping.tipo = MSG_PING;
+		enviar_mensagem(cliente->socket, &ping);
+		proxima = agora + intervalo_ping_ms;
+	}
+	if (proxima > ultima + timeout_ocioso_ms) proxima = ultima + timeout_ocioso_ms;
+	roda_agendar(&worker->roda, temporizador, tick_de(proxima));
+}
+
+static uint64_t dados_anel(void* ptr, OperacaoAnel operacao) {
+	return (uint64_t)(uintptr_t)ptr | operacao;
+}
+
+// Modo uring: entrega a fila de saída ao anel num único SENDMSG, que vai ao
+// kernel junto com os dos outros clientes no próximo anel_submeter. Com um
+// envio em andamento não faz nada: a conclusão manda o que chegou enquanto isso.
+static void enviar_cliente_uring(Worker* worker, Cliente* cliente) {
+	if (cliente->enviando || worker->parando) return;
+	int num_iov = fila_saida_preparar(&cliente->saida, cliente->vetores_envio, MAX_IOV_ANEL);
+	if (num_iov == 0) return;
+
+	memset(&cliente->envio, 0, sizeof(struct msghdr));
+	cliente->envio.msg_iov = cliente->vetores_envio;
+	cliente->envio.msg_iovlen = num_iov;
+	cliente->enviando = true;
+	cliente->pedidos_anel++;
+	anel_enviar(&worker->anel, cliente->socket, &cliente->envio, dados_anel(cliente, OPERACAO_ENVIAR));
+}
+
+// Descarrega os clientes avisados por outras threads e destrói os que
+// perderam a última referência. Roda depois de cada lote do epoll, então
+// nenhum evento ainda por tratar aponta para um cliente destruído.
+static void esvaziar_caixa(Worker* worker) {
+	NoFilaMpsc* no;
+	while ((no = fila_mpsc_remover(&worker->caixa)) != NULL) {
+		Cliente* cliente = (Cliente*)no;
+		if (atomic_load_explicit(&cliente->destruir, memory_order_acquire)) {
+			// No modo uring o slot só é liberado depois da última conclusão que o cita
+			if (cliente->pedidos_anel > 0) {
+				cliente->destruicao_adiada = true;
+			} else {
+				destruir_cliente(cliente);
+			}
+			continue;
+		}
+
+		// Quadros entregues a partir daqui geram um novo aviso
+		atomic_store_explicit(&cliente->na_caixa, false, memory_order_release);
+		if (atomic_load_explicit(&cliente->ativo, memory_order_acquire)) {
+			// O primeiro aviso (MSG_CONECTAR) arma a verificação de ociosidade
+			if (intervalo_ping_ms > 0 && !temporizador_agendado(&cliente->ocioso)) {
+				roda_agendar(&worker->roda, &cliente->ocioso, tick_de(agora_ms() + intervalo_ping_ms));
+			}
+			if (modo_io == IO_URING) {
+				enviar_cliente_uring(worker, cliente);
+			} else if (descarregar_cliente(cliente) == DESCARGA_ERRO) {
+				encerrar_conexao(worker, cliente);
+			}
+		}
+		soltar_cliente(cliente);
+	}
+}
+
+void* executar_worker(void* arg) {
+	Worker* worker = (Worker*)arg;
+	worker_atual = worker;
+
+	struct epoll_event eventos[MAX_EVENTOS_EPOLL];
+	while (1) {
+		int n = epoll_wait(worker->epoll_fd, eventos, MAX_EVENTOS_EPOLL, worker->roda.agendados > 0 ? MS_POR_TICK : -1);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			registro(REGISTRO_ERRO, "Erro no epoll_wait: %m");
+			break;
+		}
+
+		for (int i = 0; i < n; i++) {
+			void* ptr = eventos[i].data.ptr;
+			if (ptr == &marcador_escuta) {
+				aceitar_conexoes_epoll(worker);
+				continue;
+			}
+			if (ptr == &marcador_caixa) {
+				uint64_t contador;
+				ssize_t lido = read(worker->evento_fd, &contador, sizeof(contador));
+				(void)lido;
+				continue;
+			}
+
+			Cliente* cliente = (Cliente*)ptr;
+			if (!atomic_load_explicit(&cliente->ativo, memory_order_acquire)) continue;
+
+			bool manter = !(eventos[i].events & (EPOLLERR | EPOLLHUP));
+			if (manter && (eventos[i].events & EPOLLIN)) {
+				manter = ler_cliente_epoll(cliente);
+			}
+			if (manter && (eventos[i].events & EPOLLOUT)) {
+				manter = descarregar_cliente(cliente) != DESCARGA_ERRO;
+			}
+			if (manter && (eventos[i].events & EPOLLRDHUP)) {
+				manter = false;
+			}
+
+			if (!manter) encerrar_conexao(worker, cliente);
+		}
+
+		if (worker->roda.agendados > 0) {
+			roda_avancar(&worker->roda, tick_de(agora_ms()), expirar_ociosidade, worker);
+			descarregar_saidas_pendentes();
+		}
+		esvaziar_caixa(worker);
+
+		// Eventos edge-triggered que chegarem durante a pausa ficam no epoll
+		if (atomic_load_explicit(&pausar_workers, memory_order_acquire)) aguardar_pausa(&pausar_workers);
+	}
 
-	close(socket);
 	return NULL;
 }
 
-int main(int argc, char* argv[]) {
-	int porta = PORTA_PADRAO;
+// Modo uring: a conexão chega pelo accept multishot. A recepção também é
+// multishot, com buffers do grupo do anel, então não há pedido por leitura.
+static void aceitar_conexao_uring(Worker* worker, int client_socket) {
+	metricas_conexao_aceita();
+	Cliente* cliente = registrar_cliente(client_socket, worker->indice, 0);
+	if (!cliente) {
+		close(client_socket);
+		return;
+	}
 
-	if (argc > 1) {
-		porta = atoi(argv[1]);
+	// Parando, a recepção é armada depois da pausa (ou pelo processo que herdar a conexão)
+	if (!worker->parando) {
+		cliente->pedidos_anel++;
+		anel_receber_multishot(&worker->anel, client_socket, dados_anel(cliente, OPERACAO_RECEBER));
 	}
 
-	printf("Iniciando servidor de Truco na porta %d...\n", porta);
+	Mensagem msg;
+	memset(&msg, 0, sizeof(Mensagem));
+	msg.tipo = MSG_CONECTAR;
+	msg.jogador_id = cliente->id;
+	enviar_mensagem(client_socket, &msg);
+	descarregar_saidas_pendentes();
+}
+
+// Processa os bytes de uma recepção. Sem sobra de leituras anteriores os
+// quadros são decodificados direto do buffer do anel e só o quadro incompleto
+// do fim é copiado. Retorna false se chegou um quadro inválido.
+static bool receber_dados_uring(Cliente* cliente, const uint8_t* dados, size_t tamanho) {
+	while (tamanho > 0) {
+		if (cliente->bytes_entrada == 0) {
+			long consumido = processar_quadros(cliente, dados, tamanho);
+			if (consumido < 0 || tamanho - consumido > TAMANHO_BUFFER_ENTRADA) return false;
+			memcpy(cliente->buffer_entrada, dados + consumido, tamanho - consumido);
+			cliente->bytes_entrada = tamanho - consumido;
+			return true;
+		}
 
-	inicializar_servidor();
+		size_t copiar = TAMANHO_BUFFER_ENTRADA - cliente->bytes_entrada;
+		if (copiar > tamanho) copiar = tamanho;
+		memcpy(cliente->buffer_entrada + cliente->bytes_entrada, dados, copiar);
+		cliente->bytes_entrada += copiar;
+		dados += copiar;
+		tamanho -= copiar;
+		if (!processar_buffer_entrada(cliente)) return false;
+	}
+	return true;
+}
+
+static void tratar_recepcao_uring(Worker* worker, Cliente* cliente, const EventoAnel* evento) {
+	bool continua = evento->flags & IORING_CQE_F_MORE;
+	if (!continua) cliente->pedidos_anel--;
+	bool ativo = atomic_load_explicit(&cliente->ativo, memory_order_acquire);
+
+	bool manter = ativo;
+	if (evento->resultado > 0) {
+		if (ativo) manter = receber_dados_uring(cliente, anel_buffer(&worker->anel, evento->flags), evento->resultado);
+		anel_devolver_buffer(&worker->anel, evento->flags);
+	} else if (evento->resultado != -ENOBUFS && !(evento->resultado == -ECANCELED && worker->parando)) {
+		manter = false;  // Fim da conexão (0) ou erro
+	}
+
+	if (manter && !continua && !worker->parando) {
+		// O kernel encerrou o multishot (ex.: sem buffers livres): rearma
+		cliente->pedidos_anel++;
+		anel_receber_multishot(&worker->anel, cliente->socket, dados_anel(cliente, OPERACAO_RECEBER));
+	} else if (ativo && !manter) {
+		encerrar_conexao(worker, cliente);
+	}
+}
+
+static void tratar_envio_uring(Worker* worker, Cliente* cliente, const EventoAnel* evento) {
+	cliente->pedidos_anel--;
+	cliente->enviando = false;
+	if (evento->resultado > 0) {
+		fila_saida_confirmar(&cliente->saida, (size_t)evento->resultado);
+		metricas_bytes_enviados((uint64_t)evento->resultado);
+		conferir_atraso(cliente);
+	}
+
+	if (!atomic_load_explicit(&cliente->ativo, memory_order_acquire)) return;
+	if (evento->resultado < 0) {
+		encerrar_conexao(worker, cliente);
+	} else {
+		enviar_cliente_uring(worker, cliente);
+	}
+}
+
+static void tratar_evento_uring(Worker* worker, const EventoAnel* evento) {
+	if (evento->dados == DADOS_CANCELAMENTO) return;
+	void* ptr = (void*)(uintptr_t)(evento->dados & ~(uint64_t)MASCARA_OPERACAO);
+	switch ((OperacaoAnel)(evento->dados & MASCARA_OPERACAO)) {
+		case OPERACAO_ACEITAR:
+			if (evento->resultado >= 0) {
+				aceitar_conexao_uring(worker, evento->resultado);
+			} else if (evento->resultado != -EINTR && evento->resultado != -ECONNABORTED &&
+			           evento->resultado != -ECANCELED) {
+				errno = -evento->resultado;
+				registro(REGISTRO_ERRO, "Erro ao aceitar conexão: %m");
+			}
+			if (!(evento->flags & IORING_CQE_F_MORE) && !worker->parando) {
+				anel_aceitar_multishot(&worker->anel, worker->server_socket, dados_anel(worker, OPERACAO_ACEITAR));
+			}
+			break;
+
+		case OPERACAO_CAIXA:
+			// A caixa é esvaziada ao fim do lote; só falta rearmar a leitura do eventfd
+			if (worker->parando) break;
+			anel_ler(&worker->anel, worker->evento_fd, &worker->contador_caixa, sizeof(worker->contador_caixa),
+			         dados_anel(worker, OPERACAO_CAIXA));
+			break;
+
+		case OPERACAO_RECEBER:
+		case OPERACAO_ENVIAR: {
+			Cliente* cliente = ptr;
+			if ((evento->dados & MASCARA_OPERACAO) == OPERACAO_RECEBER) {
+				tratar_recepcao_uring(worker, cliente, evento);
+			} else {
+				tratar_envio_uring(worker, cliente, evento);
+			}
+			if (cliente->pedidos_anel == 0 && cliente->destruicao_adiada) destruir_cliente(cliente);
+			break;
+		}
+	}
+}
+
+// Arma o accept, a leitura da caixa e a recepção (e o envio pendente) de
+// cada conexão do worker: no início, que pode ter conexões herdadas de outro
+// processo, e na volta de uma pausa
+static void armar_anel(Worker* worker) {
+	anel_aceitar_multishot(&worker->anel, worker->server_socket, dados_anel(worker, OPERACAO_ACEITAR));
+	anel_ler(&worker->anel, worker->evento_fd, &worker->contador_caixa, sizeof(worker->contador_caixa),
+	         dados_anel(worker, OPERACAO_CAIXA));
+
+	metricas_travar(&clientes_mutex, MUTEX_CLIENTES);
+	uint32_t limite = pool_num_usados(&clientes);
+	for (uint32_t i = 0; i < limite; i++) {
+		Cliente* cliente = pool_obter(&clientes, i);
+		if (!cliente || cliente->worker != worker->indice || !atomic_load_explicit(&cliente->ativo, memory_order_acquire)) {
+			continue;
+		}
+		cliente->pedidos_anel++;
+		anel_receber_multishot(&worker->anel, cliente->socket, dados_anel(cliente, OPERACAO_RECEBER));
+		enviar_cliente_uring(worker, cliente);
+	}
+	pthread_mutex_unlock(&clientes_mutex);
+}
+
+// Antes da pausa: cancela os pedidos do anel e trata as conclusões que faltam,
+// então nenhuma recepção ou envio fica com o kernel enquanto o estado é copiado
+static void drenar_anel(Worker* worker) {
+	worker->parando = true;
+	anel_cancelar_todos(&worker->anel, DADOS_CANCELAMENTO);
+	acordar(worker->evento_fd);  // A leitura da caixa pode já estar em andamento e não ser cancelável
+	while (worker->anel.em_voo > 0) {
+		if (!anel_submeter(&worker->anel, MS_POR_TICK)) break;
+		EventoAnel evento;
+		while (anel_proximo(&worker->anel, &evento)) tratar_evento_uring(worker, &evento);
+		esvaziar_caixa(worker);
+	}
+}
+
+// Reator io_uring: cada volta submete de uma vez os envios e rearmes
+// preparados e espera as conclusões na mesma chamada de sistema
+static void* executar_worker_uring(void* arg) {
+	Worker* worker = (Worker*)arg;
+	worker_atual = worker;
+	if (!anel_habilitar(&worker->anel)) {
+		registro(REGISTRO_ERRO, "Erro ao habilitar io_uring: %m");
+		return NULL;
+	}
+	armar_anel(worker);
+
+	while (1) {
+		if (!anel_submeter(&worker->anel, worker->roda.agendados > 0 ? MS_POR_TICK : -1)) {
+			registro(REGISTRO_ERRO, "Erro no io_uring_enter: %m");
+			break;
+		}
+
+		EventoAnel evento;
+		while (anel_proximo(&worker->anel, &evento)) tratar_evento_uring(worker, &evento);
+
+		if (worker->roda.agendados > 0) {
+			roda_avancar(&worker->roda, tick_de(agora_ms()), expirar_ociosidade, worker);
+			descarregar_saidas_pendentes();
+		}
+		esvaziar_caixa(worker);
+
+		if (atomic_load_explicit(&pausar_workers, memory_order_acquire)) {
+			drenar_anel(worker);
+			aguardar_pausa(&pausar_workers);
+			worker->parando = false;
+			armar_anel(worker);
+		}
+	}
 
+	return NULL;
+}
+
+static int criar_socket_escuta(int porta, bool reuseport) {
 	int server_socket = socket(AF_INET, SOCK_STREAM, 0);
 	if (server_socket < 0) {
-		perror("Erro ao criar socket");
-		return 1;
+		registro(REGISTRO_ERRO, "Erro ao criar socket: %m");
+		return -1;
 	}
 
 	int opt = 1;
 	setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+	// Com SO_REUSEPORT o kernel distribui as conexões entre os sockets dos workers
+	if (reuseport) setsockopt(server_socket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
 
 	struct sockaddr_in server_addr;
 	memset(&server_addr, 0, sizeof(server_addr));
@@ -755,18 +2329,858 @@ int main(int argc, char* argv[]) {
 	server_addr.sin_port = htons(porta);
 
 	if (bind(server_socket, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-		perror("Erro ao fazer bind");
+		registro(REGISTRO_ERRO, "Erro ao fazer bind: %m");
 		close(server_socket);
-		return 1;
+		return -1;
 	}
 
-	if (listen(server_socket, 10) < 0) {
-		perror("Erro ao escutar");
+	if (listen(server_socket, SOMAXCONN) < 0) {
+		registro(REGISTRO_ERRO, "Erro ao escutar: %m");
 		close(server_socket);
+		return -1;
+	}
+
+	return server_socket;
+}
+
+// Sem porta (porta < 0) o worker não escuta: é o escritor do modo threads.
+// Uma escuta herdada (>= 0) substitui a criação do socket; o modo de bloqueio
+// dela só muda depois que o processo antigo confirma a saída.
+static bool iniciar_worker(Worker* worker, int indice, int porta, int escuta_herdada) {
+	worker->indice = indice;
+	worker->server_socket = escuta_herdada;
+	if (escuta_herdada < 0 && porta >= 0) {
+		worker->server_socket = criar_socket_escuta(porta, num_workers > 1);
+		if (worker->server_socket < 0) return false;
+	}
+
+	fila_mpsc_inicializar(&worker->caixa);
+	roda_inicializar(&worker->roda, tick_de(agora_ms()));
+
+	// Kernel sem io_uring (ou bloqueado pelo seccomp): o primeiro worker decide e todos ficam com epoll
+	if (modo_io == IO_URING &&
+	    !anel_inicializar(&worker->anel, ENTRADAS_ANEL, BUFFERS_ANEL, TAMANHO_BUFFER_ENTRADA)) {
+		if (indice > 0) {
+			registro(REGISTRO_ERRO, "Erro ao iniciar io_uring: %m");
+			return false;
+		}
+		registro(REGISTRO_AVISO, "io_uring indisponível (%m); usando epoll");
+		modo_io = IO_EPOLL;
+	}
+	if (modo_io == IO_URING) {
+		// O anel lê o eventfd com um pedido bloqueante, sempre rearmado
+		worker->epoll_fd = -1;
+		worker->evento_fd = eventfd(0, 0);
+		if (worker->evento_fd < 0) {
+			registro(REGISTRO_ERRO, "Erro ao iniciar io_uring: %m");
+			return false;
+		}
+		return true;
+	}
+
+	worker->epoll_fd = epoll_create1(0);
+	worker->evento_fd = eventfd(0, EFD_NONBLOCK);
+
+	if (worker->epoll_fd < 0 || worker->evento_fd < 0 ||
+	    (worker->server_socket >= 0 &&
+	     ((escuta_herdada < 0 && !definir_nao_bloqueante(worker->server_socket)) ||
+	      !registrar_no_epoll(worker->epoll_fd, worker->server_socket, EPOLLIN | EPOLLET, &marcador_escuta))) ||
+	    !registrar_no_epoll(worker->epoll_fd, worker->evento_fd, EPOLLIN | EPOLLET, &marcador_caixa)) {
+		registro(REGISTRO_ERRO, "Erro ao iniciar epoll: %m");
+		return false;
+	}
+	return true;
+}
+
+// escutas: uma por worker, herdadas de outro processo (NULL = criar na porta)
+static bool preparar_reatores(int porta, const int* escutas) {
+	workers = calloc(num_workers, sizeof(Worker));
+	if (!workers) return false;
+
+	for (int i = 0; i < num_workers; i++) {
+		if (!iniciar_worker(&workers[i], i, porta, escutas ? escutas[i] : -1)) return false;
+	}
+	return true;
+}
+
+static int executar_reatores() {
+	registro(REGISTRO_INFO, "Servidor rodando com %d worker(s) %s e %d executor(es) de salas! Aguardando conexões...",
+	         num_workers, modo_io == IO_URING ? "io_uring" : "epoll", num_executores);
+
+	void* (*executar)(void*) = modo_io == IO_URING ? executar_worker_uring : executar_worker;
+	for (int i = 1; i < num_workers; i++) {
+		pthread_create(&workers[i].thread, NULL, executar, &workers[i]);
+	}
+	executar(&workers[0]);
+	return 1;
+}
+
+// Transferência para um novo processo (--transferencia / --herdar)
+//
+// Com todas as threads pausadas o estado vai num único buffer, inteiros em varint:
+//
+//   [escutas] [clientes] [salas] [slots de sala] [proximo_cliente_id]
+//   [u64 semente_servidor] [partidas_iniciadas] [geração de cada slot] ...
+//   cliente: [id] [worker] [capacidades] [u64 token] [sala_id] [u8 ESTADO_CLIENTE_*]
+//            [ultima_atividade] [n] [entrada incompleta] [n] [saída ainda não enviada]
+//   sala:    [slot] [n] [nome] [u8 em_partida] [ultima_acao]
+//            2 × ([cliente + 1, 0 = nenhum] [jogador_id] [u64 token] [u8 suspenso] [suspenso_ate])
+//            [jogo, JOGO_TAMANHO_SERIALIZADO bytes, se em partida]
+//            [u8 gravando] ([sala] [jogador1] [jogador2] [u64 semente] [início] [ações] [último µs] [n] [ações])
+//            [adiados] ([cliente] [n] [quadro compacto]) ...
+//
+// Os fds seguem a mesma ordem: a escuta de cada worker e depois a conexão de
+// cada cliente. Instantes são do relógio monotônico, comum aos dois processos.
+// A base dos deltas não vai junto: o próximo EstadoJogo de cada jogador é completo.
+#define ESTADO_CLIENTE_ASSINANTE 0x01
+#define ESTADO_CLIENTE_ATRASADO 0x02
+#define ESTADO_CLIENTE_DERRUBADO 0x04
+
+// Confirmações de um byte no fim: o novo processo restaurou tudo; o antigo vai sair
+#define CONFIRMACAO_TRANSFERENCIA 1
+#define ESPERA_TRANSFERENCIA_S 10
+
+static const char* caminho_transferencia = NULL;
+
+// Estado recebido pelo novo processo, do cabeçalho até a confirmação
+typedef struct {
+	int conexao;
+	int* fds;  // Escutas e depois clientes; -1 nos que não foram restaurados
+	size_t num_fds;
+	uint8_t* dados;
+	LeitorEstado leitor;
+	uint32_t num_escutas;
+	uint32_t num_clientes;
+	uint32_t num_salas;
+	uint32_t slots_salas;
+	uint64_t inicio;  // ns
+} Heranca;
+
+static void definir_timeout_transferencia(int conexao) {
+	struct timeval espera = {.tv_sec = ESPERA_TRANSFERENCIA_S, .tv_usec = 0};
+	setsockopt(conexao, SOL_SOCKET, SO_RCVTIMEO, &espera, sizeof(espera));
+	setsockopt(conexao, SOL_SOCKET, SO_SNDTIMEO, &espera, sizeof(espera));
+}
+
+static void esperar_threads_em_pausa(int quantidade) {
+	pthread_mutex_lock(&pausa_mutex);
+	while (threads_em_pausa < quantidade) pthread_cond_wait(&pausa_cond, &pausa_mutex);
+	pthread_mutex_unlock(&pausa_mutex);
+}
+
+static void pausar_servidor() {
+	atomic_store_explicit(&pausar_workers, true, memory_order_release);
+	for (int i = 0; i < num_workers; i++) acordar(workers[i].evento_fd);
+	esperar_threads_em_pausa(num_workers);
+
+	atomic_store_explicit(&pausar_executores, true, memory_order_release);
+	for (int i = 0; i < num_executores; i++) acordar(executores[i].evento_fd);
+	esperar_threads_em_pausa(num_workers + num_executores);
+
+	atomic_store_explicit(&pausar_lobby, true, memory_order_release);
+	esperar_threads_em_pausa(num_workers + num_executores + 1);
+}
+
+static void retomar_servidor() {
+	pthread_mutex_lock(&pausa_mutex);
+	atomic_store_explicit(&pausar_workers, false, memory_order_release);
+	atomic_store_explicit(&pausar_executores, false, memory_order_release);
+	atomic_store_explicit(&pausar_lobby, false, memory_order_release);
+	pthread_cond_broadcast(&pausa_cond);
+	while (threads_em_pausa > 0) pthread_cond_wait(&pausa_cond, &pausa_mutex);
+	pthread_mutex_unlock(&pausa_mutex);
+}
+
+// Só com o servidor pausado. posicoes[slot do cliente] = posição na
+// transferência + 1 (0 = cliente que não vai junto).
+static void serializar_sala(EscritorEstado* saida, Sala* sala, const uint32_t* posicoes) {
+	size_t tamanho_nome = strnlen(sala->nome, sizeof(sala->nome));
+	escritor_varint(saida, sala->indice);
+	escritor_varint(saida, tamanho_nome);
+	escritor_bytes(saida, sala->nome, tamanho_nome);
+	escritor_u8(saida, sala->em_partida);
+	escritor_varint(saida, sala->ultima_acao);
+
+	for (int jogador = 1; jogador <= 2; jogador++) {
+		int socket = (jogador == 1) ? sala->jogador1_socket : sala->jogador2_socket;
+		Cliente* cliente = socket != -1 ? obter_cliente_por_socket(socket) : NULL;
+		escritor_varint(saida, cliente ? posicoes[cliente->indice] : 0);
+		escritor_varint(saida, (jogador == 1) ? sala->jogador1_id : sala->jogador2_id);
+		escritor_u64(saida, sala->token_assento[jogador - 1]);
+		escritor_u8(saida, sala->assento_suspenso[jogador - 1]);
+		escritor_varint(saida, sala->suspenso_ate[jogador - 1]);
+	}
+
+	if (sala->em_partida) {
+		uint8_t* jogo = escritor_reservar(saida, JOGO_TAMANHO_SERIALIZADO);
+		if (jogo) jogo_serializar(&sala->jogo, jogo);
+	}
+
+	GravacaoReplay* gravacao = &sala->gravacao;
+	escritor_u8(saida, gravacao->ativa);
+	if (gravacao->ativa) {
+		escritor_varint(saida, gravacao->cabecalho.sala_id);
+		escritor_varint(saida, gravacao->cabecalho.jogador1_id);
+		escritor_varint(saida, gravacao->cabecalho.jogador2_id);
+		escritor_u64(saida, gravacao->cabecalho.semente);
+		escritor_varint(saida, gravacao->cabecalho.inicio_us);
+		escritor_varint(saida, gravacao->num_acoes);
+		escritor_varint(saida, gravacao->ultimo_us);
+		escritor_varint(saida, gravacao->tamanho);
+		escritor_bytes(saida, gravacao->acoes, gravacao->tamanho);
+	}
+
+	// Jogadas de clientes que não vão junto são descartadas
+	int num_adiados = 0;
+	for (int i = 0; i < sala->num_adiados; i++) {
+		if (posicoes[sala->adiados[i]->cliente->indice]) num_adiados++;
+	}
+	escritor_varint(saida, num_adiados);
+	for (int i = 0; i < sala->num_adiados; i++) {
+		ComandoSala* comando = sala->adiados[i];
+		if (!posicoes[comando->cliente->indice]) continue;
+		uint8_t quadro[PROTOCOLO_TAMANHO_MAX_QUADRO];
+		size_t tamanho = protocolo_codificar(&comando->msg, true, quadro);
+		escritor_varint(saida, posicoes[comando->cliente->indice]);
+		escritor_varint(saida, tamanho);
+		escritor_bytes(saida, quadro, tamanho);
+	}
+}
+
+// Só com o servidor pausado. Retorna false sem memória; *fds é do chamador.
+static bool serializar_estado(EscritorEstado* saida, int** fds_saida, size_t* num_fds, uint32_t* num_salas) {
+	uint32_t slots_clientes = pool_num_usados(&clientes);
+	uint32_t slots_salas = pool_num_usados(&salas);
+	uint32_t* posicoes = calloc(slots_clientes + 1, sizeof(uint32_t));
+	int* fds = malloc((num_workers + slots_clientes) * sizeof(int));
+	if (!posicoes || !fds) {
+		free(posicoes);
+		free(fds);
+		return false;
+	}
+
+	*num_fds = 0;
+	for (int i = 0; i < num_workers; i++) fds[(*num_fds)++] = workers[i].server_socket;
+
+	// Conexões encerradas que só esperam a última referência ficam para trás
+	uint32_t num_clientes = 0;
+	for (uint32_t i = 0; i < slots_clientes; i++) {
+		Cliente* cliente = pool_obter(&clientes, i);
+		if (cliente && atomic_load_explicit(&cliente->ativo, memory_order_acquire)) posicoes[i] = ++num_clientes;
+	}
+	*num_salas = 0;
+	for (uint32_t i = 0; i < slots_salas; i++) {
+		Sala* sala = pool_obter(&salas, i);
+		if (sala && atomic_load_explicit(&sala->ativa, memory_order_acquire)) (*num_salas)++;
+	}
+
+	escritor_varint(saida, num_workers);
+	escritor_varint(saida, num_clientes);
+	escritor_varint(saida, *num_salas);
+	escritor_varint(saida, slots_salas);
+	escritor_varint(saida, proximo_cliente_id);
+	escritor_u64(saida, semente_servidor);
+	escritor_varint(saida, atomic_load_explicit(&partidas_iniciadas, memory_order_relaxed));
+	for (uint32_t i = 0; i < slots_salas; i++) {
+		Sala* sala = pool_obter(&salas, i);
+		escritor_varint(saida, sala ? sala->geracao : 0);
+	}
+
+	for (uint32_t i = 0; i < slots_clientes; i++) {
+		if (!posicoes[i]) continue;
+		Cliente* cliente = pool_obter(&clientes, i);
+		uint8_t flags = 0;
+		if (cliente->indice_assinante >= 0) flags |= ESTADO_CLIENTE_ASSINANTE;
+		if (atomic_load_explicit(&cliente->atrasado, memory_order_relaxed)) flags |= ESTADO_CLIENTE_ATRASADO;
+		if (atomic_load_explicit(&cliente->derrubado, memory_order_relaxed)) flags |= ESTADO_CLIENTE_DERRUBADO;
+
+		escritor_varint(saida, cliente->id);
+		escritor_varint(saida, cliente->worker);
+		escritor_varint(saida, atomic_load_explicit(&cliente->capacidades, memory_order_relaxed));
+		escritor_u64(saida, atomic_load_explicit(&cliente->token_sessao, memory_order_relaxed));
+		escritor_varint(saida, atomic_load_explicit(&cliente->sala_id, memory_order_relaxed));
+		escritor_u8(saida, flags);
+		escritor_varint(saida, atomic_load_explicit(&cliente->ultima_atividade, memory_order_relaxed));
+		escritor_varint(saida, cliente->bytes_entrada);
+		escritor_bytes(saida, cliente->buffer_entrada, cliente->bytes_entrada);
+
+		size_t pendente = fila_saida_copiar(&cliente->saida, NULL, 0);
+		escritor_varint(saida, pendente);
+		uint8_t* destino = escritor_reservar(saida, pendente);
+		if (destino) fila_saida_copiar(&cliente->saida, destino, pendente);
+
+		fds[(*num_fds)++] = cliente->socket;
+	}
+
+	for (uint32_t i = 0; i < slots_salas; i++) {
+		Sala* sala = pool_obter(&salas, i);
+		if (sala && atomic_load_explicit(&sala->ativa, memory_order_acquire)) serializar_sala(saida, sala, posicoes);
+	}
+
+	free(posicoes);
+	*fds_saida = fds;
+	return !saida->erro;
+}
+
+// Processo antigo: pausa, envia e, se o novo confirmar, sai sem tocar mais em
+// nenhuma conexão. Em qualquer falha o servidor simplesmente continua.
+static void transferir_estado(int conexao) {
+	uint64_t inicio = metricas_agora_ns();
+	registro(REGISTRO_INFO, "Transferindo o servidor para um novo processo...");
+	definir_timeout_transferencia(conexao);
+	pausar_servidor();
+	uint64_t pausado = metricas_agora_ns();
+
+	EscritorEstado estado;
+	memset(&estado, 0, sizeof(EscritorEstado));
+	int* fds = NULL;
+	size_t num_fds = 0;
+	uint32_t num_salas = 0;
+	bool ok = serializar_estado(&estado, &fds, &num_fds, &num_salas) &&
+	          transferencia_enviar(conexao, fds, num_fds, estado.dados, estado.tamanho);
+
+	uint8_t confirmacao = 0;
+	ok = ok && recv(conexao, &confirmacao, 1, 0) == 1 && confirmacao == CONFIRMACAO_TRANSFERENCIA;
+	if (ok) {
+		// Depois deste byte o novo processo passa a atender as conexões
+		uint8_t saindo = CONFIRMACAO_TRANSFERENCIA;
+		ok = send(conexao, &saindo, 1, MSG_NOSIGNAL) == 1;
+	}
+	if (ok) {
+		uint64_t fim = metricas_agora_ns();
+		registro(REGISTRO_INFO,
+		         "Servidor transferido: %zu conexões, %u salas, %zu bytes de estado em %.1f ms (pausa %.1f ms); "
+		         "encerrando",
+		         num_fds - num_workers, num_salas, estado.tamanho, (fim - inicio) / 1e6, (pausado - inicio) / 1e6);
+		replay_descarregar();
+		registro_descarregar();
+		_exit(0);
+	}
+
+	registro(REGISTRO_ERRO, "Transferência não concluída (o motivo fica no log do novo processo); o servidor continua");
+	free(fds);
+	escritor_liberar(&estado);
+	retomar_servidor();
+}
+
+// Aceita pedidos de transferência de processos do mesmo usuário
+static void* thread_transferencia(void* arg) {
+	int escuta = (int)(intptr_t)arg;
+	while (1) {
+		int conexao = accept4(escuta, NULL, NULL, SOCK_CLOEXEC);
+		if (conexao < 0) {
+			if (errno != EINTR) registro(REGISTRO_ERRO, "Erro ao aceitar pedido de transferência: %m");
+			continue;
+		}
+
+		struct ucred credenciais;
+		socklen_t tamanho = sizeof(credenciais);
+		if (getsockopt(conexao, SOL_SOCKET, SO_PEERCRED, &credenciais, &tamanho) < 0 || credenciais.uid != getuid()) {
+			registro(REGISTRO_AVISO, "Pedido de transferência recusado: processo de outro usuário");
+		} else {
+			transferir_estado(conexao);
+		}
+		close(conexao);
+	}
+	return NULL;
+}
+
+static bool iniciar_transferencia(const char* caminho) {
+	int escuta = transferencia_escutar(caminho);
+	if (escuta < 0) return false;
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, thread_transferencia, (void*)(intptr_t)escuta) != 0) {
+		close(escuta);
+		return false;
+	}
+	pthread_detach(thread);
+	return true;
+}
+
+// Novo processo: recebe os fds e o estado e lê o cabeçalho, que decide o
+// número de workers (um por escuta herdada)
+static bool receber_heranca(const char* caminho, Heranca* heranca) {
+	memset(heranca, 0, sizeof(Heranca));
+	heranca->inicio = metricas_agora_ns();
+	heranca->conexao = transferencia_conectar(caminho);
+	if (heranca->conexao < 0) return false;
+	definir_timeout_transferencia(heranca->conexao);
+
+	size_t tamanho = 0;
+	if (!transferencia_receber(heranca->conexao, &heranca->fds, &heranca->num_fds, &heranca->dados, &tamanho)) {
+		return false;
+	}
+	heranca->leitor = (LeitorEstado){.dados = heranca->dados, .tamanho = tamanho};
+
+	LeitorEstado* leitor = &heranca->leitor;
+	heranca->num_escutas = (uint32_t)leitor_varint(leitor);
+	heranca->num_clientes = (uint32_t)leitor_varint(leitor);
+	heranca->num_salas = (uint32_t)leitor_varint(leitor);
+	heranca->slots_salas = (uint32_t)leitor_varint(leitor);
+	proximo_cliente_id = (uint32_t)leitor_varint(leitor);
+	semente_servidor = leitor_u64(leitor);
+	atomic_store_explicit(&partidas_iniciadas, leitor_varint(leitor), memory_order_relaxed);
+
+	if (leitor->erro || heranca->num_escutas == 0 ||
+	    heranca->num_fds != (size_t)heranca->num_escutas + heranca->num_clientes) {
+		errno = EPROTO;
+		return false;
+	}
+	return true;
+}
+
+static Cliente* restaurar_cliente(Heranca* heranca, uint32_t posicao) {
+	LeitorEstado* leitor = &heranca->leitor;
+	uint32_t id = (uint32_t)leitor_varint(leitor);
+	int worker = (int)(leitor_varint(leitor) % num_workers);
+	uint32_t capacidades = (uint32_t)leitor_varint(leitor);
+	uint64_t token = leitor_u64(leitor);
+	uint32_t sala_id = (uint32_t)leitor_varint(leitor);
+	uint8_t flags = leitor_u8(leitor);
+	uint64_t ultima_atividade = leitor_varint(leitor);
+	size_t bytes_entrada = leitor_varint(leitor);
+	const uint8_t* entrada = leitor_bytes(leitor, bytes_entrada);
+	size_t bytes_saida = leitor_varint(leitor);
+	const uint8_t* saida = leitor_bytes(leitor, bytes_saida);
+	if (leitor->erro || bytes_entrada > TAMANHO_BUFFER_ENTRADA) {
+		leitor->erro = true;
+		return NULL;
+	}
+
+	int* socket = &heranca->fds[heranca->num_escutas + posicao];
+	Cliente* cliente = registrar_cliente(*socket, worker, id);
+	if (!cliente || (modo_io == IO_EPOLL && !registrar_no_epoll(workers[worker].epoll_fd, *socket,
+	                                                             EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, cliente))) {
+		registro(REGISTRO_AVISO, "Conexão herdada do cliente %u descartada: %m", id);
+		if (cliente) {
+			liberar_cliente(cliente);
+		} else {
+			close(*socket);
+		}
+		*socket = -1;
+		return NULL;
+	}
+
+	atomic_store_explicit(&cliente->capacidades, capacidades, memory_order_relaxed);
+	atomic_store_explicit(&cliente->token_sessao, token, memory_order_relaxed);
+	atomic_store_explicit(&cliente->sala_id, sala_id, memory_order_relaxed);
+	atomic_store_explicit(&cliente->atrasado, (flags & ESTADO_CLIENTE_ATRASADO) != 0, memory_order_relaxed);
+	atomic_store_explicit(&cliente->derrubado, (flags & ESTADO_CLIENTE_DERRUBADO) != 0, memory_order_relaxed);
+	atomic_store_explicit(&cliente->ultima_atividade, ultima_atividade, memory_order_relaxed);
+	memcpy(cliente->buffer_entrada, entrada, bytes_entrada);
+	cliente->bytes_entrada = bytes_entrada;
+	if (bytes_saida > 0) fila_saida_enviar(&cliente->saida, saida, bytes_saida);
+	if (flags & ESTADO_CLIENTE_ASSINANTE) assinar_lobby(cliente);
+
+	// O worker descarrega o que ficou pendente e arma a verificação de ociosidade
+	marcar_saida_pendente(cliente);
+	return cliente;
+}
+
+static bool restaurar_sala(Heranca* heranca, Cliente** restaurados) {
+	LeitorEstado* leitor = &heranca->leitor;
+	uint32_t slot = (uint32_t)leitor_varint(leitor);
+	size_t tamanho_nome = leitor_varint(leitor);
+	const uint8_t* nome = leitor_bytes(leitor, tamanho_nome);
+	bool em_partida = leitor_u8(leitor) != 0;
+	uint64_t ultima_acao = leitor_varint(leitor);
+	Sala* sala = slot < heranca->slots_salas ? pool_obter(&salas, slot) : NULL;
+	if (leitor->erro || !sala || tamanho_nome >= sizeof(sala->nome)) return false;
+
+	atomic_store_explicit(&sala->id, ((uint32_t)sala->geracao << BITS_SLOT_SALA) | slot, memory_order_release);
+	memset(sala->nome, 0, sizeof(sala->nome));
+	memcpy(sala->nome, nome, tamanho_nome);
+	sala->em_partida = em_partida;
+	sala->ultima_acao = ultima_acao;
+	sala->jogador1_socket = -1;
+	sala->jogador2_socket = -1;
+
+	uint64_t proxima_reserva = 0;
+	for (int jogador = 1; jogador <= 2; jogador++) {
+		uint64_t posicao = leitor_varint(leitor);
+		uint32_t jogador_id = (uint32_t)leitor_varint(leitor);
+		uint64_t token = leitor_u64(leitor);
+		bool suspenso = leitor_u8(leitor) != 0;
+		uint64_t suspenso_ate = leitor_varint(leitor);
+		Cliente* cliente = posicao > 0 && posicao <= heranca->num_clientes ? restaurados[posicao - 1] : NULL;
+
+		sala->token_assento[jogador - 1] = 0;
+		sala->assento_suspenso[jogador - 1] = false;
+		sala->tem_estado_enviado[jogador - 1] = false;
+		if (cliente) {
+			ocupar_assento(sala, jogador, cliente);
+			sala->token_assento[jogador - 1] = token;
+		} else if (suspenso) {
+			if (jogador == 1) {
+				sala->jogador1_id = jogador_id;
+			} else {
+				sala->jogador2_id = jogador_id;
+			}
+			sala->token_assento[jogador - 1] = token;
+			sala->assento_suspenso[jogador - 1] = true;
+			sala->suspenso_ate[jogador - 1] = suspenso_ate;
+			if (proxima_reserva == 0 || suspenso_ate < proxima_reserva) proxima_reserva = suspenso_ate;
+		} else if (jogador == 1) {
+			sala->jogador1_id = 0;
+		} else {
+			sala->jogador2_id = 0;
+		}
+	}
+
+	if (em_partida) {
+		const uint8_t* jogo = leitor_bytes(leitor, JOGO_TAMANHO_SERIALIZADO);
+		if (!jogo || !jogo_desserializar(&sala->jogo, jogo)) return false;
+	}
+
+	if (leitor_u8(leitor)) {
+		CabecalhoReplay cabecalho;
+		cabecalho.sala_id = (uint32_t)leitor_varint(leitor);
+		cabecalho.jogador1_id = (uint32_t)leitor_varint(leitor);
+		cabecalho.jogador2_id = (uint32_t)leitor_varint(leitor);
+		cabecalho.semente = leitor_u64(leitor);
+		cabecalho.inicio_us = leitor_varint(leitor);
+		uint32_t num_acoes = (uint32_t)leitor_varint(leitor);
+		uint64_t ultimo_us = leitor_varint(leitor);
+		size_t tamanho = leitor_varint(leitor);
+		const uint8_t* acoes = leitor_bytes(leitor, tamanho);
+
+		// Sem --replay neste processo a partida deixa de ser gravada
+		GravacaoReplay* gravacao = &sala->gravacao;
+		uint8_t* copia = acoes && replay_ativo() ? malloc(tamanho + 1) : NULL;
+		if (copia) {
+			memcpy(copia, acoes, tamanho);
+			free(gravacao->acoes);
+			gravacao->ativa = true;
+			gravacao->cabecalho = cabecalho;
+			gravacao->acoes = copia;
+			gravacao->tamanho = tamanho;
+			gravacao->capacidade = tamanho + 1;
+			gravacao->num_acoes = num_acoes;
+			gravacao->ultimo_us = ultimo_us;
+		}
+	}
+
+	size_t num_adiados = leitor_varint(leitor);
+	for (size_t i = 0; i < num_adiados && !leitor->erro; i++) {
+		uint64_t posicao = leitor_varint(leitor);
+		size_t tamanho = leitor_varint(leitor);
+		const uint8_t* quadro = leitor_bytes(leitor, tamanho);
+		Cliente* cliente = posicao > 0 && posicao <= heranca->num_clientes ? restaurados[posicao - 1] : NULL;
+		if (!quadro || !cliente || sala->num_adiados == MAX_COMANDOS_ADIADOS) continue;
+
+		ComandoSala* comando = malloc(sizeof(ComandoSala));
+		if (!comando) continue;
+		if (protocolo_decodificar(quadro, tamanho, &comando->msg) <= 0) {
+			free(comando);
+			continue;
+		}
+		comando->tipo = COMANDO_MENSAGEM;
+		comando->cliente = cliente;
+		comando->sala_id = sala->id;
+		comando->enfileirado_em = metricas_agora_ns();
+		reter_cliente(cliente);
+		sala->adiados[sala->num_adiados++] = comando;
+	}
+	if (leitor->erro) return false;
+
+	// Assentos de clientes que não puderam ser restaurados ficam vazios
+	if (!assento_ocupado(sala, 1) && !assento_ocupado(sala, 2)) {
+		descartar_adiados(sala);
+		gravacao_finalizar(&sala->gravacao, &sala->jogo);
+		return true;
+	}
+
+	Executor* executor = &executores[slot % num_executores];
+	if (em_partida && prazo_turno_ms > 0) roda_agendar(&executor->roda, &sala->prazo, tick_de(ultima_acao + prazo_turno_ms));
+	if (proxima_reserva > 0) roda_agendar(&executor->reservas, &sala->graca, tick_de(proxima_reserva));
+	atomic_store_explicit(&sala->ativa, true, memory_order_release);
+	publicar_sala(sala);
+	return true;
+}
+
+// Recria slots (com as gerações de antes, para os ids antigos continuarem
+// valendo e os descartados continuarem inválidos), conexões e salas. Roda
+// antes das threads de workers e executores.
+static bool restaurar_estado(Heranca* heranca) {
+	LeitorEstado* leitor = &heranca->leitor;
+
+	metricas_travar(&salas_mutex, MUTEX_SALAS);
+	bool ok = true;
+	for (uint32_t i = 0; i < heranca->slots_salas && ok; i++) {
+		uint32_t indice;
+		Sala* sala = pool_alocar(&salas, &indice);
+		ok = sala && indice == i;
+		if (ok) sala->geracao = (uint16_t)leitor_varint(leitor);
+	}
+	pthread_mutex_unlock(&salas_mutex);
+	if (!ok || leitor->erro) {
+		registro(REGISTRO_ERRO, "Estado herdado tem %u slots de sala; aumente --max-salas", heranca->slots_salas);
+		return false;
+	}
+
+	Cliente** restaurados = calloc(heranca->num_clientes + 1, sizeof(Cliente*));
+	if (!restaurados) return false;
+	for (uint32_t i = 0; i < heranca->num_clientes && !leitor->erro; i++) {
+		restaurados[i] = restaurar_cliente(heranca, i);
+	}
+	for (uint32_t i = 0; i < heranca->num_salas && ok; i++) ok = restaurar_sala(heranca, restaurados);
+	free(restaurados);
+	descarregar_saidas_pendentes();
+
+	// Slots sem sala voltam à lista livre; os de índice menor saem primeiro
+	metricas_travar(&salas_mutex, MUTEX_SALAS);
+	for (uint32_t i = heranca->slots_salas; i-- > 0;) {
+		Sala* sala = pool_obter(&salas, i);
+		if (!atomic_load_explicit(&sala->ativa, memory_order_relaxed)) pool_liberar(&salas, i);
+	}
+	pthread_mutex_unlock(&salas_mutex);
+
+	if (!ok || leitor->erro) {
+		registro(REGISTRO_ERRO, "Estado herdado inválido");
+		return false;
+	}
+	return true;
+}
+
+// Confirma ao processo antigo e espera ele avisar que vai sair; só então os
+// descritores passam ao modo de bloqueio deste processo
+static bool concluir_heranca(Heranca* heranca) {
+	uint8_t confirmacao = CONFIRMACAO_TRANSFERENCIA;
+	bool ok = send(heranca->conexao, &confirmacao, 1, MSG_NOSIGNAL) == 1 &&
+	          recv(heranca->conexao, &confirmacao, 1, 0) == 1 && confirmacao == CONFIRMACAO_TRANSFERENCIA;
+	close(heranca->conexao);
+	if (!ok) {
+		registro(REGISTRO_ERRO, "O processo antigo não confirmou a saída (%m); abortando");
+		return false;
+	}
+
+	for (size_t i = 0; i < heranca->num_fds; i++) {
+		if (heranca->fds[i] < 0) continue;
+		if (modo_io == IO_URING) {
+			definir_bloqueante(heranca->fds[i]);
+		} else {
+			definir_nao_bloqueante(heranca->fds[i]);
+		}
+	}
+
+	registro(REGISTRO_INFO, "Servidor herdado: %u conexões, %u salas, %zu bytes de estado em %.1f ms",
+	         heranca->num_clientes, heranca->num_salas, heranca->leitor.tamanho,
+	         (metricas_agora_ns() - heranca->inicio) / 1e6);
+	free(heranca->fds);
+	free(heranca->dados);
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	int porta = PORTA_PADRAO;
+	int porta_metricas = 0;
+	const char* arquivo_replay = NULL;
+	const char* arquivo_captura = NULL;
+	const char* caminho_herdar = NULL;
+	bool semente_fixa = false;
+	bool timeout_explicito = false;
+	bool io_explicito = false;
+	bool workers_explicito = false;
+	FormatoRegistro formato_log = REGISTRO_TEXTO;
+	NivelRegistro nivel_log = REGISTRO_INFO;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--io=epoll") == 0) {
+			modo_io = IO_EPOLL;
+			io_explicito = true;
+		} else if (strcmp(argv[i], "--io=uring") == 0) {
+			modo_io = IO_URING;
+			io_explicito = true;
+		} else if (strcmp(argv[i], "--io=threads") == 0) {
+			modo_io = IO_THREADS;
+			io_explicito = true;
+		} else if (strncmp(argv[i], "--workers=", 10) == 0) {
+			// --workers=0 usa um worker por núcleo
+			num_workers = atoi(argv[i] + 10);
+			if (num_workers <= 0) num_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+			workers_explicito = true;
+		} else if (strncmp(argv[i], "--executores=", 13) == 0) {
+			// --executores=0 usa um executor de salas por núcleo
+			num_executores = atoi(argv[i] + 13);
+		} else if (strncmp(argv[i], "--semente=", 10) == 0) {
+			// Semente fixa: a sequência de partidas do servidor é reproduzível
+			semente_servidor = strtoull(argv[i] + 10, NULL, 0);
+			semente_fixa = true;
+		} else if (strncmp(argv[i], "--max-salas=", 12) == 0) {
+			long valor = atol(argv[i] + 12);
+			if (valor > 0) capacidade_salas = valor > MASCARA_SLOT_SALA + 1L ? MASCARA_SLOT_SALA + 1 : (uint32_t)valor;
+		} else if (strcmp(argv[i], "--log=json") == 0) {
+			formato_log = REGISTRO_JSON;
+		} else if (strcmp(argv[i], "--log=texto") == 0) {
+			formato_log = REGISTRO_TEXTO;
+		} else if (strncmp(argv[i], "--log-nivel=", 12) == 0) {
+			if (!registro_nivel_por_nome(argv[i] + 12, &nivel_log)) {
+				fprintf(stderr, "Nível de log inválido: %s (use debug, info, aviso ou erro)\n", argv[i] + 12);
+				return 1;
+			}
+		} else if (strncmp(argv[i], "--captura=", 10) == 0) {
+			arquivo_captura = argv[i] + 10;
+		} else if (strncmp(argv[i], "--replay=", 9) == 0) {
+			arquivo_replay = argv[i] + 9;
+		} else if (strncmp(argv[i], "--metricas=", 11) == 0) {
+			porta_metricas = atoi(argv[i] + 11);
+		} else if (strncmp(argv[i], "--limite-saida=", 15) == 0) {
+			// Abaixo de um quadro completo nenhum EstadoJogo passaria
+			long valor = atol(argv[i] + 15);
+			if (valor > 0) limite_saida = (size_t)valor;
+			if (limite_saida < PROTOCOLO_TAMANHO_MAX_QUADRO) limite_saida = PROTOCOLO_TAMANHO_MAX_QUADRO;
+		} else if (strncmp(argv[i], "--heartbeat=", 12) == 0) {
+			// --heartbeat=0 desliga o heartbeat e o keepalive
+			intervalo_ping_ms = (uint64_t)atol(argv[i] + 12) * 1000;
+		} else if (strncmp(argv[i], "--timeout-ocioso=", 17) == 0) {
+			timeout_ocioso_ms = (uint64_t)atol(argv[i] + 17) * 1000;
+			timeout_explicito = true;
+		} else if (strncmp(argv[i], "--prazo-turno=", 14) == 0) {
+			prazo_turno_ms = (uint64_t)atol(argv[i] + 14) * 1000;
+		} else if (strncmp(argv[i], "--graca-sessao=", 15) == 0) {
+			graca_sessao_ms = (uint64_t)atol(argv[i] + 15) * 1000;
+		} else if (strcmp(argv[i], "--cliente-lento=snapshot") == 0) {
+			politica_lento = LENTO_SNAPSHOT;
+		} else if (strcmp(argv[i], "--cliente-lento=desconectar") == 0) {
+			politica_lento = LENTO_DESCONECTAR;
+		} else if (strcmp(argv[i], "--cliente-lento=pausar") == 0) {
+			politica_lento = LENTO_PAUSAR;
+		} else if (strncmp(argv[i], "--transferencia=", 16) == 0) {
+			caminho_transferencia = argv[i] + 16;
+		} else if (strncmp(argv[i], "--herdar=", 9) == 0) {
+			caminho_herdar = argv[i] + 9;
+		} else if (strncmp(argv[i], "--max-clientes=", 15) == 0) {
+			long valor = atol(argv[i] + 15);
+			if (valor > 0) capacidade_clientes = valor > UINT32_MAX ? UINT32_MAX : (uint32_t)valor;
+		} else {
+			porta = atoi(argv[i]);
+		}
+	}
+
+	// Resolvido depois de todas as opções, para não depender da ordem: sem
+	// --io, --workers implica epoll; o modo threads não tem workers
+	if (workers_explicito && modo_io == IO_THREADS) {
+		if (io_explicito) {
+			fprintf(stderr, "--workers não se aplica a --io=threads (use --io=epoll ou --io=uring)\n");
+			return 1;
+		}
+		modo_io = IO_EPOLL;
+	}
+
+	// Sem --timeout-ocioso a conexão cai depois de três pings sem resposta
+	if (!timeout_explicito) timeout_ocioso_ms = 3 * intervalo_ping_ms;
+
+	// No modo threads cada conexão tem uma thread bloqueada nela: não há como
+	// pausar e entregar a outro processo
+	if ((caminho_transferencia || caminho_herdar) && modo_io == IO_THREADS) modo_io = IO_EPOLL;
+
+	// Daqui em diante nenhuma thread do servidor escreve direto no stdout
+	registro_iniciar(stdout, formato_log, nivel_log);
+	registro(REGISTRO_INFO, "Iniciando servidor de Truco na porta %d (modo %s, até %u salas e %u clientes)...",
+	         porta, modo_io == IO_URING ? "uring" : modo_io == IO_EPOLL ? "epoll" : "threads", capacidade_salas,
+	         capacidade_clientes);
+
+	if (!semente_fixa && getrandom(&semente_servidor, sizeof(semente_servidor), 0) != sizeof(semente_servidor)) {
+		semente_servidor = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+	}
+
+	if (modo_io == IO_THREADS) num_workers = 1;
+	inicializar_servidor();
+	if (!preparar_executores()) {
+		registro_descarregar();
+		return 1;
+	}
+
+	// Antes da herança: as partidas herdadas só continuam gravando com o arquivo aberto
+	if (arquivo_replay) {
+		if (replay_abrir_arquivo(arquivo_replay)) {
+			registro(REGISTRO_INFO, "Gravando partidas em %s", arquivo_replay);
+		} else {
+			registro(REGISTRO_ERRO, "Erro ao abrir arquivo de replay %s: %m", arquivo_replay);
+		}
+	}
+
+	// Herança: conexões e salas do processo em execução, antes de qualquer
+	// thread que as atenda
+	Heranca heranca;
+	if (caminho_herdar) {
+		if (!receber_heranca(caminho_herdar, &heranca)) {
+			registro(REGISTRO_ERRO, "Erro ao receber o servidor de %s: %m", caminho_herdar);
+			registro_descarregar();
+			return 1;
+		}
+		num_workers = (int)heranca.num_escutas;
+	}
+	if (modo_io != IO_THREADS && !preparar_reatores(porta, caminho_herdar ? heranca.fds : NULL)) {
+		registro_descarregar();
+		return 1;
+	}
+	if (caminho_herdar && (!restaurar_estado(&heranca) || !concluir_heranca(&heranca))) {
+		registro_descarregar();
+		return 1;
+	}
+
+	// O lobby começa conhecendo as salas herdadas: os assinantes já as receberam
+	TickLobby* tick_lobby = calloc(1, sizeof(TickLobby));
+	if (!tick_lobby || !iniciar_executores()) {
+		registro_descarregar();
+		return 1;
+	}
+	tick_lobby->lote.tipo = MSG_EVENTOS_LOBBY;
+	if (caminho_herdar) {
+		tick_lobby->silencioso = true;
+		diretorio_coletar_alterados(&diretorio, visitar_alteracao_lobby, tick_lobby);
+		tick_lobby->silencioso = false;
+	}
+	pthread_t thread_eventos_lobby;
+	pthread_create(&thread_eventos_lobby, NULL, thread_lobby, tick_lobby);
+	pthread_detach(thread_eventos_lobby);
+
+	if (arquivo_captura) {
+		if (captura_abrir_arquivo(arquivo_captura)) {
+			registro(REGISTRO_INFO, "Capturando o tráfego de entrada em %s", arquivo_captura);
+		} else {
+			registro(REGISTRO_ERRO, "Erro ao abrir arquivo de captura %s: %m", arquivo_captura);
+		}
+	}
+
+	if (porta_metricas > 0) {
+		if (metricas_iniciar_servidor(porta_metricas, coletar_metricas_servidor, NULL)) {
+			registro(REGISTRO_INFO, "Métricas em http://127.0.0.1:%d/metrics", porta_metricas);
+		} else {
+			registro(REGISTRO_ERRO, "Erro ao iniciar endpoint de métricas: %m");
+		}
+	}
+
+	if (caminho_transferencia) {
+		if (iniciar_transferencia(caminho_transferencia)) {
+			registro(REGISTRO_INFO, "Aceitando transferência para um novo processo em %s", caminho_transferencia);
+		} else {
+			registro(REGISTRO_ERRO, "Erro ao escutar pedidos de transferência em %s: %m", caminho_transferencia);
+		}
+	}
+
+	if (modo_io != IO_THREADS) {
+		int resultado = executar_reatores();
+		registro_descarregar();
+		return resultado;
+	}
+
+	int server_socket = criar_socket_escuta(porta, false);
+	if (server_socket < 0) {
+		registro_descarregar();
+		return 1;
+	}
+
+	// No modo threads o único worker não escuta: só escreve nos sockets
+	workers = calloc(1, sizeof(Worker));
+	if (!workers || !iniciar_worker(&workers[0], 0, -1, -1)) {
+		registro_descarregar();
 		return 1;
 	}
+	pthread_create(&workers[0].thread, NULL, executar_worker, &workers[0]);
 
-	printf("Servidor rodando! Aguardando conexões...\n");
+	registro(REGISTRO_INFO, "Servidor rodando com %d executor(es) de salas! Aguardando conexões...", num_executores);
 
 	while (1) {
 		struct sockaddr_in client_addr;
@@ -774,9 +3188,10 @@ int main(int argc, char* argv[]) {
 
 		int client_socket = accept(server_socket, (struct sockaddr*)&client_addr, &client_len);
 		if (client_socket < 0) {
-			perror("Erro ao aceitar conexão");
+			registro(REGISTRO_ERRO, "Erro ao aceitar conexão: %m");
 			continue;
 		}
+		metricas_conexao_aceita();
 
 		int* socket_ptr = malloc(sizeof(int));
 		*socket_ptr = client_socket;
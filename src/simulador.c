@@ -0,0 +1,207 @@
+#include "simulador.h"
+
+#include <string.h>
+
+// Limite de segurança contra políticas que nunca fazem a partida avançar
+#define MAX_ACOES_PARTIDA 100000
+
+static Jogador* jogador_do_jogo(Jogo* jogo, int jogador) {
+	return (jogador == 1) ? &jogo->jogador1 : &jogo->jogador2;
+}
+
+// Jogador que deve agir agora: quem responde um canto pendente, ou quem tem a vez
+static int jogador_da_vez(Jogo* jogo) {
+	if (jogo->aguardando_resposta_truco) return (jogo->ultimo_a_aumentar_truco == 1) ? 2 : 1;
+	if (jogo->aguardando_resposta_envido) return (jogo->ultimo_a_aumentar_envido == 1) ? 2 : 1;
+	return jogo->vez_jogador;
+}
+
+// Aplica a ação; false se ela não era válida no estado atual
+static bool aplicar_acao(Jogo* jogo, int jogador, Acao acao) {
+	switch (acao.tipo) {
+		case ACAO_JOGAR_CARTA:
+			return jogar_carta(jogo, jogador, acao.valor);
+		case ACAO_CANTAR_TRUCO:
+			return cantar_truco(jogo, jogador);
+		case ACAO_CANTAR_ENVIDO:
+			return cantar_envido(jogo, jogador);
+		case ACAO_CANTAR_FLOR:
+			return cantar_flor(jogo, jogador);
+		case ACAO_IR_BARALHO:
+			if (!pode_ir_baralho(jogo, jogador)) return false;
+			ir_baralho(jogo, jogador);
+			return true;
+		case ACAO_RESPONDER_TRUCO:
+			if (!jogo->aguardando_resposta_truco) return false;
+			responder_truco(jogo, jogador, (RespostaTruco)acao.valor);
+			return true;
+		case ACAO_RESPONDER_ENVIDO:
+			if (!jogo->aguardando_resposta_envido) return false;
+			responder_envido(jogo, jogador, (RespostaEnvido)acao.valor);
+			return true;
+	}
+	return false;
+}
+
+// Usada quando a política devolve algo inválido: a partida sempre avança
+static Acao acao_padrao(Jogo* jogo) {
+	Acao acao = {ACAO_JOGAR_CARTA, 0};
+	if (jogo->aguardando_resposta_truco) {
+		acao.tipo = ACAO_RESPONDER_TRUCO;
+		acao.valor = RESPOSTA_QUERO;
+	} else if (jogo->aguardando_resposta_envido) {
+		acao.tipo = ACAO_RESPONDER_ENVIDO;
+		acao.valor = ENVIDO_QUERO;
+	}
+	return acao;
+}
+
+ResultadoPartida simular_partida(Jogo* jogo, const Politica politicas[2], uint64_t semente) {
+	ResultadoPartida resultado;
+	memset(&resultado, 0, sizeof(ResultadoPartida));
+
+	inicializar_jogo(jogo, 0, semente);
+	jogo->jogador1.id = 1;
+	jogo->jogador2.id = 2;
+	inicializar_baralho(&jogo->baralho);
+	distribuir_cartas(jogo);
+
+	// As políticas sorteiam de uma sequência separada da usada no baralho
+	GeradorAleatorio gerador;
+	gerador_semear(&gerador, misturar_semente(semente));
+
+	while (!jogo->partida_finalizada && resultado.acoes < MAX_ACOES_PARTIDA) {
+		int jogador = jogador_da_vez(jogo);
+		const Politica* politica = &politicas[jogador - 1];
+
+		Acao acao = politica->decidir(jogo, jogador, &gerador, politica->contexto);
+		if (!aplicar_acao(jogo, jogador, acao)) {
+			aplicar_acao(jogo, jogador, acao_padrao(jogo));
+		}
+		resultado.acoes++;
+	}
+
+	resultado.vencedor = jogo->partida_finalizada ? jogo->vencedor_partida : 0;
+	resultado.pontos_jogador1 = jogo->pontos_jogador1;
+	resultado.pontos_jogador2 = jogo->pontos_jogador2;
+	return resultado;
+}
+
+// Política aleatória
+static Acao decidir_aleatoria(Jogo* jogo, int jogador, GeradorAleatorio* gerador, void* contexto) {
+	(void)contexto;
+	Acao acao = {ACAO_JOGAR_CARTA, 0};
+	uint32_t sorteio = gerador_intervalo(gerador, 100);
+
+	if (jogo->aguardando_resposta_truco) {
+		acao.tipo = ACAO_RESPONDER_TRUCO;
+		if (sorteio < 50) {
+			acao.valor = RESPOSTA_QUERO;
+		} else if (sorteio < 85 || jogo->valor_rodada >= 4) {
+			acao.valor = RESPOSTA_NAO_QUERO;
+		} else {
+			acao.valor = (jogo->valor_rodada < 3) ? RESPOSTA_RETRUCO : RESPOSTA_VALE_QUATRO;
+		}
+		return acao;
+	}
+
+	if (jogo->aguardando_resposta_envido) {
+		acao.tipo = ACAO_RESPONDER_ENVIDO;
+		if (sorteio < 50) {
+			acao.valor = ENVIDO_QUERO;
+		} else if (sorteio < 85 || jogo->valor_envido >= 4) {
+			acao.valor = ENVIDO_NAO_QUERO;
+		} else {
+			acao.valor = (jogo->valor_envido < 3) ? ENVIDO_REAL_ENVIDO : ENVIDO_FALTA_ENVIDO;
+		}
+		return acao;
+	}
+
+	if (pode_cantar_flor(jogo, jogador)) {
+		acao.tipo = ACAO_CANTAR_FLOR;
+	} else if (sorteio < 10 && pode_cantar_envido(jogo, jogador)) {
+		acao.tipo = ACAO_CANTAR_ENVIDO;
+	} else if (sorteio < 20 && pode_cantar_truco(jogo, jogador)) {
+		acao.tipo = ACAO_CANTAR_TRUCO;
+	} else if (sorteio < 21) {
+		acao.tipo = ACAO_IR_BARALHO;
+	} else {
+		acao.valor = (int)gerador_intervalo(gerador, (uint32_t)jogador_do_jogo(jogo, jogador)->num_cartas);
+	}
+	return acao;
+}
+
+// Política gulosa: canta com mão forte, aceita quando tem chance, joga a menor
+// carta que vence a da mesa (ou a menor de todas)
+static Acao decidir_gulosa(Jogo* jogo, int jogador, GeradorAleatorio* gerador, void* contexto) {
+	(void)gerador;
+	(void)contexto;
+	Acao acao = {ACAO_JOGAR_CARTA, 0};
+	Jogador* j = jogador_do_jogo(jogo, jogador);
+
+	int forca = 0;
+	int maior = 0;
+	for (int i = 0; i < j->num_cartas; i++) {
+		int valor = obter_valor_carta_truco(j->mao[i]);
+		forca += valor;
+		if (valor > maior) maior = valor;
+	}
+
+	if (jogo->aguardando_resposta_truco) {
+		acao.tipo = ACAO_RESPONDER_TRUCO;
+		acao.valor = (maior >= 10 || forca >= 7 * j->num_cartas) ? RESPOSTA_QUERO : RESPOSTA_NAO_QUERO;
+		return acao;
+	}
+
+	if (jogo->aguardando_resposta_envido) {
+		acao.tipo = ACAO_RESPONDER_ENVIDO;
+		acao.valor = (j->pontos_envido >= 27) ? ENVIDO_QUERO : ENVIDO_NAO_QUERO;
+		return acao;
+	}
+
+	if (pode_cantar_flor(jogo, jogador)) {
+		acao.tipo = ACAO_CANTAR_FLOR;
+		return acao;
+	}
+	if (j->pontos_envido >= 29 && pode_cantar_envido(jogo, jogador)) {
+		acao.tipo = ACAO_CANTAR_ENVIDO;
+		return acao;
+	}
+	if (maior >= 12 && pode_cantar_truco(jogo, jogador)) {
+		acao.tipo = ACAO_CANTAR_TRUCO;
+		return acao;
+	}
+
+	// Carta do oponente na mesa, se ele já jogou nesta rodada
+	Rodada* rodada = &jogo->rodadas[jogo->rodada_atual];
+	bool oponente_jogou = (jogador == 1) ? rodada->jogador2_jogou : rodada->jogador1_jogou;
+	int valor_mesa = 0;
+	if (oponente_jogou) {
+		valor_mesa = obter_valor_carta_truco((jogador == 1) ? rodada->carta_jogador2 : rodada->carta_jogador1);
+	}
+
+	int escolhida = -1, valor_escolhida = 0;
+	int menor = 0, valor_menor = 99;
+	for (int i = 0; i < j->num_cartas; i++) {
+		int valor = obter_valor_carta_truco(j->mao[i]);
+		if (valor < valor_menor) {
+			valor_menor = valor;
+			menor = i;
+		}
+		if (oponente_jogou && valor > valor_mesa && (escolhida < 0 || valor < valor_escolhida)) {
+			escolhida = i;
+			valor_escolhida = valor;
+		}
+	}
+	acao.valor = (escolhida >= 0) ? escolhida : menor;
+	return acao;
+}
+
+const Politica POLITICA_ALEATORIA = {"aleatoria", decidir_aleatoria, NULL};
+const Politica POLITICA_GULOSA = {"gulosa", decidir_gulosa, NULL};
+
+const Politica* politica_por_nome(const char* nome) {
+	if (strcmp(nome, POLITICA_ALEATORIA.nome) == 0) return &POLITICA_ALEATORIA;
+	if (strcmp(nome, POLITICA_GULOSA.nome) == 0) return &POLITICA_GULOSA;
+	return NULL;
+}
@@ -0,0 +1,106 @@
+#include "temporizadores.h"
+
+#define MASCARA_BALDE (RODA_BALDES - 1)
+
+void roda_inicializar(RodaTemporizadores* roda, uint64_t agora) {
+	roda->agora = agora;
+	roda->agendados = 0;
+	for (int nivel = 0; nivel < RODA_NIVEIS; nivel++) {
+		for (int balde = 0; balde < RODA_BALDES; balde++) {
+			Temporizador* sentinela = &roda->baldes[nivel][balde];
+			sentinela->proximo = sentinela;
+			sentinela->anterior = sentinela;
+		}
+	}
+}
+
+void temporizador_inicializar(Temporizador* temporizador) {
+	temporizador->proximo = NULL;
+	temporizador->anterior = NULL;
+	temporizador->expira = 0;
+}
+
+bool temporizador_agendado(const Temporizador* temporizador) {
+	return temporizador->anterior != NULL;
+}
+
+static void desligar(Temporizador* temporizador) {
+	temporizador->anterior->proximo = temporizador->proximo;
+	temporizador->proximo->anterior = temporizador->anterior;
+	temporizador->proximo = NULL;
+	temporizador->anterior = NULL;
+}
+
+// Escolhe o nível pela distância até o vencimento e o balde pelos bits do
+// próprio tick de vencimento naquele nível. Vencimentos além do último nível
+// ficam no último balde alcançável e são redistribuídos quando ele desce.
+static void inserir(RodaTemporizadores* roda, Temporizador* temporizador) {
+	uint64_t distancia = temporizador->expira - roda->agora;
+	int nivel = 0;
+	while (nivel < RODA_NIVEIS - 1 && distancia >= (1ull << (RODA_BITS_NIVEL * (nivel + 1)))) nivel++;
+
+	uint64_t expira = temporizador->expira;
+	uint64_t alcance = 1ull << (RODA_BITS_NIVEL * RODA_NIVEIS);
+	if (distancia >= alcance) expira = roda->agora + alcance - 1;
+
+	Temporizador* sentinela = &roda->baldes[nivel][(expira >> (RODA_BITS_NIVEL * nivel)) & MASCARA_BALDE];
+	temporizador->proximo = sentinela;
+	temporizador->anterior = sentinela->anterior;
+	sentinela->anterior->proximo = temporizador;
+	sentinela->anterior = temporizador;
+}
+
+void roda_agendar(RodaTemporizadores* roda, Temporizador* temporizador, uint64_t expira) {
+	if (temporizador_agendado(temporizador)) {
+		desligar(temporizador);
+	} else {
+		roda->agendados++;
+	}
+	temporizador->expira = expira > roda->agora ? expira : roda->agora + 1;
+	inserir(roda, temporizador);
+}
+
+void roda_cancelar(RodaTemporizadores* roda, Temporizador* temporizador) {
+	if (!temporizador_agendado(temporizador)) return;
+	desligar(temporizador);
+	roda->agendados--;
+}
+
+// Redistribui um balde de um nível de cima pelos níveis de baixo
+static void descer(RodaTemporizadores* roda, int nivel) {
+	Temporizador* sentinela = &roda->baldes[nivel][(roda->agora >> (RODA_BITS_NIVEL * nivel)) & MASCARA_BALDE];
+	Temporizador* temporizador = sentinela->proximo;
+	sentinela->proximo = sentinela;
+	sentinela->anterior = sentinela;
+
+	while (temporizador != sentinela) {
+		Temporizador* proximo = temporizador->proximo;
+		inserir(roda, temporizador);
+		temporizador = proximo;
+	}
+}
+
+void roda_avancar(RodaTemporizadores* roda, uint64_t agora, TemporizadorExpirou expirou, void* contexto) {
+	while (roda->agora < agora) {
+		// Roda vazia: nada a redistribuir, salta direto para o tick atual
+		if (roda->agendados == 0) {
+			roda->agora = agora;
+			return;
+		}
+
+		roda->agora++;
+		for (int nivel = 1; nivel < RODA_NIVEIS; nivel++) {
+			if (roda->agora & ((1ull << (RODA_BITS_NIVEL * nivel)) - 1)) break;
+			descer(roda, nivel);
+		}
+
+		// Reagendamentos feitos pelo callback vão para ticks futuros, então o laço termina
+		Temporizador* sentinela = &roda->baldes[0][roda->agora & MASCARA_BALDE];
+		while (sentinela->proximo != sentinela) {
+			Temporizador* temporizador = sentinela->proximo;
+			desligar(temporizador);
+			roda->agendados--;
+			expirou(temporizador, contexto);
+		}
+	}
+}
@@ -0,0 +1,278 @@
+#include "transferencia.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define TAMANHO_CABECALHO 20
+
+static void escrever_u32(uint8_t* saida, uint32_t valor) {
+	for (int i = 0; i < 4; i++) saida[i] = (uint8_t)(valor >> (8 * i));
+}
+
+static uint32_t ler_u32(const uint8_t* dados) {
+	uint32_t valor = 0;
+	for (int i = 0; i < 4; i++) valor |= (uint32_t)dados[i] << (8 * i);
+	return valor;
+}
+
+// Escritor
+
+static bool garantir_espaco(EscritorEstado* escritor, size_t adicional) {
+	if (escritor->erro) return false;
+	if (escritor->tamanho + adicional <= escritor->capacidade) return true;
+	size_t nova = escritor->capacidade ? escritor->capacidade * 2 : 4096;
+	while (nova < escritor->tamanho + adicional) nova *= 2;
+	uint8_t* dados = realloc(escritor->dados, nova);
+	if (!dados) {
+		escritor->erro = true;
+		return false;
+	}
+	escritor->dados = dados;
+	escritor->capacidade = nova;
+	return true;
+}
+
+void escritor_u8(EscritorEstado* escritor, uint8_t valor) {
+	if (!garantir_espaco(escritor, 1)) return;
+	escritor->dados[escritor->tamanho++] = valor;
+}
+
+void escritor_varint(EscritorEstado* escritor, uint64_t valor) {
+	if (!garantir_espaco(escritor, 10)) return;
+	while (valor >= 0x80) {
+		escritor->dados[escritor->tamanho++] = (uint8_t)(valor | 0x80);
+		valor >>= 7;
+	}
+	escritor->dados[escritor->tamanho++] = (uint8_t)valor;
+}
+
+void escritor_u64(EscritorEstado* escritor, uint64_t valor) {
+	if (!garantir_espaco(escritor, 8)) return;
+	for (int i = 0; i < 8; i++) escritor->dados[escritor->tamanho++] = (uint8_t)(valor >> (8 * i));
+}
+
+void escritor_bytes(EscritorEstado* escritor, const void* dados, size_t tamanho) {
+	if (tamanho == 0 || !garantir_espaco(escritor, tamanho)) return;
+	memcpy(escritor->dados + escritor->tamanho, dados, tamanho);
+	escritor->tamanho += tamanho;
+}
+
+uint8_t* escritor_reservar(EscritorEstado* escritor, size_t tamanho) {
+	if (!garantir_espaco(escritor, tamanho)) return NULL;
+	uint8_t* dados = escritor->dados + escritor->tamanho;
+	escritor->tamanho += tamanho;
+	return dados;
+}
+
+void escritor_liberar(EscritorEstado* escritor) {
+	free(escritor->dados);
+	memset(escritor, 0, sizeof(*escritor));
+}
+
+// Leitor
+
+uint8_t leitor_u8(LeitorEstado* leitor) {
+	if (leitor->erro || leitor->posicao >= leitor->tamanho) {
+		leitor->erro = true;
+		return 0;
+	}
+	return leitor->dados[leitor->posicao++];
+}
+
+uint64_t leitor_varint(LeitorEstado* leitor) {
+	uint64_t valor = 0;
+	for (int deslocamento = 0; deslocamento < 64; deslocamento += 7) {
+		uint8_t byte = leitor_u8(leitor);
+		if (leitor->erro) return 0;
+		valor |= (uint64_t)(byte & 0x7F) << deslocamento;
+		if (!(byte & 0x80)) return valor;
+	}
+	leitor->erro = true;
+	return 0;
+}
+
+uint64_t leitor_u64(LeitorEstado* leitor) {
+	const uint8_t* dados = leitor_bytes(leitor, 8);
+	if (!dados) return 0;
+	uint64_t valor = 0;
+	for (int i = 0; i < 8; i++) valor |= (uint64_t)dados[i] << (8 * i);
+	return valor;
+}
+
+const uint8_t* leitor_bytes(LeitorEstado* leitor, size_t tamanho) {
+	if (leitor->erro || tamanho > leitor->tamanho - leitor->posicao) {
+		leitor->erro = true;
+		return NULL;
+	}
+	const uint8_t* dados = leitor->dados + leitor->posicao;
+	leitor->posicao += tamanho;
+	return dados;
+}
+
+// Socket
+
+static bool montar_endereco(const char* caminho, struct sockaddr_un* endereco) {
+	memset(endereco, 0, sizeof(*endereco));
+	endereco->sun_family = AF_UNIX;
+	if (strlen(caminho) >= sizeof(endereco->sun_path)) {
+		errno = ENAMETOOLONG;
+		return false;
+	}
+	strcpy(endereco->sun_path, caminho);
+	return true;
+}
+
+int transferencia_escutar(const char* caminho) {
+	struct sockaddr_un endereco;
+	if (!montar_endereco(caminho, &endereco)) return -1;
+	int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (fd < 0) return -1;
+	unlink(caminho);
+	if (bind(fd, (struct sockaddr*)&endereco, sizeof(endereco)) < 0 || listen(fd, 1) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+int transferencia_conectar(const char* caminho) {
+	struct sockaddr_un endereco;
+	if (!montar_endereco(caminho, &endereco)) return -1;
+	int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (fd < 0) return -1;
+	if (connect(fd, (struct sockaddr*)&endereco, sizeof(endereco)) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static bool enviar_mensagem(int conexao, const void* dados, size_t tamanho, const int* fds, size_t num_fds) {
+	struct iovec iov = {.iov_base = (void*)dados, .iov_len = tamanho};
+	struct msghdr mensagem = {.msg_iov = &iov, .msg_iovlen = 1};
+	union {
+		char buffer[CMSG_SPACE(sizeof(int) * TRANSFERENCIA_FDS_POR_LOTE)];
+		struct cmsghdr alinhamento;
+	} controle;
+	if (num_fds > 0) {
+		mensagem.msg_control = controle.buffer;
+		mensagem.msg_controllen = CMSG_SPACE(sizeof(int) * num_fds);
+		struct cmsghdr* cmsg = CMSG_FIRSTHDR(&mensagem);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int) * num_fds);
+		memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * num_fds);
+	}
+	ssize_t enviados;
+	do {
+		enviados = sendmsg(conexao, &mensagem, MSG_NOSIGNAL);
+	} while (enviados < 0 && errno == EINTR);
+	return enviados == (ssize_t)tamanho;
+}
+
+bool transferencia_enviar(int conexao, const int* fds, size_t num_fds, const uint8_t* dados, size_t tamanho) {
+	uint8_t cabecalho[TAMANHO_CABECALHO];
+	escrever_u32(cabecalho, TRANSFERENCIA_MAGICA);
+	escrever_u32(cabecalho + 4, TRANSFERENCIA_VERSAO);
+	escrever_u32(cabecalho + 8, (uint32_t)num_fds);
+	escrever_u32(cabecalho + 12, (uint32_t)tamanho);
+	escrever_u32(cabecalho + 16, (uint32_t)((uint64_t)tamanho >> 32));
+	if (!enviar_mensagem(conexao, cabecalho, sizeof(cabecalho), NULL, 0)) return false;
+
+	for (size_t i = 0; i < num_fds; i += TRANSFERENCIA_FDS_POR_LOTE) {
+		size_t lote = num_fds - i < TRANSFERENCIA_FDS_POR_LOTE ? num_fds - i : TRANSFERENCIA_FDS_POR_LOTE;
+		uint8_t quantidade[4];
+		escrever_u32(quantidade, (uint32_t)lote);
+		if (!enviar_mensagem(conexao, quantidade, sizeof(quantidade), fds + i, lote)) return false;
+	}
+
+	for (size_t i = 0; i < tamanho; i += TRANSFERENCIA_TAMANHO_PEDACO) {
+		size_t pedaco = tamanho - i < TRANSFERENCIA_TAMANHO_PEDACO ? tamanho - i : TRANSFERENCIA_TAMANHO_PEDACO;
+		if (!enviar_mensagem(conexao, dados + i, pedaco, NULL, 0)) return false;
+	}
+	return true;
+}
+
+// Recebe uma mensagem inteira; retorna o tamanho ou -1. Os fds que vierem
+// junto são acrescentados em fds a partir de *num_fds.
+static ssize_t receber_mensagem(int conexao, void* buffer, size_t capacidade, int* fds, size_t* num_fds,
+                                size_t max_fds) {
+	struct iovec iov = {.iov_base = buffer, .iov_len = capacidade};
+	union {
+		char buffer[CMSG_SPACE(sizeof(int) * TRANSFERENCIA_FDS_POR_LOTE)];
+		struct cmsghdr alinhamento;
+	} controle;
+	struct msghdr mensagem = {.msg_iov = &iov,
+	                          .msg_iovlen = 1,
+	                          .msg_control = controle.buffer,
+	                          .msg_controllen = sizeof(controle.buffer)};
+	ssize_t recebidos;
+	do {
+		recebidos = recvmsg(conexao, &mensagem, MSG_CMSG_CLOEXEC);
+	} while (recebidos < 0 && errno == EINTR);
+	if (recebidos <= 0) return -1;
+
+	bool erro = (mensagem.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) != 0;
+	for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&mensagem); cmsg; cmsg = CMSG_NXTHDR(&mensagem, cmsg)) {
+		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+		size_t n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		int* recebidos_fds = (int*)CMSG_DATA(cmsg);
+		for (size_t i = 0; i < n; i++) {
+			// fds além do anunciado não têm dono: fecha para não vazar
+			if (fds && *num_fds < max_fds) fds[(*num_fds)++] = recebidos_fds[i];
+			else {
+				close(recebidos_fds[i]);
+				erro = true;
+			}
+		}
+	}
+	return erro ? -1 : recebidos;
+}
+
+bool transferencia_receber(int conexao, int** fds_saida, size_t* num_fds_saida, uint8_t** dados_saida,
+                           size_t* tamanho_saida) {
+	uint8_t cabecalho[TAMANHO_CABECALHO];
+	size_t nenhum = 0;
+	if (receber_mensagem(conexao, cabecalho, sizeof(cabecalho), NULL, &nenhum, 0) != TAMANHO_CABECALHO) return false;
+	if (ler_u32(cabecalho) != TRANSFERENCIA_MAGICA || ler_u32(cabecalho + 4) != TRANSFERENCIA_VERSAO) return false;
+	size_t num_fds = ler_u32(cabecalho + 8);
+	uint64_t tamanho = ler_u32(cabecalho + 12) | ((uint64_t)ler_u32(cabecalho + 16) << 32);
+	if (tamanho > SIZE_MAX / 2) return false;
+
+	int* fds = malloc(sizeof(int) * (num_fds ? num_fds : 1));
+	uint8_t* dados = malloc(tamanho ? tamanho : 1);
+	size_t recebidos_fds = 0;
+	bool ok = fds && dados;
+
+	while (ok && recebidos_fds < num_fds) {
+		uint8_t quantidade[4];
+		size_t antes = recebidos_fds;
+		ssize_t n = receber_mensagem(conexao, quantidade, sizeof(quantidade), fds, &recebidos_fds, num_fds);
+		ok = n == (ssize_t)sizeof(quantidade) && recebidos_fds - antes == ler_u32(quantidade) && recebidos_fds > antes;
+	}
+
+	size_t recebidos = 0;
+	while (ok && recebidos < tamanho) {
+		size_t resta = tamanho - recebidos;
+		size_t pedaco = resta < TRANSFERENCIA_TAMANHO_PEDACO ? resta : TRANSFERENCIA_TAMANHO_PEDACO;
+		ssize_t n = receber_mensagem(conexao, dados + recebidos, pedaco, NULL, &nenhum, 0);
+		ok = n > 0;
+		if (ok) recebidos += (size_t)n;
+	}
+
+	if (!ok) {
+		for (size_t i = 0; i < recebidos_fds; i++) close(fds[i]);
+		free(fds);
+		free(dados);
+		return false;
+	}
+	*fds_saida = fds;
+	*num_fds_saida = num_fds;
+	*dados_saida = dados;
+	*tamanho_saida = tamanho;
+	return true;
+}
@@ -0,0 +1,777 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "game_logic.h"
+#include "histograma.h"
+#include "protocolo.h"
+
+// Gerador de carga: bots sem interface que jogam partidas reais contra o
+// servidor. Os bots andam em pares (um cria a sala, o outro entra), cada par
+// fica numa thread com seu próprio epoll, e a latência de ida e volta de cada
+// pedido é registrada por tipo de mensagem até a resposta correspondente.
+
+#define MAX_EVENTOS_EPOLL 256
+#define TAMANHO_ENTRADA_BOT (4 * sizeof(Mensagem))
+#define TAMANHO_SAIDA_BOT (2 * sizeof(Mensagem))
+#define TIMEOUT_PEDIDO_NS 5000000000ull  // Pedido sem resposta após 5 s conta como timeout
+#define ATRASO_RECONEXAO_NS 1000000000ull
+#define NUM_TIPOS_MEDIDOS (MSG_PONG + 1)
+
+typedef enum {
+	BOT_DESCONECTADO,
+	BOT_CONECTANDO,   // Aguardando o MSG_CONECTAR inicial do servidor
+	BOT_NEGOCIANDO,   // Aguardando a resposta da negociação de capacidades
+	BOT_OCIOSO,       // No lobby, esperando o parceiro
+	BOT_NA_SALA,      // Criou (ou está entrando em) uma sala
+	BOT_EM_PARTIDA,
+	BOT_SAINDO        // Enviou MSG_SAIR_SALA após o fim da partida
+} EstadoBot;
+
+typedef struct ThreadCarga ThreadCarga;
+
+typedef struct Bot {
+	struct Bot* parceiro;
+	ThreadCarga* thread;
+	int numero;
+	int fd;
+	bool criador;
+	EstadoBot estado;
+	uint32_t id;
+	uint32_t sala_id;
+	bool compacto;
+
+	EstadoJogo jogo;
+	bool tem_estado;
+	TipoMensagem canto_atual;     // Canto em disputa (MSG_TRUCO ou MSG_ENVIDO); aumentos não são anunciados
+	bool aguardando_oponente;     // Cantamos e o oponente ainda não respondeu
+
+	// Pedido em voo cuja latência está sendo medida
+	bool tem_pendente;
+	TipoMensagem pendente;
+	uint64_t enviado_em;
+
+	uint64_t prazo;  // Próximo timer (reconexão ou jogada)
+	int posicao_heap;
+
+	uint8_t entrada[TAMANHO_ENTRADA_BOT];
+	size_t tamanho_entrada;
+	uint8_t saida[TAMANHO_SAIDA_BOT];
+	size_t tamanho_saida;
+} Bot;
+
+struct ThreadCarga {
+	pthread_t thread;
+	int epoll_fd;
+	Bot* bots;
+	int num_bots;
+	Bot** heap;  // Min-heap de timers por prazo
+	int tamanho_heap;
+	GeradorAleatorio gerador;
+	Histograma* latencias;  // Um por TipoMensagem
+
+	// Escritos só pela thread, lidos pelo relatório de progresso
+	_Atomic uint64_t enviadas;
+	_Atomic uint64_t recebidas;
+	_Atomic uint64_t partidas;
+	_Atomic uint64_t conectados;
+	_Atomic uint64_t timeouts;
+	_Atomic uint64_t erros;
+};
+
+static struct {
+	struct sockaddr_in endereco;
+	int conexoes;
+	int num_threads;
+	uint64_t pensar_ns;  // Tempo médio de "pensar" antes de cada jogada
+	uint64_t rampa_ns;   // Intervalo em que as conexões são abertas
+	int duracao_s;
+	bool legado;         // Sem negociação: quadros legados e snapshots completos
+	uint64_t semente;
+} config;
+
+static _Atomic bool parar = false;
+
+static uint64_t agora_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void contar(_Atomic uint64_t* contador) {
+	atomic_store_explicit(contador, atomic_load_explicit(contador, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+// Heap de timers
+static void trocar_heap(ThreadCarga* t, int a, int b) {
+	Bot* temp = t->heap[a];
+	t->heap[a] = t->heap[b];
+	t->heap[b] = temp;
+	t->heap[a]->posicao_heap = a;
+	t->heap[b]->posicao_heap = b;
+}
+
+static void subir_heap(ThreadCarga* t, int i) {
+	while (i > 0 && t->heap[(i - 1) / 2]->prazo > t->heap[i]->prazo) {
+		trocar_heap(t, i, (i - 1) / 2);
+		i = (i - 1) / 2;
+	}
+}
+
+static void descer_heap(ThreadCarga* t, int i) {
+	while (1) {
+		int menor = i;
+		int esquerda = 2 * i + 1, direita = 2 * i + 2;
+		if (esquerda < t->tamanho_heap && t->heap[esquerda]->prazo < t->heap[menor]->prazo) menor = esquerda;
+		if (direita < t->tamanho_heap && t->heap[direita]->prazo < t->heap[menor]->prazo) menor = direita;
+		if (menor == i) return;
+		trocar_heap(t, i, menor);
+		i = menor;
+	}
+}
+
+static void agendar(Bot* bot, uint64_t prazo) {
+	ThreadCarga* t = bot->thread;
+	bot->prazo = prazo;
+	if (bot->posicao_heap < 0) {
+		bot->posicao_heap = t->tamanho_heap;
+		t->heap[t->tamanho_heap++] = bot;
+	}
+	subir_heap(t, bot->posicao_heap);
+	descer_heap(t, bot->posicao_heap);
+}
+
+static void cancelar_timer(Bot* bot) {
+	ThreadCarga* t = bot->thread;
+	int i = bot->posicao_heap;
+	if (i < 0) return;
+
+	bot->posicao_heap = -1;
+	t->tamanho_heap--;
+	if (i == t->tamanho_heap) return;
+
+	t->heap[i] = t->heap[t->tamanho_heap];
+	t->heap[i]->posicao_heap = i;
+	subir_heap(t, i);
+	descer_heap(t, i);
+}
+
+static void desconectar_bot(Bot* bot, bool por_erro);
+
+// Envia o que couber da saída; o restante segue no próximo EPOLLOUT
+static void descarregar_saida(Bot* bot) {
+	size_t enviados = 0;
+	while (enviados < bot->tamanho_saida) {
+		ssize_t n = send(bot->fd, bot->saida + enviados, bot->tamanho_saida - enviados, MSG_NOSIGNAL);
+		if (n > 0) {
+			enviados += (size_t)n;
+		} else if (n < 0 && errno == EINTR) {
+			continue;
+		} else {
+			if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+				desconectar_bot(bot, true);
+				return;
+			}
+			break;
+		}
+	}
+	memmove(bot->saida, bot->saida + enviados, bot->tamanho_saida - enviados);
+	bot->tamanho_saida -= enviados;
+}
+
+// Enfileira uma mensagem; se `medir`, ela vira o pedido pendente do bot
+static void enviar(Bot* bot, TipoMensagem tipo, const void* dados, uint32_t tamanho, bool medir) {
+	Mensagem msg;
+	memset(&msg, 0, sizeof(Mensagem));
+	msg.tipo = tipo;
+	msg.sala_id = bot->sala_id;
+	msg.jogador_id = bot->id;
+	if (tamanho > 0) memcpy(msg.dados, dados, tamanho);
+	msg.tamanho_dados = tamanho;
+
+	// A negociação vai sempre no formato legado: o servidor ainda não sabe o que aceitamos
+	bool compacto = bot->compacto && tipo != MSG_CONECTAR;
+	if (bot->tamanho_saida + PROTOCOLO_TAMANHO_MAX_QUADRO > sizeof(bot->saida)) {
+		desconectar_bot(bot, true);
+		return;
+	}
+	bot->tamanho_saida += protocolo_codificar(&msg, compacto, bot->saida + bot->tamanho_saida);
+	contar(&bot->thread->enviadas);
+
+	if (medir) {
+		bot->tem_pendente = true;
+		bot->pendente = tipo;
+		bot->enviado_em = agora_ns();
+	}
+	descarregar_saida(bot);
+}
+
+// Registra a latência do pedido pendente
+static void concluir_pendente(Bot* bot) {
+	if (!bot->tem_pendente) return;
+	bot->tem_pendente = false;
+	histograma_registrar(&bot->thread->latencias[bot->pendente], (agora_ns() - bot->enviado_em) / 1000);
+}
+
+static uint64_t tempo_pensar(ThreadCarga* t) {
+	if (config.pensar_ns == 0) return 0;
+	// Uniforme em [0.5, 1.5] x o tempo médio
+	return config.pensar_ns / 2 + (uint64_t)gerador_intervalo(&t->gerador, 1000) * config.pensar_ns / 1000;
+}
+
+static void conectar_bot(Bot* bot) {
+	ThreadCarga* t = bot->thread;
+
+	int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if (fd < 0) {
+		contar(&t->erros);
+		agendar(bot, agora_ns() + ATRASO_RECONEXAO_NS);
+		return;
+	}
+	int sim = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &sim, sizeof(sim));
+
+	if (connect(fd, (struct sockaddr*)&config.endereco, sizeof(config.endereco)) < 0 && errno != EINPROGRESS) {
+		close(fd);
+		contar(&t->erros);
+		agendar(bot, agora_ns() + ATRASO_RECONEXAO_NS);
+		return;
+	}
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	ev.data.ptr = bot;
+	if (epoll_ctl(t->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		close(fd);
+		contar(&t->erros);
+		agendar(bot, agora_ns() + ATRASO_RECONEXAO_NS);
+		return;
+	}
+
+	bot->fd = fd;
+	bot->estado = BOT_CONECTANDO;
+	bot->id = 0;
+	bot->sala_id = 0;
+	bot->compacto = false;
+	bot->tem_estado = false;
+	bot->aguardando_oponente = false;
+	bot->tem_pendente = false;
+	bot->tamanho_entrada = 0;
+	bot->tamanho_saida = 0;
+}
+
+// Fecha a conexão do bot e a do parceiro (a sala deles não serve mais) e
+// agenda a reconexão dos dois
+static void desconectar_bot(Bot* bot, bool por_erro) {
+	if (bot->estado == BOT_DESCONECTADO) return;
+	if (por_erro) contar(&bot->thread->erros);
+
+	if (bot->estado >= BOT_NEGOCIANDO) {
+		atomic_fetch_sub_explicit(&bot->thread->conectados, 1, memory_order_relaxed);
+	}
+	close(bot->fd);
+	bot->fd = -1;
+	bot->estado = BOT_DESCONECTADO;
+	bot->tem_pendente = false;
+	cancelar_timer(bot);
+	if (!atomic_load_explicit(&parar, memory_order_relaxed)) {
+		agendar(bot, agora_ns() + ATRASO_RECONEXAO_NS);
+	}
+
+	desconectar_bot(bot->parceiro, false);
+}
+
+// Com os dois bots do par no lobby, o criador abre uma sala nova
+static void tentar_formar_par(Bot* bot) {
+	Bot* criador = bot->criador ? bot : bot->parceiro;
+	if (criador->estado != BOT_OCIOSO || criador->parceiro->estado != BOT_OCIOSO) return;
+	if (atomic_load_explicit(&parar, memory_order_relaxed)) return;
+
+	char nome[64];
+	memset(nome, 0, sizeof(nome));
+	snprintf(nome, sizeof(nome), "carga-%d", criador->numero);
+	criador->estado = BOT_NA_SALA;
+	enviar(criador, MSG_CRIAR_SALA, nome, sizeof(nome), true);
+}
+
+static void entrar_no_lobby(Bot* bot) {
+	bot->estado = BOT_OCIOSO;
+	bot->sala_id = 0;
+	bot->tem_estado = false;
+	bot->aguardando_oponente = false;
+	tentar_formar_par(bot);
+}
+
+static void sair_da_sala(Bot* bot) {
+	cancelar_timer(bot);
+	bot->tem_pendente = false;  // Uma jogada sem resposta não entra na medição
+	bot->estado = BOT_SAINDO;
+	enviar(bot, MSG_SAIR_SALA, NULL, 0, true);
+}
+
+static void encerrar_partida(Bot* bot) {
+	if (bot->criador) contar(&bot->thread->partidas);
+	sair_da_sala(bot);
+}
+
+// O bot age quando é a sua vez ou quando precisa responder a um canto
+static bool deve_agir(const Bot* bot) {
+	if (bot->estado != BOT_EM_PARTIDA || !bot->tem_estado) return false;
+	if (bot->tem_pendente || bot->aguardando_oponente) return false;
+	if (bot->jogo.aguardando_resposta) return true;
+	return bot->jogo.vez_jogador == 1 && bot->jogo.num_cartas_mao > 0;
+}
+
+static void agendar_jogada(Bot* bot) {
+	if (deve_agir(bot)) agendar(bot, agora_ns() + tempo_pensar(bot->thread));
+}
+
+// Escolhe uma jogada legal a partir do último EstadoJogo recebido
+static void jogar(Bot* bot) {
+	if (!deve_agir(bot)) return;
+
+	GeradorAleatorio* gerador = &bot->thread->gerador;
+	const EstadoJogo* jogo = &bot->jogo;
+	uint32_t sorteio = gerador_intervalo(gerador, 100);
+
+	if (jogo->aguardando_resposta) {
+		int32_t resposta;
+		if (bot->canto_atual == MSG_ENVIDO) {
+			bool pode_aumentar = jogo->valor_envido < 4;
+			resposta = (sorteio < 60) ? ENVIDO_QUERO : (sorteio < 90 || !pode_aumentar) ? ENVIDO_NAO_QUERO
+			           : (jogo->valor_envido < 3)                                   ? ENVIDO_REAL_ENVIDO
+			                                                                        : ENVIDO_FALTA_ENVIDO;
+			bot->aguardando_oponente = resposta >= ENVIDO_REAL_ENVIDO;
+			enviar(bot, MSG_RESPOSTA_ENVIDO, &resposta, sizeof(resposta), true);
+		} else {
+			bool pode_aumentar = jogo->valor_rodada < 4;
+			resposta = (sorteio < 60) ? RESPOSTA_QUERO : (sorteio < 90 || !pode_aumentar) ? RESPOSTA_NAO_QUERO
+			           : (jogo->valor_rodada < 3)                                     ? RESPOSTA_RETRUCO
+			                                                                          : RESPOSTA_VALE_QUATRO;
+			bot->aguardando_oponente = resposta >= RESPOSTA_RETRUCO;
+			enviar(bot, MSG_RESPOSTA_TRUCO, &resposta, sizeof(resposta), true);
+		}
+		return;
+	}
+
+	if (jogo->pode_cantar_flor) {
+		enviar(bot, MSG_FLOR, NULL, 0, true);
+	} else if (sorteio < 5 && jogo->pode_cantar_envido) {
+		bot->aguardando_oponente = true;
+		bot->canto_atual = MSG_ENVIDO;
+		enviar(bot, MSG_ENVIDO, NULL, 0, true);
+	} else if (sorteio < 10 && jogo->pode_cantar_truco) {
+		bot->aguardando_oponente = true;
+		bot->canto_atual = MSG_TRUCO;
+		enviar(bot, MSG_TRUCO, NULL, 0, true);
+	} else {
+		int32_t indice = (int32_t)gerador_intervalo(gerador, jogo->num_cartas_mao);
+		enviar(bot, MSG_JOGAR_CARTA, &indice, sizeof(indice), true);
+	}
+}
+
+static void receber_estado(Bot* bot, const Mensagem* msg) {
+	if (msg->tipo == MSG_ESTADO_JOGO) {
+		memcpy(&bot->jogo, msg->dados, sizeof(EstadoJogo));
+		bot->tem_estado = true;
+	} else if (!bot->tem_estado || !estado_delta_aplicar(&bot->jogo, msg->dados, msg->tamanho_dados)) {
+		desconectar_bot(bot, true);
+		return;
+	}
+
+	// Resposta à nossa jogada, ou o oponente agiu
+	if (bot->tem_pendente) {
+		concluir_pendente(bot);
+	} else {
+		bot->aguardando_oponente = false;
+	}
+
+	// O servidor só manda MSG_FIM_PARTIDA quando a partida acaba numa carta ou
+	// numa resposta a truco/envido; decidida por flor ou ir ao baralho, o fim
+	// aparece apenas no placar
+	if (bot->jogo.pontos_jogador1 >= PONTOS_VITORIA || bot->jogo.pontos_jogador2 >= PONTOS_VITORIA) {
+		encerrar_partida(bot);
+		return;
+	}
+	agendar_jogada(bot);
+}
+
+static void processar_quadro(Bot* bot, const Mensagem* msg) {
+	ThreadCarga* t = bot->thread;
+	contar(&t->recebidas);
+
+	switch (msg->tipo) {
+		case MSG_PING:
+			enviar(bot, MSG_PONG, NULL, 0, false);
+			break;
+
+		case MSG_CONECTAR:
+			if (bot->estado == BOT_CONECTANDO) {
+				bot->id = msg->jogador_id;
+				atomic_fetch_add_explicit(&t->conectados, 1, memory_order_relaxed);
+				if (config.legado) {
+					entrar_no_lobby(bot);
+				} else {
+					uint32_t capacidades = CAP_QUADRO_COMPACTO | CAP_ESTADO_DELTA | CAP_HEARTBEAT;
+					bot->estado = BOT_NEGOCIANDO;
+					enviar(bot, MSG_CONECTAR, &capacidades, sizeof(capacidades), true);
+				}
+			} else if (bot->estado == BOT_NEGOCIANDO) {
+				concluir_pendente(bot);
+				uint32_t capacidades = 0;
+				memcpy(&capacidades, msg->dados, sizeof(capacidades));
+				bot->compacto = capacidades & CAP_QUADRO_COMPACTO;
+				entrar_no_lobby(bot);
+			} else if (bot->estado == BOT_SAINDO && msg->jogador_id == 0) {
+				concluir_pendente(bot);
+				entrar_no_lobby(bot);
+			}
+			break;
+
+		case MSG_CRIAR_SALA:
+			if (bot->estado != BOT_NA_SALA || !bot->criador) break;
+			concluir_pendente(bot);
+			bot->sala_id = msg->sala_id;
+			if (bot->parceiro->estado == BOT_OCIOSO) {
+				uint32_t sala_id = msg->sala_id;
+				bot->parceiro->estado = BOT_NA_SALA;
+				enviar(bot->parceiro, MSG_ENTRAR_SALA, &sala_id, sizeof(sala_id), true);
+			}
+			break;
+
+		case MSG_ENTRAR_SALA:
+			if (bot->estado != BOT_NA_SALA) break;
+			if (!bot->criador && bot->tem_pendente && bot->pendente == MSG_ENTRAR_SALA) {
+				// Confirmação para quem entrou; o estado inicial chega com o início da partida
+				concluir_pendente(bot);
+				bot->sala_id = msg->sala_id;
+				bot->estado = BOT_EM_PARTIDA;
+			} else if (bot->criador && msg->jogador_id != 0) {
+				// O parceiro entrou: começa a partida
+				bot->estado = BOT_EM_PARTIDA;
+				enviar(bot, MSG_INICIAR_PARTIDA, NULL, 0, true);
+			}
+			break;
+
+		case MSG_TRUCO:
+		case MSG_ENVIDO:
+			bot->canto_atual = msg->tipo;
+			break;
+
+		case MSG_ESTADO_JOGO:
+		case MSG_ESTADO_DELTA:
+			if (bot->estado == BOT_EM_PARTIDA) receber_estado(bot, msg);
+			break;
+
+		case MSG_FIM_PARTIDA:
+			if (bot->estado == BOT_EM_PARTIDA) encerrar_partida(bot);
+			break;
+
+		case MSG_ERRO:
+			// Sala cheia ou servidor sem capacidade: o par reconecta depois de um tempo
+			desconectar_bot(bot, true);
+			break;
+
+		default:
+			break;
+	}
+}
+
+static void ler_bot(Bot* bot) {
+	while (bot->estado != BOT_DESCONECTADO) {
+		ssize_t n = recv(bot->fd, bot->entrada + bot->tamanho_entrada, sizeof(bot->entrada) - bot->tamanho_entrada, 0);
+		if (n == 0) {
+			desconectar_bot(bot, true);
+			return;
+		}
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK) desconectar_bot(bot, true);
+			return;
+		}
+		bot->tamanho_entrada += (size_t)n;
+
+		size_t inicio = 0;
+		while (bot->estado != BOT_DESCONECTADO) {
+			Mensagem msg;
+			int consumidos = protocolo_decodificar(bot->entrada + inicio, bot->tamanho_entrada - inicio, &msg);
+			if (consumidos < 0) {
+				desconectar_bot(bot, true);
+				return;
+			}
+			if (consumidos == 0) break;
+			inicio += (size_t)consumidos;
+			processar_quadro(bot, &msg);
+		}
+		if (bot->estado == BOT_DESCONECTADO) return;
+
+		memmove(bot->entrada, bot->entrada + inicio, bot->tamanho_entrada - inicio);
+		bot->tamanho_entrada -= inicio;
+	}
+}
+
+// Pedidos (ou cantos) sem resposta: a jogada é refeita; fora da partida o par reconecta
+static void verificar_timeouts(ThreadCarga* t, uint64_t agora) {
+	for (int i = 0; i < t->num_bots; i++) {
+		Bot* bot = &t->bots[i];
+		if (!bot->tem_pendente && !bot->aguardando_oponente) continue;
+		if (agora < bot->enviado_em + TIMEOUT_PEDIDO_NS) continue;  // Pode ter sido enviado depois de `agora`
+
+		contar(&t->timeouts);
+		bot->tem_pendente = false;
+		if (bot->estado == BOT_EM_PARTIDA) {
+			bot->aguardando_oponente = false;
+			agendar_jogada(bot);
+		} else {
+			desconectar_bot(bot, false);
+		}
+	}
+}
+
+static void* executar_thread_carga(void* arg) {
+	ThreadCarga* t = (ThreadCarga*)arg;
+	struct epoll_event eventos[MAX_EVENTOS_EPOLL];
+	uint64_t proxima_verificacao = agora_ns() + 1000000000ull;
+
+	while (!atomic_load_explicit(&parar, memory_order_relaxed)) {
+		uint64_t agora = agora_ns();
+
+		// Timers vencidos: conexões da rampa, reconexões e jogadas
+		while (t->tamanho_heap > 0 && t->heap[0]->prazo <= agora) {
+			Bot* bot = t->heap[0];
+			cancelar_timer(bot);
+			if (bot->estado == BOT_DESCONECTADO) {
+				conectar_bot(bot);
+			} else {
+				jogar(bot);
+			}
+		}
+
+		if (agora >= proxima_verificacao) {
+			verificar_timeouts(t, agora);
+			proxima_verificacao = agora + 1000000000ull;
+		}
+
+		int espera_ms = 100;
+		if (t->tamanho_heap > 0) {
+			uint64_t falta = t->heap[0]->prazo > agora ? t->heap[0]->prazo - agora : 0;
+			if (falta / 1000000 < (uint64_t)espera_ms) espera_ms = (int)((falta + 999999) / 1000000);
+		}
+
+		int n = epoll_wait(t->epoll_fd, eventos, MAX_EVENTOS_EPOLL, espera_ms);
+		for (int i = 0; i < n; i++) {
+			Bot* bot = (Bot*)eventos[i].data.ptr;
+			if (bot->estado == BOT_DESCONECTADO) continue;
+
+			if (eventos[i].events & (EPOLLERR | EPOLLHUP)) {
+				desconectar_bot(bot, true);
+				continue;
+			}
+			if (eventos[i].events & EPOLLOUT && bot->tamanho_saida > 0) descarregar_saida(bot);
+			if (eventos[i].events & (EPOLLIN | EPOLLRDHUP)) ler_bot(bot);
+		}
+	}
+
+	for (int i = 0; i < t->num_bots; i++) {
+		if (t->bots[i].estado != BOT_DESCONECTADO) close(t->bots[i].fd);
+	}
+	return NULL;
+}
+
+static void imprimir_progresso(ThreadCarga* threads, double segundos, uint64_t* enviadas_antes) {
+	uint64_t enviadas = 0, recebidas = 0, partidas = 0, conectados = 0, timeouts = 0, erros = 0;
+	for (int i = 0; i < config.num_threads; i++) {
+		enviadas += atomic_load_explicit(&threads[i].enviadas, memory_order_relaxed);
+		recebidas += atomic_load_explicit(&threads[i].recebidas, memory_order_relaxed);
+		partidas += atomic_load_explicit(&threads[i].partidas, memory_order_relaxed);
+		conectados += atomic_load_explicit(&threads[i].conectados, memory_order_relaxed);
+		timeouts += atomic_load_explicit(&threads[i].timeouts, memory_order_relaxed);
+		erros += atomic_load_explicit(&threads[i].erros, memory_order_relaxed);
+	}
+	printf("[%5.1fs] conectados %llu, partidas %llu, enviadas %llu/s, recebidas %llu, timeouts %llu, erros %llu\n",
+	       segundos, (unsigned long long)conectados, (unsigned long long)partidas,
+	       (unsigned long long)(enviadas - *enviadas_antes), (unsigned long long)recebidas,
+	       (unsigned long long)timeouts, (unsigned long long)erros);
+	fflush(stdout);
+	*enviadas_antes = enviadas;
+}
+
+static void imprimir_relatorio(ThreadCarga* threads, double segundos) {
+	Histograma* total = calloc(NUM_TIPOS_MEDIDOS, sizeof(Histograma));
+	if (!total) return;
+
+	uint64_t enviadas = 0, recebidas = 0, partidas = 0, timeouts = 0, erros = 0;
+	for (int i = 0; i < config.num_threads; i++) {
+		for (int tipo = 0; tipo < NUM_TIPOS_MEDIDOS; tipo++) histograma_somar(&total[tipo], &threads[i].latencias[tipo]);
+		enviadas += threads[i].enviadas;
+		recebidas += threads[i].recebidas;
+		partidas += threads[i].partidas;
+		timeouts += threads[i].timeouts;
+		erros += threads[i].erros;
+	}
+
+	printf("\nLatência de ida e volta por tipo de pedido (µs):\n");
+	printf("%-18s %10s %10s %10s %10s %10s %10s\n", "pedido", "amostras", "média", "p50", "p99", "p999", "máx");
+	for (int tipo = 0; tipo < NUM_TIPOS_MEDIDOS; tipo++) {
+		Histograma* h = &total[tipo];
+		if (h->total == 0) continue;
+		printf("%-18s %10llu %10.0f %10llu %10llu %10llu %10llu\n", tipo_mensagem_para_string((TipoMensagem)tipo),
+		       (unsigned long long)h->total, histograma_media(h), (unsigned long long)histograma_percentil(h, 50),
+		       (unsigned long long)histograma_percentil(h, 99), (unsigned long long)histograma_percentil(h, 99.9),
+		       (unsigned long long)h->maximo);
+	}
+
+	printf("\nEm %.1f s: %llu mensagens enviadas (%.0f/s), %llu recebidas (%.0f/s), %llu partidas (%.1f/s)\n",
+	       segundos, (unsigned long long)enviadas, enviadas / segundos, (unsigned long long)recebidas,
+	       recebidas / segundos, (unsigned long long)partidas, partidas / segundos);
+	printf("Timeouts: %llu, erros: %llu\n", (unsigned long long)timeouts, (unsigned long long)erros);
+	free(total);
+}
+
+// Milhares de conexões precisam de mais descritores que o limite padrão
+static void aumentar_limite_descritores(void) {
+	struct rlimit limite;
+	if (getrlimit(RLIMIT_NOFILE, &limite) == 0 && limite.rlim_cur < limite.rlim_max) {
+		limite.rlim_cur = limite.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limite);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	const char* ip = "127.0.0.1";
+	int porta = PORTA_PADRAO;
+	config.conexoes = 100;
+	config.num_threads = 1;
+	config.pensar_ns = 50000000ull;
+	config.rampa_ns = 1000000000ull;
+	config.duracao_s = 10;
+	config.semente = 1;
+
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--servidor=", 11) == 0) {
+			ip = argv[i] + 11;
+		} else if (strncmp(argv[i], "--porta=", 8) == 0) {
+			porta = atoi(argv[i] + 8);
+		} else if (strncmp(argv[i], "--conexoes=", 11) == 0) {
+			config.conexoes = atoi(argv[i] + 11);
+		} else if (strncmp(argv[i], "--threads=", 10) == 0) {
+			// --threads=0 usa uma thread por núcleo
+			config.num_threads = atoi(argv[i] + 10);
+			if (config.num_threads <= 0) config.num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+		} else if (strncmp(argv[i], "--pensar=", 9) == 0) {
+			config.pensar_ns = strtoull(argv[i] + 9, NULL, 0) * 1000000ull;
+		} else if (strncmp(argv[i], "--rampa=", 8) == 0) {
+			config.rampa_ns = (uint64_t)(atof(argv[i] + 8) * 1e9);
+		} else if (strncmp(argv[i], "--duracao=", 10) == 0) {
+			config.duracao_s = atoi(argv[i] + 10);
+		} else if (strncmp(argv[i], "--semente=", 10) == 0) {
+			config.semente = strtoull(argv[i] + 10, NULL, 0);
+		} else if (strcmp(argv[i], "--legado") == 0) {
+			config.legado = true;
+		} else {
+			fprintf(stderr,
+			        "Uso: %s [--servidor=IP] [--porta=N] [--conexoes=N] [--threads=N] [--pensar=MS] "
+			        "[--rampa=S] [--duracao=S] [--semente=N] [--legado]\n",
+			        argv[0]);
+			return 1;
+		}
+	}
+
+	// Bots andam em pares
+	int num_pares = (config.conexoes + 1) / 2;
+	if (num_pares < 1) num_pares = 1;
+	config.conexoes = num_pares * 2;
+	if (config.num_threads > num_pares) config.num_threads = num_pares;
+	if (config.duracao_s <= 0) config.duracao_s = 1;
+
+	memset(&config.endereco, 0, sizeof(config.endereco));
+	config.endereco.sin_family = AF_INET;
+	config.endereco.sin_port = htons(porta);
+	if (inet_pton(AF_INET, ip, &config.endereco.sin_addr) <= 0) {
+		fprintf(stderr, "Endereço inválido: %s\n", ip);
+		return 1;
+	}
+	aumentar_limite_descritores();
+
+	ThreadCarga* threads = calloc(config.num_threads, sizeof(ThreadCarga));
+	if (!threads) return 1;
+
+	printf("Gerando carga em %s:%d: %d conexões em %d thread(s), pensar %llu ms, rampa %.1f s, %d s\n", ip, porta,
+	       config.conexoes, config.num_threads, (unsigned long long)(config.pensar_ns / 1000000),
+	       config.rampa_ns / 1e9, config.duracao_s);
+
+	uint64_t inicio = agora_ns();
+	for (int i = 0; i < config.num_threads; i++) {
+		ThreadCarga* t = &threads[i];
+		int pares_da_thread = num_pares / config.num_threads + (i < num_pares % config.num_threads);
+
+		t->num_bots = pares_da_thread * 2;
+		t->bots = calloc(t->num_bots, sizeof(Bot));
+		t->heap = calloc(t->num_bots, sizeof(Bot*));
+		t->latencias = calloc(NUM_TIPOS_MEDIDOS, sizeof(Histograma));
+		t->epoll_fd = epoll_create1(0);
+		if (!t->bots || !t->heap || !t->latencias || t->epoll_fd < 0) {
+			perror("Erro ao preparar thread de carga");
+			return 1;
+		}
+		gerador_semear(&t->gerador, misturar_semente(config.semente + (uint64_t)i));
+
+		for (int p = 0; p < pares_da_thread; p++) {
+			Bot* criador = &t->bots[2 * p];
+			Bot* convidado = &t->bots[2 * p + 1];
+			int par_global = p * config.num_threads + i;
+
+			for (int b = 0; b < 2; b++) {
+				Bot* bot = &t->bots[2 * p + b];
+				bot->thread = t;
+				bot->numero = 2 * par_global + b;
+				bot->fd = -1;
+				bot->estado = BOT_DESCONECTADO;
+				bot->posicao_heap = -1;
+			}
+			criador->criador = true;
+			criador->parceiro = convidado;
+			convidado->parceiro = criador;
+
+			// Rampa: os pares abrem conexão espalhados pelo intervalo
+			uint64_t atraso = config.rampa_ns * (uint64_t)par_global / (uint64_t)num_pares;
+			agendar(criador, inicio + atraso);
+			agendar(convidado, inicio + atraso);
+		}
+	}
+
+	for (int i = 0; i < config.num_threads; i++) {
+		pthread_create(&threads[i].thread, NULL, executar_thread_carga, &threads[i]);
+	}
+
+	uint64_t enviadas_antes = 0;
+	for (int s = 1; s <= config.duracao_s; s++) {
+		sleep(1);
+		imprimir_progresso(threads, (agora_ns() - inicio) / 1e9, &enviadas_antes);
+	}
+
+	atomic_store(&parar, true);
+	for (int i = 0; i < config.num_threads; i++) pthread_join(threads[i].thread, NULL);
+	imprimir_relatorio(threads, (agora_ns() - inicio) / 1e9);
+
+	for (int i = 0; i < config.num_threads; i++) {
+		close(threads[i].epoll_fd);
+		free(threads[i].bots);
+		free(threads[i].heap);
+		free(threads[i].latencias);
+	}
+	free(threads);
+	return 0;
+}
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "game_logic.h"
+#include "replay.h"
+
+// Reprodutor de partidas gravadas pelo servidor com --replay=ARQUIVO. Cada
+// partida é refeita a partir da semente e das ações, usando o game_logic.c
+// deste build, e o placar final é comparado com o gravado. Serve para resolver
+// disputas (--detalhar mostra cada jogada) e como corpus de regressão e de
+// desempenho para novas versões das regras (--repetir=N).
+
+typedef struct {
+	long partidas;
+	long abandonadas;
+	long divergentes;
+	long long acoes;
+} TotaisReplay;
+
+static double agora_segundos(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint8_t* ler_arquivo(const char* caminho, size_t* tamanho) {
+	FILE* arquivo = fopen(caminho, "rb");
+	if (!arquivo) return NULL;
+
+	uint8_t* dados = NULL;
+	if (fseek(arquivo, 0, SEEK_END) == 0) {
+		long fim = ftell(arquivo);
+		rewind(arquivo);
+		if (fim >= 0) {
+			dados = malloc(fim > 0 ? (size_t)fim : 1);
+			*tamanho = dados ? fread(dados, 1, (size_t)fim, arquivo) : 0;
+		}
+	}
+	fclose(arquivo);
+	return dados;
+}
+
+static void imprimir_cabecalho(const PartidaReplay* partida) {
+	time_t segundos = (time_t)(partida->cabecalho.inicio_us / 1000000);
+	struct tm data;
+	char inicio[32];
+	localtime_r(&segundos, &data);
+	strftime(inicio, sizeof(inicio), "%Y-%m-%d %H:%M:%S", &data);
+	printf("Sala %u, %s, jogadores %u x %u, semente %llu, %u ações\n", partida->cabecalho.sala_id, inicio,
+	       partida->cabecalho.jogador1_id, partida->cabecalho.jogador2_id,
+	       (unsigned long long)partida->cabecalho.semente, partida->num_acoes);
+}
+
+// Refaz uma partida; retorna false se o resultado diverge do gravado.
+// Com `relatar`, imprime as divergências; com `detalhar`, cada ação.
+static bool reproduzir(const PartidaReplay* partida, bool detalhar, bool relatar, long long* acoes) {
+	Jogo jogo;
+	replay_preparar_jogo(&jogo, &partida->cabecalho);
+	if (detalhar) imprimir_cabecalho(partida);
+
+	size_t cursor = 0;
+	uint64_t instante = 0;
+	uint32_t aplicadas = 0;
+	bool recusada = false;
+	AcaoReplay acao;
+	while (aplicadas < partida->num_acoes && replay_proxima_acao(partida, &cursor, &instante, &acao)) {
+		bool aceita = replay_aplicar(&jogo, &acao);
+		if (detalhar) {
+			printf("  %8.3f s  jogador %d  %-15s", instante / 1e6, acao.jogador, tipo_acao_replay_para_string(acao.tipo));
+			if (acao.tipo == REPLAY_JOGAR_CARTA || acao.tipo == REPLAY_RESPOSTA_TRUCO ||
+			    acao.tipo == REPLAY_RESPOSTA_ENVIDO || acao.tipo == REPLAY_RESPOSTA_FLOR) {
+				printf(" %u", acao.valor);
+			}
+			printf("  -> %d x %d%s\n", jogo.pontos_jogador1, jogo.pontos_jogador2, aceita ? "" : "  (recusada)");
+		}
+		if (!aceita) recusada = true;
+		aplicadas++;
+	}
+	*acoes += aplicadas;
+
+	int vencedor = jogo.partida_finalizada ? jogo.vencedor_partida : 0;
+	bool confere = aplicadas == partida->num_acoes && !recusada && vencedor == partida->final.vencedor &&
+	               jogo.pontos_jogador1 == partida->final.pontos_jogador1 &&
+	               jogo.pontos_jogador2 == partida->final.pontos_jogador2;
+
+	if (!confere && relatar) {
+		if (!detalhar) imprimir_cabecalho(partida);
+		printf("  DIVERGÊNCIA: gravado %d x %d (vencedor %d), reproduzido %d x %d (vencedor %d)%s%s\n",
+		       partida->final.pontos_jogador1, partida->final.pontos_jogador2, partida->final.vencedor,
+		       jogo.pontos_jogador1, jogo.pontos_jogador2, vencedor, recusada ? ", ação recusada" : "",
+		       aplicadas < partida->num_acoes ? ", ações truncadas" : "");
+	} else if (detalhar) {
+		printf("  Confere: %d x %d (vencedor %d)\n", jogo.pontos_jogador1, jogo.pontos_jogador2, vencedor);
+	}
+	return confere;
+}
+
+int main(int argc, char* argv[]) {
+	const char* caminho = NULL;
+	bool detalhar = false;
+	long sala = -1;
+	int repeticoes = 1;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--detalhar") == 0) {
+			detalhar = true;
+		} else if (strncmp(argv[i], "--sala=", 7) == 0) {
+			sala = strtol(argv[i] + 7, NULL, 0);
+		} else if (strncmp(argv[i], "--repetir=", 10) == 0) {
+			repeticoes = atoi(argv[i] + 10);
+			if (repeticoes < 1) repeticoes = 1;
+		} else if (argv[i][0] != '-' && !caminho) {
+			caminho = argv[i];
+		} else {
+			caminho = NULL;
+			break;
+		}
+	}
+	if (!caminho) {
+		fprintf(stderr, "Uso: %s ARQUIVO [--detalhar] [--sala=ID] [--repetir=N]\n", argv[0]);
+		return 1;
+	}
+
+	size_t tamanho = 0;
+	uint8_t* dados = ler_arquivo(caminho, &tamanho);
+	if (!dados) {
+		perror(caminho);
+		return 1;
+	}
+
+	TotaisReplay totais;
+	bool corrompido = false;
+	double inicio = agora_segundos();
+	for (int r = 0; r < repeticoes; r++) {
+		memset(&totais, 0, sizeof(TotaisReplay));
+		size_t posicao = 0;
+		PartidaReplay partida;
+		int lido;
+		while ((lido = replay_proxima_partida(dados, tamanho, &posicao, &partida)) == 1) {
+			if (sala >= 0 && partida.cabecalho.sala_id != (uint32_t)sala) continue;
+			totais.partidas++;
+			if (partida.final.vencedor == 0) totais.abandonadas++;
+			// Só a primeira passada detalha e relata divergências
+			if (!reproduzir(&partida, detalhar && r == 0, r == 0, &totais.acoes)) totais.divergentes++;
+		}
+		if (lido < 0) {
+			if (r == 0) fprintf(stderr, "Bloco corrompido ou truncado na posição %zu de %zu\n", posicao, tamanho);
+			corrompido = true;
+		}
+	}
+	double duracao = agora_segundos() - inicio;
+	if (duracao <= 0) duracao = 1e-9;
+
+	printf("Partidas: %ld (%ld abandonadas), ações: %lld\n", totais.partidas, totais.abandonadas, totais.acoes);
+	printf("Conferem: %ld, divergentes: %ld\n", totais.partidas - totais.divergentes, totais.divergentes);
+	printf("Reprodução: %d passada(s) em %.3f s (%.0f partidas/s, %.0f ações/s)\n", repeticoes, duracao,
+	       totais.partidas * repeticoes / duracao, totais.acoes * repeticoes / duracao);
+
+	free(dados);
+	return (totais.divergentes > 0 || corrompido) ? 1 : 0;
+}
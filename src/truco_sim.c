@@ -0,0 +1,129 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "game_logic.h"
+#include "simulador.h"
+
+// Simulador em lote: joga N partidas completas sem rede e mede a vazão do
+// motor de regras. A semente de cada partida depende só do seu número, então
+// o resultado agregado é o mesmo para qualquer quantidade de threads.
+
+typedef struct {
+	pthread_t thread;
+	int indice;
+	int num_threads;
+	long partidas;
+	uint64_t semente;
+	Politica politicas[2];
+
+	// Resultados da thread
+	long vitorias[3];  // [0] = partidas interrompidas
+	long long acoes;
+	long long pontos[2];
+} TrabalhoSimulacao;
+
+static void* executar_simulacao(void* arg) {
+	TrabalhoSimulacao* trabalho = (TrabalhoSimulacao*)arg;
+	Jogo jogo;  // Cada thread tem o seu; nada é compartilhado durante a simulação
+
+	for (long i = trabalho->indice; i < trabalho->partidas; i += trabalho->num_threads) {
+		uint64_t semente = misturar_semente(trabalho->semente + (uint64_t)i);
+		ResultadoPartida resultado = simular_partida(&jogo, trabalho->politicas, semente);
+		trabalho->vitorias[resultado.vencedor]++;
+		trabalho->acoes += resultado.acoes;
+		trabalho->pontos[0] += resultado.pontos_jogador1;
+		trabalho->pontos[1] += resultado.pontos_jogador2;
+	}
+	return NULL;
+}
+
+static double agora_segundos(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static const Politica* ler_politica(const char* nome) {
+	const Politica* politica = politica_por_nome(nome);
+	if (!politica) {
+		fprintf(stderr, "Política desconhecida: %s (use aleatoria ou gulosa)\n", nome);
+		exit(1);
+	}
+	return politica;
+}
+
+int main(int argc, char* argv[]) {
+	long partidas = 100000;
+	int num_threads = 1;
+	uint64_t semente = 1;
+	const Politica* politicas[2] = {&POLITICA_ALEATORIA, &POLITICA_ALEATORIA};
+
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--partidas=", 11) == 0) {
+			partidas = atol(argv[i] + 11);
+		} else if (strncmp(argv[i], "--threads=", 10) == 0) {
+			// --threads=0 usa uma thread por núcleo
+			num_threads = atoi(argv[i] + 10);
+			if (num_threads <= 0) num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+		} else if (strncmp(argv[i], "--semente=", 10) == 0) {
+			semente = strtoull(argv[i] + 10, NULL, 0);
+		} else if (strncmp(argv[i], "--politica1=", 12) == 0) {
+			politicas[0] = ler_politica(argv[i] + 12);
+		} else if (strncmp(argv[i], "--politica2=", 12) == 0) {
+			politicas[1] = ler_politica(argv[i] + 12);
+		} else {
+			fprintf(stderr,
+			        "Uso: %s [--partidas=N] [--threads=N] [--semente=N] "
+			        "[--politica1=aleatoria|gulosa] [--politica2=aleatoria|gulosa]\n",
+			        argv[0]);
+			return 1;
+		}
+	}
+	if (partidas <= 0) partidas = 1;
+	if (num_threads > partidas) num_threads = (int)partidas;
+
+	TrabalhoSimulacao* trabalhos = calloc(num_threads, sizeof(TrabalhoSimulacao));
+	if (!trabalhos) return 1;
+
+	printf("Simulando %ld partidas (%s x %s) em %d thread(s), semente %llu...\n", partidas,
+	       politicas[0]->nome, politicas[1]->nome, num_threads, (unsigned long long)semente);
+
+	double inicio = agora_segundos();
+	for (int i = 0; i < num_threads; i++) {
+		trabalhos[i].indice = i;
+		trabalhos[i].num_threads = num_threads;
+		trabalhos[i].partidas = partidas;
+		trabalhos[i].semente = semente;
+		trabalhos[i].politicas[0] = *politicas[0];
+		trabalhos[i].politicas[1] = *politicas[1];
+		pthread_create(&trabalhos[i].thread, NULL, executar_simulacao, &trabalhos[i]);
+	}
+
+	long vitorias[3] = {0, 0, 0};
+	long long acoes = 0, pontos[2] = {0, 0};
+	for (int i = 0; i < num_threads; i++) {
+		pthread_join(trabalhos[i].thread, NULL);
+		for (int v = 0; v < 3; v++) vitorias[v] += trabalhos[i].vitorias[v];
+		acoes += trabalhos[i].acoes;
+		pontos[0] += trabalhos[i].pontos[0];
+		pontos[1] += trabalhos[i].pontos[1];
+	}
+	double duracao = agora_segundos() - inicio;
+	if (duracao <= 0) duracao = 1e-9;
+
+	printf("Partidas: %ld em %.3f s (%.0f partidas/s, %.0f ações/s)\n", partidas, duracao,
+	       partidas / duracao, acoes / duracao);
+	printf("Vitórias: jogador 1 (%s) %ld (%.1f%%), jogador 2 (%s) %ld (%.1f%%)\n", politicas[0]->nome,
+	       vitorias[1], 100.0 * vitorias[1] / partidas, politicas[1]->nome, vitorias[2],
+	       100.0 * vitorias[2] / partidas);
+	printf("Média por partida: %.1f ações, %.1f x %.1f pontos\n", (double)acoes / partidas,
+	       (double)pontos[0] / partidas, (double)pontos[1] / partidas);
+	if (vitorias[0] > 0) printf("Partidas interrompidas: %ld\n", vitorias[0]);
+
+	free(trabalhos);
+	return 0;
+}
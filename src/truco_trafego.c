@@ -0,0 +1,864 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "captura.h"
+#include "common.h"
+#include "game_logic.h"
+#include "histograma.h"
+#include "protocolo.h"
+
+// Reprodutor de tráfego: refaz contra um servidor as sessões gravadas com
+// --captura, na cadência original (--velocidade=1), acelerada (10, 100...) ou
+// sem esperas (max), com várias cópias em paralelo. Cada cópia abre suas
+// próprias conexões e traduz os ids de sala capturados para os que o servidor
+// atribuir agora. Mede a latência vista pelo cliente (do envio até o quadro
+// seguinte da mesma conexão) e, com --metricas, a latência dentro do servidor
+// pela diferença dos histogramas de processar_mensagem antes e depois.
+
+#define MAX_EVENTOS_EPOLL 256
+#define TAMANHO_ENTRADA_CONEXAO (4 * sizeof(Mensagem))
+#define TAMANHO_SAIDA_CONEXAO (8 * sizeof(Mensagem))
+#define ESPERA_SALA_NS 2000000000ull    // ENTRAR_SALA espera até 2 s pelo id da sala nesta cópia
+#define NOVA_TENTATIVA_NS 5000000ull     // Intervalo entre tentativas de um envio adiado
+#define DRENAGEM_NS 500000000ull          // Espera pelas últimas respostas após o último evento
+#define MAX_SALAS_ESPERADAS 4
+#define NUM_TIPOS_MEDIDOS (MSG_PONG + 1)
+#define NUM_LIMITES_SERVIDOR 26  // Baldes le=2^10..2^34 ns e +Inf de /metrics
+
+// Evento de uma sessão capturada; o quadro aponta para o arquivo em memória
+typedef struct {
+	uint64_t instante_us;  // Relativo ao primeiro registro da captura
+	TipoRegistroCaptura tipo;
+	TipoMensagem tipo_msg;
+	const uint8_t* quadro;
+	uint32_t tamanho_quadro;
+	uint32_t sala_criada;  // MSG_CRIAR_SALA: id capturado da sala criada (0 = falhou)
+} EventoSessao;
+
+typedef struct {
+	uint32_t conexao;
+	EventoSessao* eventos;
+	uint32_t num_eventos;
+} Sessao;
+
+typedef struct {
+	uint32_t capturada;
+	uint32_t atual;
+} EntradaMapaSalas;
+
+typedef struct ThreadTrafego ThreadTrafego;
+
+// Ids de sala capturados -> ids desta cópia (endereçamento aberto)
+typedef struct {
+	EntradaMapaSalas* entradas;
+	uint32_t mascara;
+} Copia;
+
+typedef struct Conexao {
+	ThreadTrafego* thread;
+	Copia* copia;
+	const Sessao* sessao;
+	uint32_t proximo;  // Próximo evento da sessão
+	int fd;
+	bool compacto;
+	bool concluida;
+
+	uint64_t prazo;
+	int posicao_heap;
+	uint64_t adiada_desde;  // ENTRAR_SALA aguardando o id da sala, 0 se não está adiada
+
+	// Pedido cuja latência está sendo medida
+	bool tem_pendente;
+	TipoMensagem pendente;
+	uint64_t enviado_em;
+
+	// Salas capturadas dos CRIAR_SALA em voo, na ordem de envio
+	uint32_t salas_esperadas[MAX_SALAS_ESPERADAS];
+	int num_salas_esperadas;
+
+	uint8_t entrada[TAMANHO_ENTRADA_CONEXAO];
+	size_t tamanho_entrada;
+	uint8_t saida[TAMANHO_SAIDA_CONEXAO];
+	size_t tamanho_saida;
+} Conexao;
+
+struct ThreadTrafego {
+	pthread_t thread;
+	int epoll_fd;
+	Copia* copias;
+	int num_copias;
+	Conexao* conexoes;
+	int num_conexoes;
+	Conexao** heap;
+	int tamanho_heap;
+	int ativas;  // Conexões com eventos por reproduzir
+	uint64_t inicio;
+	Histograma* latencias;
+
+	_Atomic uint64_t enviadas;
+	_Atomic uint64_t recebidas;
+	_Atomic uint64_t sem_resposta;
+	_Atomic uint64_t adiadas;
+	_Atomic uint64_t erros;
+};
+
+// Histograma de processar_mensagem lido de /metrics, por tipo
+typedef struct {
+	uint64_t baldes[NUM_LIMITES_SERVIDOR];  // Cumulativos, como no formato do Prometheus
+	double soma;
+	uint64_t total;
+} HistogramaServidor;
+
+static struct {
+	struct sockaddr_in endereco;
+	Sessao* sessoes;
+	int num_sessoes;
+	uint32_t capacidade_mapa;
+	double velocidade;  // 0 = sem esperas
+	int copias;
+	int num_threads;
+	int porta_metricas;
+} config;
+
+static uint64_t agora_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void contar(_Atomic uint64_t* contador) {
+	atomic_store_explicit(contador, atomic_load_explicit(contador, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+// Mapa de salas
+
+static uint32_t posicao_mapa(const Copia* copia, uint32_t capturada) {
+	return (uint32_t)(misturar_semente(capturada) & copia->mascara);
+}
+
+static void mapear_sala(Copia* copia, uint32_t capturada, uint32_t atual) {
+	uint32_t i = posicao_mapa(copia, capturada);
+	while (copia->entradas[i].capturada != 0 && copia->entradas[i].capturada != capturada) {
+		i = (i + 1) & copia->mascara;
+	}
+	copia->entradas[i].capturada = capturada;
+	copia->entradas[i].atual = atual;
+}
+
+static uint32_t traduzir_sala(const Copia* copia, uint32_t capturada) {
+	for (uint32_t i = posicao_mapa(copia, capturada); copia->entradas[i].capturada != 0;
+	     i = (i + 1) & copia->mascara) {
+		if (copia->entradas[i].capturada == capturada) return copia->entradas[i].atual;
+	}
+	return 0;
+}
+
+// Heap de timers
+
+static void trocar_heap(ThreadTrafego* t, int a, int b) {
+	Conexao* temp = t->heap[a];
+	t->heap[a] = t->heap[b];
+	t->heap[b] = temp;
+	t->heap[a]->posicao_heap = a;
+	t->heap[b]->posicao_heap = b;
+}
+
+static void subir_heap(ThreadTrafego* t, int i) {
+	while (i > 0 && t->heap[(i - 1) / 2]->prazo > t->heap[i]->prazo) {
+		trocar_heap(t, i, (i - 1) / 2);
+		i = (i - 1) / 2;
+	}
+}
+
+static void descer_heap(ThreadTrafego* t, int i) {
+	while (1) {
+		int menor = i;
+		int esquerda = 2 * i + 1, direita = 2 * i + 2;
+		if (esquerda < t->tamanho_heap && t->heap[esquerda]->prazo < t->heap[menor]->prazo) menor = esquerda;
+		if (direita < t->tamanho_heap && t->heap[direita]->prazo < t->heap[menor]->prazo) menor = direita;
+		if (menor == i) return;
+		trocar_heap(t, i, menor);
+		i = menor;
+	}
+}
+
+static void agendar(Conexao* conexao, uint64_t prazo) {
+	ThreadTrafego* t = conexao->thread;
+	conexao->prazo = prazo;
+	if (conexao->posicao_heap < 0) {
+		conexao->posicao_heap = t->tamanho_heap;
+		t->heap[t->tamanho_heap++] = conexao;
+	}
+	subir_heap(t, conexao->posicao_heap);
+	descer_heap(t, conexao->posicao_heap);
+}
+
+static void remover_do_heap(ThreadTrafego* t) {
+	Conexao* conexao = t->heap[0];
+	conexao->posicao_heap = -1;
+	t->tamanho_heap--;
+	if (t->tamanho_heap == 0) return;
+	t->heap[0] = t->heap[t->tamanho_heap];
+	t->heap[0]->posicao_heap = 0;
+	descer_heap(t, 0);
+}
+
+// Prazo do evento na escala de tempo escolhida
+static uint64_t prazo_evento(const ThreadTrafego* t, const EventoSessao* evento) {
+	if (config.velocidade <= 0) return t->inicio;
+	return t->inicio + (uint64_t)((double)evento->instante_us * 1000.0 / config.velocidade);
+}
+
+// Passa para o próximo evento da sessão, ou encerra a reprodução dela
+static void avancar(Conexao* conexao) {
+	conexao->proximo++;
+	conexao->adiada_desde = 0;
+	if (conexao->proximo < conexao->sessao->num_eventos) {
+		agendar(conexao, prazo_evento(conexao->thread, &conexao->sessao->eventos[conexao->proximo]));
+	} else {
+		conexao->concluida = true;
+		conexao->thread->ativas--;
+	}
+}
+
+// Rede
+
+static void fechar_conexao(Conexao* conexao) {
+	if (conexao->fd < 0) return;
+	close(conexao->fd);
+	conexao->fd = -1;
+	conexao->tem_pendente = false;
+	conexao->num_salas_esperadas = 0;
+	conexao->tamanho_entrada = 0;
+	conexao->tamanho_saida = 0;
+}
+
+static void descarregar_saida(Conexao* conexao) {
+	size_t enviados = 0;
+	while (enviados < conexao->tamanho_saida) {
+		ssize_t n = send(conexao->fd, conexao->saida + enviados, conexao->tamanho_saida - enviados, MSG_NOSIGNAL);
+		if (n > 0) {
+			enviados += (size_t)n;
+		} else if (n < 0 && errno == EINTR) {
+			continue;
+		} else {
+			if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+				contar(&conexao->thread->erros);
+				fechar_conexao(conexao);
+				return;
+			}
+			break;
+		}
+	}
+	memmove(conexao->saida, conexao->saida + enviados, conexao->tamanho_saida - enviados);
+	conexao->tamanho_saida -= enviados;
+}
+
+static bool abrir_conexao(Conexao* conexao) {
+	ThreadTrafego* t = conexao->thread;
+	int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if (fd < 0) return false;
+	int sim = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &sim, sizeof(sim));
+
+	if (connect(fd, (struct sockaddr*)&config.endereco, sizeof(config.endereco)) < 0 && errno != EINPROGRESS) {
+		close(fd);
+		return false;
+	}
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	ev.data.ptr = conexao;
+	if (epoll_ctl(t->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		close(fd);
+		return false;
+	}
+
+	conexao->fd = fd;
+	conexao->compacto = false;
+	conexao->tem_pendente = false;
+	conexao->num_salas_esperadas = 0;
+	conexao->tamanho_entrada = 0;
+	conexao->tamanho_saida = 0;
+	return true;
+}
+
+// Envia o quadro capturado; false se deve ser tentado de novo mais tarde
+static bool enviar_evento(Conexao* conexao, const EventoSessao* evento, uint64_t agora) {
+	Mensagem msg;
+	if (protocolo_decodificar(evento->quadro, evento->tamanho_quadro, &msg) <= 0) return true;
+
+	// A sala capturada ainda não foi criada nesta cópia: espera um pouco pelo CRIAR_SALA dela
+	if (msg.tipo == MSG_ENTRAR_SALA && msg.tamanho_dados >= sizeof(uint32_t)) {
+		uint32_t capturada;
+		memcpy(&capturada, msg.dados, sizeof(uint32_t));
+		uint32_t atual = traduzir_sala(conexao->copia, capturada);
+		if (atual == 0) {
+			if (conexao->adiada_desde == 0) {
+				conexao->adiada_desde = agora;
+				contar(&conexao->thread->adiadas);
+			}
+			if (agora - conexao->adiada_desde < ESPERA_SALA_NS) return false;
+		} else {
+			memcpy(msg.dados, &atual, sizeof(uint32_t));
+		}
+	}
+	uint32_t sala_atual = msg.sala_id ? traduzir_sala(conexao->copia, msg.sala_id) : 0;
+	msg.sala_id = sala_atual;
+
+	if (conexao->tamanho_saida + PROTOCOLO_TAMANHO_MAX_QUADRO > sizeof(conexao->saida)) return false;
+
+	// A negociação vai sempre no formato legado; depois vale o que a sessão pediu
+	if (msg.tipo == MSG_CONECTAR && msg.tamanho_dados >= sizeof(uint32_t)) {
+		uint32_t capacidades;
+		memcpy(&capacidades, msg.dados, sizeof(uint32_t));
+		conexao->tamanho_saida += protocolo_codificar(&msg, false, conexao->saida + conexao->tamanho_saida);
+		conexao->compacto = capacidades & CAP_QUADRO_COMPACTO;
+	} else {
+		conexao->tamanho_saida += protocolo_codificar(&msg, conexao->compacto, conexao->saida + conexao->tamanho_saida);
+	}
+
+	if (msg.tipo == MSG_CRIAR_SALA && conexao->num_salas_esperadas < MAX_SALAS_ESPERADAS) {
+		conexao->salas_esperadas[conexao->num_salas_esperadas++] = evento->sala_criada;
+	}
+
+	ThreadTrafego* t = conexao->thread;
+	contar(&t->enviadas);
+	if (conexao->tem_pendente) contar(&t->sem_resposta);
+	conexao->tem_pendente = true;
+	conexao->pendente = msg.tipo;
+	conexao->enviado_em = agora_ns();
+	descarregar_saida(conexao);
+	return true;
+}
+
+static void executar_evento(Conexao* conexao, uint64_t agora) {
+	const EventoSessao* evento = &conexao->sessao->eventos[conexao->proximo];
+
+	switch (evento->tipo) {
+		case CAPTURA_ABERTURA:
+			fechar_conexao(conexao);
+			if (!abrir_conexao(conexao)) contar(&conexao->thread->erros);
+			break;
+
+		case CAPTURA_MENSAGEM:
+			// Captura iniciada com a conexão já aberta
+			if (conexao->fd < 0 && !abrir_conexao(conexao)) {
+				contar(&conexao->thread->erros);
+				break;
+			}
+			if (!enviar_evento(conexao, evento, agora)) {
+				agendar(conexao, agora + NOVA_TENTATIVA_NS);
+				return;
+			}
+			break;
+
+		case CAPTURA_FECHAMENTO:
+			if (conexao->fd >= 0) descarregar_saida(conexao);
+			fechar_conexao(conexao);
+			break;
+
+		case CAPTURA_SALA:
+			break;
+	}
+	avancar(conexao);
+}
+
+static void processar_quadro(Conexao* conexao, const Mensagem* msg) {
+	ThreadTrafego* t = conexao->thread;
+	contar(&t->recebidas);
+
+	if (msg->tipo == MSG_CRIAR_SALA && conexao->num_salas_esperadas > 0) {
+		uint32_t capturada = conexao->salas_esperadas[0];
+		memmove(conexao->salas_esperadas, conexao->salas_esperadas + 1,
+		        (--conexao->num_salas_esperadas) * sizeof(uint32_t));
+		if (capturada != 0) mapear_sala(conexao->copia, capturada, msg->sala_id);
+	} else if (msg->tipo == MSG_ERRO && conexao->tem_pendente && conexao->pendente == MSG_CRIAR_SALA &&
+	           conexao->num_salas_esperadas > 0) {
+		conexao->num_salas_esperadas--;  // A sala não foi criada nesta cópia
+	}
+
+	// O MSG_CONECTAR inicial do servidor não responde a nenhum pedido
+	if (msg->tipo == MSG_CONECTAR && msg->tamanho_dados == 0) return;
+	if (conexao->tem_pendente) {
+		conexao->tem_pendente = false;
+		histograma_registrar(&t->latencias[conexao->pendente], (agora_ns() - conexao->enviado_em) / 1000);
+	}
+}
+
+static void ler_conexao(Conexao* conexao) {
+	while (conexao->fd >= 0) {
+		ssize_t n = recv(conexao->fd, conexao->entrada + conexao->tamanho_entrada,
+		                 sizeof(conexao->entrada) - conexao->tamanho_entrada, 0);
+		if (n == 0) {
+			fechar_conexao(conexao);
+			return;
+		}
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				contar(&conexao->thread->erros);
+				fechar_conexao(conexao);
+			}
+			return;
+		}
+		conexao->tamanho_entrada += (size_t)n;
+
+		size_t inicio = 0;
+		while (1) {
+			Mensagem msg;
+			int consumidos =
+			    protocolo_decodificar(conexao->entrada + inicio, conexao->tamanho_entrada - inicio, &msg);
+			if (consumidos < 0) {
+				contar(&conexao->thread->erros);
+				fechar_conexao(conexao);
+				return;
+			}
+			if (consumidos == 0) break;
+			inicio += (size_t)consumidos;
+			processar_quadro(conexao, &msg);
+		}
+		memmove(conexao->entrada, conexao->entrada + inicio, conexao->tamanho_entrada - inicio);
+		conexao->tamanho_entrada -= inicio;
+	}
+}
+
+static void* executar_thread_trafego(void* arg) {
+	ThreadTrafego* t = (ThreadTrafego*)arg;
+	struct epoll_event eventos[MAX_EVENTOS_EPOLL];
+	uint64_t fim = 0;
+
+	while (1) {
+		uint64_t agora = agora_ns();
+		while (t->tamanho_heap > 0 && t->heap[0]->prazo <= agora) {
+			Conexao* conexao = t->heap[0];
+			remover_do_heap(t);
+			executar_evento(conexao, agora);
+		}
+
+		// Depois do último evento ainda espera as respostas em voo
+		if (t->ativas == 0) {
+			if (fim == 0) fim = agora + DRENAGEM_NS;
+			if (agora >= fim) break;
+		}
+
+		int espera_ms = 100;
+		if (t->tamanho_heap > 0) {
+			uint64_t falta = t->heap[0]->prazo > agora ? t->heap[0]->prazo - agora : 0;
+			if (falta / 1000000 < (uint64_t)espera_ms) espera_ms = (int)((falta + 999999) / 1000000);
+		}
+
+		int n = epoll_wait(t->epoll_fd, eventos, MAX_EVENTOS_EPOLL, espera_ms);
+		for (int i = 0; i < n; i++) {
+			Conexao* conexao = (Conexao*)eventos[i].data.ptr;
+			if (conexao->fd < 0) continue;
+
+			if (eventos[i].events & (EPOLLERR | EPOLLHUP)) {
+				contar(&t->erros);
+				fechar_conexao(conexao);
+				continue;
+			}
+			if (eventos[i].events & EPOLLOUT && conexao->tamanho_saida > 0) descarregar_saida(conexao);
+			if (eventos[i].events & (EPOLLIN | EPOLLRDHUP)) ler_conexao(conexao);
+		}
+	}
+
+	for (int i = 0; i < t->num_conexoes; i++) fechar_conexao(&t->conexoes[i]);
+	return NULL;
+}
+
+// Carga da captura
+
+static uint8_t* ler_arquivo(const char* caminho, size_t* tamanho) {
+	FILE* arquivo = fopen(caminho, "rb");
+	if (!arquivo) return NULL;
+
+	uint8_t* dados = NULL;
+	if (fseek(arquivo, 0, SEEK_END) == 0) {
+		long fim = ftell(arquivo);
+		rewind(arquivo);
+		if (fim >= 0) {
+			dados = malloc(fim > 0 ? (size_t)fim : 1);
+			*tamanho = dados ? fread(dados, 1, (size_t)fim, arquivo) : 0;
+		}
+	}
+	fclose(arquivo);
+	return dados;
+}
+
+typedef struct {
+	RegistroCaptura registro;
+	uint32_t ordem;  // Posição no arquivo: desempate da ordenação
+} RegistroOrdenado;
+
+static int comparar_registros(const void* a, const void* b) {
+	const RegistroOrdenado* ra = a;
+	const RegistroOrdenado* rb = b;
+	if (ra->registro.conexao != rb->registro.conexao) return ra->registro.conexao < rb->registro.conexao ? -1 : 1;
+	return ra->ordem < rb->ordem ? -1 : ra->ordem > rb->ordem;
+}
+
+// Agrupa os registros por conexão; retorna o número de salas criadas na captura
+static int carregar_sessoes(const uint8_t* dados, size_t tamanho, uint32_t* salas_capturadas) {
+	size_t capacidade = 1024, num_registros = 0, posicao = 0;
+	RegistroOrdenado* registros = malloc(capacidade * sizeof(RegistroOrdenado));
+	if (!registros) return -1;
+
+	uint64_t primeiro_instante = UINT64_MAX;
+	int lido;
+	while (1) {
+		if (num_registros == capacidade) {
+			capacidade *= 2;
+			RegistroOrdenado* novos = realloc(registros, capacidade * sizeof(RegistroOrdenado));
+			if (!novos) {
+				free(registros);
+				return -1;
+			}
+			registros = novos;
+		}
+		lido = captura_proximo_registro(dados, tamanho, &posicao, &registros[num_registros].registro);
+		if (lido <= 0) break;
+		registros[num_registros].ordem = (uint32_t)num_registros;
+		if (registros[num_registros].registro.instante_us < primeiro_instante) {
+			primeiro_instante = registros[num_registros].registro.instante_us;
+		}
+		num_registros++;
+	}
+	if (lido < 0) fprintf(stderr, "Captura corrompida ou truncada na posição %zu; usando o que foi lido\n", posicao);
+	qsort(registros, num_registros, sizeof(RegistroOrdenado), comparar_registros);
+
+	config.sessoes = calloc(num_registros > 0 ? num_registros : 1, sizeof(Sessao));
+	EventoSessao* eventos = calloc(num_registros > 0 ? num_registros : 1, sizeof(EventoSessao));
+	if (!config.sessoes || !eventos) {
+		free(registros);
+		return -1;
+	}
+
+	*salas_capturadas = 0;
+	for (size_t i = 0; i < num_registros; i++) {
+		const RegistroCaptura* registro = &registros[i].registro;
+		if (i == 0 || registro->conexao != registros[i - 1].registro.conexao) {
+			Sessao* sessao = &config.sessoes[config.num_sessoes++];
+			sessao->conexao = registro->conexao;
+			sessao->eventos = &eventos[i];
+		}
+		Sessao* sessao = &config.sessoes[config.num_sessoes - 1];
+		EventoSessao* evento = &sessao->eventos[sessao->num_eventos++];
+		evento->instante_us = registro->instante_us - primeiro_instante;
+		evento->tipo = registro->tipo;
+
+		if (registro->tipo == CAPTURA_MENSAGEM) {
+			evento->tipo_msg = registro->msg.tipo;
+			evento->quadro = registro->quadro;
+			evento->tamanho_quadro = (uint32_t)registro->tamanho_quadro;
+		} else if (registro->tipo == CAPTURA_SALA) {
+			// Liga a sala ao CRIAR_SALA mais recente da sessão que ainda não tem uma
+			for (int j = (int)sessao->num_eventos - 2; j >= 0; j--) {
+				EventoSessao* anterior = &sessao->eventos[j];
+				if (anterior->tipo != CAPTURA_MENSAGEM || anterior->tipo_msg != MSG_CRIAR_SALA) continue;
+				if (anterior->sala_criada == 0) anterior->sala_criada = registro->sala_id;
+				break;
+			}
+			(*salas_capturadas)++;
+		}
+	}
+	free(registros);
+	return config.num_sessoes;
+}
+
+// Métricas do servidor
+
+static char* coletar_metricas(void) {
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0) return NULL;
+
+	struct sockaddr_in endereco;
+	memset(&endereco, 0, sizeof(endereco));
+	endereco.sin_family = AF_INET;
+	endereco.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	endereco.sin_port = htons(config.porta_metricas);
+	const char* pedido = "GET /metrics HTTP/1.0\r\n\r\n";
+	if (connect(fd, (struct sockaddr*)&endereco, sizeof(endereco)) < 0 || !send_all(fd, pedido, strlen(pedido))) {
+		close(fd);
+		return NULL;
+	}
+
+	size_t capacidade = 1 << 16, tamanho = 0;
+	char* resposta = malloc(capacidade);
+	while (resposta) {
+		if (tamanho + 1 == capacidade) {
+			char* nova = realloc(resposta, capacidade * 2);
+			if (!nova) break;
+			resposta = nova;
+			capacidade *= 2;
+		}
+		ssize_t n = recv(fd, resposta + tamanho, capacidade - tamanho - 1, 0);
+		if (n <= 0) break;
+		tamanho += (size_t)n;
+	}
+	close(fd);
+	if (resposta) resposta[tamanho] = '\0';
+	return resposta;
+}
+
+static int tipo_por_nome(const char* nome, size_t tamanho) {
+	for (int tipo = 0; tipo < NUM_TIPOS_MEDIDOS; tipo++) {
+		const char* candidato = tipo_mensagem_para_string((TipoMensagem)tipo);
+		if (strlen(candidato) == tamanho && strncmp(candidato, nome, tamanho) == 0) return tipo;
+	}
+	return -1;
+}
+
+// Extrai truco_processamento_segundos{tipo=...} da resposta de /metrics
+static bool ler_histogramas_servidor(HistogramaServidor* histogramas) {
+	memset(histogramas, 0, NUM_TIPOS_MEDIDOS * sizeof(HistogramaServidor));
+	char* texto = coletar_metricas();
+	if (!texto) return false;
+
+	const char* prefixo = "truco_processamento_segundos_";
+	for (char* linha = strtok(texto, "\n"); linha; linha = strtok(NULL, "\n")) {
+		if (strncmp(linha, prefixo, strlen(prefixo)) != 0) continue;
+		char* sufixo = linha + strlen(prefixo);
+		char* tipo_inicio = strstr(linha, "tipo=\"");
+		char* valor = strrchr(linha, ' ');
+		if (!tipo_inicio || !valor) continue;
+		tipo_inicio += 6;
+		char* tipo_fim = strchr(tipo_inicio, '"');
+		int tipo = tipo_fim ? tipo_por_nome(tipo_inicio, (size_t)(tipo_fim - tipo_inicio)) : -1;
+		if (tipo < 0) continue;
+
+		HistogramaServidor* h = &histogramas[tipo];
+		if (strncmp(sufixo, "bucket", 6) == 0) {
+			char* le = strstr(tipo_fim, "le=\"");
+			if (!le) continue;
+			le += 4;
+			int indice = NUM_LIMITES_SERVIDOR - 1;  // +Inf
+			if (*le != '+') {
+				double limite = strtod(le, NULL) * 1e9;
+				for (indice = 0; indice < NUM_LIMITES_SERVIDOR - 2 && (double)(1ull << (10 + indice)) < limite * 0.999;
+				     indice++) {
+				}
+			}
+			h->baldes[indice] = strtoull(valor + 1, NULL, 10);
+		} else if (strncmp(sufixo, "sum", 3) == 0) {
+			h->soma = strtod(valor + 1, NULL);
+		} else if (strncmp(sufixo, "count", 5) == 0) {
+			h->total = strtoull(valor + 1, NULL, 10);
+		}
+	}
+	free(texto);
+	return true;
+}
+
+// Limite superior (µs) do balde onde a contagem cumulativa alcança o percentil
+static double percentil_servidor(const uint64_t* baldes, uint64_t total, double percentil) {
+	uint64_t alvo = (uint64_t)(total * percentil / 100.0 + 0.5);
+	if (alvo == 0) alvo = 1;
+	for (int i = 0; i < NUM_LIMITES_SERVIDOR - 1; i++) {
+		if (baldes[i] >= alvo) return (double)(1ull << (10 + i)) / 1000.0;
+	}
+	return (double)(1ull << (10 + NUM_LIMITES_SERVIDOR - 2)) / 1000.0;
+}
+
+static void imprimir_latencia_servidor(const HistogramaServidor* antes, const HistogramaServidor* depois) {
+	printf("\nLatência no servidor (processar_mensagem, µs; p50/p99 pelo limite do balde):\n");
+	printf("%-18s %10s %10s %10s %10s\n", "mensagem", "amostras", "média", "p50", "p99");
+	for (int tipo = 0; tipo < NUM_TIPOS_MEDIDOS; tipo++) {
+		uint64_t total = depois[tipo].total - antes[tipo].total;
+		if (total == 0) continue;
+		uint64_t baldes[NUM_LIMITES_SERVIDOR];
+		for (int i = 0; i < NUM_LIMITES_SERVIDOR; i++) baldes[i] = depois[tipo].baldes[i] - antes[tipo].baldes[i];
+		printf("%-18s %10llu %10.1f %10.0f %10.0f\n", tipo_mensagem_para_string((TipoMensagem)tipo),
+		       (unsigned long long)total, (depois[tipo].soma - antes[tipo].soma) * 1e6 / total,
+		       percentil_servidor(baldes, total, 50), percentil_servidor(baldes, total, 99));
+	}
+}
+
+static void imprimir_relatorio(ThreadTrafego* threads, double segundos) {
+	Histograma* total = calloc(NUM_TIPOS_MEDIDOS, sizeof(Histograma));
+	if (!total) return;
+
+	uint64_t enviadas = 0, recebidas = 0, sem_resposta = 0, adiadas = 0, erros = 0;
+	for (int i = 0; i < config.num_threads; i++) {
+		for (int tipo = 0; tipo < NUM_TIPOS_MEDIDOS; tipo++) histograma_somar(&total[tipo], &threads[i].latencias[tipo]);
+		enviadas += threads[i].enviadas;
+		recebidas += threads[i].recebidas;
+		sem_resposta += threads[i].sem_resposta;
+		adiadas += threads[i].adiadas;
+		erros += threads[i].erros;
+	}
+
+	printf("\nLatência vista pelo cliente, do envio ao próximo quadro da conexão (µs):\n");
+	printf("%-18s %10s %10s %10s %10s %10s %10s\n", "pedido", "amostras", "média", "p50", "p99", "p999", "máx");
+	for (int tipo = 0; tipo < NUM_TIPOS_MEDIDOS; tipo++) {
+		Histograma* h = &total[tipo];
+		if (h->total == 0) continue;
+		printf("%-18s %10llu %10.0f %10llu %10llu %10llu %10llu\n", tipo_mensagem_para_string((TipoMensagem)tipo),
+		       (unsigned long long)h->total, histograma_media(h), (unsigned long long)histograma_percentil(h, 50),
+		       (unsigned long long)histograma_percentil(h, 99), (unsigned long long)histograma_percentil(h, 99.9),
+		       (unsigned long long)h->maximo);
+	}
+
+	printf("\nEm %.2f s: %llu mensagens enviadas (%.0f/s), %llu recebidas (%.0f/s)\n", segundos,
+	       (unsigned long long)enviadas, enviadas / segundos, (unsigned long long)recebidas, recebidas / segundos);
+	printf("Sem resposta antes do envio seguinte: %llu, ENTRAR_SALA adiados: %llu, erros: %llu\n",
+	       (unsigned long long)sem_resposta, (unsigned long long)adiadas, (unsigned long long)erros);
+	free(total);
+}
+
+// Milhares de conexões precisam de mais descritores que o limite padrão
+static void aumentar_limite_descritores(void) {
+	struct rlimit limite;
+	if (getrlimit(RLIMIT_NOFILE, &limite) == 0 && limite.rlim_cur < limite.rlim_max) {
+		limite.rlim_cur = limite.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limite);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	const char* ip = "127.0.0.1";
+	const char* caminho = NULL;
+	int porta = PORTA_PADRAO;
+	config.velocidade = 1;
+	config.copias = 1;
+	config.num_threads = 1;
+
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--servidor=", 11) == 0) {
+			ip = argv[i] + 11;
+		} else if (strncmp(argv[i], "--porta=", 8) == 0) {
+			porta = atoi(argv[i] + 8);
+		} else if (strncmp(argv[i], "--velocidade=", 13) == 0) {
+			// --velocidade=max (ou 0) envia sem esperar a cadência capturada
+			config.velocidade = strcmp(argv[i] + 13, "max") == 0 ? 0 : atof(argv[i] + 13);
+		} else if (strncmp(argv[i], "--copias=", 9) == 0) {
+			config.copias = atoi(argv[i] + 9);
+		} else if (strncmp(argv[i], "--threads=", 10) == 0) {
+			// --threads=0 usa uma thread por núcleo
+			config.num_threads = atoi(argv[i] + 10);
+			if (config.num_threads <= 0) config.num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+		} else if (strncmp(argv[i], "--metricas=", 11) == 0) {
+			config.porta_metricas = atoi(argv[i] + 11);
+		} else if (argv[i][0] != '-' && !caminho) {
+			caminho = argv[i];
+		} else {
+			caminho = NULL;
+			break;
+		}
+	}
+	if (!caminho) {
+		fprintf(stderr,
+		        "Uso: %s ARQUIVO [--servidor=IP] [--porta=N] [--velocidade=X|max] [--copias=N] [--threads=N] "
+		        "[--metricas=PORTA]\n",
+		        argv[0]);
+		return 1;
+	}
+	if (config.velocidade < 0) config.velocidade = 0;
+	if (config.copias < 1) config.copias = 1;
+	if (config.num_threads > config.copias) config.num_threads = config.copias;
+
+	memset(&config.endereco, 0, sizeof(config.endereco));
+	config.endereco.sin_family = AF_INET;
+	config.endereco.sin_port = htons(porta);
+	if (inet_pton(AF_INET, ip, &config.endereco.sin_addr) <= 0) {
+		fprintf(stderr, "Endereço inválido: %s\n", ip);
+		return 1;
+	}
+
+	size_t tamanho = 0;
+	uint8_t* dados = ler_arquivo(caminho, &tamanho);
+	if (!dados) {
+		perror(caminho);
+		return 1;
+	}
+	uint32_t salas_capturadas = 0;
+	if (carregar_sessoes(dados, tamanho, &salas_capturadas) <= 0) {
+		fprintf(stderr, "Nenhuma sessão em %s\n", caminho);
+		return 1;
+	}
+	config.capacidade_mapa = 16;
+	while (config.capacidade_mapa < 2 * salas_capturadas) config.capacidade_mapa *= 2;
+	aumentar_limite_descritores();
+
+	char velocidade[32];
+	if (config.velocidade > 0) {
+		snprintf(velocidade, sizeof(velocidade), "%gx", config.velocidade);
+	} else {
+		snprintf(velocidade, sizeof(velocidade), "max");
+	}
+	printf("Reproduzindo %d sessões (%u salas) de %s em %s:%d: %d cópia(s), %d thread(s), velocidade %s\n",
+	       config.num_sessoes, salas_capturadas, caminho, ip, porta, config.copias, config.num_threads, velocidade);
+
+	HistogramaServidor* antes = NULL;
+	HistogramaServidor* depois = NULL;
+	if (config.porta_metricas > 0) {
+		antes = calloc(NUM_TIPOS_MEDIDOS, sizeof(HistogramaServidor));
+		depois = calloc(NUM_TIPOS_MEDIDOS, sizeof(HistogramaServidor));
+		if (!antes || !depois || !ler_histogramas_servidor(antes)) {
+			fprintf(stderr, "Não foi possível ler as métricas em 127.0.0.1:%d\n", config.porta_metricas);
+			return 1;
+		}
+	}
+
+	ThreadTrafego* threads = calloc(config.num_threads, sizeof(ThreadTrafego));
+	if (!threads) return 1;
+
+	uint64_t inicio = agora_ns();
+	for (int i = 0; i < config.num_threads; i++) {
+		ThreadTrafego* t = &threads[i];
+		t->num_copias = config.copias / config.num_threads + (i < config.copias % config.num_threads);
+		t->num_conexoes = t->num_copias * config.num_sessoes;
+		t->copias = calloc(t->num_copias, sizeof(Copia));
+		t->conexoes = calloc(t->num_conexoes, sizeof(Conexao));
+		t->heap = calloc(t->num_conexoes, sizeof(Conexao*));
+		t->latencias = calloc(NUM_TIPOS_MEDIDOS, sizeof(Histograma));
+		t->epoll_fd = epoll_create1(0);
+		if (!t->copias || !t->conexoes || !t->heap || !t->latencias || t->epoll_fd < 0) {
+			perror("Erro ao preparar thread de reprodução");
+			return 1;
+		}
+		t->inicio = inicio;
+
+		for (int c = 0; c < t->num_copias; c++) {
+			Copia* copia = &t->copias[c];
+			copia->mascara = config.capacidade_mapa - 1;
+			copia->entradas = calloc(config.capacidade_mapa, sizeof(EntradaMapaSalas));
+			if (!copia->entradas) return 1;
+
+			for (int s = 0; s < config.num_sessoes; s++) {
+				Conexao* conexao = &t->conexoes[c * config.num_sessoes + s];
+				conexao->thread = t;
+				conexao->copia = copia;
+				conexao->sessao = &config.sessoes[s];
+				conexao->fd = -1;
+				conexao->posicao_heap = -1;
+				t->ativas++;
+				agendar(conexao, prazo_evento(t, &conexao->sessao->eventos[0]));
+			}
+		}
+	}
+	for (int i = 0; i < config.num_threads; i++) {
+		pthread_create(&threads[i].thread, NULL, executar_thread_trafego, &threads[i]);
+	}
+	for (int i = 0; i < config.num_threads; i++) pthread_join(threads[i].thread, NULL);
+
+	imprimir_relatorio(threads, (agora_ns() - inicio) / 1e9);
+	if (antes && ler_histogramas_servidor(depois)) imprimir_latencia_servidor(antes, depois);
+
+	free(antes);
+	free(depois);
+	free(dados);
+	return 0;
+}
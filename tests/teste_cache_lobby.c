@@ -0,0 +1,129 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "cache_lobby.h"
+#include "protocolo.h"
+
+// Estresse do cache do lobby: leitores pedem páginas sem parar enquanto
+// escritores mudam o diretório, o que força recodificações e publicações de
+// conjuntos novos a todo momento. O cache é compilado com sched_yield() nos
+// pontos de corrida da aquisição (CACHE_LOBBY_PONTO_DE_CORRIDA), então um
+// leitor para com frequência bem no meio dela. Cada quadro recebido é
+// decodificado e cada sala conferida contra o nome derivado do id; um
+// conjunto solto com leitor dentro aparece como quadro corrompido ou, com
+// -fsanitize=address, como use-after-free:
+//
+//   make clean && make teste CC="gcc -fsanitize=address"
+
+#define NUM_LEITORES 6
+#define NUM_ESCRITORES 2
+#define NUM_SLOTS 256
+#define DURACAO_S 2
+
+static DiretorioSalas diretorio;
+static CacheLobby cache;
+static _Atomic bool parar;
+static _Atomic uint64_t falhas;
+static uint64_t pedidos[NUM_LEITORES];
+
+static void nome_da_sala(uint32_t id, char* nome, size_t tamanho) {
+	snprintf(nome, tamanho, "sala-%u-%u", id, id * 2654435761u);
+}
+
+static void* escritor(void* arg) {
+	uint32_t estado = (uint32_t)(uintptr_t)arg * 7919 + 1;
+	uint32_t geracao = 0;
+	while (!atomic_load_explicit(&parar, memory_order_relaxed)) {
+		estado = estado * 1103515245 + 12345;
+		uint32_t slot = (estado >> 8) % NUM_SLOTS;
+		if ((estado >> 24) % 4 == 0) {
+			diretorio_remover(&diretorio, slot);
+			continue;
+		}
+
+		InfoSala info;
+		memset(&info, 0, sizeof(InfoSala));
+		info.id = (++geracao << 16) | slot;
+		nome_da_sala(info.id, info.nome, sizeof(info.nome));
+		info.num_jogadores = 1 + (estado >> 4) % 2;
+		info.max_jogadores = 2;
+		info.em_partida = info.num_jogadores == 2;
+		diretorio_publicar(&diretorio, slot, &info);
+
+		// Uma mudança a cada poucos microssegundos: os leitores alternam entre
+		// acertos sem lock e faltas que publicam conjuntos novos
+		if (geracao % 8 == 0) {
+			struct timespec pausa = {.tv_sec = 0, .tv_nsec = 2000};
+			nanosleep(&pausa, NULL);
+		}
+	}
+	return NULL;
+}
+
+static bool conferir_quadro(const BufferCompartilhado* quadro) {
+	Mensagem msg;
+	if (protocolo_decodificar(quadro->dados, quadro->tamanho, &msg) != (int)quadro->tamanho) return false;
+	if (msg.tipo != MSG_LISTAR_SALAS || msg.tamanho_dados % sizeof(InfoSala) != 0) return false;
+
+	InfoSala salas[sizeof(msg.dados) / sizeof(InfoSala)];
+	memcpy(salas, msg.dados, msg.tamanho_dados);
+	for (size_t i = 0; i < msg.tamanho_dados / sizeof(InfoSala); i++) {
+		char esperado[sizeof(salas[i].nome)];
+		nome_da_sala(salas[i].id, esperado, sizeof(esperado));
+		if (strcmp(salas[i].nome, esperado) != 0 || salas[i].max_jogadores != 2) return false;
+	}
+	return true;
+}
+
+static void* leitor(void* arg) {
+	int indice = (int)(uintptr_t)arg;
+	uint64_t n = (uint64_t)indice;
+	while (!atomic_load_explicit(&parar, memory_order_relaxed)) {
+		PedidoListaSalas pedido;
+		memset(&pedido, 0, sizeof(PedidoListaSalas));
+		pedido.cursor = (uint32_t)(n % 4) * (NUM_SLOTS / 4);
+		pedido.apenas_abertas = (n / 4) % 2;
+		bool compacto = (n / 8) % 2;
+
+		BufferCompartilhado* quadro = cache_lobby_obter(&cache, &diretorio, &pedido, compacto);
+		if (!quadro || atomic_load(&quadro->referencias) < 1 || !conferir_quadro(quadro)) {
+			atomic_fetch_add(&falhas, 1);
+		}
+		if (quadro) buffer_compartilhado_liberar(quadro);
+		n++;
+		pedidos[indice]++;
+	}
+	return NULL;
+}
+
+int main(void) {
+	if (!diretorio_inicializar(&diretorio, NUM_SLOTS)) {
+		fprintf(stderr, "Sem memória para o diretório\n");
+		return 1;
+	}
+	cache_lobby_inicializar(&cache);
+
+	pthread_t leitores[NUM_LEITORES];
+	pthread_t escritores[NUM_ESCRITORES];
+	for (int i = 0; i < NUM_LEITORES; i++) pthread_create(&leitores[i], NULL, leitor, (void*)(uintptr_t)i);
+	for (int i = 0; i < NUM_ESCRITORES; i++) pthread_create(&escritores[i], NULL, escritor, (void*)(uintptr_t)i);
+
+	struct timespec espera = {.tv_sec = DURACAO_S, .tv_nsec = 0};
+	nanosleep(&espera, NULL);
+	atomic_store(&parar, true);
+
+	uint64_t total = 0;
+	for (int i = 0; i < NUM_LEITORES; i++) {
+		pthread_join(leitores[i], NULL);
+		total += pedidos[i];
+	}
+	for (int i = 0; i < NUM_ESCRITORES; i++) pthread_join(escritores[i], NULL);
+
+	uint64_t num_falhas = atomic_load(&falhas);
+	printf("cache_lobby: %llu pedidos, %llu quadros inválidos\n", (unsigned long long)total,
+	       (unsigned long long)num_falhas);
+	return num_falhas == 0 ? 0 : 1;
+}
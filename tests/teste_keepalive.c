@@ -0,0 +1,42 @@
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "keepalive.h"
+
+// Parâmetros do keepalive do TCP: o kernel precisa desistir exatamente no
+// timeout de ociosidade, com o tempo ocioso dominando (sem sondas a cada
+// segundo em conexões paradas)
+
+static int falhas = 0;
+
+static void conferir(const char* caso, uint64_t timeout_ms, uint64_t ping_ms) {
+	ParametrosKeepalive p = keepalive_calcular(timeout_ms, ping_ms);
+	int total = p.ocioso + p.tentativas * p.intervalo;
+	int esperado = (int)((timeout_ms + 999) / 1000);
+	bool ok = total == esperado && p.ocioso >= p.tentativas * p.intervalo && p.intervalo >= 1 &&
+	          p.intervalo <= (int)((ping_ms + 999) / 1000) && p.tentativas == KEEPALIVE_TENTATIVAS;
+	printf("keepalive %-22s KEEPIDLE=%d KEEPINTVL=%d KEEPCNT=%d (%d s) %s\n", caso, p.ocioso, p.intervalo,
+	       p.tentativas, total, ok ? "ok" : "FALHOU");
+	if (!ok) falhas++;
+}
+
+int main(void) {
+	ParametrosKeepalive padrao = keepalive_calcular(TIMEOUT_OCIOSO_PADRAO_MS, INTERVALO_PING_PADRAO_MS);
+	if (padrao.ocioso <= 1) {
+		printf("keepalive padrão: KEEPIDLE=%d, sondas desde o primeiro segundo ocioso\n", padrao.ocioso);
+		falhas++;
+	}
+	conferir("padrão", TIMEOUT_OCIOSO_PADRAO_MS, INTERVALO_PING_PADRAO_MS);
+	conferir("heartbeat 10 s", 30000, 10000);
+	conferir("timeout 120 s", 120000, INTERVALO_PING_PADRAO_MS);
+	conferir("timeout 600 s", 600000, 5000);
+	conferir("timeout 20 s", 20000, 60000);
+
+	// Abaixo de 6 s não cabe metade em sondas de 1 s: vale o mínimo de cada parte
+	ParametrosKeepalive curto = keepalive_calcular(2000, 1000);
+	if (curto.ocioso < 1 || curto.intervalo < 1) {
+		printf("keepalive timeout 2 s: KEEPIDLE=%d KEEPINTVL=%d abaixo de 1 s\n", curto.ocioso, curto.intervalo);
+		falhas++;
+	}
+	return falhas == 0 ? 0 : 1;
+}